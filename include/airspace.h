@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include "asset_store.h"
+#include "gps_fix.h"
+
+// Airspace warnings from a read-only store in its own partition, compiled
+// from OpenAir by tools/airspace.py. Arcs are turned into polygon vertices by
+// the tool; circles stay circles.
+//
+// Layout, little-endian: header, area records, int32 vertices, then a uniform
+// grid whose cells list every area whose bounding box, grown by the warning
+// margin, touches the cell, then NUL-terminated names. Per fix only the
+// areas listed in the cell under the aircraft are looked at: a bounding-box
+// test first, then point-in-polygon and distance to the nearest edge in a
+// local flat projection, all in float.
+//
+// Each evaluation tests at most AIRSPACE_VERTEX_BUDGET vertices and continues
+// with the remaining areas on the next fix, so the cost per fix is bounded
+// however dense the airspace. The compiler keeps every area within the budget
+// and airspaceBegin() rejects a store that doesn't. A warning that gets worse
+// is raised at once; one that eases is only cleared when a full pass over the
+// cell agrees.
+#define AIRSPACE_PARTITION "airspace"
+#define AIRSPACE_MAGIC 0x53524941 // "AIRS"
+#define AIRSPACE_VERSION 1
+
+#define AIRSPACE_NEAR_HORIZONTAL_M 1000.0f // Warn this close to the lateral boundary...
+#define AIRSPACE_NEAR_VERTICAL_M 100.0f    // ...or this close below the floor / above the ceiling
+#define AIRSPACE_VERTEX_BUDGET 2048        // Edges tested per fix at most, and per area
+
+#define AIRSPACE_FLAG_CIRCLE 0x01
+#define AIRSPACE_FLAG_FLOOR_AGL 0x02
+#define AIRSPACE_FLAG_CEILING_AGL 0x04
+
+#define AIRSPACE_LEVEL_NONE 0
+#define AIRSPACE_LEVEL_NEAR 1
+#define AIRSPACE_LEVEL_INSIDE 2
+
+struct __attribute__((packed)) AirspaceHeader {
+  AssetHeader asset;
+  uint32_t areaCount;
+  uint32_t vertexCount;
+  int32_t originLat;       // South-west corner of the grid, 1e-7 degrees
+  int32_t originLon;
+  int32_t cellSize;        // Cell edge, 1e-7 degrees
+  uint16_t cols;
+  uint16_t rows;
+  uint32_t marginMeters;   // Bounding boxes were grown by this much when filling the grid
+  uint32_t areasOffset;    // areaCount AirspaceArea
+  uint32_t verticesOffset; // vertexCount NavPoint
+  uint32_t cellsOffset;    // cols * rows + 1 uint32 start indices into the cell list
+  uint32_t cellListOffset; // uint16 area indices
+  uint32_t cellListCount;
+  uint32_t namesOffset;
+  uint32_t namesSize;
+};
+
+struct __attribute__((packed)) AirspaceArea {
+  int32_t minLat, minLon, maxLat, maxLon; // Bounding box, 1e-7 degrees
+  uint32_t firstVertex;
+  uint16_t vertexCount;   // Polygon vertices; a circle has one, its centre
+  uint8_t airspaceClass;  // Letter of the OpenAir AC line, e.g. 'C', 'R', 'P'; 'T' for CTR
+  uint8_t flags;          // AIRSPACE_FLAG_*
+  int16_t floorMeters;    // MSL, or above ground with AIRSPACE_FLAG_FLOOR_AGL
+  int16_t ceilingMeters;  // MSL, or above ground with AIRSPACE_FLAG_CEILING_AGL
+  uint32_t radiusMeters;  // Circles only
+  uint32_t nameOffset;
+};
+
+static_assert(sizeof(AirspaceHeader) == 72, "Header layout is shared with the compiler");
+static_assert(sizeof(AirspaceArea) == 36, "Area layout is shared with the compiler");
+
+struct AirspaceStatus {
+  uint8_t level;          // AIRSPACE_LEVEL_*
+  uint32_t area;          // Area causing the warning, if any
+  float horizontalMeters; // To the lateral boundary, 0 when inside it
+  float verticalMeters;   // To the floor or ceiling, 0 when between them
+};
+
+struct AirspaceStats {
+  uint32_t lastMicros;    // Duration of the last evaluation
+  uint32_t maxMicros;
+  uint32_t deferredPasses; // Evaluations that hit the vertex budget
+  uint32_t lastVertices;   // Tested by the last evaluation
+};
+
+// Map the store and check it. False if it is missing or corrupt.
+bool airspaceBegin();
+uint32_t airspaceCount();
+// Evaluate at a fix. groundMeters is the terrain elevation MSL, NAN if unknown,
+// in which case limits above ground are taken as above sea level.
+const AirspaceStatus &airspaceEvaluate(const GpsFix &fix, float groundMeters);
+const AirspaceStatus &airspaceStatus();
+AirspaceStats airspaceStats();
+const AirspaceArea *airspaceArea(uint32_t index);
+const char *airspaceName(uint32_t index);
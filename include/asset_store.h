@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Zero-copy access to large read-only assets (waypoints, airspace, terrain,
+// fonts, bitmaps) kept in their own data partitions. Every image starts with
+// an AssetHeader; assetOpen() checks it and the CRC once and then maps the
+// whole image, so readers index straight into flash through the cache.
+//
+// Readers never cast raw pointers themselves: they take typed views of parts
+// of the image, and a view is only handed out if it lies inside the image.
+//
+// On the ESP32 the image is the partition with the given label, mapped with
+// esp_partition_mmap. In a host build the same image file, <label>.bin in the
+// directory set with assetSetHostDirectory(), is mapped with mmap, so the
+// readers can be run against the files the host tools produce.
+#define ASSET_SUBTYPE_WAYPOINTS 0x41
+#define ASSET_SUBTYPE_AIRSPACE 0x42
+#define ASSET_SUBTYPE_TERRAIN 0x43
+
+#define ASSET_SLOTS 2 // For assets replaced while in use, see assetWriteBegin()
+
+struct __attribute__((packed)) AssetHeader {
+  uint32_t magic;      // Identifies the kind of asset
+  uint16_t version;    // Of that asset's layout
+  uint16_t headerSize; // Asset-specific header, this one included
+  uint32_t totalSize;  // Whole image, header included
+  uint32_t crc;        // CRC-32 of everything after the header, up to totalSize
+};
+
+static_assert(sizeof(AssetHeader) == 16, "Asset header layout is shared with the host tools");
+
+struct AssetImage {
+  const uint8_t *base; // nullptr while not open
+  uint32_t size;       // totalSize from the header
+  uint8_t slot;        // Which of the labels given to assetOpenSlots() it came from
+  uint32_t generation; // From the slot trailer, 0 without one
+  uint32_t mapHandle;
+  size_t mapLength;
+};
+
+template <typename T>
+struct AssetArray {
+  const T *data;
+  uint32_t count;
+  const T *at(uint32_t index) const { return index < count ? &data[index] : nullptr; }
+  const T &operator[](uint32_t index) const { return data[index]; } // For indices already checked against count
+};
+
+// Table of NUL-terminated strings; the last byte is always a NUL
+struct AssetStrings {
+  const char *data;
+  uint32_t size;
+  const char *at(uint32_t offset) const { return offset < size ? data + offset : ""; }
+};
+
+// Map the image and check magic, version and CRC. False if it is missing or corrupt.
+bool assetOpen(const char *label, uint8_t subtype, uint32_t magic, uint16_t version, AssetImage &image);
+// Open the newest image of an asset kept in two slots, falling back to the
+// other slot if the newest doesn't check out
+bool assetOpenSlots(const char *const labels[ASSET_SLOTS], uint8_t subtype, uint32_t magic, uint16_t version,
+                    AssetImage &image);
+void assetClose(AssetImage &image);
+#ifndef ESP_PLATFORM
+void assetSetHostDirectory(const char *directory);
+#endif
+
+// Writing a new image over a partition, e.g. from a BLE upload. The old
+// image stops opening as soon as the write begins: its first sector is
+// erased and the AssetHeader of the new one is held back in RAM. Data can
+// be written in any order; sectors are erased as writes first reach them.
+// assetWriteCommit() writes the header last, so a write cut short by an
+// abort or power loss never leaves a half image that opens.
+//
+// An asset that is replaced while in use, like the waypoint database, has
+// two slots: the new image is written to the slot not in use while readers
+// keep the old one open. Each image written here is followed, at the next
+// 4-byte boundary, by an AssetSlotTrailer with a generation one past the one
+// it replaces, written just before the header; assetOpenSlots() opens the
+// highest generation. An image flashed by the host tools has no trailer and
+// counts as generation 0.
+#define ASSET_SECTOR_SIZE 4096
+#define ASSET_SLOT_MAGIC 0x544F4C53 // "SLOT"
+
+struct __attribute__((packed)) AssetSlotTrailer {
+  uint32_t magic;
+  uint32_t generation;
+  uint32_t crc; // The header's, so a trailer left over from an older image doesn't count
+};
+
+struct AssetWriter {
+  bool active;       // A write is in progress
+  uint32_t size;     // Of the new image
+  uint32_t erasedTo; // Sectors below this offset are erased
+  uint32_t generation;
+  uint8_t header[sizeof(AssetHeader)];
+#ifdef ESP_PLATFORM
+  const void *partition;
+#else
+  int fd;
+#endif
+};
+
+// Start a write of size bytes. False if there is no such partition or the image and its trailer don't fit.
+bool assetWriteBegin(const char *label, uint8_t subtype, uint32_t size, uint32_t generation, AssetWriter &writer);
+bool assetWrite(AssetWriter &writer, uint32_t offset, const uint8_t *data, size_t length);
+// CRC-32 of the whole new image as stored, header included. False if it can't be read back.
+bool assetWriteCrc(const AssetWriter &writer, uint32_t &crc);
+// Write the trailer, then the held-back header, making the image visible to assetOpen()
+bool assetWriteCommit(AssetWriter &writer);
+// Give up; the partition is left without an image
+void assetWriteAbort(AssetWriter &writer);
+
+inline bool assetFits(const AssetImage &image, uint32_t offset, uint64_t length) {
+  return image.base && (uint64_t)offset + length <= image.size;
+}
+
+// The asset-specific header, if the image has one at least that large
+template <typename H>
+const H *assetHeader(const AssetImage &image) {
+  if (!image.base || ((const AssetHeader *)image.base)->headerSize < sizeof(H)) {
+    return nullptr;
+  }
+  return (const H *)image.base;
+}
+
+template <typename T>
+bool assetArray(const AssetImage &image, uint32_t offset, uint32_t count, AssetArray<T> &view) {
+  if (!assetFits(image, offset, (uint64_t)count * sizeof(T)) || offset % alignof(T)) {
+    return false;
+  }
+  view.data = (const T *)(image.base + offset);
+  view.count = count;
+  return true;
+}
+
+inline bool assetStrings(const AssetImage &image, uint32_t offset, uint32_t size, AssetStrings &view) {
+  if (size == 0 || !assetFits(image, offset, size) || image.base[offset + size - 1] != '\0') {
+    return false;
+  }
+  view.data = (const char *)(image.base + offset);
+  view.size = size;
+  return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Parser for the text commands written by the phone app. One pass over the
+// NUL-terminated command splits it into ':'-separated fields, the first field
+// is looked up in a sorted keyword table, and the rest are converted to the
+// types that verb's table entry lists. Nothing is allocated and numbers are
+// read without strtod/sscanf. A command starting with a number is the legacy
+// <lat>:<lon>:<enabled> POI form.
+//
+// Decimals take the forms JavaScript prints numbers in, exponents included.
+// NaN and Infinity, which the app sends for an empty coordinate box, parse as
+// NAN: the value isn't set. Integers must be plain digits.
+//
+//   POI:<index>:<lat>:<lon>:<enabled>
+//   <lat>:<lon>:<enabled>
+//   GET_DATA
+//   FUEL:<level>:<rate>[:<added>]
+//   MODE:<mode>
+//   STREAM:<hz>
+#define BLE_COMMAND_MAX_ARGS 4
+
+#define BLE_VERB_NONE 0
+#define BLE_VERB_POI 1
+#define BLE_VERB_LEGACY_POI 2
+#define BLE_VERB_GET_DATA 3
+#define BLE_VERB_FUEL 4
+#define BLE_VERB_MODE 5
+#define BLE_VERB_STREAM 6
+
+#define BLE_PARSE_OK 0
+#define BLE_PARSE_UNKNOWN 1 // No such verb
+#define BLE_PARSE_ARGS 2    // Wrong number of arguments
+#define BLE_PARSE_NUMBER 3  // An argument isn't a number of the right kind
+#define BLE_PARSE_RANGE 4   // A coordinate out of range
+
+union BleArg {
+  int32_t integer;
+  double decimal;
+};
+
+struct BleCommand {
+  uint8_t verb;     // BLE_VERB_*
+  uint8_t argCount; // Optional arguments may be missing
+  BleArg args[BLE_COMMAND_MAX_ARGS];
+  const char *usage; // Expected form of the verb, for error messages
+};
+
+// Returns a BLE_PARSE_*. verb and usage are set whenever the verb was recognised.
+uint8_t bleCommandParse(const char *text, BleCommand &command);
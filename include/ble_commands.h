@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Commands written to the receive characteristic, handed from the BLE task
+// to the application task. The write callback only copies the payload into
+// a lock-free SpscRing and returns; handling (settings writes, display
+// redraws) happens when loop() drains the queue.
+#define BLE_COMMAND_MAX_LENGTH 96 // Longest accepted command, NUL not included
+#define BLE_COMMAND_SLOTS 8       // Power of two
+#define BLE_COMMAND_BUDGET_MS 20  // Drain no further in one loop() pass once this is spent
+
+struct BleCommandStats {
+  uint32_t received;  // Queued since boot
+  uint32_t dropped;   // Queue was full
+  uint32_t oversized; // Longer than BLE_COMMAND_MAX_LENGTH, dropped
+};
+
+// Producer side, from the write callback. Trailing CR, LF and NUL are
+// trimmed. False if the command was dropped.
+bool bleCommandPush(const uint8_t *data, size_t length);
+// Consumer side: copy the oldest command, NUL terminated, into out
+// (BLE_COMMAND_MAX_LENGTH + 1 bytes). False if the queue is empty.
+bool bleCommandPop(char *out);
+// Consumer side: commands are still waiting, e.g. after the budget ran out
+bool bleCommandPending();
+BleCommandStats bleCommandStats();
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+// Decides what the BLE radio should be doing; main.cpp applies it.
+//
+// After boot, wake from sleep, a disconnect or the button gesture the device
+// advertises fast so a phone that is looking finds it at once, then steps down
+// to slower intervals, and once BLE_RADIO_TIMEOUT_MS pass without a connection
+// advertising stops, leaving the radio idle, until the button brings it back.
+//
+// While connected, the connection parameters follow what the link is used
+// for: short intervals during a bulk upload, medium while the live stream runs
+// or commands come in, and long intervals with slave latency when idle.
+// Faster profiles are asked for as soon as they are needed; slower ones only
+// after the faster demand has been gone for that profile's hold time, so a
+// burst of commands doesn't cause a parameter update per command. All
+// profiles stay within Apple's accessory design guidelines so iOS accepts
+// them.
+//
+// Everything is called from loop(); the time spent in each state is counted
+// for checking what the radio costs.
+#define BLE_RADIO_OFF 0
+#define BLE_RADIO_ADVERTISING 1
+#define BLE_RADIO_CONNECTED 2
+
+#define BLE_RADIO_TIMEOUT_MS 300000   // Advertising without a connection for this long turns the radio off
+#define BLE_RADIO_RESTART_MS 400      // After a disconnect, let the stack settle before advertising again
+
+#define BLE_ADVERTISING_PHASES 3 // Fast, medium, slow
+
+// Connection profiles, in order of increasing demand
+#define BLE_LINK_IDLE 0
+#define BLE_LINK_ACTIVE 1 // Live stream or commands
+#define BLE_LINK_BULK 2
+#define BLE_LINK_PROFILES 3
+
+// What bleGovernorService() wants done
+#define BLE_GOVERNOR_NONE 0
+#define BLE_GOVERNOR_RADIO_ON 1   // Start advertising again with bleGovernorAdvertising()
+#define BLE_GOVERNOR_ADVERTISE 2  // (Re)start advertising with bleGovernorAdvertising()
+#define BLE_GOVERNOR_LINK 3       // Ask the central for bleGovernorLink()
+#define BLE_GOVERNOR_RADIO_OFF 4  // Stop advertising; the radio stays idle
+
+struct BleAdvertisingParams {
+  uint16_t minInterval; // 0.625 ms units
+  uint16_t maxInterval;
+};
+
+struct BleLinkParams {
+  uint16_t minInterval; // 1.25 ms units
+  uint16_t maxInterval;
+  uint16_t latency;     // Connection events the peripheral may skip
+  uint16_t timeout;     // Supervision timeout, 10 ms units
+};
+
+struct BleRadioStats {
+  uint32_t advertisingMs[BLE_ADVERTISING_PHASES];
+  uint32_t connectedMs[BLE_LINK_PROFILES];
+  uint32_t offMs;
+  uint32_t wakes;       // Radio brought back by the button
+  uint32_t linkUpdates; // Connection parameter requests
+};
+
+// The stack is being brought up by setup(); starts with fast advertising
+void bleGovernorBegin(uint32_t nowMs);
+// Button gesture: radio back on if it was off, fast advertising if it was advertising
+void bleGovernorWake(uint32_t nowMs);
+// Skip the advertising phases faster than minInterval (0.625 ms units), e.g. per power profile
+void bleGovernorSetAdvertisingFloor(uint16_t minInterval, uint32_t nowMs);
+// Once per loop() pass, with the connection state and the BLE_LINK_* the traffic
+// needs right now. Returns a BLE_GOVERNOR_*; call again next pass for the next one.
+uint8_t bleGovernorService(uint32_t nowMs, bool connected, uint8_t demand);
+
+uint8_t bleGovernorState(); // BLE_RADIO_*
+BleAdvertisingParams bleGovernorAdvertising();
+BleLinkParams bleGovernorLink();
+uint8_t bleGovernorLinkProfile(); // BLE_LINK_*
+BleRadioStats bleGovernorStats();
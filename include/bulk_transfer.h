@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bulk upload of a whole asset image over BLE, e.g. a waypoint database
+// built by tools/waypoint_db.py with thousands of points, replacing it in
+// one go instead of a text command per point.
+//
+// The sender writes BEGIN with the size, the CRC-32 of the image and its
+// chunk size, then CHUNK packets (write without response, chunk size picked
+// from the MTU) and finally END. Chunks are numbered and may arrive lost,
+// duplicated or out of order: the receiver keeps any chunk inside a window of
+// BULK_WINDOW past the first missing one and answers with an ACK notification
+// carrying that first missing chunk and a bitmap of the ones after it it
+// already has, so the sender resends only the gaps. Chunks go straight to
+// flash through an AssetWriter, into the target's slot that is not in use, so
+// the old data keeps being read during the upload. The new image only becomes
+// visible, and replaces the old one, when END finds every chunk present, the
+// CRC right and the asset header of the expected kind; anything else leaves
+// the old data in place.
+//
+// The write callback only queues packets; bulkTransferService() handles them
+// from loop().
+#define BULK_CHARACTERISTIC_UUID "0000ffe4-0000-1000-8000-00805f9b34fb"
+
+#define BULK_OP_BEGIN 0x01
+#define BULK_OP_CHUNK 0x02
+#define BULK_OP_END 0x03
+#define BULK_OP_ABORT 0x04
+#define BULK_OP_ACK 0x81
+
+#define BULK_TARGET_WAYPOINTS 1
+
+#define BULK_STATUS_OK 0
+#define BULK_STATUS_STATE 1      // No upload in progress
+#define BULK_STATUS_TARGET 2     // Unknown target or chunk size
+#define BULK_STATUS_SIZE 3       // Doesn't fit the slot
+#define BULK_STATUS_INCOMPLETE 4 // END with chunks missing; the ACK says which
+#define BULK_STATUS_CRC 5
+#define BULK_STATUS_IMAGE 6      // Not a valid image for the target
+#define BULK_STATUS_FLASH 7
+
+#define BULK_MAX_CHUNK 241   // ATT MTU 247 less the ATT and chunk headers
+#define BULK_WINDOW 32       // Chunks kept past the first missing one, one bit each in the ACK
+#define BULK_SLOTS 16        // Packets queued between the BLE task and loop()
+#define BULK_BUDGET_MS 30    // Handle packets for at most this long per loop() pass
+#define BULK_TIMEOUT_MS 10000 // An upload silent for this long is abandoned
+
+#define BULK_EVENT_NONE 0
+#define BULK_EVENT_STARTED 1   // The old data is still in use
+#define BULK_EVENT_COMMITTED 2 // The new data is in place and open instead
+#define BULK_EVENT_FAILED 3    // The old data is still in use
+
+struct __attribute__((packed)) BulkBegin {
+  uint8_t op;
+  uint8_t target;     // BULK_TARGET_*
+  uint32_t size;      // Of the whole image
+  uint32_t crc;       // CRC-32 of the whole image
+  uint16_t chunkSize; // Every chunk but the last is this long
+};
+
+struct __attribute__((packed)) BulkChunkHeader {
+  uint8_t op;
+  uint16_t sequence; // Chunk n holds bytes n * chunkSize onwards
+};
+
+struct __attribute__((packed)) BulkAck {
+  uint8_t op;
+  uint8_t status;    // BULK_STATUS_*
+  uint8_t request;   // BULK_OP_* this answers
+  uint16_t next;     // All chunks before this one are stored
+  uint32_t received; // Bit i: chunk next + i is stored
+};
+
+struct BulkStats {
+  uint32_t chunks;       // Stored
+  uint32_t duplicates;   // Already stored, dropped
+  uint32_t outOfWindow;  // Too far ahead, dropped
+  uint32_t queueFull;    // Dropped by the write callback
+  uint32_t lastBytes;    // Last committed upload
+  uint32_t lastMillis;   // From BEGIN to commit
+};
+
+// Producer side, from the write callback. False if the packet was dropped.
+bool bulkTransferPush(const uint8_t *data, size_t length);
+// Handle queued packets for up to BULK_BUDGET_MS. Returns a BULK_EVENT_*;
+// sendAck is set when ack should be notified to the sender.
+uint8_t bulkTransferService(BulkAck &ack, bool &sendAck);
+bool bulkTransferActive();
+// Packets are still queued, e.g. after the budget ran out
+bool bulkTransferPending();
+BulkStats bulkTransferStats();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gps_fix.h"
+
+// Learned fuel burn model: rate = b0 + b1 * speed + b2 * climb, in L/h with
+// speed in 100 km/h and climb in km/h. Between refuel events the engine
+// hours, distance and height climbed are summed per fix; at a refuel the
+// litres actually burnt are known, which gives one linear observation for a
+// recursive least-squares update with forgetting. Everything is a fixed 3x3
+// problem, O(1) per fix and per event. Until BURN_MODEL_MIN_EVENTS segments
+// have been seen, the constant rate set over BLE is used.
+#define BURN_MODEL_FORGETTING 0.95f  // Older flights fade out, e.g. after a prop change
+#define BURN_MODEL_PRIOR_VARIANCE 4.0f
+#define BURN_MODEL_MIN_EVENTS 2
+#define BURN_MODEL_MIN_SEGMENT_H 0.1f // Shorter segments are mostly measurement error
+#define BURN_MODEL_MIN_RATE 0.5f
+#define BURN_MODEL_MAX_RATE 20.0f
+#define BURN_MODEL_CLIMB_SMOOTHING 0.2f
+
+// Persisted part of the model, kept in the settings record
+struct __attribute__((packed)) BurnModelState {
+  float coeff[3];
+  float cov[6];     // Upper triangle of the 3x3 covariance: 00 01 02 11 12 22
+  uint16_t events;  // Segments fitted so far, 0 = not initialised
+};
+
+// Load the model, or start one from the constant rate
+void burnModelBegin(const BurnModelState &state, double constantRate);
+BurnModelState burnModelState();
+// Add a tick of engine time at the current fix
+void burnModelAccumulate(const GpsFix &fix, double hours);
+// A FUEL update: levelAfter is the tank now and starts the next segment.
+// Only an update with litresAdded (0 for a reading with nothing added) is a
+// measurement; negative means unknown, and the update only restarts the
+// segment: a bare level may be the device's own estimate sent back, and
+// learning from it would fit the model to itself. Returns true if the model
+// learned from it.
+bool burnModelRefuel(double levelAfter, double litresAdded);
+// Burn rate for the current conditions, the constant rate until the model is trained
+double burnModelRate(double constantRate);
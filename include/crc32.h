@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Standard CRC-32 (IEEE 802.3, as zlib). Start with crc = 0 and feed the
+// previous result back in to checksum data in pieces.
+uint32_t crc32Update(uint32_t crc, const void *data, size_t length);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+// Integer trig for everything drawn around the navigation dial. Angles are
+// binary angles with DIAL_ANGLE_STEPS per turn (0 = up, clockwise) and sine
+// values are Q14 (DIAL_TRIG_ONE = 1.0). The quarter-wave table is generated
+// at compile time, so nothing on the render path calls into libm.
+#define DIAL_ANGLE_STEPS 1024
+#define DIAL_ANGLE_MASK (DIAL_ANGLE_STEPS - 1)
+#define DIAL_QUARTER_STEPS (DIAL_ANGLE_STEPS / 4)
+#define DIAL_TRIG_SHIFT 14
+#define DIAL_TRIG_ONE (1 << DIAL_TRIG_SHIFT)
+
+namespace dial_trig_detail {
+
+constexpr double kHalfPi = 1.57079632679489661923;
+
+// Taylor series, only ever evaluated on [0, pi/2] by the compiler
+constexpr double sine(double x) {
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 12; n++) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+struct QuarterWave {
+  int16_t value[DIAL_QUARTER_STEPS + 1];
+};
+
+constexpr QuarterWave makeQuarterWave() {
+  QuarterWave table = {};
+  for (int i = 0; i <= DIAL_QUARTER_STEPS; i++) {
+    table.value[i] = (int16_t)(sine(i * kHalfPi / DIAL_QUARTER_STEPS) * DIAL_TRIG_ONE + 0.5);
+  }
+  return table;
+}
+
+inline constexpr QuarterWave kQuarterWave = makeQuarterWave();
+
+static_assert(kQuarterWave.value[0] == 0, "sin(0) must be 0");
+static_assert(kQuarterWave.value[DIAL_QUARTER_STEPS] == DIAL_TRIG_ONE, "sin(90) must be 1.0");
+
+} // namespace dial_trig_detail
+
+// Sine of a binary angle in Q14
+inline int16_t dialSin(uint16_t angle) {
+  angle &= DIAL_ANGLE_MASK;
+  uint16_t index = angle % DIAL_QUARTER_STEPS;
+  switch (angle / DIAL_QUARTER_STEPS) {
+    case 0: return dial_trig_detail::kQuarterWave.value[index];
+    case 1: return dial_trig_detail::kQuarterWave.value[DIAL_QUARTER_STEPS - index];
+    case 2: return -dial_trig_detail::kQuarterWave.value[index];
+    default: return -dial_trig_detail::kQuarterWave.value[DIAL_QUARTER_STEPS - index];
+  }
+}
+
+// Cosine of a binary angle in Q14
+inline int16_t dialCos(uint16_t angle) {
+  return dialSin(angle + DIAL_QUARTER_STEPS);
+}
+
+// Degrees (any sign or range) to the nearest binary angle
+inline uint16_t dialAngleFromDegrees(float degrees) {
+  float steps = degrees * (DIAL_ANGLE_STEPS / 360.0f);
+  int32_t rounded = (int32_t)(steps + (steps >= 0.0f ? 0.5f : -0.5f));
+  return (uint16_t)(rounded & DIAL_ANGLE_MASK);
+}
+
+// Screen position `radius` pixels from (centerX, centerY) towards `angle`
+inline void dialPolarToScreen(int16_t centerX, int16_t centerY, int16_t radius, uint16_t angle,
+                              int16_t *x, int16_t *y) {
+  const int32_t half = DIAL_TRIG_ONE / 2;
+  *x = centerX + (int16_t)(((int32_t)radius * dialSin(angle) + half) >> DIAL_TRIG_SHIFT);
+  *y = centerY - (int16_t)(((int32_t)radius * dialCos(angle) + half) >> DIAL_TRIG_SHIFT);
+}
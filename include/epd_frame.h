@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GxEPD.h>
+#include "frame_diff.h"
+
+#define FRAME_FULL_PUSH_PERCENT 70  // Above this share of dirty bytes, push one full window
+
+// 1bpp frame that all screens draw into. It keeps a copy of the last frame
+// that was pushed to the panel, so refresh() only sends the byte-aligned
+// rectangles that actually changed instead of the whole 200x200 window.
+class EpdFrame : public GFXcanvas1 {
+  public:
+    EpdFrame(GxEPD &panel, uint16_t w, uint16_t h);
+    ~EpdFrame();
+
+    void init();
+    void setRotation(uint8_t r) override; // Rotation is applied by the panel, the frame stays unrotated
+
+    void update();  // Full refresh of the whole panel
+    void updateWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool using_rotation = true);
+    void refresh(); // Partial refresh of the changed rectangles only
+    void invalidate(); // Forget the last pushed frame, next refresh() pushes everything
+    void copyFrom(const GFXcanvas1 &layer); // Replace the whole frame with a pre-rendered layer of the same size
+
+    // Work out the changed rectangles between the current and the last pushed frame
+    uint8_t findDirtyRects(FrameRect *rects, uint8_t maxRects) const;
+
+    uint32_t lastPushBytes() const { return pushBytes; }
+    uint8_t lastPushWindows() const { return pushWindows; }
+
+  private:
+    GxEPD &panel;
+    uint8_t *previous;   // Copy of the frame currently shown on the panel
+    bool previousValid;
+    uint16_t stride;     // Bytes per frame row
+    uint32_t pushBytes;
+    uint8_t pushWindows;
+
+    void pushRect(const FrameRect &rect);
+};
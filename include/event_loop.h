@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// What loop() waits on between work items. Sources post event bits: the GPS
+// ingest task when it publishes a fix, the button interrupt, and the BLE
+// callbacks when they queue a write or the connection changes. loop() blocks
+// in eventWait() until one arrives or its timeout passes; the timeout is the
+// timer source for everything that runs on a schedule.
+//
+// Power management lets the CPU drop to EVENT_LOOP_MIN_MHZ while loop() is
+// blocked and holds it at EVENT_LOOP_MAX_MHZ while loop() works. There is no
+// light sleep: the GPS keeps the UART busy the whole time. The working clock
+// can be lowered with eventLoopSetMaxMhz(), e.g. per power profile; without
+// power management that sets a fixed clock instead.
+#define EVENT_GPS (1 << 0)    // New fix published
+#define EVENT_BUTTON (1 << 1) // Button pin changed
+#define EVENT_BLE (1 << 2)    // Write queued or connection changed
+#define EVENT_TIMER (1 << 3)  // eventWait() timed out; never posted
+
+#define EVENT_LOOP_MAX_MHZ 240
+#define EVENT_LOOP_MIN_MHZ 80 // Keeps the APB clock, and with it the UART baud rates, unchanged
+#define EVENT_LOOP_IDLE_MS 1000 // Longest wait when nothing is scheduled sooner
+
+struct EventLoopStats {
+  uint16_t idleMs;   // Of the last full second, blocked in eventWait()
+  uint16_t activeMs; // Of the last full second, working
+  uint16_t wakeups;  // eventWait() returns in the last full second
+  uint16_t maxMhz;   // Clock while working
+  bool frequencyScaling;
+};
+
+// Create the event group and configure power management; loop() counts as working from here
+void eventLoopBegin();
+// Clock while loop() works, at least EVENT_LOOP_MIN_MHZ
+void eventLoopSetMaxMhz(uint16_t mhz);
+void eventPost(uint32_t events);
+void IRAM_ATTR eventPostFromISR(uint32_t events);
+// Block until an event is posted or timeoutMs passes. Returns the events
+// posted since the last call, EVENT_TIMER if none.
+uint32_t eventWait(uint32_t timeoutMs);
+EventLoopStats eventLoopStats();
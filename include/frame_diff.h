@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Finding the parts of a 1bpp frame that changed since the last one pushed
+// to the panel. Frames are rows of stride bytes, 8 pixels per byte; nothing
+// here touches the display, so EpdFrame and the host tests share it.
+//
+// Changed bytes are collected into byte-wide, 8-row tiles, runs of tiles are
+// grown into candidate windows, and candidates are merged while one window
+// costs less than two. Each window is then shrunk to the bytes and rows that
+// really changed.
+
+// Rectangle in frame coordinates. x and w are always multiples of 8 so that
+// every window starts and ends on a framebuffer byte.
+struct FrameRect {
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+};
+
+#define FRAME_MAX_WINDOWS 4         // Never push more partial windows than this per refresh
+#define FRAME_WINDOW_COST_BYTES 400 // Fixed cost of one extra window, expressed in pushed bytes
+
+// Changed rectangles between frame and previous, at most maxRects. Frames up
+// to 256 pixels wide and 256 rows high are covered.
+uint8_t frameDirtyRects(const uint8_t *frame, const uint8_t *previous, uint16_t stride, uint16_t height,
+                        FrameRect *rects, uint8_t maxRects);
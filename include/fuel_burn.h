@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gps_fix.h"
+
+// Fuel burn integrator. Each tick returns the hours the engine ran since
+// the time last counted. While the ticks have fresh fixes the interval comes
+// from GPS time, counted when the GPS second changes; otherwise, and across a
+// jump in GPS time, it comes from millis(). Time spent asleep is never
+// counted: the integrator starts from zero on every boot.
+//
+// Being in flying mode isn't enough to count as burning: the engine is taken
+// as running from the first fresh fix faster than FUEL_BURN_START_KMH, and as
+// stopped once the fixes have been slow and level for FUEL_BURN_STOP_MS, so
+// the time on the ground before and after a flight isn't charged. Without a
+// fresh fix it keeps its last state.
+#define FUEL_BURN_MAX_GPS_AGE_MS 2000  // Older fixes don't clock the integrator
+#define FUEL_BURN_MAX_CLOCK_SKEW_S 2.0 // GPS interval further than this from millis() is ignored
+#define FUEL_BURN_START_KMH 12.0f      // Faster than a walk: taking off or flying
+#define FUEL_BURN_STOP_KMH 3.0f        // Slower than this...
+#define FUEL_BURN_STOP_ALTITUDE_M 5.0f // ...and within this of the altitude it slowed down at...
+#define FUEL_BURN_STOP_MS 60000        // ...for this long is on the ground
+
+struct FuelPrediction {
+  float enduranceMinutes; // At the current burn rate, 0 if the rate is unknown
+  float rangeKm;          // Endurance times current ground speed
+};
+
+// Start a new interval, nothing before this call will be counted; the engine counts as stopped
+void fuelBurnReset();
+// Engine hours since the previous tick; burning is false while the engine can't be running
+double fuelBurnTick(bool burning, const GpsFix &fix);
+FuelPrediction fuelPredict(double level, double burnRateLph, const GpsFix &fix);
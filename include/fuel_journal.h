@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Append-only fuel journal in its own flash partition. Checkpoints are
+// 16-byte records written into erased flash, one after the other, so a
+// checkpoint is a single small write and never an erase. When a sector
+// fills, the next one round-robin is erased and the new checkpoint starts
+// it, which spreads erases evenly over all sectors. On boot the
+// newest record with a good CRC wins; a record torn by power loss is
+// skipped.
+#define FUEL_JOURNAL_PARTITION "fuel"
+#define FUEL_JOURNAL_SUBTYPE 0x40
+#define FUEL_JOURNAL_SECTOR_SIZE 4096
+#define FUEL_JOURNAL_INTERVAL_MS 5000 // Minimum time between checkpoints of a changing level
+
+struct FuelCheckpoint {
+  uint32_t timestamp; // UTC seconds, 0 if the clock wasn't set
+  float level;        // Litres
+  float burnRate;     // Litres per hour
+};
+
+// Find the partition and recover the newest checkpoint. False if there is no partition.
+bool fuelJournalBegin();
+// Newest checkpoint, false if the journal is empty
+bool fuelJournalLast(FuelCheckpoint &checkpoint);
+// Write a checkpoint now
+bool fuelJournalAppend(float level, float burnRate);
+// Checkpoint from the main loop, at most every FUEL_JOURNAL_INTERVAL_MS and only on change
+void fuelJournalService(float level, float burnRate);
+// Checkpoint now if anything changed since the last one, e.g. before sleep
+void fuelJournalFlush(float level, float burnRate);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gps_fix.h"
+
+// Hot-start aiding. The last fix and its UTC time are kept in RTC slow memory
+// through deep sleep. On wake they are sent to the receiver as UBX-AID-INI,
+// with accuracies widened by the time spent asleep, so it doesn't have to
+// search the whole sky. Also measures time to first fix for each boot.
+#define GPS_AID_SAVE_INTERVAL_MS 10000 // How often a running fix is copied to RTC memory
+#define GPS_AID_MAX_SPEED_MPS 30.0f    // Assumed worst case travel while asleep (car to launch)
+#define GPS_AID_UNKNOWN_AGE_ACC_M 100000.0f // Position accuracy when sleep time is unknown
+#define GPS_AID_MAX_POS_ACC_M 300000.0f     // Beyond this the position isn't worth sending
+#define GPS_AID_CLOCK_DRIFT_PPM 20000  // RTC slow clock runs off the internal RC, assume 2%
+#define GPS_UTC_LEAP_SECONDS 18        // GPS - UTC since 2017
+
+struct GpsTtff {
+  uint32_t ms;          // This boot, 0 until the first fix
+  bool aided;           // This boot was given AID-INI
+  uint32_t previousMs;  // Previous boot, 0 if it never got a fix
+  bool previousAided;
+};
+
+// Receiver was just powered up: start the TTFF clock
+void gpsAidBegin();
+// Send AID-INI from the saved fix once the link is up. Returns true if anything was sent.
+bool gpsAidInject();
+// Call with each new fix: stops the TTFF clock, keeps the system clock on GPS time
+// and refreshes the saved fix
+void gpsAidUpdate(const GpsFix &fix);
+// Save the current fix right before deep sleep
+void gpsAidSave(const GpsFix &fix);
+GpsTtff gpsAidTtff();
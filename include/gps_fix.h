@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include "nav_math.h"
+
+#define GPS_SOURCE_NONE 0
+#define GPS_SOURCE_NMEA 1
+#define GPS_SOURCE_UBX 2
+
+// Position, motion and time state read by the screens. It is filled either
+// from NMEA (TinyGPSPlus) or from UBX binary messages and mirrors the parts
+// of the TinyGPSPlus interface the screens use, so they don't care which
+// protocol the receiver speaks. Like TinyGPSPlus, a field stays valid once
+// it has been received.
+struct GpsFix {
+  struct Location {
+    bool valid;
+    NavPoint point;
+    bool isValid() const { return valid; }
+    double lat() const { return navLatDegrees(point); }
+    double lng() const { return navLonDegrees(point); }
+  } location;
+
+  struct Altitude {
+    bool valid;
+    float value; // Metres above mean sea level
+    bool isValid() const { return valid; }
+    double meters() const { return value; }
+  } altitude;
+
+  struct Speed {
+    bool valid;
+    float value; // km/h over ground
+    bool isValid() const { return valid; }
+    double kmph() const { return value; }
+  } speed;
+
+  struct Course {
+    bool valid;
+    float value; // Degrees over ground, 0-360
+    bool isValid() const { return valid; }
+    double deg() const { return value; }
+  } course;
+
+  struct Time {
+    bool valid;
+    uint8_t h, m, s;
+    bool isValid() const { return valid; }
+    uint8_t hour() const { return h; }
+    uint8_t minute() const { return m; }
+    uint8_t second() const { return s; }
+  } time;
+
+  struct Date {
+    bool valid;
+    uint16_t y;
+    uint8_t mo, d;
+    bool isValid() const { return valid; }
+    uint16_t year() const { return y; }
+    uint8_t month() const { return mo; }
+    uint8_t day() const { return d; }
+  } date;
+
+  struct Satellites {
+    uint8_t count;
+    uint32_t value() const { return count; }
+  } satellites;
+
+  uint8_t fixType;       // 0 = no fix, 2 = 2D, 3 = 3D
+  float hAccMeters;      // Estimated horizontal accuracy, 0 if unknown
+  uint8_t source;        // GPS_SOURCE_* that produced the last update
+  uint32_t updateMillis; // millis() when the last update was published
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gps_stream.h"
+
+// Background GPS ingest. A FreeRTOS task woken by the UART receive events
+// drains the driver's RX ring buffer as soon as bytes arrive, whatever the UI
+// task is doing, and hands them to gps_stream. Every fix it publishes becomes
+// a snapshot that the UI picks up with gpsIngestSync().
+// Closing the port or changing its speed waits for the task to finish the
+// read it is in.
+#define GPS_RX_BUFFER_SIZE 2048   // UART driver ring buffer, about 2 s of NMEA at 9600 baud
+#define GPS_TASK_STACK_SIZE 3072
+#define GPS_TASK_PRIORITY 3
+#define GPS_TASK_CORE 0
+#define GPS_TASK_IDLE_WAKE_MS 100 // Drain even if a receive event was missed
+#define GPS_UBX_ACK_TIMEOUT_MS 300
+
+struct GpsIngestStats {
+  uint32_t bytes;              // Bytes handed to the parsers
+  uint32_t sentences;          // NMEA sentences and UBX frames with a valid checksum
+  uint32_t checksumFailures;   // Sentences and frames rejected on checksum
+  uint32_t overruns;           // UART FIFO or ring buffer overflows reported by the driver
+  uint16_t sentencesPerSecond; // Valid sentences and frames over the last full second
+  uint8_t protocol;            // GPS_SOURCE_* currently driving the fix
+};
+
+// (Re)start the serial port and make sure the ingest task is running
+void gpsIngestBegin(HardwareSerial &serial, unsigned long baud, int8_t rxPin, int8_t txPin);
+// Stop feeding the parsers and close the serial port, e.g. before deep sleep
+void gpsIngestEnd();
+// Copy the latest fix into gps, returns true if anything new arrived
+bool gpsIngestSync(GpsFix &gps);
+// Called on the ingest task whenever a fix is published, e.g. to wake the UI
+void gpsIngestOnFix(void (*callback)());
+GpsIngestStats gpsIngestStats();
+
+// Switch a u-blox receiver to UBX navigation output: NAV-PVT when the
+// receiver has it, NAV-POSLLH/VELNED/SOL/TIMEUTC on the NEO-6M. Returns
+// false, leaving the receiver on NMEA, if it does not acknowledge.
+bool gpsConfigureUbx();
+// Send a UBX message that is not acknowledged (AID, RXM)
+void gpsWriteUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length);
+// Send a UBX message and wait for its ACK-ACK (true) or ACK-NAK/timeout (false)
+bool gpsSendUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length);
+// Poll a UBX message (empty payload) and copy the answer into out. Returns
+// the answer's payload length, or -1 if nothing came back in time.
+int16_t gpsPollUbx(uint8_t cls, uint8_t id, uint8_t *out, uint16_t maxLength);
+
+// Change only our side of the UART
+void gpsIngestSetBaud(unsigned long baud);
+// Tell the receiver to move to baud with CFG-PRT, then follow it
+void gpsIngestSwitchBaud(unsigned long baud);
+unsigned long gpsIngestBaud();
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Receiver link negotiation on top of the ingest task: find the baud rate the
+// receiver is talking at, move it to a faster one, drop the NMEA sentences we
+// never parse, optionally switch to UBX and set the navigation rate. The
+// result lives in RTC memory so a wake from deep sleep tries it first.
+#define GPS_DEFAULT_BAUD 9600     // Receiver factory setting
+#define GPS_FAST_BAUD 115200
+#define GPS_FALLBACK_BAUD 38400   // If the fast rate doesn't come up cleanly
+#define GPS_PROBE_MS 1500         // A 1 Hz receiver sends at least one sentence in this time
+#define GPS_MAX_RATE_HZ 5
+#define GPS_SLOW_LINK_MAX_RATE_HZ 2 // RMC+GGA at 9600 baud stop fitting above this
+
+struct GpsLinkState {
+  uint32_t baud;    // 0 if no receiver answered
+  uint8_t rateHz;   // Navigation rate requested from the receiver
+  bool ubx;         // Receiver sends UBX navigation instead of NMEA
+  bool verified;    // Rate read back from the receiver matched the request
+};
+
+// The way to the receiver. On the device it is the ingest task; the host
+// tests put a simulated receiver behind it.
+struct GpsLinkTransport {
+  uint32_t (*sentences)();          // Sentences and frames with a valid checksum so far
+  void (*setBaud)(unsigned long baud);    // Only our side of the UART
+  void (*switchBaud)(unsigned long baud); // CFG-PRT to the receiver, then our side
+  unsigned long (*baud)();
+  bool (*sendUbx)(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length); // True on ACK-ACK
+  int16_t (*pollUbx)(uint8_t cls, uint8_t id, uint8_t *out, uint16_t maxLength);     // Payload length or -1
+  bool (*configureUbx)();           // Switch to UBX navigation output
+  void (*wait)(uint32_t ms);
+};
+
+// Replace the ingest task as the transport
+void gpsLinkSetTransport(const GpsLinkTransport *transport);
+// Full negotiation, run once after power-up. Returns false if no receiver answered.
+bool gpsNegotiateLink(uint8_t rateHz, bool useUbx);
+// Change the navigation rate, e.g. on a mode change, and read it back
+bool gpsSetNavRate(uint8_t rateHz);
+GpsLinkState gpsLinkState();
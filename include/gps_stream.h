@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gps_fix.h"
+#include "ubx.h"
+
+// The receiver's byte stream turned into fixes, without the UART or the
+// ingest task around it, so the host tests can feed it recorded captures.
+// NMEA goes through TinyGPSPlus, UBX frames through the binary decoder; both
+// fill one working GpsFix that is handed to the fix callback when published.
+// Everything here runs on whichever task feeds the bytes.
+//
+// A fix is published once per navigation epoch, when every message the
+// receiver sends for it has arrived, so a consumer never sees the new
+// position with the previous epoch's speed and course. NMEA epochs are keyed
+// by the UTC time of GGA and RMC, UBX ones by the iTOW of the NAV messages.
+// Which messages make up an epoch is learned from the stream: one with a new
+// stamp before the previous epoch completed publishes that epoch as it stands.
+#define GPS_UBX_TIMEOUT_MS 3000 // Fall back to NMEA when UBX navigation stops for this long
+
+struct GpsStreamStats {
+  uint32_t sentences;        // NMEA sentences and UBX frames with a valid checksum
+  uint32_t checksumFailures; // Sentences and frames rejected on checksum
+  uint32_t fixes;            // Fixes handed to the fix callback
+  uint8_t source;            // GPS_SOURCE_* of the last published fix
+};
+
+// Parse received bytes, publishing fixes as they complete
+void gpsStreamFeed(const uint8_t *data, size_t length);
+// Called with every published fix
+void gpsStreamOnFix(void (*callback)(const GpsFix &fix));
+// Offered every UBX frame first, e.g. for ACKs and poll answers; returns true if it took the frame
+void gpsStreamOnFrame(bool (*callback)(const UbxDecoder &frame));
+// The receiver was just told to send UBX: NMEA stops driving the fix from now on
+void gpsStreamStartUbx();
+// millis() of the last UBX navigation message, 0 if there never was one
+uint32_t gpsStreamLastUbxMillis();
+// Drop a half-received UBX frame, e.g. after a baud rate change
+void gpsStreamResync();
+// Forget everything, as after power-up
+void gpsStreamReset();
+GpsStreamStats gpsStreamStats();
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <GxEPD.h>
+
+// The static art of the navigation dial: border, jerry can, rings and the
+// icon of the operation mode. It only draws through Adafruit_GFX, so it is
+// rendered into a background canvas once per mode at boot and copied into
+// the frame before every navigation screen.
+#define MODE_FLYING 1
+#define MODE_WALKING 2
+
+// Clear gfx and draw the dial around (centerX, centerY) for mode
+void drawNavigationBackground(Adafruit_GFX &gfx, int centerX, int centerY, uint8_t mode);
+// The walking or flying icon in the top right corner
+void drawModeIcon(Adafruit_GFX &gfx, uint8_t mode);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+// Single-precision navigation math for the ESP32 FPU, which only handles
+// float in hardware. Coordinates are int32 in 1e-7 degrees (about 1 cm), so
+// the differences between two points are exact before any float math runs.
+//
+// Up to NAV_FLAT_SPAN_DEG of latitude/longitude difference the kernels use
+// an equirectangular projection around the mid latitude; beyond that they
+// switch to a float haversine / great-circle bearing. Both use the same sphere
+// as TinyGPSPlus (R = 6372795 m). Measured against TinyGPSPlus::distanceBetween
+// and courseTo in double over random pairs between 70S and 70N:
+//   distance: < 0.5 m while both deltas are under 0.45 degree (about 50 km),
+//             < 0.015% + 0.5 m everywhere else
+//   course:   < 0.003 degree whenever the target is more than 10 m away
+#define NAV_COORD_SCALE 10000000L // Units per degree
+#define NAV_EARTH_RADIUS_M 6372795.0f
+#define NAV_FLAT_SPAN_DEG 2
+
+struct NavPoint {
+  int32_t lat; // 1e-7 degrees
+  int32_t lon; // 1e-7 degrees
+};
+
+// Terms that only depend on the current position, computed once per fix
+struct NavOrigin {
+  NavPoint point;
+  float latRad;
+  float cosLat;
+  float sinLat;
+};
+
+NavPoint navPointFromDegrees(double lat, double lon);
+NavPoint navPointFromRaw(uint16_t latDeg, uint32_t latBillionths, bool latNegative,
+                         uint16_t lonDeg, uint32_t lonBillionths, bool lonNegative);
+double navLatDegrees(const NavPoint &p);
+double navLonDegrees(const NavPoint &p);
+
+NavOrigin navOrigin(const NavPoint &p);
+
+// Distance in metres and initial course in degrees (0-360, 0 = north)
+void navDistanceCourse(const NavOrigin &from, const NavPoint &to, float *meters, float *course);
+float navDistanceMeters(const NavOrigin &from, const NavPoint &to);
+float navCourseDegrees(const NavOrigin &from, const NavPoint &to);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "gps_fix.h"
+#include "nav_math.h"
+
+// Navigation to a set of targets, worked out once per GPS fix. The caller
+// owns the targets and sizes the array: main.cpp keeps home and the POIs. The
+// origin terms (cos/sin of the current latitude) are computed once and shared
+// by all targets, so the cost is linear in the number of targets. Screens and
+// BLE only read the result, so refreshing a screen does no trig at all.
+#define NAV_ETA_MIN_CLOSING_KMH 3.0f // Slower than this towards a target and there is no ETA
+
+struct NavTarget {
+  NavPoint point;
+  bool enabled;
+  float distanceMeters;
+  float courseDegrees;   // 0-360, 0 = north
+  float relativeBearing; // Course minus heading, -180 to 180
+  float etaSeconds;      // At the current closing speed, negative if not closing
+};
+
+// The part shared by every target
+struct NavSolution {
+  bool valid;            // Position was valid at the last update
+  NavOrigin origin;
+  float headingDegrees;  // Course over ground, 0 when unknown
+  float speedKmh;
+  uint32_t fixMillis;    // updateMillis of the fix this was computed from
+};
+
+// Recompute targets[0..count) from a fix. Targets only change on user input:
+// set point and enabled, then call this; otherwise once per new fix
+void navSolutionUpdate(const GpsFix &fix, NavTarget *targets, size_t count);
+const NavSolution &navSolution();
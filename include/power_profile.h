@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include "gps_fix.h"
+
+// Power profile for what the device is being used for right now: CPU clock,
+// GPS navigation rate, how often the screen is redrawn, the fastest BLE
+// advertising and how often the battery is measured. The operation mode picks
+// flying or walking. Walking drops to resting once the fixes show the device
+// standing still, and goes back as soon as it moves again; flying never does,
+// since a paramotor into a headwind can be airborne at walking speed.
+//
+// powerProfileUpdate() only decides. The caller applies every setting of the
+// new profile in one go, so no switch leaves part of the old one in place.
+//
+// Screen redraw and fix handling times are kept per profile, to check that a
+// profile's clock is enough for its work.
+#define POWER_PROFILE_FLYING 0
+#define POWER_PROFILE_WALKING 1
+#define POWER_PROFILE_RESTING 2
+#define POWER_PROFILES 3
+
+#define POWER_MOVING_KMH 4.0f  // Faster than this is moving
+#define POWER_STOPPED_KMH 1.5f // Slower than this for POWER_STOPPED_MS is resting
+#define POWER_STOPPED_MS 60000
+
+struct PowerProfile {
+  const char *name;
+  uint16_t cpuMhz;
+  uint8_t gpsRateHz;
+  uint32_t displayRefreshMs; // Redraw of the current screen
+  uint16_t advertisingFloor; // Fastest advertising interval, 0.625 ms units
+  uint32_t batterySampleMs;
+};
+
+struct PowerTiming {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+};
+
+struct PowerProfileStats {
+  PowerTiming frames[POWER_PROFILES]; // Screen redraws, drawing and panel update
+  PowerTiming fixes[POWER_PROFILES];  // Handling of a new fix in loop()
+  uint32_t switches;
+};
+
+// Track motion from the fix and pick the profile. True when it changed,
+// including the first call; then apply powerProfile().
+bool powerProfileUpdate(bool flying, const GpsFix &fix, uint32_t nowMs);
+uint8_t powerProfileId(); // POWER_PROFILE_*
+const PowerProfile &powerProfile();
+const PowerProfile &powerProfileAt(uint8_t id);
+bool powerProfileMoving();
+
+// Charged to the current profile
+void powerProfileRecordFrame(uint32_t micros);
+void powerProfileRecordFix(uint32_t micros);
+PowerProfileStats powerProfileStats();
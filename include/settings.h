@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+#include "burn_model.h"
+
+// Everything kept in EEPROM, as one packed record with a version and CRC.
+// It is read once at boot. Saves only update a RAM copy; the flash commit
+// happens once no change has come in for SETTINGS_COMMIT_DELAY_MS, or at
+// sleep, so a burst of BLE updates costs one erase instead of one per field.
+// Changes that keep coming are still committed SETTINGS_COMMIT_MAX_DELAY_MS
+// after the first one.
+#define SETTINGS_EEPROM_SIZE 512
+#define SETTINGS_MAGIC 0x53504E47 // "GNPS"
+#define SETTINGS_VERSION 2
+#define SETTINGS_POI_COUNT 3
+#define SETTINGS_COMMIT_DELAY_MS 10000
+#define SETTINGS_COMMIT_MAX_DELAY_MS 60000
+
+#define SETTINGS_DEFAULT_FUEL_LEVEL 12.0
+#define SETTINGS_DEFAULT_BURN_RATE 4.5
+#define SETTINGS_DEFAULT_MODE 1 // MODE_FLYING
+
+struct __attribute__((packed)) Settings {
+  // Header, not covered by the CRC
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length;    // Bytes of the record as written, so newer fields can be appended
+  uint32_t crc;       // CRC-32 of everything after the header, up to length
+
+  double homeLatitude;
+  double homeLongitude;
+  double poiLatitudes[SETTINGS_POI_COUNT];
+  double poiLongitudes[SETTINGS_POI_COUNT];
+  uint8_t poiEnabled[SETTINGS_POI_COUNT];
+  double fuelLevel;
+  double fuelBurnRate;
+  uint8_t operationMode;
+
+  // Version 2
+  BurnModelState burnModel;
+};
+
+static_assert(sizeof(Settings) <= SETTINGS_EEPROM_SIZE, "Settings record does not fit the EEPROM area");
+
+// Load the record, migrating the pre-versioned layout if that is what is stored.
+// Returns false if nothing usable was found and s holds defaults.
+bool settingsLoad(Settings &s);
+// Queue s for writing; nothing is written if it didn't change
+void settingsStore(const Settings &s);
+// Commit queued changes once they have settled, call from the main loop
+void settingsService();
+// Commit queued changes now, e.g. before deep sleep
+void settingsFlush();
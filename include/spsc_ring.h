@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Fixed ring of message slots between one producer task and one consumer
+// task, e.g. a BLE write callback and loop(). No lock: each side owns one
+// free-running index and publishes it with release/acquire ordering, so the
+// producer never waits and a full ring just refuses the message.
+template <size_t SlotSize, uint32_t Slots>
+class SpscRing {
+  static_assert((Slots & (Slots - 1)) == 0, "Slot count must be a power of two");
+  static_assert(SlotSize <= UINT16_MAX, "Slot length is stored in 16 bits");
+
+ public:
+  // Producer side. False if the message is too long or the ring is full.
+  bool push(const uint8_t *data, size_t length) {
+    if (length > SlotSize) {
+      return false;
+    }
+    uint32_t at = head.load(std::memory_order_relaxed);
+    if (at - tail.load(std::memory_order_acquire) >= Slots) {
+      return false;
+    }
+    Slot &slot = slots[at % Slots];
+    memcpy(slot.data, data, length);
+    slot.length = length;
+    head.store(at + 1, std::memory_order_release); // Slot contents are visible before the new head
+    return true;
+  }
+
+  // Consumer side: copy the oldest message into out (SlotSize bytes). False if empty.
+  bool pop(uint8_t *out, size_t &length) {
+    uint32_t at = tail.load(std::memory_order_relaxed);
+    if (at == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    const Slot &slot = slots[at % Slots];
+    length = slot.length;
+    memcpy(out, slot.data, length);
+    tail.store(at + 1, std::memory_order_release); // Slot is free for the producer again
+    return true;
+  }
+
+  // Consumer side: nothing left to pop
+  bool empty() const {
+    return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+  }
+
+  // Messages accepted so far
+  uint32_t pushed() const {
+    return head.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    uint16_t length;
+    uint8_t data[SlotSize];
+  };
+
+  Slot slots[Slots];
+  std::atomic<uint32_t> head{0}; // Next slot to fill, written by the producer only
+  std::atomic<uint32_t> tail{0}; // Next slot to drain, written by the consumer only
+};
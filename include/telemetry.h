@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Binary telemetry for the phone app, notified on its own characteristic
+// next to the legacy text one. Frames are packed little-endian structs
+// behind a 4-byte header giving the schema version, the frame type and the
+// length. Clients skip frame types they don't know, frames of another
+// version, and frames shorter than the fields they read. So new fields are
+// only ever appended, which older clients ignore; TELEMETRY_VERSION changes
+// only when an existing field moves or changes meaning.
+//
+// The live frame carries what changes with every fix; the config frame
+// carries what only changes on user input; the diagnostics frame carries the
+// counters for checking what the radio, the loop and the power profiles cost. A notification holds MTU - 3
+// bytes and the ATT MTU starts at 23: frames that don't fit the negotiated
+// MTU are not sent, leaving that client with the text status.
+#define TELEMETRY_CHARACTERISTIC_UUID "0000ffe3-0000-1000-8000-00805f9b34fb"
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_FRAME_LIVE 1
+#define TELEMETRY_FRAME_CONFIG 2
+#define TELEMETRY_FRAME_DIAGNOSTICS 4 // 3 is the stream's delta frame
+#define TELEMETRY_POI_COUNT 3
+#define TELEMETRY_PROFILE_COUNT 3
+
+#define TELEMETRY_UNKNOWN_I16 INT16_MIN
+#define TELEMETRY_UNKNOWN_U16 UINT16_MAX
+
+#define TELEMETRY_FLAG_FIX 0x01
+#define TELEMETRY_FLAG_ALTITUDE 0x02
+#define TELEMETRY_FLAG_HOME 0x04
+#define TELEMETRY_FLAG_AIRSPACE_SHIFT 4 // Two bits of AIRSPACE_LEVEL_*
+
+#define TELEMETRY_DIAG_FREQUENCY_SCALING 0x01
+#define TELEMETRY_DIAG_MOVING 0x02
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Telemetry frames are sent in memory order");
+
+struct __attribute__((packed)) TelemetryHeader {
+  uint8_t version;
+  uint8_t type;    // TELEMETRY_FRAME_*
+  uint16_t length; // Whole frame, header included
+};
+
+struct __attribute__((packed)) TelemetryLive {
+  TelemetryHeader header;
+  int32_t lat;               // 1e-7 degrees
+  int32_t lon;
+  int16_t altitude;          // Metres MSL
+  int16_t agl;               // Metres above ground
+  uint16_t speed;            // 0.1 km/h
+  uint16_t course;           // 0.01 degree
+  uint8_t satellites;
+  uint8_t flags;             // TELEMETRY_FLAG_*
+  uint16_t fuel;             // 0.01 litre
+  uint16_t batteryMv;
+  uint16_t enduranceMinutes;
+  uint16_t homeDistance;     // 10 m
+  int16_t homeBearing;       // Relative to the course, 0.1 degree
+};
+
+struct __attribute__((packed)) TelemetryPoint {
+  int32_t lat; // 1e-7 degrees
+  int32_t lon;
+};
+
+struct __attribute__((packed)) TelemetryConfig {
+  TelemetryHeader header;
+  TelemetryPoint home;
+  TelemetryPoint pois[TELEMETRY_POI_COUNT];
+  uint8_t poiEnabled; // Bit per POI
+  uint8_t mode;
+  uint16_t burnRate;  // 0.01 L/h
+};
+
+struct __attribute__((packed)) TelemetryProfileTiming {
+  uint16_t frameAvgMs; // Screen redraw
+  uint16_t frameMaxMs;
+  uint16_t fixAvgUs;   // Fix handling in loop()
+  uint16_t fixMaxUs;
+};
+
+// Counters saturate at their field's maximum
+struct __attribute__((packed)) TelemetryDiagnostics {
+  TelemetryHeader header;
+  uint8_t streamHz;
+  uint8_t linkProfile;     // BLE_LINK_*
+  uint16_t streamIntervalMs;
+  uint16_t streamBytesPerSecond;
+  uint16_t streamBackoffs;
+  uint16_t commands;        // Received since boot
+  uint16_t commandsDropped; // Queue full or too long
+  uint32_t advertisingSeconds;
+  uint32_t connectedSeconds;
+  uint32_t idleLinkSeconds; // Of the connected time, on the idle link profile
+  uint32_t radioOffSeconds;
+  uint16_t linkUpdates;
+  uint16_t loopIdleMs;      // Of the last full second
+  uint16_t loopActiveMs;
+  uint16_t loopWakeups;
+  uint16_t cpuMhz;          // While loop() works
+  uint8_t flags;            // TELEMETRY_DIAG_*
+  uint8_t powerProfile;     // POWER_PROFILE_*
+  uint16_t profileSwitches;
+  TelemetryProfileTiming profiles[TELEMETRY_PROFILE_COUNT];
+};
+
+static_assert(sizeof(TelemetryLive) == 32, "Live frame layout is shared with the web app");
+static_assert(sizeof(TelemetryConfig) == 40, "Config frame layout is shared with the web app");
+static_assert(sizeof(TelemetryDiagnostics) == 70, "Diagnostics frame layout is shared with the web app");
+
+// Whether a frame fits one notification at this ATT MTU
+inline bool telemetryFits(uint16_t mtu, uint16_t length) {
+  return mtu >= length + 3;
+}
+
+template <typename F>
+inline void telemetryBegin(F &frame, uint8_t type) {
+  frame.header.version = TELEMETRY_VERSION;
+  frame.header.type = type;
+  frame.header.length = sizeof(F);
+}
+
+// value / unit, rounded and saturated to the field; NAN gives the unknown marker
+inline int16_t telemetryI16(float value, float unit) {
+  if (isnan(value)) return TELEMETRY_UNKNOWN_I16;
+  float scaled = roundf(value / unit);
+  return scaled <= INT16_MIN + 1 ? INT16_MIN + 1 : (scaled >= INT16_MAX ? INT16_MAX : (int16_t)scaled);
+}
+
+inline uint16_t telemetryU16(float value, float unit) {
+  if (isnan(value)) return TELEMETRY_UNKNOWN_U16;
+  float scaled = roundf(value / unit);
+  return scaled <= 0.0f ? 0 : (scaled >= UINT16_MAX - 1 ? UINT16_MAX - 1 : (uint16_t)scaled);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry.h"
+
+// Live tracking stream on the telemetry characteristic. Each frame carries
+// only the fields that changed since the client last heard them, as zigzag
+// varints of the difference, so a steady cruise costs a handful of bytes.
+//
+// Frame: TelemetryHeader (type TELEMETRY_FRAME_DELTA), a sequence number, a
+// mask of the fields present, and a mask of those among them that are
+// absolute values rather than differences. Then one varint per present field,
+// in bit order. Every field is sent absolute after a reset (new subscriber)
+// and again every TELEMETRY_STREAM_KEYFRAME_MS. Fields that don't fit the MTU
+// wait for the next frame. The reference the differences are taken from only
+// moves once the frame carrying a field was handed to the client, and the
+// sequence number only counts those frames: a frame that failed to go out is
+// encoded again, and a gap in the sequence means the client lost one. It then
+// asks for a reset with the STREAM command instead of waiting for a keyframe.
+//
+// The frame interval starts at the requested rate, never goes below
+// TELEMETRY_STREAM_LINK_EVENTS connection events, doubles whenever the link
+// reports its transmit queue backing up, and creeps back once it drains.
+#define TELEMETRY_FRAME_DELTA 3
+
+#define TELEMETRY_STREAM_MAX_HZ 5
+#define TELEMETRY_STREAM_KEYFRAME_MS 10000
+#define TELEMETRY_STREAM_LINK_EVENTS 2         // Connection events per frame at least
+#define TELEMETRY_STREAM_MAX_INTERVAL_MS 2000  // Back-off limit
+#define TELEMETRY_STREAM_MAX_FRAME 40          // Every field absolute, with room to spare
+
+// Bits of the field masks, also the order of the varints
+#define TELEMETRY_STREAM_LAT 0
+#define TELEMETRY_STREAM_LON 1
+#define TELEMETRY_STREAM_ALTITUDE 2
+#define TELEMETRY_STREAM_SPEED 3
+#define TELEMETRY_STREAM_COURSE 4
+#define TELEMETRY_STREAM_FUEL 5
+#define TELEMETRY_STREAM_BATTERY 6
+#define TELEMETRY_STREAM_FIELDS 7
+
+struct __attribute__((packed)) TelemetryDeltaHeader {
+  TelemetryHeader header;
+  uint8_t sequence;
+  uint8_t fields;   // Bit per field present
+  uint8_t absolute; // Of those, the ones sent as values rather than differences
+};
+
+struct TelemetryStreamStats {
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t backoffs;       // Frames held back because the link was congested
+  uint16_t intervalMs;     // Current frame interval
+  uint16_t bytesPerSecond; // Over the last few seconds
+};
+
+// Requested rate, 0 stops the stream; clamped to TELEMETRY_STREAM_MAX_HZ
+void telemetryStreamSetRate(uint8_t hz);
+uint8_t telemetryStreamRate();
+// Negotiated ATT MTU and connection interval, whenever either changes
+void telemetryStreamSetLink(uint16_t mtu, uint16_t connectionIntervalMs);
+// Next frame sends every field absolute, e.g. for a new subscriber
+void telemetryStreamReset();
+
+// True when a frame is due; then encode one and report how it went
+bool telemetryStreamDue(uint32_t nowMs);
+// Milliseconds until the next frame is due, UINT32_MAX while stopped
+uint32_t telemetryStreamWaitMs(uint32_t nowMs);
+// Frame for the changes since the last one sent into out (TELEMETRY_STREAM_MAX_FRAME
+// bytes), at most MTU - 3 long. 0 if nothing changed.
+size_t telemetryStreamEncode(const TelemetryLive &live, uint32_t nowMs, uint8_t *out);
+// After each due slot: bytes the client was sent, 0 if none or if the notify
+// failed, which leaves the encoded changes due; and whether the link was congested
+void telemetryStreamSent(uint32_t nowMs, size_t bytes, bool congested);
+TelemetryStreamStats telemetryStreamStats();
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include "asset_store.h"
+#include "nav_math.h"
+
+// Terrain elevation for height above ground, from DEM tiles in their own
+// partition built by tools/terrain.py from SRTM .hgt files.
+//
+// The region is cut into square tiles of TERRAIN_TILE_SAMPLES x
+// TERRAIN_TILE_SAMPLES elevations, row 0 at the south edge. Neighbouring
+// tiles share their edge samples, so bilinear interpolation never needs more
+// than one tile. Each tile is stored quantized to a step of whole metres and
+// delta coded against the sample to its west (the first column against the
+// sample to its south) as zigzag varints, typically a little over a byte per
+// sample. Decoded tiles are kept in a small LRU cache in RAM; a lookup is a
+// cache probe and a bilinear blend, and a miss decodes one tile.
+#define TERRAIN_PARTITION "terrain"
+#define TERRAIN_MAGIC 0x4E525254 // "TRRN"
+#define TERRAIN_VERSION 1
+
+#define TERRAIN_TILE_SAMPLES 33 // 32 intervals per tile edge
+#define TERRAIN_CACHE_TILES 14
+#define TERRAIN_CACHE_BUDGET 32768 // Bytes of decoded tiles at most
+
+struct __attribute__((packed)) TerrainHeader {
+  AssetHeader asset;
+  int32_t originLat;    // South-west corner of tile 0, 1e-7 degrees
+  int32_t originLon;
+  int32_t tileSize;     // Tile edge, 1e-7 degrees
+  uint16_t cols;
+  uint16_t rows;
+  uint32_t indexOffset; // cols * rows + 1 uint32 offsets into the tile data; an empty range is a tile without data
+  uint32_t dataOffset;
+  uint32_t dataSize;
+};
+
+// Each tile's data starts with this, followed by the varints
+struct __attribute__((packed)) TerrainTileHeader {
+  int16_t base; // Metres, added to every quantized sample
+  uint8_t step; // Quantization step in metres
+};
+
+static_assert(sizeof(TerrainHeader) == 44, "Header layout is shared with the builder");
+static_assert(TERRAIN_CACHE_TILES * TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES * sizeof(int16_t) <= TERRAIN_CACHE_BUDGET,
+              "Terrain cache is over its memory budget");
+
+struct TerrainStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t lastMicros; // Last lookup, including any decode
+  uint32_t maxMicros;
+};
+
+// Map the tiles and check them. False if they are missing or corrupt.
+bool terrainBegin();
+// Elevation MSL in metres, NAN outside the tiles or where a tile is missing
+float terrainElevation(const NavPoint &point);
+TerrainStats terrainStats();
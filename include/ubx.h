@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "gps_fix.h"
+
+// u-blox UBX binary protocol: frame builder, streaming decoder and the few
+// NAV messages we need to fill a GpsFix.
+#define UBX_SYNC1 0xB5
+#define UBX_SYNC2 0x62
+#define UBX_FRAME_OVERHEAD 8 // Sync, class, id, length and checksum
+#define UBX_MAX_PAYLOAD 100  // NAV-PVT (92 bytes) is the largest message we accept
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_AID 0x0B
+#define UBX_CLASS_NMEA 0xF0 // Standard NMEA sentences, for CFG-MSG
+
+#define UBX_NAV_POSLLH 0x02
+#define UBX_NAV_SOL 0x06
+#define UBX_NAV_PVT 0x07
+#define UBX_NAV_VELNED 0x12
+#define UBX_NAV_TIMEUTC 0x21
+#define UBX_ACK_NAK 0x00
+#define UBX_ACK_ACK 0x01
+#define UBX_CFG_PRT 0x00
+#define UBX_CFG_MSG 0x01
+#define UBX_CFG_RATE 0x08
+#define UBX_CFG_CFG 0x09
+#define UBX_AID_INI 0x01
+#define UBX_NMEA_GLL 0x01
+#define UBX_NMEA_GSV 0x03
+#define UBX_NMEA_VTG 0x05
+
+#define UBX_PROTO_UBX 0x01
+#define UBX_PROTO_NMEA 0x02
+
+// Incremental frame decoder. Payload bytes are kept in one fixed buffer and
+// messages are decoded in place from it, nothing is copied or allocated.
+class UbxDecoder {
+  public:
+    UbxDecoder() { reset(); }
+
+    // Feed one byte, returns true when a complete frame with a valid checksum is ready
+    bool feed(uint8_t byte);
+    void reset() { state = 0; }
+    bool inFrame() const { return state != 0; }
+
+    uint8_t msgClass() const { return cls; }
+    uint8_t msgId() const { return id; }
+    uint16_t length() const { return len; }
+    const uint8_t *payload() const { return buffer; }
+
+    uint32_t frames() const { return frameCount; }
+    uint32_t checksumFailures() const { return failureCount; }
+
+  private:
+    uint8_t state;
+    uint8_t cls, id;
+    uint16_t len, pos;
+    uint8_t ckA, ckB;
+    uint32_t frameCount = 0;
+    uint32_t failureCount = 0;
+    uint8_t buffer[UBX_MAX_PAYLOAD];
+};
+
+// Build a complete frame into out (payloadLength + UBX_FRAME_OVERHEAD bytes), returns its size
+size_t ubxBuildFrame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t payloadLength, uint8_t *out);
+
+// Decode a NAV message into fix. Returns true if it was one we understand.
+bool ubxApplyNav(const UbxDecoder &frame, GpsFix &fix);
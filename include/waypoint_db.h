@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include "asset_store.h"
+#include "nav_math.h"
+
+// Read-only waypoint database in its own flash partition, built on the host
+// by tools/waypoint_db.py from a CSV. The image is mapped through the asset
+// store, so queries read records straight from flash and nothing is copied
+// into RAM.
+//
+// Layout, little-endian: header, then a uniform grid of cells over the
+// bounding box of all waypoints, then the records sorted by cell, then
+// NUL-terminated names. Cell i holds records cellStart[i] .. cellStart[i + 1] - 1.
+// Queries visit cells in rings around the query point and stop as soon as no
+// unvisited cell can hold anything closer, so the work depends on the local
+// density and not on the size of the set.
+//
+// The database has two slots. The host tools flash the first; an upload over
+// BLE goes to whichever one is not open, and the newest valid one is opened.
+#define WAYPOINT_DB_PARTITION "waypoints"
+#define WAYPOINT_DB_PARTITION_B "waypoints_b"
+#define WAYPOINT_DB_MAGIC 0x42445057 // "WPDB"
+#define WAYPOINT_DB_VERSION 1
+
+#define WAYPOINT_TYPE_OTHER 0
+#define WAYPOINT_TYPE_LANDABLE 1
+#define WAYPOINT_TYPE_FUEL 2
+#define WAYPOINT_TYPE_ANY 0xFF // Type mask matching every type
+
+#define WAYPOINT_FLAG_ENABLED 0x01
+
+struct __attribute__((packed)) WaypointDbHeader {
+  AssetHeader asset;
+  uint32_t count;         // Records
+  int32_t originLat;      // South-west corner of the grid, 1e-7 degrees
+  int32_t originLon;
+  int32_t cellSize;       // Cell edge, 1e-7 degrees
+  uint16_t cols;
+  uint16_t rows;
+  uint32_t cellsOffset;   // cols * rows + 1 uint32 start indices
+  uint32_t recordsOffset; // count WaypointRecord
+  uint32_t namesOffset;   // Name table
+  uint32_t namesSize;
+};
+
+struct __attribute__((packed)) WaypointRecord {
+  NavPoint point;
+  uint32_t nameOffset; // Into the name table
+  uint8_t type;        // WAYPOINT_TYPE_*
+  uint8_t flags;       // WAYPOINT_FLAG_*
+  int16_t elevation;   // Metres MSL, as given in the CSV
+};
+
+static_assert(sizeof(WaypointDbHeader) == 52, "Header layout is shared with the builder");
+static_assert(sizeof(WaypointRecord) == 16, "Record layout is shared with the builder");
+
+struct WaypointHit {
+  uint32_t index;
+  float distanceMeters;
+};
+
+// Map the newest of the two slots that checks out. False if neither does.
+bool waypointDbBegin();
+// Unmap; queries then find nothing
+void waypointDbEnd();
+// What is open, to write a new image to the other slot; base is nullptr if nothing is
+const AssetImage &waypointDbImage();
+uint32_t waypointDbCount();
+// Record by index; the name points into flash and stays valid
+const WaypointRecord *waypointDbRecord(uint32_t index);
+const char *waypointDbName(const WaypointRecord &record);
+// Up to maxHits nearest enabled waypoints whose type is in typeMask (bit per
+// WAYPOINT_TYPE_*), closest first. Returns how many were found.
+uint16_t waypointDbNearest(const NavPoint &at, uint8_t typeMask, WaypointHit *hits, uint16_t maxHits);
+// Like waypointDbNearest, limited to radiusMeters
+uint16_t waypointDbWithin(const NavPoint &at, float radiusMeters, uint8_t typeMask,
+                          WaypointHit *hits, uint16_t maxHits);
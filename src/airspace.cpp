@@ -0,0 +1,230 @@
+#include "airspace.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+#define METERS_PER_UNIT (NAV_EARTH_RADIUS_M * 1.745329252e-9f) // Along a meridian, per 1e-7 degree
+#define RAD_PER_UNIT 1.745329252e-9f
+
+static AssetImage image;
+static const AirspaceHeader *header = nullptr;
+static AssetArray<AirspaceArea> areas;
+static AssetArray<NavPoint> vertices;
+static AssetArray<uint32_t> cellStart;
+static AssetArray<uint16_t> cellList;
+static AssetStrings names;
+
+static AirspaceStatus status = {AIRSPACE_LEVEL_NONE, 0, 0.0f, 0.0f};
+static AirspaceStats stats = {0, 0, 0, 0};
+
+// A pass over one cell's areas, which may take several fixes
+static int32_t passCell = -1;
+static uint32_t passCursor = 0;
+static AirspaceStatus passWorst;
+
+static const AirspaceStatus noWarning = {AIRSPACE_LEVEL_NONE, 0, 0.0f, 0.0f};
+
+// Flat projection around the aircraft, metres east and north
+struct Local {
+  NavPoint at;
+  float xScale;
+  float yScale;
+};
+
+static inline void project(const Local &local, const NavPoint &p, float &x, float &y) {
+  x = (float)((int64_t)p.lon - local.at.lon) * local.xScale;
+  y = (float)((int64_t)p.lat - local.at.lat) * local.yScale;
+}
+
+bool airspaceBegin() {
+  header = nullptr;
+  if (!assetOpen(AIRSPACE_PARTITION, ASSET_SUBTYPE_AIRSPACE, AIRSPACE_MAGIC, AIRSPACE_VERSION, image)) {
+    return false;
+  }
+
+  const AirspaceHeader *h = assetHeader<AirspaceHeader>(image);
+  bool ok = h && h->cols > 0 && h->rows > 0 && h->cellSize > 0 &&
+            assetArray(image, h->areasOffset, h->areaCount, areas) &&
+            assetArray(image, h->verticesOffset, h->vertexCount, vertices) &&
+            assetArray(image, h->cellsOffset, (uint32_t)h->cols * h->rows + 1, cellStart) &&
+            assetArray(image, h->cellListOffset, h->cellListCount, cellList) &&
+            assetStrings(image, h->namesOffset, h->namesSize, names) &&
+            cellStart[0] == 0 && cellStart[cellStart.count - 1] == h->cellListCount;
+
+  // Everything the evaluator indexes must stay inside the image
+  for (uint32_t i = 0; ok && i + 1 < cellStart.count; i++) {
+    ok = cellStart[i] <= cellStart[i + 1];
+  }
+  for (uint32_t i = 0; ok && i < cellList.count; i++) {
+    ok = cellList[i] < h->areaCount;
+  }
+  for (uint32_t i = 0; ok && i < areas.count; i++) {
+    const AirspaceArea &area = areas[i];
+    ok = (uint64_t)area.firstVertex + area.vertexCount <= h->vertexCount &&
+         (area.flags & AIRSPACE_FLAG_CIRCLE ? area.vertexCount == 1 : area.vertexCount >= 3) &&
+         area.vertexCount <= AIRSPACE_VERTEX_BUDGET;
+  }
+  if (!ok) {
+    assetClose(image);
+    return false;
+  }
+
+  header = h;
+  passCell = -1;
+  status = noWarning;
+  return true;
+}
+
+uint32_t airspaceCount() {
+  return header ? header->areaCount : 0;
+}
+
+const AirspaceArea *airspaceArea(uint32_t index) {
+  return header ? areas.at(index) : nullptr;
+}
+
+const char *airspaceName(uint32_t index) {
+  const AirspaceArea *area = airspaceArea(index);
+  return area ? names.at(area->nameOffset) : "";
+}
+
+const AirspaceStatus &airspaceStatus() {
+  return status;
+}
+
+AirspaceStats airspaceStats() {
+  return stats;
+}
+
+// More severe first, then closer
+static bool worse(const AirspaceStatus &a, const AirspaceStatus &b) {
+  if (a.level != b.level) {
+    return a.level > b.level;
+  }
+  return a.level != AIRSPACE_LEVEL_NONE && a.horizontalMeters + a.verticalMeters < b.horizontalMeters + b.verticalMeters;
+}
+
+// Distance from the aircraft to the area's lateral boundary; inside tells which side
+static float lateralDistance(const AirspaceArea &area, const Local &local, bool &inside) {
+  float x, y;
+  if (area.flags & AIRSPACE_FLAG_CIRCLE) {
+    project(local, vertices[area.firstVertex], x, y);
+    float d = sqrtf(x * x + y * y);
+    inside = d <= area.radiusMeters;
+    return fabsf(d - area.radiusMeters);
+  }
+
+  // Crossing test along a ray to the east, and the nearest edge, in one walk
+  inside = false;
+  float nearest2 = INFINITY;
+  float xj, yj;
+  project(local, vertices[area.firstVertex + area.vertexCount - 1], xj, yj);
+  for (uint32_t i = 0; i < area.vertexCount; i++) {
+    float xi, yi;
+    project(local, vertices[area.firstVertex + i], xi, yi);
+    if ((yi > 0.0f) != (yj > 0.0f) && xi + (xj - xi) * (-yi) / (yj - yi) > 0.0f) {
+      inside = !inside;
+    }
+    float dx = xj - xi;
+    float dy = yj - yi;
+    float length2 = dx * dx + dy * dy;
+    float t = length2 > 0.0f ? -(xi * dx + yi * dy) / length2 : 0.0f;
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    float px = xi + t * dx;
+    float py = yi + t * dy;
+    nearest2 = fminf(nearest2, px * px + py * py);
+    xj = xi;
+    yj = yi;
+  }
+  return sqrtf(nearest2);
+}
+
+static float verticalDistance(const AirspaceArea &area, float altitude, float ground) {
+  float floor = area.floorMeters + (area.flags & AIRSPACE_FLAG_FLOOR_AGL ? ground : 0.0f);
+  float ceiling = area.ceilingMeters + (area.flags & AIRSPACE_FLAG_CEILING_AGL ? ground : 0.0f);
+  if (altitude < floor) return floor - altitude;
+  if (altitude > ceiling) return altitude - ceiling;
+  return 0.0f;
+}
+
+const AirspaceStatus &airspaceEvaluate(const GpsFix &fix, float groundMeters) {
+  uint32_t started = micros();
+  if (!header || !fix.location.isValid()) {
+    status = noWarning;
+    passCell = -1;
+    return status;
+  }
+
+  NavPoint at = fix.location.point;
+  int64_t col = ((int64_t)at.lon - header->originLon) / header->cellSize;
+  int64_t row = ((int64_t)at.lat - header->originLat) / header->cellSize;
+  if (at.lon < header->originLon || at.lat < header->originLat || col >= header->cols || row >= header->rows) {
+    status = noWarning; // Nothing is within the warning margin outside the grid
+    passCell = -1;
+    return status;
+  }
+  int32_t cell = (int32_t)(row * header->cols + col);
+  if (cell != passCell) {
+    passCell = cell;
+    passCursor = 0;
+    passWorst = noWarning;
+  }
+
+  Local local;
+  local.at = at;
+  local.yScale = METERS_PER_UNIT;
+  local.xScale = METERS_PER_UNIT * cosf(at.lat * RAD_PER_UNIT);
+  float nearHorizontal = fminf(AIRSPACE_NEAR_HORIZONTAL_M, (float)header->marginMeters);
+  int32_t latMargin = (int32_t)(nearHorizontal / local.yScale) + 1;
+  int32_t lonMargin = (int32_t)(nearHorizontal / fmaxf(local.xScale, 1e-6f)) + 1;
+  float altitude = fix.altitude.isValid() ? fix.altitude.value : NAN;
+  float ground = isnan(groundMeters) ? 0.0f : groundMeters;
+
+  uint32_t first = cellStart[cell];
+  uint32_t count = cellStart[cell + 1] - first;
+  uint32_t budget = AIRSPACE_VERTEX_BUDGET;
+  while (passCursor < count) {
+    uint16_t index = cellList[first + passCursor];
+    const AirspaceArea &area = areas[index];
+    if (at.lat < area.minLat - latMargin || at.lat > area.maxLat + latMargin ||
+        at.lon < area.minLon - lonMargin || at.lon > area.maxLon + lonMargin) {
+      passCursor++;
+      continue;
+    }
+    // An area that doesn't fit what is left waits for the next fix. None is
+    // larger than the whole budget, so every evaluation gets at least one done.
+    if (area.vertexCount > budget) {
+      break;
+    }
+    budget -= area.vertexCount;
+    passCursor++;
+
+    bool inside;
+    AirspaceStatus result = {AIRSPACE_LEVEL_NONE, index, 0.0f, 0.0f};
+    float lateral = lateralDistance(area, local, inside);
+    // Without an altitude assume we are between floor and ceiling
+    result.verticalMeters = isnan(altitude) ? 0.0f : verticalDistance(area, altitude, ground);
+    result.horizontalMeters = inside ? 0.0f : lateral;
+    if (inside && result.verticalMeters == 0.0f) {
+      result.level = AIRSPACE_LEVEL_INSIDE;
+    } else if (result.horizontalMeters <= nearHorizontal && result.verticalMeters <= AIRSPACE_NEAR_VERTICAL_M) {
+      result.level = AIRSPACE_LEVEL_NEAR;
+    }
+
+    if (worse(result, passWorst)) passWorst = result;
+    if (worse(result, status)) status = result; // Don't wait for the pass to finish to warn
+  }
+
+  if (passCursor >= count) {
+    status = passWorst;
+    passCursor = 0;
+    passWorst = noWarning;
+  } else {
+    stats.deferredPasses++;
+  }
+
+  stats.lastVertices = AIRSPACE_VERTEX_BUDGET - budget;
+  stats.lastMicros = micros() - started;
+  if (stats.lastMicros > stats.maxMicros) stats.maxMicros = stats.lastMicros;
+  return status;
+}
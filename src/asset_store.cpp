@@ -0,0 +1,276 @@
+#include "asset_store.h"
+
+#include <string.h>
+#include "crc32.h"
+
+#ifdef ESP_PLATFORM
+#include <esp_partition.h>
+#else
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *hostDirectory = ".";
+
+void assetSetHostDirectory(const char *directory) {
+  hostDirectory = directory;
+}
+#endif
+
+static bool headerValid(const AssetHeader &header, uint32_t magic, uint16_t version, size_t available) {
+  return header.magic == magic && header.version == version && header.headerSize >= sizeof(AssetHeader) &&
+         header.totalSize >= header.headerSize && header.totalSize <= available;
+}
+
+// Find the image, check its header against the space it sits in and map all of it
+static const uint8_t *mapImage(const char *label, uint8_t subtype, uint32_t magic, uint16_t version,
+                               AssetImage &image) {
+#ifdef ESP_PLATFORM
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+  AssetHeader header;
+  if (!partition || esp_partition_read(partition, 0, &header, sizeof(header)) != ESP_OK ||
+      !headerValid(header, magic, version, partition->size)) {
+    return nullptr;
+  }
+  const void *mapped = nullptr;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, header.totalSize, ESP_PARTITION_MMAP_DATA, &mapped, &handle) != ESP_OK) {
+    return nullptr;
+  }
+  image.mapHandle = handle;
+  image.mapLength = header.totalSize;
+  return (const uint8_t *)mapped;
+#else
+  (void)subtype;
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s.bin", hostDirectory, label);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  AssetHeader header;
+  if (fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+      !headerValid(header, magic, version, (size_t)st.st_size)) {
+    close(fd);
+    return nullptr;
+  }
+  void *mapped = mmap(nullptr, header.totalSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  image.mapHandle = 0;
+  image.mapLength = header.totalSize;
+  return (const uint8_t *)mapped;
+#endif
+}
+
+// Where the slot trailer of an image of this size goes
+static uint64_t trailerOffset(uint32_t size) {
+  return ((uint64_t)size + 3) & ~(uint64_t)3;
+}
+
+static bool readSlot(const char *label, uint8_t subtype, uint64_t offset, void *data, size_t length) {
+#ifdef ESP_PLATFORM
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+  return partition && offset + length <= partition->size &&
+         esp_partition_read(partition, offset, data, length) == ESP_OK;
+#else
+  (void)subtype;
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s.bin", hostDirectory, label);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = pread(fd, data, length, (off_t)offset) == (ssize_t)length;
+  close(fd);
+  return ok;
+#endif
+}
+
+// Generation the slot's trailer claims, without checking the image itself
+static uint32_t slotGeneration(const char *label, uint8_t subtype) {
+  AssetHeader header;
+  AssetSlotTrailer trailer;
+  if (!readSlot(label, subtype, 0, &header, sizeof(header)) ||
+      !readSlot(label, subtype, trailerOffset(header.totalSize), &trailer, sizeof(trailer))) {
+    return 0;
+  }
+  return trailer.magic == ASSET_SLOT_MAGIC && trailer.crc == header.crc ? trailer.generation : 0;
+}
+
+static void unmapImage(AssetImage &image) {
+#ifdef ESP_PLATFORM
+  spi_flash_munmap(image.mapHandle);
+#else
+  munmap((void *)image.base, image.mapLength);
+#endif
+}
+
+bool assetOpen(const char *label, uint8_t subtype, uint32_t magic, uint16_t version, AssetImage &image) {
+  memset(&image, 0, sizeof(image));
+  const uint8_t *base = mapImage(label, subtype, magic, version, image);
+  if (!base) {
+    return false;
+  }
+  image.base = base;
+
+  // The header was read before mapping; read it again from the mapping so the CRC covers what readers see
+  const AssetHeader *header = (const AssetHeader *)base;
+  image.size = header->totalSize;
+  if (image.size != image.mapLength ||
+      crc32Update(0, base + header->headerSize, image.size - header->headerSize) != header->crc) {
+    assetClose(image);
+    return false;
+  }
+  image.generation = slotGeneration(label, subtype);
+  return true;
+}
+
+bool assetOpenSlots(const char *const labels[ASSET_SLOTS], uint8_t subtype, uint32_t magic, uint16_t version,
+                    AssetImage &image) {
+  static_assert(ASSET_SLOTS == 2, "Slots are tried newest first, then the other one");
+  uint8_t newest = slotGeneration(labels[1], subtype) > slotGeneration(labels[0], subtype) ? 1 : 0;
+  const uint8_t order[ASSET_SLOTS] = {newest, (uint8_t)(1 - newest)};
+  for (uint8_t slot : order) {
+    if (assetOpen(labels[slot], subtype, magic, version, image)) {
+      image.slot = slot;
+      return true;
+    }
+  }
+  return false;
+}
+
+void assetClose(AssetImage &image) {
+  if (image.base) {
+    unmapImage(image);
+  }
+  memset(&image, 0, sizeof(image));
+}
+
+static bool writerErase(AssetWriter &writer, uint32_t offset) {
+#ifdef ESP_PLATFORM
+  return esp_partition_erase_range((const esp_partition_t *)writer.partition, offset, ASSET_SECTOR_SIZE) == ESP_OK;
+#else
+  uint8_t erased[ASSET_SECTOR_SIZE];
+  memset(erased, 0xFF, sizeof(erased));
+  return pwrite(writer.fd, erased, sizeof(erased), offset) == (ssize_t)sizeof(erased);
+#endif
+}
+
+static bool writerWrite(AssetWriter &writer, uint32_t offset, const uint8_t *data, size_t length) {
+#ifdef ESP_PLATFORM
+  return esp_partition_write((const esp_partition_t *)writer.partition, offset, data, length) == ESP_OK;
+#else
+  return pwrite(writer.fd, data, length, offset) == (ssize_t)length;
+#endif
+}
+
+static bool writerRead(const AssetWriter &writer, uint32_t offset, uint8_t *data, size_t length) {
+#ifdef ESP_PLATFORM
+  return esp_partition_read((const esp_partition_t *)writer.partition, offset, data, length) == ESP_OK;
+#else
+  return pread(writer.fd, data, length, offset) == (ssize_t)length;
+#endif
+}
+
+// Erase the sectors up to end that writes haven't reached yet
+static bool eraseTo(AssetWriter &writer, uint64_t end) {
+  while (writer.erasedTo < end) {
+    if (!writerErase(writer, writer.erasedTo)) {
+      return false;
+    }
+    writer.erasedTo += ASSET_SECTOR_SIZE;
+  }
+  return true;
+}
+
+bool assetWriteBegin(const char *label, uint8_t subtype, uint32_t size, uint32_t generation, AssetWriter &writer) {
+  memset(&writer, 0, sizeof(writer));
+  if (size < sizeof(AssetHeader)) {
+    return false;
+  }
+#ifdef ESP_PLATFORM
+  const esp_partition_t *partition =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)subtype, label);
+  if (!partition || trailerOffset(size) + sizeof(AssetSlotTrailer) > partition->size) {
+    return false;
+  }
+  writer.partition = partition;
+#else
+  (void)subtype;
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s.bin", hostDirectory, label);
+  writer.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (writer.fd < 0) {
+    return false;
+  }
+#endif
+  writer.active = true;
+  writer.size = size;
+  writer.generation = generation;
+  memset(writer.header, 0xFF, sizeof(writer.header));
+  // From here on the old image no longer opens
+  if (!writerErase(writer, 0)) {
+    assetWriteAbort(writer);
+    return false;
+  }
+  writer.erasedTo = ASSET_SECTOR_SIZE;
+  return true;
+}
+
+bool assetWrite(AssetWriter &writer, uint32_t offset, const uint8_t *data, size_t length) {
+  if (!writer.active || (uint64_t)offset + length > writer.size) {
+    return false;
+  }
+  // The header goes to flash last, at commit
+  while (length > 0 && offset < sizeof(AssetHeader)) {
+    writer.header[offset++] = *data++;
+    length--;
+  }
+  if (!eraseTo(writer, (uint64_t)offset + length)) {
+    return false;
+  }
+  return length == 0 || writerWrite(writer, offset, data, length);
+}
+
+bool assetWriteCrc(const AssetWriter &writer, uint32_t &crc) {
+  crc = crc32Update(0, writer.header, sizeof(writer.header));
+  uint8_t buffer[256];
+  for (uint32_t offset = sizeof(AssetHeader); offset < writer.size; offset += sizeof(buffer)) {
+    size_t length = writer.size - offset < sizeof(buffer) ? writer.size - offset : sizeof(buffer);
+    if (!writerRead(writer, offset, buffer, length)) {
+      return false;
+    }
+    crc = crc32Update(crc, buffer, length);
+  }
+  return true;
+}
+
+bool assetWriteCommit(AssetWriter &writer) {
+  AssetHeader header;
+  memcpy(&header, writer.header, sizeof(header));
+  AssetSlotTrailer trailer = {ASSET_SLOT_MAGIC, writer.generation, header.crc};
+  uint64_t offset = trailerOffset(writer.size);
+  // Without its header the image doesn't open yet, trailer or not
+  bool ok = writer.active && eraseTo(writer, offset + sizeof(trailer)) &&
+            writerWrite(writer, (uint32_t)offset, (const uint8_t *)&trailer, sizeof(trailer)) &&
+            writerWrite(writer, 0, writer.header, sizeof(writer.header));
+  assetWriteAbort(writer);
+  return ok;
+}
+
+void assetWriteAbort(AssetWriter &writer) {
+#ifndef ESP_PLATFORM
+  if (writer.active) {
+    close(writer.fd);
+  }
+#endif
+  writer.active = false;
+}
@@ -0,0 +1,263 @@
+#include "ble_command_parser.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MAX_FIELDS (BLE_COMMAND_MAX_ARGS + 2) // Verb, arguments, and one more to notice extras
+#define MAX_DIGITS 18                         // Significant digits that fit the int64 mantissa
+#define MAX_EXPONENT 999                      // Larger exponents over- or underflow a double anyway
+
+#define ARG_INTEGER 1
+#define ARG_DECIMAL 2
+#define ARG_LATITUDE 3
+#define ARG_LONGITUDE 4
+
+struct Keyword {
+  const char *name;
+  uint8_t verb;
+  uint8_t minArgs;
+  uint8_t maxArgs;
+  uint8_t types[BLE_COMMAND_MAX_ARGS]; // ARG_*
+  const char *usage;
+};
+
+struct Field {
+  const char *start;
+  uint8_t length;
+};
+
+// Sorted by name for the binary search; checked at compile time below
+static constexpr Keyword keywords[] = {
+  {"FUEL", BLE_VERB_FUEL, 2, 3, {ARG_DECIMAL, ARG_DECIMAL, ARG_DECIMAL}, "FUEL:<level>:<rate>[:<added>]"},
+  {"GET_DATA", BLE_VERB_GET_DATA, 0, 0, {}, "GET_DATA"},
+  {"MODE", BLE_VERB_MODE, 1, 1, {ARG_INTEGER}, "MODE:<mode>"},
+  {"POI", BLE_VERB_POI, 4, 4, {ARG_INTEGER, ARG_LATITUDE, ARG_LONGITUDE, ARG_INTEGER},
+   "POI:<index>:<lat>:<lon>:<enabled>"},
+  {"STREAM", BLE_VERB_STREAM, 1, 1, {ARG_INTEGER}, "STREAM:<hz>"},
+};
+static constexpr size_t KEYWORD_COUNT = sizeof(keywords) / sizeof(keywords[0]);
+
+static constexpr Keyword legacyPoi = {nullptr, BLE_VERB_LEGACY_POI, 3, 3, {ARG_LATITUDE, ARG_LONGITUDE, ARG_INTEGER},
+                                      "<lat>:<lon>:<enabled>"};
+
+static constexpr int compareNames(const char *a, const char *b) {
+  while (*a && *a == *b) {
+    a++;
+    b++;
+  }
+  return (unsigned char)*a - (unsigned char)*b;
+}
+
+static constexpr bool keywordsSorted() {
+  for (size_t i = 1; i < KEYWORD_COUNT; i++) {
+    if (compareNames(keywords[i - 1].name, keywords[i].name) >= 0) return false;
+  }
+  return true;
+}
+
+static_assert(keywordsSorted(), "Keyword table must be sorted by name");
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                     1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+// Field against a NUL-terminated keyword, strcmp style
+static int compareField(const Field &field, const char *name) {
+  int order = strncmp(field.start, name, field.length);
+  return order ? order : (name[field.length] ? -1 : 0);
+}
+
+static const Keyword *findKeyword(const Field &field) {
+  size_t low = 0;
+  size_t high = KEYWORD_COUNT;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    int order = compareField(field, keywords[middle].name);
+    if (order == 0) return &keywords[middle];
+    if (order < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return nullptr;
+}
+
+// Case-insensitive match of the whole field
+static bool fieldIs(const Field &field, const char *name) {
+  size_t length = strlen(name);
+  return field.length == length && strncasecmp(field.start, name, length) == 0;
+}
+
+// What JavaScript prints for a number that isn't one: NaN, Infinity, -Infinity
+static bool parseNonFinite(const Field &field, double &value) {
+  Field rest = field;
+  bool negative = false;
+  if (rest.length && (*rest.start == '-' || *rest.start == '+')) {
+    negative = *rest.start == '-';
+    rest.start++;
+    rest.length--;
+  }
+  if (fieldIs(rest, "nan")) {
+    value = NAN;
+  } else if (fieldIs(rest, "infinity") || fieldIs(rest, "inf")) {
+    value = negative ? -INFINITY : INFINITY;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// [+-]digits[.digits][e[+-]digits], at least one digit. Exact for up to 15
+// significant digits, which is all a coordinate in 1e-7 degrees needs. The
+// exponent is what JavaScript's number to string gives below 1e-6.
+static bool parseNumber(const Field &field, bool allowFraction, double &value) {
+  const char *p = field.start;
+  const char *end = field.start + field.length;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+  }
+  int64_t mantissa = 0;
+  uint8_t digits = 0;
+  int32_t scale = 0; // Power of ten to apply to the mantissa
+  bool seenPoint = false;
+  bool any = false;
+  for (; p < end; p++) {
+    if (*p == '.' && allowFraction && !seenPoint) {
+      seenPoint = true;
+      continue;
+    }
+    if ((*p == 'e' || *p == 'E') && allowFraction && any) {
+      break;
+    }
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    any = true;
+    if (digits == 0 && *p == '0') {
+      if (seenPoint) scale--;
+      continue; // Leading zeros don't use up digits
+    }
+    if (digits == MAX_DIGITS) {
+      if (!seenPoint) scale++; // Integer digits beyond the precision still count
+      continue;
+    }
+    mantissa = mantissa * 10 + (*p - '0');
+    digits++;
+    if (seenPoint) scale--;
+  }
+  if (!any) {
+    return false;
+  }
+  if (!allowFraction && scale > 0) {
+    return false; // Integer too long
+  }
+
+  if (p < end) {
+    p++; // The 'e'
+    bool negativeExponent = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negativeExponent = *p++ == '-';
+    }
+    if (p == end) {
+      return false;
+    }
+    int32_t exponent = 0;
+    for (; p < end; p++) {
+      if (*p < '0' || *p > '9') return false;
+      exponent = exponent * 10 + (*p - '0');
+      if (exponent > MAX_EXPONENT) exponent = MAX_EXPONENT;
+    }
+    scale += negativeExponent ? -exponent : exponent;
+  }
+
+  value = (double)mantissa;
+  if (mantissa) {
+    for (; scale > MAX_DIGITS; scale -= MAX_DIGITS) value *= powersOfTen[MAX_DIGITS];
+    for (; scale < -MAX_DIGITS; scale += MAX_DIGITS) value /= powersOfTen[MAX_DIGITS];
+    value = scale < 0 ? value / powersOfTen[-scale] : value * powersOfTen[scale];
+  }
+  if (negative) value = -value;
+  return true;
+}
+
+static uint8_t parseArg(const Field &field, uint8_t type, BleArg &arg) {
+  double value;
+  if (type != ARG_INTEGER && parseNonFinite(field, value)) {
+    arg.decimal = NAN; // Not set
+    return BLE_PARSE_OK;
+  }
+  if (!parseNumber(field, type != ARG_INTEGER, value)) {
+    return BLE_PARSE_NUMBER;
+  }
+  if (isinf(value)) {
+    return BLE_PARSE_RANGE; // Overflowed the exponent
+  }
+  switch (type) {
+    case ARG_INTEGER:
+      if (value < INT32_MIN || value > INT32_MAX) return BLE_PARSE_NUMBER;
+      arg.integer = (int32_t)value;
+      return BLE_PARSE_OK;
+    case ARG_LATITUDE:
+      if (value < -90.0 || value > 90.0) return BLE_PARSE_RANGE;
+      break;
+    case ARG_LONGITUDE:
+      if (value < -180.0 || value > 180.0) return BLE_PARSE_RANGE;
+      break;
+  }
+  arg.decimal = value;
+  return BLE_PARSE_OK;
+}
+
+uint8_t bleCommandParse(const char *text, BleCommand &command) {
+  command.verb = BLE_VERB_NONE;
+  command.argCount = 0;
+  command.usage = "";
+
+  // Split on ':' in one pass, without touching the text
+  Field fields[MAX_FIELDS];
+  uint8_t fieldCount = 0;
+  const char *start = text;
+  for (const char *p = text;; p++) {
+    if (*p == ':' || *p == '\0') {
+      if (fieldCount == MAX_FIELDS || p - start > UINT8_MAX) {
+        return BLE_PARSE_ARGS;
+      }
+      fields[fieldCount++] = {start, (uint8_t)(p - start)};
+      if (*p == '\0') break;
+      start = p + 1;
+    }
+  }
+
+  const Keyword *keyword;
+  uint8_t firstArg;
+  char first = fields[0].length ? fields[0].start[0] : '\0';
+  double unset;
+  if ((first >= '0' && first <= '9') || first == '-' || first == '+' || first == '.' ||
+      parseNonFinite(fields[0], unset)) {
+    keyword = &legacyPoi;
+    firstArg = 0;
+  } else {
+    keyword = findKeyword(fields[0]);
+    firstArg = 1;
+  }
+  if (!keyword) {
+    return BLE_PARSE_UNKNOWN;
+  }
+  command.verb = keyword->verb;
+  command.usage = keyword->usage;
+
+  uint8_t argCount = fieldCount - firstArg;
+  if (argCount < keyword->minArgs || argCount > keyword->maxArgs) {
+    return BLE_PARSE_ARGS;
+  }
+  for (uint8_t i = 0; i < argCount; i++) {
+    uint8_t result = parseArg(fields[firstArg + i], keyword->types[i], command.args[i]);
+    if (result != BLE_PARSE_OK) {
+      return result;
+    }
+  }
+  command.argCount = argCount;
+  return BLE_PARSE_OK;
+}
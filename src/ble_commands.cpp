@@ -0,0 +1,41 @@
+#include "ble_commands.h"
+
+#include <atomic>
+#include <string.h>
+#include "spsc_ring.h"
+
+static SpscRing<BLE_COMMAND_MAX_LENGTH, BLE_COMMAND_SLOTS> ring;
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<uint32_t> oversized(0);
+
+bool bleCommandPush(const uint8_t *data, size_t length) {
+  while (length > 0 && (data[length - 1] == '\r' || data[length - 1] == '\n' || data[length - 1] == '\0')) {
+    length--;
+  }
+  if (length > BLE_COMMAND_MAX_LENGTH) {
+    oversized.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  if (!ring.push(data, length)) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool bleCommandPop(char *out) {
+  size_t length;
+  if (!ring.pop((uint8_t *)out, length)) {
+    return false;
+  }
+  out[length] = '\0';
+  return true;
+}
+
+bool bleCommandPending() {
+  return !ring.empty();
+}
+
+BleCommandStats bleCommandStats() {
+  return {ring.pushed(), dropped.load(std::memory_order_relaxed), oversized.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,191 @@
+#include "ble_governor.h"
+
+struct AdvertisingPhase {
+  uint32_t untilMs; // Since advertising (re)started
+  BleAdvertisingParams params;
+};
+
+struct LinkProfile {
+  BleLinkParams params;
+  uint32_t holdMs; // Kept this long after the last demand for it
+};
+
+// Apple's recommended intervals: 20 ms for the first 30 s, then 152.5 ms,
+// then 1022.5 ms and up
+static const AdvertisingPhase phases[BLE_ADVERTISING_PHASES] = {
+  {30000, {32, 48}},                   // 20-30 ms
+  {120000, {244, 338}},                // 152.5-211.25 ms
+  {BLE_RADIO_TIMEOUT_MS, {1636, 2056}}, // 1022.5-1285 ms
+};
+
+// Interval max * (latency + 1) <= 2 s, min + 15 ms <= max, timeout > 3 * max * (latency + 1)
+static const LinkProfile profiles[BLE_LINK_PROFILES] = {
+  {{144, 160, 4, 500}, 0},     // Idle: 180-200 ms, up to 4 events skipped, 5 s timeout
+  {{24, 40, 0, 400}, 15000},   // Active: 30-50 ms, 4 s timeout
+  {{12, 24, 0, 400}, 3000},    // Bulk: 15-30 ms, 4 s timeout
+};
+
+static uint8_t state = BLE_RADIO_OFF;
+static uint8_t phase;
+static uint16_t advertisingFloor = 0;
+static uint32_t advertisingSinceMs;
+static bool advertisePending; // Advertising to (re)start once restartAtMs passes
+static uint32_t restartAtMs;
+static bool wakeRequested;
+static uint8_t link;
+static uint32_t lastDemandMs[BLE_LINK_PROFILES];
+static uint32_t accountedMs;
+static BleRadioStats stats = {};
+
+// Phase actually advertised: the schedule's, or the first one the floor allows
+static uint8_t effectivePhase() {
+  uint8_t effective = phase;
+  while (effective + 1 < BLE_ADVERTISING_PHASES && phases[effective].params.minInterval < advertisingFloor) {
+    effective++;
+  }
+  return effective;
+}
+
+// Charge the time since the last call to the current state
+static void account(uint32_t nowMs) {
+  uint32_t elapsed = nowMs - accountedMs;
+  accountedMs = nowMs;
+  if (state == BLE_RADIO_ADVERTISING) {
+    stats.advertisingMs[effectivePhase()] += elapsed;
+  } else if (state == BLE_RADIO_CONNECTED) {
+    stats.connectedMs[link] += elapsed;
+  } else {
+    stats.offMs += elapsed;
+  }
+}
+
+static void startAdvertising(uint32_t nowMs, uint32_t delayMs) {
+  state = BLE_RADIO_ADVERTISING;
+  phase = 0;
+  advertisingSinceMs = nowMs;
+  advertisePending = true;
+  restartAtMs = nowMs + delayMs;
+}
+
+// As if no profile had been demanded within its hold time
+static void forgetDemand(uint32_t nowMs) {
+  for (uint8_t profile = 0; profile < BLE_LINK_PROFILES; profile++) {
+    lastDemandMs[profile] = nowMs - profiles[profile].holdMs;
+  }
+}
+
+void bleGovernorBegin(uint32_t nowMs) {
+  accountedMs = nowMs;
+  link = BLE_LINK_IDLE;
+  forgetDemand(nowMs);
+  startAdvertising(nowMs, 0);
+  advertisePending = false; // setup() starts advertising itself
+  wakeRequested = false;
+}
+
+void bleGovernorWake(uint32_t nowMs) {
+  account(nowMs);
+  if (state == BLE_RADIO_OFF) {
+    wakeRequested = true;
+  } else if (state == BLE_RADIO_ADVERTISING && phase > 0) {
+    startAdvertising(nowMs, 0);
+  }
+}
+
+void bleGovernorSetAdvertisingFloor(uint16_t minInterval, uint32_t nowMs) {
+  account(nowMs);
+  uint8_t before = effectivePhase();
+  advertisingFloor = minInterval;
+  if (state == BLE_RADIO_ADVERTISING && effectivePhase() != before && !advertisePending) {
+    advertisePending = true;
+    restartAtMs = nowMs;
+  }
+}
+
+// Fastest profile demanded within its hold time
+static uint8_t linkTarget(uint32_t nowMs) {
+  for (uint8_t profile = BLE_LINK_PROFILES - 1; profile > BLE_LINK_IDLE; profile--) {
+    if (nowMs - lastDemandMs[profile] < profiles[profile].holdMs) return profile;
+  }
+  return BLE_LINK_IDLE;
+}
+
+uint8_t bleGovernorService(uint32_t nowMs, bool connected, uint8_t demand) {
+  account(nowMs);
+
+  if (state == BLE_RADIO_OFF) {
+    if (!wakeRequested) {
+      return BLE_GOVERNOR_NONE;
+    }
+    wakeRequested = false;
+    stats.wakes++;
+    startAdvertising(nowMs, 0);
+    advertisePending = false; // RADIO_ON starts advertising itself
+    return BLE_GOVERNOR_RADIO_ON;
+  }
+
+  if (connected && state != BLE_RADIO_CONNECTED) {
+    // Centrals open at 30-50 ms; that is the active profile, so an idle
+    // link only gets slowed down once the active hold time has passed. What
+    // the previous connection demanded doesn't carry over.
+    state = BLE_RADIO_CONNECTED;
+    link = BLE_LINK_ACTIVE;
+    forgetDemand(nowMs);
+    lastDemandMs[BLE_LINK_ACTIVE] = nowMs;
+  } else if (!connected && state == BLE_RADIO_CONNECTED) {
+    startAdvertising(nowMs, BLE_RADIO_RESTART_MS);
+  }
+
+  if (state == BLE_RADIO_CONNECTED) {
+    for (uint8_t profile = BLE_LINK_IDLE; profile <= demand && profile < BLE_LINK_PROFILES; profile++) {
+      lastDemandMs[profile] = nowMs;
+    }
+    uint8_t target = linkTarget(nowMs);
+    if (target == link) {
+      return BLE_GOVERNOR_NONE;
+    }
+    link = target;
+    stats.linkUpdates++;
+    return BLE_GOVERNOR_LINK;
+  }
+
+  uint32_t elapsed = nowMs - advertisingSinceMs;
+  if (elapsed >= BLE_RADIO_TIMEOUT_MS) {
+    state = BLE_RADIO_OFF;
+    advertisePending = false;
+    return BLE_GOVERNOR_RADIO_OFF;
+  }
+  uint8_t before = effectivePhase();
+  while (phase + 1 < BLE_ADVERTISING_PHASES && elapsed >= phases[phase].untilMs) {
+    phase++;
+  }
+  bool slower = effectivePhase() != before;
+  if (advertisePending) {
+    if ((int32_t)(nowMs - restartAtMs) < 0) {
+      return BLE_GOVERNOR_NONE;
+    }
+    advertisePending = false;
+    return BLE_GOVERNOR_ADVERTISE;
+  }
+  return slower ? BLE_GOVERNOR_ADVERTISE : BLE_GOVERNOR_NONE;
+}
+
+uint8_t bleGovernorState() {
+  return state;
+}
+
+BleAdvertisingParams bleGovernorAdvertising() {
+  return phases[effectivePhase()].params;
+}
+
+BleLinkParams bleGovernorLink() {
+  return profiles[link].params;
+}
+
+uint8_t bleGovernorLinkProfile() {
+  return link;
+}
+
+BleRadioStats bleGovernorStats() {
+  return stats;
+}
@@ -0,0 +1,255 @@
+#include "bulk_transfer.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include "asset_store.h"
+#include "spsc_ring.h"
+#include "waypoint_db.h"
+
+#define PACKET_SIZE (sizeof(BulkChunkHeader) + BULK_MAX_CHUNK)
+
+static_assert(BULK_WINDOW <= 32, "The ACK bitmap is 32 bits");
+
+struct BulkTarget {
+  uint8_t id;
+  const char *labels[ASSET_SLOTS];
+  uint8_t subtype;
+  uint32_t magic;
+  uint16_t version;
+  const AssetImage &(*image)(); // What readers have open now
+  bool (*reload)();             // Open the newest slot
+};
+
+static const BulkTarget targets[] = {
+  {BULK_TARGET_WAYPOINTS, {WAYPOINT_DB_PARTITION, WAYPOINT_DB_PARTITION_B}, ASSET_SUBTYPE_WAYPOINTS,
+   WAYPOINT_DB_MAGIC, WAYPOINT_DB_VERSION, waypointDbImage, waypointDbBegin},
+};
+
+static SpscRing<PACKET_SIZE, BULK_SLOTS> ring;
+static std::atomic<uint32_t> queueFull(0);
+
+static const BulkTarget *target = nullptr; // Upload in progress
+static AssetWriter writer;
+static uint32_t size;
+static uint32_t crc;
+static uint16_t chunkSize;
+static uint32_t chunkCount;
+static uint32_t next;     // First chunk not stored yet
+static uint32_t received; // Bit i: chunk next + i stored
+static uint32_t startedMs;
+static uint32_t lastPacketMs;
+static BulkStats stats = {};
+
+bool bulkTransferPush(const uint8_t *data, size_t length) {
+  if (!ring.push(data, length)) {
+    queueFull.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool bulkTransferActive() {
+  return target != nullptr;
+}
+
+bool bulkTransferPending() {
+  return !ring.empty();
+}
+
+BulkStats bulkTransferStats() {
+  BulkStats copy = stats;
+  copy.queueFull = queueFull.load(std::memory_order_relaxed);
+  return copy;
+}
+
+// Drop the upload; the spare slot stays without an image and readers keep the one they have
+static void abandon() {
+  assetWriteAbort(writer);
+  target = nullptr;
+}
+
+static uint8_t beginUpload(const BulkBegin &request, uint32_t nowMs, uint8_t &event) {
+  if (target) {
+    abandon(); // A new BEGIN restarts
+    event = BULK_EVENT_FAILED;
+  }
+  const BulkTarget *found = nullptr;
+  for (const BulkTarget &candidate : targets) {
+    if (candidate.id == request.target) found = &candidate;
+  }
+  if (!found || request.chunkSize == 0 || request.chunkSize > BULK_MAX_CHUNK) {
+    return BULK_STATUS_TARGET;
+  }
+  uint32_t count = (request.size + request.chunkSize - 1) / request.chunkSize;
+  if (request.size < sizeof(AssetHeader) || count > UINT16_MAX) {
+    return BULK_STATUS_SIZE;
+  }
+
+  // Never the slot readers have open
+  const AssetImage &live = found->image();
+  uint8_t slot = live.base ? (live.slot + 1) % ASSET_SLOTS : 0;
+  uint32_t generation = live.base ? live.generation + 1 : 1;
+  if (!assetWriteBegin(found->labels[slot], found->subtype, request.size, generation, writer)) {
+    return BULK_STATUS_SIZE;
+  }
+  target = found;
+  size = request.size;
+  crc = request.crc;
+  chunkSize = request.chunkSize;
+  chunkCount = count;
+  next = 0;
+  received = 0;
+  startedMs = nowMs;
+  event = BULK_EVENT_STARTED;
+  return BULK_STATUS_OK;
+}
+
+static uint8_t storeChunk(const uint8_t *packet, size_t length, uint8_t &event) {
+  if (!target) {
+    return BULK_STATUS_STATE;
+  }
+  BulkChunkHeader header;
+  memcpy(&header, packet, sizeof(header));
+  uint32_t sequence = header.sequence;
+  if (sequence < next) {
+    stats.duplicates++;
+    return BULK_STATUS_OK;
+  }
+  if (sequence >= next + BULK_WINDOW || sequence >= chunkCount) {
+    stats.outOfWindow++;
+    return BULK_STATUS_OK;
+  }
+  uint32_t bit = 1UL << (sequence - next);
+  if (received & bit) {
+    stats.duplicates++;
+    return BULK_STATUS_OK;
+  }
+  uint32_t offset = sequence * chunkSize;
+  uint32_t expected = size - offset < chunkSize ? size - offset : chunkSize;
+  if (length - sizeof(header) != expected) {
+    return BULK_STATUS_OK; // Malformed; the sender sees it missing and resends
+  }
+
+  if (!assetWrite(writer, offset, packet + sizeof(header), expected)) {
+    abandon();
+    event = BULK_EVENT_FAILED;
+    return BULK_STATUS_FLASH;
+  }
+  stats.chunks++;
+  received |= bit;
+  while (received & 1) {
+    received >>= 1;
+    next++;
+  }
+  return BULK_STATUS_OK;
+}
+
+static uint8_t endUpload(uint32_t nowMs, uint8_t &event) {
+  if (!target) {
+    return BULK_STATUS_STATE;
+  }
+  if (next < chunkCount) {
+    return BULK_STATUS_INCOMPLETE;
+  }
+
+  uint32_t stored;
+  if (!assetWriteCrc(writer, stored)) {
+    abandon();
+    event = BULK_EVENT_FAILED;
+    return BULK_STATUS_FLASH;
+  }
+  AssetHeader header;
+  memcpy(&header, writer.header, sizeof(header));
+  uint8_t status = BULK_STATUS_OK;
+  if (stored != crc) {
+    status = BULK_STATUS_CRC;
+  } else if (header.magic != target->magic || header.version != target->version || header.totalSize != size) {
+    status = BULK_STATUS_IMAGE;
+  }
+  if (status != BULK_STATUS_OK) {
+    abandon();
+    event = BULK_EVENT_FAILED;
+    return status;
+  }
+
+  // The one write that makes the new image visible
+  if (!assetWriteCommit(writer)) {
+    abandon();
+    event = BULK_EVENT_FAILED;
+    return BULK_STATUS_FLASH;
+  }
+  // Switches readers to the new slot, or leaves them on the old one if it doesn't open
+  bool opened = target->reload();
+  target = nullptr;
+  if (!opened) {
+    event = BULK_EVENT_FAILED;
+    return BULK_STATUS_IMAGE;
+  }
+  stats.lastBytes = size;
+  stats.lastMillis = nowMs - startedMs;
+  event = BULK_EVENT_COMMITTED;
+  return BULK_STATUS_OK;
+}
+
+uint8_t bulkTransferService(BulkAck &ack, bool &sendAck) {
+  uint8_t event = BULK_EVENT_NONE;
+  uint8_t status = BULK_STATUS_OK;
+  uint8_t request = BULK_OP_CHUNK;
+  sendAck = false;
+
+  // Chunks are acknowledged once per pass, not one by one. Stop early on
+  // anything the sender or the caller has to see before the next packet.
+  uint8_t packet[PACKET_SIZE];
+  size_t length;
+  uint32_t started = millis();
+  while (millis() - started < BULK_BUDGET_MS && ring.pop(packet, length)) {
+    if (length == 0) {
+      continue;
+    }
+    uint32_t now = millis();
+    lastPacketMs = now;
+    request = packet[0];
+    switch (packet[0]) {
+      case BULK_OP_BEGIN:
+        if (length >= sizeof(BulkBegin)) {
+          BulkBegin begin;
+          memcpy(&begin, packet, sizeof(begin));
+          status = beginUpload(begin, now, event);
+          sendAck = true;
+        }
+        break;
+      case BULK_OP_CHUNK:
+        if (length > sizeof(BulkChunkHeader)) {
+          status = storeChunk(packet, length, event);
+          sendAck = true;
+        }
+        break;
+      case BULK_OP_END:
+        status = endUpload(now, event);
+        sendAck = true;
+        break;
+      case BULK_OP_ABORT:
+        if (target) {
+          abandon();
+          event = BULK_EVENT_FAILED;
+        }
+        break;
+    }
+    if (event != BULK_EVENT_NONE || status != BULK_STATUS_OK || request != BULK_OP_CHUNK) {
+      break;
+    }
+  }
+
+  if (target && millis() - lastPacketMs >= BULK_TIMEOUT_MS) {
+    abandon();
+    event = BULK_EVENT_FAILED;
+  }
+
+  ack.op = BULK_OP_ACK;
+  ack.status = status;
+  ack.request = request;
+  ack.next = next;
+  ack.received = received;
+  return event;
+}
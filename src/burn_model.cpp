@@ -0,0 +1,124 @@
+#include "burn_model.h"
+
+#include <esp_sleep.h>
+
+#define BURN_SEGMENT_MAGIC 0x42534547 // "BSEG"
+
+// Sums since the last refuel. In RTC memory, the flight and the refuel that
+// closes it are usually on different sides of a deep sleep.
+struct BurnSegment {
+  uint32_t magic;
+  float startLevel;    // Litres at the refuel that started the segment
+  float hours;         // Engine hours
+  float distance;      // Ground distance in 100 km
+  float climb;         // Height gained in km
+};
+
+static RTC_DATA_ATTR BurnSegment segment = {};
+
+static BurnModelState model = {};
+static float climbRate = 0.0f;   // m/s, smoothed
+static float speedKmh = 0.0f;
+static float lastAltitude = 0.0f;
+static uint32_t lastFixMillis = 0;
+static bool haveAltitude = false;
+
+static void unpackCovariance(float P[3][3]) {
+  P[0][0] = model.cov[0]; P[0][1] = P[1][0] = model.cov[1]; P[0][2] = P[2][0] = model.cov[2];
+  P[1][1] = model.cov[3]; P[1][2] = P[2][1] = model.cov[4];
+  P[2][2] = model.cov[5];
+}
+
+static void packCovariance(const float P[3][3]) {
+  model.cov[0] = P[0][0]; model.cov[1] = P[0][1]; model.cov[2] = P[0][2];
+  model.cov[3] = P[1][1]; model.cov[4] = P[1][2];
+  model.cov[5] = P[2][2];
+}
+
+// One recursive least-squares step for burnt = x . coeff
+static void rlsUpdate(const float x[3], float burnt) {
+  float P[3][3], Px[3];
+  unpackCovariance(P);
+  for (uint8_t i = 0; i < 3; i++) {
+    Px[i] = P[i][0] * x[0] + P[i][1] * x[1] + P[i][2] * x[2];
+  }
+  float denominator = BURN_MODEL_FORGETTING + x[0] * Px[0] + x[1] * Px[1] + x[2] * Px[2];
+  float error = burnt - (x[0] * model.coeff[0] + x[1] * model.coeff[1] + x[2] * model.coeff[2]);
+  for (uint8_t i = 0; i < 3; i++) {
+    model.coeff[i] += Px[i] / denominator * error;
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    for (uint8_t j = 0; j < 3; j++) {
+      P[i][j] = (P[i][j] - Px[i] * Px[j] / denominator) / BURN_MODEL_FORGETTING;
+    }
+  }
+  packCovariance(P);
+  if (model.events < 0xFFFF) {
+    model.events++;
+  }
+}
+
+void burnModelBegin(const BurnModelState &state, double constantRate) {
+  model = state;
+  if (!model.events) {
+    // Untrained: constant rate, no speed or climb terms, wide uncertainty
+    model.coeff[0] = constantRate;
+    model.coeff[1] = 0.0f;
+    model.coeff[2] = 0.0f;
+    const float P[3][3] = {{BURN_MODEL_PRIOR_VARIANCE, 0, 0},
+                           {0, BURN_MODEL_PRIOR_VARIANCE, 0},
+                           {0, 0, BURN_MODEL_PRIOR_VARIANCE}};
+    packCovariance(P);
+  }
+}
+
+BurnModelState burnModelState() {
+  return model;
+}
+
+void burnModelAccumulate(const GpsFix &fix, double hours) {
+  // Climb from the altitude change between fixes, smoothed against GPS altitude noise
+  if (fix.altitude.isValid() && fix.updateMillis != lastFixMillis) {
+    float dt = (fix.updateMillis - lastFixMillis) / 1000.0f;
+    if (haveAltitude && dt > 0.0f && dt < 5.0f) {
+      float climb = (fix.altitude.value - lastAltitude) / dt;
+      climbRate += BURN_MODEL_CLIMB_SMOOTHING * (climb - climbRate);
+    }
+    lastAltitude = fix.altitude.value;
+    lastFixMillis = fix.updateMillis;
+    haveAltitude = true;
+  }
+  speedKmh = fix.speed.isValid() ? fix.speed.value : 0.0f;
+
+  if (hours <= 0.0 || segment.magic != BURN_SEGMENT_MAGIC) {
+    return;
+  }
+  segment.hours += hours;
+  segment.distance += speedKmh / 100.0f * hours;
+  segment.climb += max(climbRate, 0.0f) * 3.6f * hours;
+}
+
+bool burnModelRefuel(double levelAfter, double litresAdded) {
+  bool learned = false;
+  if (segment.magic == BURN_SEGMENT_MAGIC && segment.hours >= BURN_MODEL_MIN_SEGMENT_H) {
+    double levelBefore = litresAdded >= 0.0 ? levelAfter - litresAdded : -1.0;
+    float burnt = segment.startLevel - levelBefore;
+    if (levelBefore >= 0.0 && burnt > 0.0f) {
+      const float x[3] = {segment.hours, segment.distance, segment.climb};
+      rlsUpdate(x, burnt);
+      learned = true;
+    }
+  }
+
+  segment = {BURN_SEGMENT_MAGIC, (float)levelAfter, 0.0f, 0.0f, 0.0f};
+  return learned;
+}
+
+double burnModelRate(double constantRate) {
+  if (model.events < BURN_MODEL_MIN_EVENTS) {
+    return constantRate;
+  }
+  float rate = model.coeff[0] + model.coeff[1] * speedKmh / 100.0f +
+               model.coeff[2] * max(climbRate, 0.0f) * 3.6f;
+  return constrain(rate, BURN_MODEL_MIN_RATE, BURN_MODEL_MAX_RATE);
+}
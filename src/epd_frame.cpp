@@ -0,0 +1,132 @@
+#include "epd_frame.h"
+
+EpdFrame::EpdFrame(GxEPD &panel, uint16_t w, uint16_t h)
+    : GFXcanvas1(w, h), panel(panel), previousValid(false), stride((w + 7) / 8), pushBytes(0), pushWindows(0) {
+  previous = (uint8_t *)malloc((size_t)stride * h);
+}
+
+EpdFrame::~EpdFrame() {
+  free(previous);
+}
+
+void EpdFrame::init() {
+  panel.init();
+  previousValid = false;
+}
+
+void EpdFrame::setRotation(uint8_t r) {
+  panel.setRotation(r);
+}
+
+void EpdFrame::invalidate() {
+  previousValid = false;
+}
+
+void EpdFrame::copyFrom(const GFXcanvas1 &layer) {
+  uint8_t *frame = getBuffer();
+  const uint8_t *source = layer.getBuffer();
+  if (frame && source && layer.width() == WIDTH && layer.height() == HEIGHT) {
+    memcpy(frame, source, (size_t)stride * HEIGHT);
+  }
+}
+
+void EpdFrame::update() {
+  FrameRect all = {0, 0, (uint16_t)(stride * 8), (uint16_t)HEIGHT};
+  uint8_t *frame = getBuffer();
+  for (uint16_t y = 0; y < HEIGHT; y++) {
+    for (uint16_t x = 0; x < WIDTH; x++) {
+      bool white = frame[y * stride + x / 8] & (0x80 >> (x & 7));
+      panel.drawPixel(x, y, white ? GxEPD_WHITE : GxEPD_BLACK);
+    }
+  }
+  panel.update();
+
+  if (previous) {
+    memcpy(previous, frame, (size_t)stride * HEIGHT);
+    previousValid = true;
+  }
+  pushBytes = (uint32_t)stride * all.h;
+  pushWindows = 1;
+}
+
+void EpdFrame::updateWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool using_rotation) {
+  // The frame is kept in screen coordinates, so the window is always rotated by the panel
+  (void)using_rotation;
+  FrameRect rect;
+  rect.x = x & ~7;
+  rect.y = y;
+  rect.w = ((x + w + 7) & ~7) - rect.x;
+  rect.h = h;
+  pushBytes = 0;
+  pushWindows = 0;
+  pushRect(rect);
+
+  // A full window brings the panel in line with the frame
+  if (previous && rect.x == 0 && rect.y == 0 && rect.w >= WIDTH && rect.h >= HEIGHT) {
+    previousValid = true;
+  }
+}
+
+void EpdFrame::refresh() {
+  if (!previousValid) {
+    updateWindow(0, 0, WIDTH, HEIGHT);
+    return;
+  }
+
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  uint8_t count = findDirtyRects(rects, FRAME_MAX_WINDOWS);
+
+  uint32_t dirtyBytes = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    dirtyBytes += (uint32_t)(rects[i].w / 8) * rects[i].h;
+  }
+
+  // Nothing changed, leave the panel alone
+  if (count == 0) {
+    pushBytes = 0;
+    pushWindows = 0;
+    return;
+  }
+
+  // Most of the screen changed (e.g. switching screens), one window is cheaper
+  if (dirtyBytes * 100 > (uint32_t)stride * HEIGHT * FRAME_FULL_PUSH_PERCENT) {
+    updateWindow(0, 0, WIDTH, HEIGHT);
+    return;
+  }
+
+  pushBytes = 0;
+  pushWindows = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    pushRect(rects[i]);
+  }
+}
+
+uint8_t EpdFrame::findDirtyRects(FrameRect *rects, uint8_t maxRects) const {
+  const uint8_t *frame = getBuffer();
+  if (!previousValid || !frame) {
+    return 0;
+  }
+  return frameDirtyRects(frame, previous, stride, HEIGHT, rects, maxRects);
+}
+
+void EpdFrame::pushRect(const FrameRect &rect) {
+  uint8_t *frame = getBuffer();
+  uint16_t xEnd = min((uint16_t)(rect.x + rect.w), (uint16_t)WIDTH);
+  uint16_t yEnd = min((uint16_t)(rect.y + rect.h), (uint16_t)HEIGHT);
+
+  for (uint16_t y = rect.y; y < yEnd; y++) {
+    for (uint16_t x = rect.x; x < xEnd; x++) {
+      bool white = frame[y * stride + x / 8] & (0x80 >> (x & 7));
+      panel.drawPixel(x, y, white ? GxEPD_WHITE : GxEPD_BLACK);
+    }
+  }
+  panel.updateWindow(rect.x, rect.y, xEnd - rect.x, yEnd - rect.y, true);
+
+  if (previous) {
+    for (uint16_t y = rect.y; y < yEnd; y++) {
+      memcpy(previous + (size_t)y * stride + rect.x / 8, frame + (size_t)y * stride + rect.x / 8, (xEnd - rect.x + 7) / 8);
+    }
+  }
+  pushBytes += (uint32_t)((xEnd - rect.x + 7) / 8) * (yEnd - rect.y);
+  pushWindows++;
+}
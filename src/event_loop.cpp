@@ -0,0 +1,99 @@
+#include "event_loop.h"
+
+#include <esp_pm.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+#define EVENT_ALL (EVENT_GPS | EVENT_BUTTON | EVENT_BLE)
+
+static EventGroupHandle_t events = nullptr;
+static esp_pm_lock_handle_t cpuLock = nullptr; // Held while loop() works
+static EventLoopStats stats = {};
+
+// Current second
+static uint32_t windowStartUs;
+static uint32_t windowIdleUs;
+static uint16_t windowWakeups;
+
+// Frequency scaling only: the GPS streams into the UART continuously and the
+// BLE controller runs off the main crystal, so light sleep would never be
+// allowed anyway, and the UART would lose the bytes that woke it
+static void configure(uint16_t maxMhz) {
+  esp_pm_config_esp32_t config = {};
+  config.max_freq_mhz = maxMhz;
+  config.min_freq_mhz = EVENT_LOOP_MIN_MHZ;
+  config.light_sleep_enable = false;
+  stats.frequencyScaling = esp_pm_configure(&config) == ESP_OK;
+  stats.maxMhz = maxMhz;
+}
+
+void eventLoopBegin() {
+  if (!events) {
+    events = xEventGroupCreate();
+  }
+
+  configure(EVENT_LOOP_MAX_MHZ);
+
+  if (stats.frequencyScaling && !cpuLock && esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "loop", &cpuLock) == ESP_OK) {
+    esp_pm_lock_acquire(cpuLock);
+  }
+  windowStartUs = micros();
+}
+
+void eventLoopSetMaxMhz(uint16_t mhz) {
+  if (mhz < EVENT_LOOP_MIN_MHZ) {
+    mhz = EVENT_LOOP_MIN_MHZ;
+  }
+  if (mhz == stats.maxMhz) {
+    return;
+  }
+  if (stats.frequencyScaling) {
+    configure(mhz);
+  } else {
+    setCpuFrequencyMhz(mhz);
+    stats.maxMhz = mhz;
+  }
+}
+
+void eventPost(uint32_t bits) {
+  if (events) {
+    xEventGroupSetBits(events, bits);
+  }
+}
+
+void IRAM_ATTR eventPostFromISR(uint32_t bits) {
+  if (events) {
+    BaseType_t woken = pdFALSE;
+    xEventGroupSetBitsFromISR(events, bits, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+}
+
+uint32_t eventWait(uint32_t timeoutMs) {
+  uint32_t started = micros();
+  if (cpuLock) {
+    esp_pm_lock_release(cpuLock);
+  }
+  uint32_t bits = xEventGroupWaitBits(events, EVENT_ALL, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeoutMs)) & EVENT_ALL;
+  if (cpuLock) {
+    esp_pm_lock_acquire(cpuLock);
+  }
+  uint32_t now = micros();
+  windowIdleUs += now - started;
+  windowWakeups++;
+
+  uint32_t elapsed = now - windowStartUs;
+  if (elapsed >= 1000000) {
+    stats.idleMs = (uint64_t)windowIdleUs * 1000 / elapsed;
+    stats.activeMs = 1000 - stats.idleMs;
+    stats.wakeups = windowWakeups;
+    windowStartUs = now;
+    windowIdleUs = 0;
+    windowWakeups = 0;
+  }
+  return bits ? bits : EVENT_TIMER;
+}
+
+EventLoopStats eventLoopStats() {
+  return stats;
+}
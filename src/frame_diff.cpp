@@ -0,0 +1,146 @@
+#include "frame_diff.h"
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define FRAME_TILE_ROWS 8      // Dirty tiles are one framebuffer byte wide and 8 rows high
+#define FRAME_MAX_TILE_ROWS 32 // Enough for frames up to 256 rows
+#define FRAME_MAX_CANDIDATES 32
+
+// Candidate window in tile units, inclusive bounds
+struct TileRect {
+  uint8_t x0, y0, x1, y1;
+};
+
+static uint32_t tileRectBytes(const TileRect &r) {
+  return (uint32_t)(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1) * FRAME_TILE_ROWS;
+}
+
+static TileRect tileRectUnion(const TileRect &a, const TileRect &b) {
+  TileRect u;
+  u.x0 = min(a.x0, b.x0);
+  u.y0 = min(a.y0, b.y0);
+  u.x1 = max(a.x1, b.x1);
+  u.y1 = max(a.y1, b.y1);
+  return u;
+}
+
+// Extra bytes pushed when a and b are sent as one window instead of two
+static int32_t tileRectMergePenalty(const TileRect &a, const TileRect &b) {
+  return (int32_t)tileRectBytes(tileRectUnion(a, b)) - (int32_t)tileRectBytes(a) - (int32_t)tileRectBytes(b)
+         - FRAME_WINDOW_COST_BYTES;
+}
+
+uint8_t frameDirtyRects(const uint8_t *frame, const uint8_t *previous, uint16_t stride, uint16_t height,
+                        FrameRect *rects, uint8_t maxRects) {
+  if (maxRects == 0) {
+    return 0;
+  }
+
+  // Mark every byte-wide, 8-row tile that has at least one changed byte
+  uint8_t tileRows = (height + FRAME_TILE_ROWS - 1) / FRAME_TILE_ROWS;
+  uint8_t tileCols = min(stride, (uint16_t)32);
+  uint32_t tileMask[FRAME_MAX_TILE_ROWS] = {0};
+  tileRows = min(tileRows, (uint8_t)FRAME_MAX_TILE_ROWS);
+
+  for (uint16_t y = 0; y < height && y / FRAME_TILE_ROWS < tileRows; y++) {
+    const uint8_t *cur = frame + (size_t)y * stride;
+    const uint8_t *old = previous + (size_t)y * stride;
+    for (uint8_t bx = 0; bx < tileCols; bx++) {
+      if (cur[bx] != old[bx]) {
+        tileMask[y / FRAME_TILE_ROWS] |= 1UL << bx;
+      }
+    }
+  }
+
+  // Turn each run of dirty tiles into a candidate, growing candidates from the
+  // row above when the runs touch
+  TileRect candidates[FRAME_MAX_CANDIDATES];
+  uint8_t count = 0;
+  for (uint8_t ty = 0; ty < tileRows; ty++) {
+    uint32_t mask = tileMask[ty];
+    uint8_t tx = 0;
+    while (tx < tileCols) {
+      if (!(mask & (1UL << tx))) {
+        tx++;
+        continue;
+      }
+      TileRect run = {tx, ty, tx, ty};
+      while (run.x1 + 1 < tileCols && (mask & (1UL << (run.x1 + 1)))) {
+        run.x1++;
+      }
+      tx = run.x1 + 1;
+
+      bool merged = false;
+      for (uint8_t i = 0; i < count && !merged; i++) {
+        TileRect &c = candidates[i];
+        if (c.y1 + 1 == ty && run.x0 <= c.x1 + 1 && run.x1 + 1 >= c.x0) {
+          c = tileRectUnion(c, run);
+          merged = true;
+        }
+      }
+      if (!merged) {
+        if (count < FRAME_MAX_CANDIDATES) {
+          candidates[count++] = run;
+        } else {
+          candidates[count - 1] = tileRectUnion(candidates[count - 1], run);
+        }
+      }
+    }
+  }
+
+  // Merge windows while that is cheaper than paying for another window, then
+  // keep merging the cheapest pair until we are within the window budget
+  while (count > 1) {
+    uint8_t bestA = 0, bestB = 1;
+    int32_t bestPenalty = INT32_MAX;
+    for (uint8_t a = 0; a < count; a++) {
+      for (uint8_t b = a + 1; b < count; b++) {
+        int32_t penalty = tileRectMergePenalty(candidates[a], candidates[b]);
+        if (penalty < bestPenalty) {
+          bestPenalty = penalty;
+          bestA = a;
+          bestB = b;
+        }
+      }
+    }
+    if (bestPenalty > 0 && count <= maxRects) {
+      break;
+    }
+    candidates[bestA] = tileRectUnion(candidates[bestA], candidates[bestB]);
+    candidates[bestB] = candidates[--count];
+  }
+
+  // Shrink each window to the rows and bytes that really changed
+  uint8_t found = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    const TileRect &c = candidates[i];
+    uint16_t rowStart = c.y0 * FRAME_TILE_ROWS;
+    uint16_t rowEnd = min((uint16_t)((c.y1 + 1) * FRAME_TILE_ROWS), (uint16_t)height);
+    int16_t top = -1, bottom = -1;
+    uint8_t left = c.x1, right = c.x0;
+    for (uint16_t y = rowStart; y < rowEnd; y++) {
+      const uint8_t *cur = frame + (size_t)y * stride;
+      const uint8_t *old = previous + (size_t)y * stride;
+      for (uint8_t bx = c.x0; bx <= c.x1; bx++) {
+        if (cur[bx] != old[bx]) {
+          if (top < 0) top = y;
+          bottom = y;
+          left = min(left, bx);
+          right = max(right, bx);
+        }
+      }
+    }
+    if (top < 0) {
+      continue;
+    }
+    rects[found].x = left * 8;
+    rects[found].y = top;
+    rects[found].w = (right - left + 1) * 8;
+    rects[found].h = bottom - top + 1;
+    found++;
+  }
+  return found;
+}
@@ -0,0 +1,94 @@
+#include "fuel_burn.h"
+
+static bool started = false;
+static unsigned long paidMillis = 0; // Time up to here has been counted
+static bool lastGpsValid = false;
+static uint32_t lastGpsSeconds = 0; // Seconds since the start of the month of the last fresh fix
+
+static bool running = false;
+static bool slow = false;
+static unsigned long slowSince = 0;
+static float slowAltitude = 0.0f;
+
+// Monotonic enough between consecutive fixes; month rollover is caught by the skew check
+static bool gpsSeconds(const GpsFix &fix, unsigned long now, uint32_t &seconds) {
+  if (!fix.time.isValid() || !fix.date.isValid() || now - fix.updateMillis > FUEL_BURN_MAX_GPS_AGE_MS) {
+    return false;
+  }
+  seconds = ((fix.date.day() * 24 + fix.time.hour()) * 60 + fix.time.minute()) * 60 + fix.time.second();
+  return true;
+}
+
+// Engine state from ground speed, and altitude to tell a slow climb into a
+// headwind from standing on the ground
+static void trackEngine(const GpsFix &fix, unsigned long now) {
+  if (!fix.location.isValid() || !fix.speed.isValid() || now - fix.updateMillis > FUEL_BURN_MAX_GPS_AGE_MS) {
+    return;
+  }
+  float kmph = fix.speed.value;
+  if (kmph > FUEL_BURN_START_KMH) {
+    running = true;
+    slow = false;
+  } else if (kmph >= FUEL_BURN_STOP_KMH || (fix.altitude.isValid() && slow &&
+                                            fabsf(fix.altitude.value - slowAltitude) > FUEL_BURN_STOP_ALTITUDE_M)) {
+    slow = false; // Still moving, or climbing or sinking
+  } else if (!slow) {
+    slow = true;
+    slowSince = now;
+    slowAltitude = fix.altitude.isValid() ? fix.altitude.value : 0.0f;
+  } else if (now - slowSince >= FUEL_BURN_STOP_MS) {
+    running = false;
+  }
+}
+
+void fuelBurnReset() {
+  started = false;
+  running = false;
+  slow = false;
+}
+
+double fuelBurnTick(bool burning, const GpsFix &fix) {
+  unsigned long now = millis();
+  uint32_t seconds = 0;
+  bool gpsValid = gpsSeconds(fix, now, seconds);
+  trackEngine(fix, now);
+
+  // Ticks within one GPS second count nothing yet; the tick that sees the
+  // next second is paid the whole interval, so no time is lost between them
+  double elapsed = 0.0;
+  if (!started) {
+    paidMillis = now;
+  } else if (gpsValid && lastGpsValid && seconds == lastGpsSeconds) {
+    // Paid once the second changes, or from millis() if the fixes stop first
+  } else {
+    elapsed = (now - paidMillis) / 1000.0;
+    paidMillis = now;
+    if (gpsValid && lastGpsValid) {
+      double gpsElapsed = (double)seconds - (double)lastGpsSeconds;
+      // A jump in GPS time is paid from millis(); the next second counts from the new time
+      if (fabs(gpsElapsed - elapsed) < FUEL_BURN_MAX_CLOCK_SKEW_S) {
+        elapsed = gpsElapsed;
+      }
+    }
+  }
+
+  started = true;
+  lastGpsValid = gpsValid;
+  lastGpsSeconds = seconds;
+
+  if (!burning || !running || elapsed <= 0.0) {
+    return 0.0;
+  }
+  return elapsed / 3600.0;
+}
+
+FuelPrediction fuelPredict(double level, double burnRateLph, const GpsFix &fix) {
+  FuelPrediction prediction = {0.0f, 0.0f};
+  if (burnRateLph > 0.0 && level > 0.0) {
+    prediction.enduranceMinutes = level / burnRateLph * 60.0;
+    if (fix.speed.isValid()) {
+      prediction.rangeKm = prediction.enduranceMinutes / 60.0f * fix.speed.value;
+    }
+  }
+  return prediction;
+}
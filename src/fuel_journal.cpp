@@ -0,0 +1,194 @@
+#include "fuel_journal.h"
+
+#include <esp_partition.h>
+#include <sys/time.h>
+#include "crc32.h"
+
+#define FUEL_JOURNAL_MAGIC 0x4C455546 // "FUEL"
+#define FUEL_RECORD_SIZE 16
+#define FUEL_RECORDS_PER_SECTOR (FUEL_JOURNAL_SECTOR_SIZE / FUEL_RECORD_SIZE - 1) // First slot is the header
+
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t sequence; // Increases every time a sector is started, the highest is the active one
+  uint32_t reserved;
+  uint32_t crc;
+};
+
+struct FuelRecord {
+  FuelCheckpoint checkpoint;
+  uint32_t crc;
+};
+
+static_assert(sizeof(SectorHeader) == FUEL_RECORD_SIZE, "Sector header must fill one record slot");
+static_assert(sizeof(FuelRecord) == FUEL_RECORD_SIZE, "Fuel record must be 16 bytes");
+
+static const esp_partition_t *journal = nullptr;
+static uint8_t sectorCount = 0;
+static uint8_t activeSector = 0;
+static uint32_t activeSequence = 0;
+static uint16_t nextSlot = 0;   // Next free record slot in the active sector, 1-based
+static bool haveLast = false;
+static FuelCheckpoint last = {};
+static unsigned long lastAppendMillis = 0;
+
+static bool isErased(const void *data, size_t length) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < length; i++) {
+    if (p[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+static size_t slotOffset(uint8_t sector, uint16_t slot) {
+  return (size_t)sector * FUEL_JOURNAL_SECTOR_SIZE + (size_t)slot * FUEL_RECORD_SIZE;
+}
+
+static bool readHeader(uint8_t sector, SectorHeader &header) {
+  return esp_partition_read(journal, slotOffset(sector, 0), &header, sizeof(header)) == ESP_OK &&
+         header.magic == FUEL_JOURNAL_MAGIC && header.crc == crc32Update(0, &header, 12);
+}
+
+// Newest valid record in a sector; also finds the first free slot
+static bool scanSector(uint8_t sector, FuelCheckpoint &found, uint16_t &freeSlot) {
+  FuelRecord records[16];
+  bool any = false;
+  freeSlot = FUEL_RECORDS_PER_SECTOR + 1;
+  for (uint16_t slot = 1; slot <= FUEL_RECORDS_PER_SECTOR; slot += 16) {
+    uint16_t count = min<uint16_t>(16, FUEL_RECORDS_PER_SECTOR + 1 - slot);
+    if (esp_partition_read(journal, slotOffset(sector, slot), records, count * FUEL_RECORD_SIZE) != ESP_OK) {
+      return any;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      if (isErased(&records[i], FUEL_RECORD_SIZE)) {
+        freeSlot = slot + i;
+        return any;
+      }
+      if (records[i].crc == crc32Update(0, &records[i].checkpoint, sizeof(FuelCheckpoint))) {
+        found = records[i].checkpoint;
+        any = true;
+      }
+    }
+  }
+  return any;
+}
+
+// Erase the next sector round-robin and make it the active one
+static bool startSector(uint8_t sector) {
+  if (esp_partition_erase_range(journal, slotOffset(sector, 0), FUEL_JOURNAL_SECTOR_SIZE) != ESP_OK) {
+    return false;
+  }
+  SectorHeader header = {FUEL_JOURNAL_MAGIC, activeSequence + 1, 0xFFFFFFFF, 0};
+  header.crc = crc32Update(0, &header, 12);
+  if (esp_partition_write(journal, slotOffset(sector, 0), &header, sizeof(header)) != ESP_OK) {
+    return false;
+  }
+  activeSector = sector;
+  activeSequence = header.sequence;
+  nextSlot = 1;
+  return true;
+}
+
+static bool writeRecord(const FuelCheckpoint &checkpoint) {
+  FuelRecord record = {checkpoint, 0};
+  record.crc = crc32Update(0, &record.checkpoint, sizeof(FuelCheckpoint));
+  if (esp_partition_write(journal, slotOffset(activeSector, nextSlot), &record, sizeof(record)) != ESP_OK) {
+    return false;
+  }
+  nextSlot++;
+  return true;
+}
+
+bool fuelJournalBegin() {
+  journal = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)FUEL_JOURNAL_SUBTYPE,
+                                     FUEL_JOURNAL_PARTITION);
+  if (!journal || journal->size < 2 * FUEL_JOURNAL_SECTOR_SIZE) {
+    journal = nullptr;
+    return false;
+  }
+  sectorCount = min<uint32_t>(journal->size / FUEL_JOURNAL_SECTOR_SIZE, 255);
+
+  // Active sector is the one with the highest sequence; the one before it
+  // still holds the newest record if power was lost between starting the
+  // active sector and writing its first record
+  bool found = false;
+  uint8_t previousSector = 0;
+  uint32_t previousSequence = 0;
+  for (uint8_t sector = 0; sector < sectorCount; sector++) {
+    SectorHeader header;
+    if (!readHeader(sector, header)) continue;
+    if (!found || header.sequence > activeSequence) {
+      if (found) {
+        previousSector = activeSector;
+        previousSequence = activeSequence;
+      }
+      activeSector = sector;
+      activeSequence = header.sequence;
+      found = true;
+    } else if (header.sequence > previousSequence) {
+      previousSector = sector;
+      previousSequence = header.sequence;
+    }
+  }
+
+  haveLast = false;
+  if (!found) {
+    activeSequence = 0;
+    return startSector(0);
+  }
+
+  haveLast = scanSector(activeSector, last, nextSlot);
+  if (!haveLast && previousSequence) {
+    uint16_t unused;
+    haveLast = scanSector(previousSector, last, unused);
+  }
+  return true;
+}
+
+bool fuelJournalLast(FuelCheckpoint &checkpoint) {
+  if (haveLast) {
+    checkpoint = last;
+  }
+  return haveLast;
+}
+
+bool fuelJournalAppend(float level, float burnRate) {
+  if (!journal) {
+    return false;
+  }
+
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  FuelCheckpoint checkpoint = {now.tv_sec > 1577836800 ? (uint32_t)now.tv_sec : 0, level, burnRate};
+
+  if (nextSlot > FUEL_RECORDS_PER_SECTOR) {
+    // Sector full: the only time the journal erases anything
+    if (!startSector((activeSector + 1) % sectorCount)) {
+      return false;
+    }
+  }
+  if (!writeRecord(checkpoint)) {
+    // Half-written slot: skip it, the CRC keeps it out of recovery
+    nextSlot++;
+    return false;
+  }
+  last = checkpoint;
+  haveLast = true;
+  lastAppendMillis = millis();
+  return true;
+}
+
+void fuelJournalService(float level, float burnRate) {
+  if (haveLast && last.level == level && last.burnRate == burnRate) {
+    return;
+  }
+  if (millis() - lastAppendMillis >= FUEL_JOURNAL_INTERVAL_MS || !haveLast) {
+    fuelJournalAppend(level, burnRate);
+  }
+}
+
+void fuelJournalFlush(float level, float burnRate) {
+  if (!haveLast || last.level != level || last.burnRate != burnRate) {
+    fuelJournalAppend(level, burnRate);
+  }
+}
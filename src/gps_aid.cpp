@@ -0,0 +1,151 @@
+#include "gps_aid.h"
+
+#include <esp_sleep.h>
+#include <sys/time.h>
+#include "gps_ingest.h"
+#include "ubx.h"
+
+#define GPS_AID_MAGIC 0x47414944 // "GAID"
+#define GPS_EPOCH_UNIX 315964800 // 1980-01-06
+#define GPS_AID_MIN_UNIX 1577836800 // 2020-01-01, anything earlier means the clock was never set
+
+struct GpsAidRecord {
+  uint32_t magic;
+  NavPoint point;
+  float altitudeMeters;
+  float hAccMeters;
+  int64_t fixUnix;      // UTC seconds of the fix, 0 if the time was unknown
+  uint32_t ttffMs;      // Time to first fix of the boot that wrote this
+  bool ttffAided;
+};
+
+// RTC slow memory, kept powered through deep sleep
+static RTC_DATA_ATTR GpsAidRecord aidRecord = {};
+
+static GpsTtff ttff = {};
+static unsigned long ttffStart = 0;
+static unsigned long lastSaveMillis = 0;
+static bool savedThisBoot = false;
+
+static int64_t daysFromCivil(int y, int m, int d) {
+  y -= m <= 2;
+  int era = (y >= 0 ? y : y - 399) / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (int64_t)era * 146097 + doe - 719468;
+}
+
+// UTC seconds of the fix, 0 if date or time are missing
+static int64_t fixUnixTime(const GpsFix &fix) {
+  if (!fix.date.isValid() || !fix.time.isValid() || fix.date.year() < 2020) {
+    return 0;
+  }
+  return daysFromCivil(fix.date.year(), fix.date.month(), fix.date.day()) * 86400 +
+         fix.time.hour() * 3600 + fix.time.minute() * 60 + fix.time.second();
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static void saveRecord(const GpsFix &fix, int64_t unixTime) {
+  aidRecord.point = fix.location.point;
+  aidRecord.altitudeMeters = fix.altitude.isValid() ? fix.altitude.value : 0.0f;
+  aidRecord.hAccMeters = fix.hAccMeters;
+  aidRecord.fixUnix = unixTime;
+  aidRecord.magic = GPS_AID_MAGIC;
+  lastSaveMillis = millis();
+  savedThisBoot = true;
+}
+
+void gpsAidBegin() {
+  ttff = {};
+  if (aidRecord.magic == GPS_AID_MAGIC) {
+    ttff.previousMs = aidRecord.ttffMs;
+    ttff.previousAided = aidRecord.ttffAided;
+  }
+  aidRecord.ttffMs = 0;
+  ttffStart = millis();
+}
+
+bool gpsAidInject() {
+  if (aidRecord.magic != GPS_AID_MAGIC) {
+    return false;
+  }
+
+  uint8_t payload[48] = {};
+  uint32_t flags = 0;
+  float posAcc = max(aidRecord.hAccMeters, 50.0f) + GPS_AID_UNKNOWN_AGE_ACC_M;
+
+  // The system clock keeps running through deep sleep once it has been set from GPS
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  if (aidRecord.fixUnix && now.tv_sec > GPS_AID_MIN_UNIX && now.tv_sec >= aidRecord.fixUnix) {
+    int64_t asleep = now.tv_sec - aidRecord.fixUnix;
+    int64_t gpsSeconds = now.tv_sec - GPS_EPOCH_UNIX + GPS_UTC_LEAP_SECONDS;
+    uint32_t towMs = (gpsSeconds % 604800) * 1000 + now.tv_usec / 1000;
+    uint32_t tAccMs = 2000 + (uint32_t)min<int64_t>(asleep * GPS_AID_CLOCK_DRIFT_PPM / 1000, 3600000);
+    payload[18] = (gpsSeconds / 604800) & 0xFF; // Week number
+    payload[19] = (gpsSeconds / 604800) >> 8;
+    putU32(payload + 20, towMs);
+    putU32(payload + 28, tAccMs);
+    flags |= 0x02; // Time valid
+    posAcc = max(aidRecord.hAccMeters, 50.0f) + asleep * GPS_AID_MAX_SPEED_MPS;
+  }
+
+  if (posAcc <= GPS_AID_MAX_POS_ACC_M) {
+    putU32(payload + 0, aidRecord.point.lat);
+    putU32(payload + 4, aidRecord.point.lon);
+    putU32(payload + 8, (int32_t)(aidRecord.altitudeMeters * 100.0f));
+    putU32(payload + 12, (uint32_t)(posAcc * 100.0f));
+    flags |= 0x01 | 0x20; // Position valid, given as lat/lon/alt
+  }
+
+  if (!flags) {
+    return false;
+  }
+  putU32(payload + 44, flags);
+  gpsWriteUbx(UBX_CLASS_AID, UBX_AID_INI, payload, sizeof(payload));
+  ttff.aided = true;
+  return true;
+}
+
+void gpsAidUpdate(const GpsFix &fix) {
+  if (!fix.location.isValid() || fix.fixType < 2) {
+    return;
+  }
+
+  if (!ttff.ms) {
+    ttff.ms = max(millis() - ttffStart, 1UL);
+    aidRecord.ttffMs = ttff.ms;
+    aidRecord.ttffAided = ttff.aided;
+  }
+
+  int64_t unixTime = fixUnixTime(fix);
+  if (unixTime) {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if (llabs(now.tv_sec - unixTime) > 2) {
+      struct timeval gpsTime = {(time_t)unixTime, 0};
+      settimeofday(&gpsTime, nullptr);
+    }
+  }
+
+  if (!savedThisBoot || millis() - lastSaveMillis >= GPS_AID_SAVE_INTERVAL_MS) {
+    saveRecord(fix, unixTime);
+  }
+}
+
+void gpsAidSave(const GpsFix &fix) {
+  if (fix.location.isValid() && fix.fixType >= 2) {
+    saveRecord(fix, fixUnixTime(fix));
+  }
+}
+
+GpsTtff gpsAidTtff() {
+  return ttff;
+}
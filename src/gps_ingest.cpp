@@ -0,0 +1,291 @@
+#include "gps_ingest.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "ubx.h"
+#include <string.h>
+
+static HardwareSerial *gpsPort = nullptr;
+static unsigned long gpsBaud = 0;
+static TaskHandle_t gpsTask = nullptr;
+static SemaphoreHandle_t gpsLock = nullptr;
+static SemaphoreHandle_t portLock = nullptr; // Held while the port is read, reconfigured or closed
+static volatile bool gpsRunning = false;
+static void (*fixCallback)() = nullptr;
+
+// Guarded by gpsLock
+static GpsFix gpsSnapshot = {};
+static bool gpsSnapshotFresh = false;
+static GpsIngestStats gpsStats = {};
+
+static volatile uint32_t gpsOverruns = 0;
+static volatile bool ubxActive = false;    // Receiver was told to send UBX only
+static volatile uint16_t ubxAckFor = 0;    // class << 8 | id we are waiting on
+static volatile int8_t ubxAckResult = 0;   // 1 = ACK, -1 = NAK, 0 = pending
+static volatile uint16_t ubxPollFor = 0;   // class << 8 | id of a polled message
+static volatile int16_t ubxPollLength = -1; // Length of the answer in ubxPollBuffer, -1 = pending
+static uint8_t ubxPollBuffer[UBX_MAX_PAYLOAD];
+
+static void onGpsReceive() {
+  if (gpsTask) {
+    xTaskNotifyGive(gpsTask);
+  }
+}
+
+static void onGpsReceiveError(hardwareSerial_error_t error) {
+  if (error == UART_FIFO_OVF_ERROR || error == UART_BUFFER_FULL_ERROR) {
+    gpsOverruns++;
+  }
+}
+
+// Runs on the ingest task
+static void publishFix(const GpsFix &fix) {
+  xSemaphoreTake(gpsLock, portMAX_DELAY);
+  gpsSnapshot = fix;
+  gpsSnapshotFresh = true;
+  xSemaphoreGive(gpsLock);
+  if (fixCallback) {
+    fixCallback();
+  }
+}
+
+static void sendUbxFrame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length) {
+  uint8_t frame[UBX_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+  if (gpsPort && length <= UBX_MAX_PAYLOAD) {
+    gpsPort->write(frame, ubxBuildFrame(cls, id, payload, length, frame));
+  }
+}
+
+// CFG-PRT for UART1 at the given baud rate and output protocols
+static void sendPortConfig(uint32_t baud, uint16_t outProtocols) {
+  uint8_t payload[20] = {
+    1, 0, 0, 0,                 // portID UART1, reserved, txReady off
+    0xD0, 0x08, 0x00, 0x00,     // mode 8N1
+    (uint8_t)baud, (uint8_t)(baud >> 8), (uint8_t)(baud >> 16), (uint8_t)(baud >> 24),
+    UBX_PROTO_UBX | UBX_PROTO_NMEA, 0,   // inProtoMask
+    (uint8_t)outProtocols, 0,            // outProtoMask
+    0, 0, 0, 0                           // flags, reserved
+  };
+  sendUbxFrame(UBX_CLASS_CFG, UBX_CFG_PRT, payload, sizeof(payload));
+}
+
+// Runs on the ingest task: ACKs and polled answers for the UI task waiting on them
+static bool handleUbxFrame(const UbxDecoder &frame) {
+  if (frame.msgClass() == UBX_CLASS_ACK && frame.length() >= 2) {
+    const uint8_t *p = frame.payload();
+    if (ubxAckFor == ((p[0] << 8) | p[1])) {
+      ubxAckResult = frame.msgId() == UBX_ACK_ACK ? 1 : -1;
+    }
+    return true;
+  }
+  if (ubxPollFor && ubxPollLength < 0 && ubxPollFor == ((frame.msgClass() << 8) | frame.msgId())) {
+    memcpy(ubxPollBuffer, frame.payload(), frame.length());
+    ubxPollLength = frame.length();
+    return true;
+  }
+  return false;
+}
+
+static void gpsIngestTask(void *) {
+  uint8_t chunk[128];
+  uint32_t windowStart = millis();
+  uint32_t windowSentences = 0;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_TASK_IDLE_WAKE_MS));
+
+    for (;;) {
+      // The UI task may be closing the port or changing its speed
+      xSemaphoreTake(portLock, portMAX_DELAY);
+      size_t count = gpsRunning && gpsPort->available() > 0 ? gpsPort->read(chunk, sizeof(chunk)) : 0;
+      gpsStreamFeed(chunk, count);
+      xSemaphoreGive(portLock);
+      if (count == 0) {
+        break;
+      }
+
+      xSemaphoreTake(gpsLock, portMAX_DELAY);
+      gpsStats.bytes += count;
+      xSemaphoreGive(gpsLock);
+    }
+
+    uint32_t now = millis();
+
+    // UBX went quiet: put NMEA back on the port so the TinyGPSPlus path takes over
+    xSemaphoreTake(portLock, portMAX_DELAY);
+    if (gpsRunning && ubxActive && now - gpsStreamLastUbxMillis() > GPS_UBX_TIMEOUT_MS) {
+      ubxActive = false;
+      sendPortConfig(gpsBaud, UBX_PROTO_UBX | UBX_PROTO_NMEA);
+    }
+    xSemaphoreGive(portLock);
+
+    xSemaphoreTake(gpsLock, portMAX_DELAY);
+    GpsStreamStats stream = gpsStreamStats();
+    gpsStats.sentences = stream.sentences;
+    gpsStats.checksumFailures = stream.checksumFailures;
+    gpsStats.overruns = gpsOverruns;
+    gpsStats.protocol = stream.source;
+    if (now - windowStart >= 1000) {
+      gpsStats.sentencesPerSecond = (gpsStats.sentences - windowSentences) * 1000 / (now - windowStart);
+      windowSentences = gpsStats.sentences;
+      windowStart = now;
+    }
+    xSemaphoreGive(gpsLock);
+  }
+}
+
+void gpsIngestBegin(HardwareSerial &serial, unsigned long baud, int8_t rxPin, int8_t txPin) {
+  if (!gpsLock) {
+    gpsLock = xSemaphoreCreateMutex();
+    portLock = xSemaphoreCreateMutex();
+    gpsStreamOnFix(publishFix);
+    gpsStreamOnFrame(handleUbxFrame);
+  }
+
+  gpsIngestEnd();
+  xSemaphoreTake(portLock, portMAX_DELAY);
+  gpsPort = &serial;
+  gpsBaud = baud;
+  gpsPort->setRxBufferSize(GPS_RX_BUFFER_SIZE);
+  gpsPort->begin(baud, SERIAL_8N1, rxPin, txPin);
+  gpsPort->onReceive(onGpsReceive);
+  gpsPort->onReceiveError(onGpsReceiveError);
+  gpsRunning = true;
+  xSemaphoreGive(portLock);
+
+  if (!gpsTask) {
+    xTaskCreatePinnedToCore(gpsIngestTask, "gpsIngest", GPS_TASK_STACK_SIZE, nullptr,
+                            GPS_TASK_PRIORITY, &gpsTask, GPS_TASK_CORE);
+  }
+}
+
+void gpsIngestEnd() {
+  if (!portLock) {
+    return; // Never started
+  }
+  xSemaphoreTake(portLock, portMAX_DELAY);
+  gpsRunning = false;
+  ubxActive = false;
+  if (gpsPort) {
+    gpsPort->end();
+  }
+  xSemaphoreGive(portLock);
+}
+
+void gpsIngestOnFix(void (*callback)()) {
+  fixCallback = callback;
+}
+
+bool gpsIngestSync(GpsFix &gps) {
+  if (!gpsLock) {
+    return false;
+  }
+  bool fresh = false;
+  xSemaphoreTake(gpsLock, portMAX_DELAY);
+  if (gpsSnapshotFresh) {
+    gps = gpsSnapshot;
+    gpsSnapshotFresh = false;
+    fresh = true;
+  }
+  xSemaphoreGive(gpsLock);
+  return fresh;
+}
+
+GpsIngestStats gpsIngestStats() {
+  GpsIngestStats stats = {};
+  if (gpsLock) {
+    xSemaphoreTake(gpsLock, portMAX_DELAY);
+    stats = gpsStats;
+    xSemaphoreGive(gpsLock);
+  }
+  return stats;
+}
+
+void gpsWriteUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length) {
+  if (gpsRunning) {
+    sendUbxFrame(cls, id, payload, length);
+  }
+}
+
+bool gpsSendUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length) {
+  if (!gpsRunning) {
+    return false;
+  }
+  ubxAckResult = 0;
+  ubxAckFor = (cls << 8) | id;
+  sendUbxFrame(cls, id, payload, length);
+
+  unsigned long start = millis();
+  while (ubxAckResult == 0 && millis() - start < GPS_UBX_ACK_TIMEOUT_MS) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  ubxAckFor = 0;
+  return ubxAckResult == 1;
+}
+
+bool gpsConfigureUbx() {
+  // NAV-PVT on u-blox 7 and later; the NEO-6M NAKs it and needs four messages instead
+  uint8_t enablePvt[3] = {UBX_CLASS_NAV, UBX_NAV_PVT, 1};
+  if (!gpsSendUbx(UBX_CLASS_CFG, UBX_CFG_MSG, enablePvt, sizeof(enablePvt))) {
+    const uint8_t legacy[] = {UBX_NAV_POSLLH, UBX_NAV_SOL, UBX_NAV_VELNED, UBX_NAV_TIMEUTC};
+    for (uint8_t i = 0; i < sizeof(legacy); i++) {
+      uint8_t enable[3] = {UBX_CLASS_NAV, legacy[i], 1};
+      if (!gpsSendUbx(UBX_CLASS_CFG, UBX_CFG_MSG, enable, sizeof(enable))) {
+        return false; // Not a u-blox receiver, or it is not listening: stay on NMEA
+      }
+    }
+  }
+
+  // Drop NMEA output; the ingest task switches it back on if UBX goes quiet
+  gpsStreamStartUbx();
+  ubxActive = true;
+  sendPortConfig(gpsBaud, UBX_PROTO_UBX);
+  return true;
+}
+
+int16_t gpsPollUbx(uint8_t cls, uint8_t id, uint8_t *out, uint16_t maxLength) {
+  if (!gpsRunning) {
+    return -1;
+  }
+  ubxPollLength = -1;
+  ubxPollFor = (cls << 8) | id;
+  sendUbxFrame(cls, id, nullptr, 0);
+
+  unsigned long start = millis();
+  while (ubxPollLength < 0 && millis() - start < GPS_UBX_ACK_TIMEOUT_MS) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  ubxPollFor = 0;
+  int16_t length = ubxPollLength;
+  if (length > 0) {
+    memcpy(out, ubxPollBuffer, min((uint16_t)length, maxLength));
+  }
+  return length;
+}
+
+void gpsIngestSetBaud(unsigned long baud) {
+  if (!gpsPort) {
+    return;
+  }
+  xSemaphoreTake(portLock, portMAX_DELAY);
+  gpsBaud = baud;
+  gpsPort->updateBaudRate(baud);
+  gpsStreamResync();
+  xSemaphoreGive(portLock);
+}
+
+void gpsIngestSwitchBaud(unsigned long baud) {
+  if (!gpsRunning) {
+    return;
+  }
+  // The receiver changes speed right after this frame, so there is no ACK to wait for
+  sendPortConfig(baud, ubxActive ? UBX_PROTO_UBX : (UBX_PROTO_UBX | UBX_PROTO_NMEA));
+  gpsPort->flush();
+  delay(50);
+  gpsIngestSetBaud(baud);
+}
+
+unsigned long gpsIngestBaud() {
+  return gpsBaud;
+}
@@ -0,0 +1,165 @@
+#include "gps_link.h"
+
+#include <esp_sleep.h>
+#include "ubx.h"
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "gps_ingest.h"
+
+static uint32_t ingestSentences() {
+  return gpsIngestStats().sentences;
+}
+
+static void taskWait(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+static const GpsLinkTransport ingestTransport = {
+  ingestSentences, gpsIngestSetBaud, gpsIngestSwitchBaud, gpsIngestBaud,
+  gpsSendUbx, gpsPollUbx, gpsConfigureUbx, taskWait
+};
+static const GpsLinkTransport *receiver = &ingestTransport;
+#else
+static const GpsLinkTransport *receiver = nullptr; // Set by the tests
+#endif
+
+#define GPS_LINK_MAGIC 0x474C4E4B // "GLNK"
+
+// Kept in RTC memory so the negotiated link survives deep sleep
+static RTC_DATA_ATTR uint32_t savedLinkMagic = 0;
+static RTC_DATA_ATTR GpsLinkState savedLink = {};
+
+static GpsLinkState currentLink = {};
+
+// True once a sentence or frame with a valid checksum arrives
+static bool waitForTraffic(uint32_t timeoutMs) {
+  uint32_t before = receiver->sentences();
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    receiver->wait(50);
+    if (receiver->sentences() != before) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool probeBaud(unsigned long baud) {
+  receiver->setBaud(baud);
+  return waitForTraffic(GPS_PROBE_MS);
+}
+
+// Baud rate the receiver is currently talking at, 0 if it is silent
+static unsigned long findReceiverBaud() {
+  unsigned long candidates[] = {GPS_DEFAULT_BAUD, GPS_FAST_BAUD, GPS_FALLBACK_BAUD, GPS_DEFAULT_BAUD};
+  if (savedLinkMagic == GPS_LINK_MAGIC && savedLink.baud) {
+    candidates[0] = savedLink.baud;
+  }
+  for (uint8_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    if ((i == 0 || candidates[i] != candidates[0]) && probeBaud(candidates[i])) {
+      return candidates[i];
+    }
+  }
+  return 0;
+}
+
+// Move the receiver to baud and check it is still heard, otherwise go back
+static bool switchBaud(unsigned long baud) {
+  unsigned long previous = receiver->baud();
+  receiver->switchBaud(baud);
+  if (waitForTraffic(GPS_PROBE_MS)) {
+    return true;
+  }
+  // The receiver may not have taken the CFG-PRT; see if it is still at the old rate
+  if (probeBaud(previous)) {
+    return false;
+  }
+  if (probeBaud(baud)) {
+    return true;
+  }
+  // It moved, but nothing it sends at the new rate comes through. Our side
+  // may still reach it there, so tell it to go back before following it.
+  receiver->switchBaud(previous);
+  return false;
+}
+
+static bool disableNmea(uint8_t sentence) {
+  uint8_t payload[3] = {UBX_CLASS_NMEA, sentence, 0};
+  return receiver->sendUbx(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+}
+
+// Store port, message and navigation settings in battery-backed RAM and flash
+static void saveReceiverConfig() {
+  uint8_t payload[13] = {
+    0, 0, 0, 0,           // clearMask
+    0x0B, 0, 0, 0,        // saveMask: ioPort, msgConf, navConf
+    0, 0, 0, 0,           // loadMask
+    0x07                  // deviceMask: BBR, flash, EEPROM
+  };
+  receiver->sendUbx(UBX_CLASS_CFG, UBX_CFG_CFG, payload, sizeof(payload));
+}
+
+bool gpsSetNavRate(uint8_t rateHz) {
+  if (!currentLink.baud) {
+    return false;
+  }
+  rateHz = constrain(rateHz, 1, GPS_MAX_RATE_HZ);
+  if (!currentLink.ubx && currentLink.baud < GPS_FALLBACK_BAUD) {
+    rateHz = min(rateHz, (uint8_t)GPS_SLOW_LINK_MAX_RATE_HZ);
+  }
+
+  uint16_t measRate = 1000 / rateHz;
+  uint8_t rate[6] = {(uint8_t)measRate, (uint8_t)(measRate >> 8), 1, 0, 1, 0}; // navRate 1, GPS time
+  receiver->sendUbx(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+
+  // Read it back rather than trusting the ACK
+  uint8_t answer[6];
+  currentLink.rateHz = rateHz;
+  currentLink.verified = receiver->pollUbx(UBX_CLASS_CFG, UBX_CFG_RATE, answer, sizeof(answer)) >= 2 &&
+                         (answer[0] | (answer[1] << 8)) == measRate;
+  savedLink = currentLink;
+  return currentLink.verified;
+}
+
+bool gpsNegotiateLink(uint8_t rateHz, bool useUbx) {
+  bool remembered = savedLinkMagic == GPS_LINK_MAGIC;
+  unsigned long baud = findReceiverBaud();
+  currentLink = {};
+  if (!baud) {
+    receiver->setBaud(GPS_DEFAULT_BAUD);
+    savedLinkMagic = 0;
+    return false;
+  }
+
+  // Nothing to redo if the receiver kept what we set up before sleep
+  bool changed = !remembered || baud != savedLink.baud;
+  if (baud != GPS_FAST_BAUD && !switchBaud(GPS_FAST_BAUD) && baud != GPS_FALLBACK_BAUD) {
+    switchBaud(GPS_FALLBACK_BAUD);
+  }
+  currentLink.baud = receiver->baud();
+
+  if (changed) {
+    disableNmea(UBX_NMEA_GSV);
+    disableNmea(UBX_NMEA_GLL);
+    disableNmea(UBX_NMEA_VTG);
+  }
+  currentLink.ubx = useUbx && receiver->configureUbx();
+  gpsSetNavRate(rateHz);
+
+  if (changed && currentLink.verified) {
+    saveReceiverConfig();
+  }
+  savedLink = currentLink;
+  savedLinkMagic = GPS_LINK_MAGIC;
+  return true;
+}
+
+void gpsLinkSetTransport(const GpsLinkTransport *transport) {
+  receiver = transport;
+}
+
+GpsLinkState gpsLinkState() {
+  return currentLink;
+}
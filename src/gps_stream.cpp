@@ -0,0 +1,219 @@
+#include "gps_stream.h"
+
+#include <TinyGPS++.h>
+
+// Messages that make up one navigation epoch
+enum {
+  EPOCH_GGA = 0x01,
+  EPOCH_RMC = 0x02,
+  EPOCH_PVT = 0x04,
+  EPOCH_POSLLH = 0x08,
+  EPOCH_SOL = 0x10,
+  EPOCH_VELNED = 0x20,
+  EPOCH_TIMEUTC = 0x40,
+};
+
+#define EPOCH_UBX_ALL (EPOCH_PVT | EPOCH_POSLLH | EPOCH_SOL | EPOCH_VELNED | EPOCH_TIMEUTC)
+
+// One epoch being put together from messages with the same receiver time stamp
+struct GpsEpoch {
+  uint32_t stamp;
+  uint8_t parts;    // EPOCH_* seen with this stamp
+  uint8_t complete; // EPOCH_* that complete an epoch, learned from what the receiver sends
+  bool published;
+};
+
+static TinyGPSPlus gpsParser;
+static UbxDecoder ubxDecoder;
+static GpsFix gpsWorking = {};
+static GpsEpoch nmeaEpoch = {0, 0, EPOCH_GGA | EPOCH_RMC, false};
+static GpsEpoch ubxEpoch = {0, 0, EPOCH_UBX_ALL, false}; // Stamped with iTOW
+static uint32_t ubxLastNavMillis = 0;
+static uint32_t fixCount = 0;
+static void (*fixCallback)(const GpsFix &fix) = nullptr;
+static bool (*frameCallback)(const UbxDecoder &frame) = nullptr;
+
+static void publishFix(uint8_t source) {
+  gpsWorking.source = source;
+  gpsWorking.updateMillis = millis();
+  fixCount++;
+  if (fixCallback) {
+    fixCallback(gpsWorking);
+  }
+}
+
+// Copy what TinyGPSPlus has into the shared fix
+static void applyNmea(TinyGPSPlus &parser, GpsFix &fix) {
+  if (parser.location.isValid()) {
+    const RawDegrees &lat = parser.location.rawLat();
+    const RawDegrees &lon = parser.location.rawLng();
+    fix.location.valid = true;
+    fix.location.point = navPointFromRaw(lat.deg, lat.billionths, lat.negative,
+                                         lon.deg, lon.billionths, lon.negative);
+  }
+  if (parser.altitude.isValid()) {
+    fix.altitude.valid = true;
+    fix.altitude.value = parser.altitude.meters();
+  }
+  if (parser.speed.isValid()) {
+    fix.speed.valid = true;
+    fix.speed.value = parser.speed.kmph();
+  }
+  if (parser.course.isValid()) {
+    fix.course.valid = true;
+    fix.course.value = parser.course.deg();
+  }
+  if (parser.time.isValid()) {
+    fix.time.valid = true;
+    fix.time.h = parser.time.hour();
+    fix.time.m = parser.time.minute();
+    fix.time.s = parser.time.second();
+  }
+  if (parser.date.isValid()) {
+    fix.date.valid = true;
+    fix.date.y = parser.date.year();
+    fix.date.mo = parser.date.month();
+    fix.date.d = parser.date.day();
+  }
+  fix.satellites.count = parser.satellites.value();
+  fix.fixType = (parser.location.isValid() && parser.location.age() < 2000) ? 3 : 0;
+  fix.hAccMeters = parser.hdop.isValid() ? parser.hdop.hdop() * 5.0f : 0.0f; // HDOP times a typical UERE
+}
+
+// A message stamped `stamp` is about to be applied. Returns true if it starts a
+// new epoch while the previous one never completed: the receiver sends fewer
+// messages than expected, so what it did send goes out now and is all that is
+// waited for from here on.
+static bool epochOpens(GpsEpoch &epoch, uint32_t stamp) {
+  if (stamp == epoch.stamp) {
+    return false;
+  }
+  bool incomplete = epoch.parts && !epoch.published;
+  if (incomplete) {
+    epoch.complete = epoch.parts;
+  }
+  epoch.stamp = stamp;
+  epoch.parts = 0;
+  epoch.published = false;
+  return incomplete;
+}
+
+// The message was applied; returns true once every part of the epoch is in
+static bool epochCloses(GpsEpoch &epoch, uint8_t part) {
+  if (epoch.published) {
+    epoch.complete |= part; // Arrived after the epoch went out: wait for it next time
+    return false;
+  }
+  epoch.parts |= part;
+  if ((epoch.parts & epoch.complete) != epoch.complete) {
+    return false;
+  }
+  epoch.published = true;
+  return true;
+}
+
+// GGA and RMC of one epoch carry the same time; the fix goes out once both are in
+static void handleNmeaSentence() {
+  // GSA, GSV and the rest have no time stamp and add nothing to the fix
+  if (!gpsParser.time.isUpdated()) {
+    return;
+  }
+  uint8_t part = gpsParser.date.isUpdated() ? EPOCH_RMC : EPOCH_GGA;
+  // While UBX navigation is flowing, stray NMEA doesn't drive the fix
+  bool driving = millis() - ubxLastNavMillis > GPS_UBX_TIMEOUT_MS || ubxLastNavMillis == 0;
+  if (epochOpens(nmeaEpoch, gpsParser.time.value()) && driving) {
+    publishFix(GPS_SOURCE_NMEA);
+  }
+  applyNmea(gpsParser, gpsWorking);
+  if (epochCloses(nmeaEpoch, part) && driving) {
+    publishFix(GPS_SOURCE_NMEA);
+  }
+}
+
+static uint8_t ubxEpochPart(uint8_t id) {
+  switch (id) {
+    case UBX_NAV_PVT: return EPOCH_PVT;
+    case UBX_NAV_POSLLH: return EPOCH_POSLLH;
+    case UBX_NAV_SOL: return EPOCH_SOL;
+    case UBX_NAV_VELNED: return EPOCH_VELNED;
+    case UBX_NAV_TIMEUTC: return EPOCH_TIMEUTC;
+  }
+  return 0;
+}
+
+// NAV-PVT is a whole epoch; the NEO-6M's POSLLH, SOL, VELNED and TIMEUTC
+// share an iTOW and go out together
+static void handleUbxFrame() {
+  // ACKs and polled answers go to whoever is waiting for them
+  if (frameCallback && frameCallback(ubxDecoder)) {
+    return;
+  }
+  uint8_t part = ubxDecoder.msgClass() == UBX_CLASS_NAV ? ubxEpochPart(ubxDecoder.msgId()) : 0;
+  if (!part || ubxDecoder.length() < 4) {
+    return;
+  }
+  const uint8_t *p = ubxDecoder.payload();
+  uint32_t iTow = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  if (epochOpens(ubxEpoch, iTow)) {
+    publishFix(GPS_SOURCE_UBX);
+  }
+  if (ubxApplyNav(ubxDecoder, gpsWorking)) {
+    ubxLastNavMillis = millis();
+    if (epochCloses(ubxEpoch, part)) {
+      publishFix(GPS_SOURCE_UBX);
+    }
+  }
+}
+
+void gpsStreamFeed(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = data[i];
+    // UBX frames start with 0xB5, which never appears in NMEA text
+    if (ubxDecoder.inFrame() || c == UBX_SYNC1) {
+      if (ubxDecoder.feed(c)) {
+        handleUbxFrame();
+      }
+    } else if (gpsParser.encode(c)) {
+      handleNmeaSentence();
+    }
+  }
+}
+
+void gpsStreamOnFix(void (*callback)(const GpsFix &fix)) {
+  fixCallback = callback;
+}
+
+void gpsStreamOnFrame(bool (*callback)(const UbxDecoder &frame)) {
+  frameCallback = callback;
+}
+
+void gpsStreamStartUbx() {
+  ubxLastNavMillis = millis();
+}
+
+uint32_t gpsStreamLastUbxMillis() {
+  return ubxLastNavMillis;
+}
+
+void gpsStreamResync() {
+  ubxDecoder.reset();
+}
+
+void gpsStreamReset() {
+  gpsParser = TinyGPSPlus();
+  ubxDecoder = UbxDecoder();
+  gpsWorking = {};
+  nmeaEpoch = {0, 0, EPOCH_GGA | EPOCH_RMC, false};
+  ubxEpoch = {0, 0, EPOCH_UBX_ALL, false};
+  ubxLastNavMillis = 0;
+  fixCount = 0;
+}
+
+GpsStreamStats gpsStreamStats() {
+  GpsStreamStats stats;
+  stats.sentences = gpsParser.passedChecksum() + ubxDecoder.frames();
+  stats.checksumFailures = gpsParser.failedChecksum() + ubxDecoder.checksumFailures();
+  stats.fixes = fixCount;
+  stats.source = gpsWorking.source;
+  return stats;
+}
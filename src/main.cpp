@@ -3,8 +3,6 @@
 #include <GxIO/GxIO_SPI/GxIO_SPI.h>
 #include <GxIO/GxIO.h>
 #include <WiFi.h>
-#include <TinyGPS++.h>
-#include <EEPROM.h>
 #include "time.h"
 #include <AceButton.h>
 #include "driver/adc.h"
@@ -13,6 +11,29 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include "epd_frame.h"
+#include "nav_math.h"
+#include "dial_trig.h"
+#include "nav_dial.h"
+#include "gps_ingest.h"
+#include "gps_link.h"
+#include "gps_aid.h"
+#include "settings.h"
+#include "fuel_journal.h"
+#include "fuel_burn.h"
+#include "burn_model.h"
+#include "nav_solution.h"
+#include "waypoint_db.h"
+#include "airspace.h"
+#include "terrain.h"
+#include "telemetry.h"
+#include "telemetry_stream.h"
+#include "ble_commands.h"
+#include "ble_command_parser.h"
+#include "ble_governor.h"
+#include "bulk_transfer.h"
+#include "event_loop.h"
+#include "power_profile.h"
 
 #define DEBUG_ENABLED 0 // Set to 1 to enable debug output, 0 to disable
 
@@ -44,6 +65,7 @@
 #define GPS_RX_PIN 21
 #define GPS_TX_PIN 22
 #define GPS_RES 23
+#define GPS_USE_UBX 1          // Try to switch a u-blox receiver to binary UBX output
 
 // Define app version
 #define APP_VERSION "V2.00"
@@ -78,12 +100,20 @@ const char *ssid = "ESPNETWORK";
 const char *password = "12345678";
 
 // GPS settings
-TinyGPSPlus gps;
+GpsFix gps;
 HardwareSerial gpsSerial(1);
 
 // Create an instance of the display class for your specific ePaper display
 GxIO_Class io(SPI, /*CS=*/EPD_CS, /*DC=*/EPD_DC, /*RST=*/EPD_RESET);
-GxEPD_Class display(io, /*RST=*/EPD_RESET, /*BUSY=*/EPD_BUSY);
+GxEPD_Class epd(io, /*RST=*/EPD_RESET, /*BUSY=*/EPD_BUSY);
+
+// Screens draw into this frame; refresh() only pushes the parts that changed
+EpdFrame display(epd, 200, 200);
+
+// Static dial art (border, jerry can, rings and mode icon), rendered once per
+// operation mode at boot and copied into the frame before the dynamic overlays
+GFXcanvas1 flyingBackground(200, 200);
+GFXcanvas1 walkingBackground(200, 200);
 
 unsigned long lastRefreshTime = 0;  // Track the last refresh time
 unsigned long lastSerialOutputTime = 0; // Track the last time serial output was done
@@ -102,24 +132,44 @@ double fuelLevel = 12.0; // Initial fuel level in liters
 // Define an additional characteristic UUID for receiving data
 #define RECEIVE_CHARACTERISTIC_UUID "0000ffe1-0000-1000-8000-00805f9b34fb"
 
+#define BLE_LOCAL_MTU 247 // Largest ATT MTU we accept; fills one LE data packet
+#define BLE_MIN_SENDABLE_PACKETS 2 // Fewer free controller buffers than this and the link is congested
+
 // BLE variables
 BLEServer *pServer = NULL;
 BLECharacteristic *pCharacteristic = NULL;
 BLECharacteristic *pReceiveCharacteristic = NULL;
+BLECharacteristic *pTelemetryCharacteristic = NULL;
+BLECharacteristic *pBulkCharacteristic = NULL;
 bool deviceConnected = false;
-bool oldDeviceConnected = false;
-unsigned long bleConnectionTime = 0;
-const unsigned long bleTimeout = 300000; // 5 minutes in milliseconds
+
+// Link parameters, written from the BLE task and picked up by the stream in loop()
+volatile uint16_t bleConnId = 0;
+volatile uint16_t bleMtu = 23;
+volatile uint16_t bleConnectionIntervalMs = 30;
+esp_bd_addr_t bleRemoteAddress; // For connection parameter requests
 
 class MyServerCallbacks : public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
         deviceConnected = true;
-        bleConnectionTime = millis(); // Reset the timeout timer
-        DEBUG_PRINTLN("Device connected, resetting BLE timeout timer");
+        eventPost(EVENT_BLE);
+        DEBUG_PRINTLN("Device connected");
+    }
+
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
+        bleConnId = param->connect.conn_id;
+        bleMtu = 23; // Until the exchange
+        bleConnectionIntervalMs = param->connect.conn_params.interval * 5 / 4; // 1.25 ms units
+        memcpy(bleRemoteAddress, param->connect.remote_bda, sizeof(bleRemoteAddress));
+    }
+
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
+        bleMtu = param->mtu.mtu;
     }
 
     void onDisconnect(BLEServer* pServer) {
         deviceConnected = false;
+        eventPost(EVENT_BLE);
         DEBUG_PRINTLN("Device disconnected");
     }
 };
@@ -128,17 +178,17 @@ class MyServerCallbacks : public BLEServerCallbacks {
 #define BUTTON_DEBOUNCE_MS 50       // Debounce time in milliseconds
 #define BUTTON_SHORT_PRESS_MAX 800  // Maximum time for a short press in milliseconds
 #define BUTTON_LONG_PRESS_MIN 2000  // Minimum time for long press recognition in milliseconds
-volatile unsigned long lastButtonInterruptTime = 0;
-volatile bool buttonStateChanged = false;
+#define BUTTON_HELD_POLL_MS 50      // Loop wake-up interval while the button is held, to time the press
+#define LOOP_REPORT_MS 10000        // Idle/active time on serial this often
 
+// Every edge wakes loop(), which reads the pin and times the press itself
 void IRAM_ATTR handleButtonInterrupt() {
-  unsigned long interruptTime = millis();
-  // Ignore interrupts within debounce period
-  if (interruptTime - lastButtonInterruptTime > BUTTON_DEBOUNCE_MS) {
-    buttonPressed = true;
-    buttonStateChanged = true;
-    lastButtonInterruptTime = interruptTime;
-  }
+  eventPostFromISR(EVENT_BUTTON);
+}
+
+// Runs on the GPS ingest task
+static void handleGpsFix() {
+  eventPost(EVENT_GPS);
 }
 
 void handleEvent(AceButton* /*button*/, uint8_t eventType, uint8_t /*buttonState*/);
@@ -151,23 +201,31 @@ void displayCountdownScreen(int seconds);
 void printLocalTime();
 void printGPSData();
 void printGPSTime();
-void saveHomePoint();
-void loadHomePoint();
-double calculateDirectionToHome();
+void saveSettings();
+void loadSettings();
 int calculateBatteryStatus();
-double calculateRelativeBearing(double homeBearing, double pilotHeading);
-void drawNavigationDisplay(int centerX, int centerY, double homeBearing, double pilotHeading);
+void drawNavigationDisplay(int centerX, int centerY);
+void renderNavigationBackgrounds();
+void blitNavigationBackground();
 void drawSpeedometer(int centerX, int centerY, int speed);
 void updateDisplay();
 void handleButtonPress();
 void buzz(unsigned int frequency, unsigned long duration);
 void vibrateMotor(unsigned long duration);
+void checkAirspace();
+float heightAboveGround();
 void displaySleepScreen();
 void enterSleepMode();
 void handleWakeUp();
 void setupBLE();
 void sendBLEData();
-void handleBLECommand(const std::string &command);
+void sendTelemetryFrames();
+void serviceTelemetryStream();
+void serviceBulkTransfer();
+void handleBLECommand(const char *command);
+bool serviceBLECommands();
+void serviceBLERadio(bool commandsHandled);
+uint32_t loopTimeoutMs(bool buttonHeld);
 
 // Add variables for the POI (for backward compatibility)
 double poiLatitude = 0.0;
@@ -178,19 +236,32 @@ bool legacyPoiEnabled = false; // Renamed from poiEnabled to avoid conflict
 double fuelBurnRate = 4.8; // Default burn rate in L/h
 
 // Add global variables for mode selection and POIs at the top
-#define MODE_FLYING 1
-#define MODE_WALKING 2
 uint8_t operationMode = MODE_FLYING; // Default to flying mode
 bool doubleTapDetected = false;
 unsigned long lastTapTime = 0;
 const unsigned long doubleTapThreshold = 300; // ms between taps to count as double-tap
 
 // Add global variables for POIs
-#define MAX_POIS 3
+#define MAX_POIS SETTINGS_POI_COUNT
 double poiLatitudes[MAX_POIS] = {0.0};
 double poiLongitudes[MAX_POIS] = {0.0};
 bool poiEnabled[MAX_POIS] = {false};
 
+// What the nav solution works out each fix: home, then the POIs
+#define NAV_TARGET_HOME 0
+#define NAV_TARGET_POI 1
+#define NAV_TARGETS (NAV_TARGET_POI + MAX_POIS)
+NavTarget navTargets[NAV_TARGETS] = {};
+
+// Nearest landable fields from the waypoint database, refreshed with each fix
+#define NEAREST_WAYPOINTS 3
+WaypointHit nearestWaypoints[NEAREST_WAYPOINTS];
+uint16_t nearestWaypointCount = 0;
+
+#define AIRSPACE_ALERT_REPEAT_MS 30000 // Keep alerting this often while inside
+
+float groundElevation = NAN; // Terrain under the last fix in metres MSL, NAN if unknown
+
 // Add more screens
 bool isScreen6 = false;
 bool isScreen7 = false;
@@ -209,17 +280,59 @@ void displayPOIScreen(int poiIndex);
 void displayCoordinatesScreen();
 void displayAutoPowerOff(bool isFlying);
 float getBatteryVoltage();
-void saveOperationMode();
-void loadOperationMode();
-void savePOIs();
-void loadPOIs();
-
-// Function to calculate the direction to the POI
-double calculateDirectionToPOI() {
-    if (gps.location.isValid() && legacyPoiEnabled) {
-        return TinyGPSPlus::courseTo(gps.location.lat(), gps.location.lng(), poiLatitude, poiLongitude);
+
+// Battery as last sampled, at the power profile's interval
+float batteryVoltage = 0.0f;
+int batteryPercent = 0;
+unsigned long lastBatterySampleTime = 0;
+unsigned long lastDisplayRefreshTime = 0;
+
+void sampleBattery() {
+    batteryVoltage = getBatteryVoltage();
+    batteryPercent = calculateBatteryStatus();
+    lastBatterySampleTime = millis();
+}
+
+// Average and worst screen redraw and fix handling for each profile that has run
+void formatPowerTimings(char *out, size_t size) {
+    PowerProfileStats power = powerProfileStats();
+    size_t used = snprintf(out, size, "%s%s", powerProfile().name, powerProfileMoving() ? "" : " (still)");
+    for (uint8_t i = 0; i < POWER_PROFILES && used < size; i++) {
+        const PowerTiming &frames = power.frames[i];
+        const PowerTiming &fixes = power.fixes[i];
+        if (!frames.count && !fixes.count) {
+            continue;
+        }
+        used += snprintf(out + used, size - used, ", %s frame %lu/%lu ms fix %lu/%lu us", powerProfileAt(i).name,
+                         (unsigned long)(frames.count ? frames.totalUs / frames.count / 1000 : 0),
+                         (unsigned long)(frames.maxUs / 1000),
+                         (unsigned long)(fixes.count ? fixes.totalUs / fixes.count : 0), (unsigned long)fixes.maxUs);
     }
-    return 0.0;
+}
+
+// Every setting of the current power profile in one go. The screen and
+// battery cadences are read from the profile where they are used.
+void applyPowerProfile() {
+    const PowerProfile &profile = powerProfile();
+    eventLoopSetMaxMhz(profile.cpuMhz);
+    if (gpsLinkState().rateHz != profile.gpsRateHz) {
+        gpsSetNavRate(profile.gpsRateHz);
+    }
+    bleGovernorSetAdvertisingFloor(profile.advertisingFloor, millis());
+    DEBUG_PRINTF("Power profile %s: %u MHz, GPS %u Hz, screen every %lu s, battery every %lu s\n",
+                 profile.name, profile.cpuMhz, profile.gpsRateHz, (unsigned long)(profile.displayRefreshMs / 1000),
+                 (unsigned long)(profile.batterySampleMs / 1000));
+}
+
+// Hand home and the POIs to the nav solution and recompute it from the current fix
+void updateNavTargets() {
+    navTargets[NAV_TARGET_HOME].point = navPointFromDegrees(homeLatitude, homeLongitude);
+    navTargets[NAV_TARGET_HOME].enabled = homePointSet;
+    for (int i = 0; i < MAX_POIS; i++) {
+        navTargets[NAV_TARGET_POI + i].point = navPointFromDegrees(poiLatitudes[i], poiLongitudes[i]);
+        navTargets[NAV_TARGET_POI + i].enabled = poiEnabled[i];
+    }
+    navSolutionUpdate(gps, navTargets, NAV_TARGETS);
 }
 
 void handleEvent(AceButton* /*button*/, uint8_t eventType, uint8_t /*buttonState*/) {
@@ -385,7 +498,7 @@ void displayWaitingForSatsScreen() {
   }
 
   // Add battery percentage on the bottom right
-  int batteryPercentage = calculateBatteryStatus();
+  int batteryPercentage = batteryPercent;
   display.setTextSize(1);
   display.setCursor(150, 185);
   display.print(batteryPercentage);
@@ -397,7 +510,7 @@ void displayWaitingForSatsScreen() {
   display.print("2");
 
   // Partial update
-  display.updateWindow(0, 0, display.width(), display.height(), false);
+  display.refresh();
   DEBUG_PRINTLN("Screen 2: Waiting for Satellites Screen");
 }
 
@@ -406,19 +519,11 @@ void displaySetHomePointScreen() {
 }
 
 void displayHomePointScreen() {
-  display.fillScreen(GxEPD_WHITE);
-
-  // Calculate direction to home and pilot's heading
-  double homeBearing = gps.location.isValid() && homePointSet
-                           ? TinyGPSPlus::courseTo(gps.location.lat(), gps.location.lng(), homeLatitude, homeLongitude)
-                           : 0.0;
-  double pilotHeading = gps.course.isValid() ? gps.course.deg() : 0.0;
-
-  // Draw the navigation display
-  drawNavigationDisplay(100, 100, homeBearing, pilotHeading);
+  // Draw the navigation display from the bearings worked out at the last fix
+  drawNavigationDisplay(100, 100);
 
   // Display battery percentage on the top left
-  int batteryPercentage = calculateBatteryStatus();
+  int batteryPercentage = batteryPercent;
   display.setCursor(0, 0);
   display.print(batteryPercentage);
   display.print("%");
@@ -428,8 +533,9 @@ void displayHomePointScreen() {
   display.setCursor(5, display.height() - 22); // Adjusted position
   display.print("H");
 
-  display.updateWindow(0, 0, display.width(), display.height(), false);
-  DEBUG_PRINTLN("Screen 5: Home Point Screen");
+  display.refresh();
+  DEBUG_PRINTF("Screen 5: Home Point Screen (%lu bytes, %u windows)\n",
+               (unsigned long)display.lastPushBytes(), display.lastPushWindows());
 }
 
 void displayDataScreen() {
@@ -465,7 +571,7 @@ void displayDataScreen() {
     display.print("N/A");
   }
   
-  yPos += 25; // Increased spacing for larger font
+  yPos += 22; // Increased spacing for larger font
   display.setCursor(labelX, yPos);
   display.print("Lon:");
   display.setCursor(valueX, yPos);
@@ -475,7 +581,7 @@ void displayDataScreen() {
     display.print("N/A");
   }
   
-  yPos += 25;
+  yPos += 22;
   display.setCursor(labelX, yPos);
   display.print("Alt:");
   display.setCursor(valueX, yPos);
@@ -486,7 +592,19 @@ void displayDataScreen() {
     display.print("N/A");
   }
   
-  yPos += 25;
+  yPos += 22;
+  display.setCursor(labelX, yPos);
+  display.print("AGL:");
+  display.setCursor(valueX, yPos);
+  float agl = heightAboveGround();
+  if (!isnan(agl)) {
+    display.print(agl, 0);
+    display.print("m");
+  } else {
+    display.print("N/A");
+  }
+  
+  yPos += 22;
   display.setCursor(labelX, yPos);
   display.print("Spd:");
   display.setCursor(valueX, yPos);
@@ -497,14 +615,14 @@ void displayDataScreen() {
     display.print("N/A");
   }
   
-  yPos += 25;
+  yPos += 22;
   display.setCursor(labelX, yPos);
   display.print("Sats:");
   display.setCursor(valueX, yPos);
   display.print(gps.satellites.value());
   
   // Add time at the bottom
-  yPos += 25;
+  yPos += 22;
   display.setCursor(labelX, yPos);
   display.print("Time:");
   display.setCursor(valueX, yPos);
@@ -521,7 +639,7 @@ void displayDataScreen() {
   display.setCursor(185, 190);
   display.print("6");
 
-  display.updateWindow(0, 0, display.width(), display.height(), false);
+  display.refresh();
   DEBUG_PRINTLN("Screen 6: Data Screen");
 }
 
@@ -566,7 +684,7 @@ void displayCountdownScreen(int seconds) {
   display.print("Lon: ");
   display.print(homeLongitude, 6);
 
-  display.updateWindow(0, 0, display.width(), display.height(), false);
+  display.refresh();
 
   if (seconds == 10) {
     DEBUG_PRINTLN("Screen 4: Press Button Countdown Screen");
@@ -599,6 +717,10 @@ void printGPSData()
   {
     DEBUG_PRINTLN("Waiting for GPS signal...");
   }
+
+  GpsIngestStats stats = gpsIngestStats();
+  DEBUG_PRINTF("GPS ingest (%s): %u messages/s, %lu checksum failures, %lu overruns\n",
+               stats.protocol == GPS_SOURCE_UBX ? "UBX" : "NMEA", stats.sentencesPerSecond, (unsigned long)stats.checksumFailures, (unsigned long)stats.overruns);
 }
 
 void printGPSTime()
@@ -616,106 +738,57 @@ void printGPSTime()
   }
 }
 
-void saveHomePoint() {
-  EEPROM.begin(512);
-  EEPROM.put(0, homeLatitude);
-  EEPROM.put(sizeof(homeLatitude), homeLongitude);
-  EEPROM.commit();
-  DEBUG_PRINTLN("Home point saved");
-}
-
-void loadHomePoint() {
-  EEPROM.begin(512);
-  EEPROM.get(0, homeLatitude);
-  EEPROM.get(sizeof(homeLatitude), homeLongitude);
-  DEBUG_PRINTLN("Home point loaded");
-}
-
-void savePOI() {
-    EEPROM.begin(512);
-    EEPROM.put(sizeof(homeLatitude) + sizeof(homeLongitude), poiLatitude);
-    EEPROM.put(sizeof(homeLatitude) + sizeof(homeLongitude) + sizeof(poiLatitude), poiLongitude);
-    EEPROM.put(sizeof(homeLatitude) + sizeof(homeLongitude) + sizeof(poiLatitude) + sizeof(poiLongitude), legacyPoiEnabled);
-    EEPROM.commit();
-    DEBUG_PRINTLN("POI saved to EEPROM");
-}
-
-void loadPOI() {
-    EEPROM.begin(512);
-    EEPROM.get(sizeof(homeLatitude) + sizeof(homeLongitude), poiLatitude);
-    EEPROM.get(sizeof(homeLatitude) + sizeof(homeLongitude) + sizeof(poiLatitude), poiLongitude);
-    EEPROM.get(sizeof(homeLatitude) + sizeof(homeLongitude) + sizeof(poiLatitude) + sizeof(poiLongitude), legacyPoiEnabled);
-    DEBUG_PRINTF("POI loaded from EEPROM: Lat=%.6f, Lon=%.6f, Enabled=%d\n", poiLatitude, poiLongitude, legacyPoiEnabled);
+// Copy the persisted globals into the settings record, committed later by settingsService()
+void saveSettings() {
+    Settings settings;
+    settings.homeLatitude = homeLatitude;
+    settings.homeLongitude = homeLongitude;
+    for (int i = 0; i < MAX_POIS; i++) {
+        settings.poiLatitudes[i] = poiLatitudes[i];
+        settings.poiLongitudes[i] = poiLongitudes[i];
+        settings.poiEnabled[i] = poiEnabled[i];
+    }
+    settings.fuelLevel = fuelLevel;
+    settings.fuelBurnRate = fuelBurnRate;
+    settings.operationMode = operationMode;
+    settings.burnModel = burnModelState();
+    settingsStore(settings);
+    updateNavTargets();
 }
 
-void saveFuelData() {
-    // Initialize EEPROM with enough size
-    EEPROM.begin(512);
-    
-    // Calculate the memory addresses where to store the values
-    int fuelLevelOffset = sizeof(homeLatitude) + sizeof(homeLongitude) + sizeof(poiLatitude) + sizeof(poiLongitude) + sizeof(legacyPoiEnabled);
-    int fuelBurnRateOffset = fuelLevelOffset + sizeof(double);
-    
-    DEBUG_PRINTF("DEBUG: Saving fuel data - Level=%.2f L, Rate=%.2f L/h at offsets %d and %d\n", 
-                  fuelLevel, fuelBurnRate, fuelLevelOffset, fuelBurnRateOffset);
-    
-    // Save the values to EEPROM
-    EEPROM.put(fuelLevelOffset, fuelLevel);
-    EEPROM.put(fuelBurnRateOffset, fuelBurnRate);
-    
-    // Important: commit the changes to EEPROM
-    bool success = EEPROM.commit();
-    DEBUG_PRINTF("EEPROM commit %s\n", success ? "successful" : "failed");
-    
-    // Verify what was actually saved
-    double storedLevel, storedRate;
-    EEPROM.get(fuelLevelOffset, storedLevel);
-    EEPROM.get(fuelBurnRateOffset, storedRate);
-    DEBUG_PRINTF("Verification - Read from EEPROM: Level=%.2f L, Rate=%.2f L/h\n", storedLevel, storedRate);
-}
+void loadSettings() {
+    Settings settings;
+    if (!settingsLoad(settings)) {
+        DEBUG_PRINTLN("No stored settings, using defaults");
+    }
 
-void loadFuelData() {
-    EEPROM.begin(512);
-    
-    // Calculate the same memory addresses
-    int fuelLevelOffset = sizeof(homeLatitude) + sizeof(homeLongitude) + sizeof(poiLatitude) + sizeof(poiLongitude) + sizeof(legacyPoiEnabled);
-    int fuelBurnRateOffset = fuelLevelOffset + sizeof(double);
-    
-    DEBUG_PRINTF("DEBUG: Loading fuel data from offsets %d and %d\n", fuelLevelOffset, fuelBurnRateOffset);
-    
-    // Load the values from EEPROM
-    double storedLevel, storedRate;
-    EEPROM.get(fuelLevelOffset, storedLevel);
-    EEPROM.get(fuelBurnRateOffset, storedRate);
-    
-    DEBUG_PRINTF("Raw fuel data from EEPROM: Level=%.2f L, Rate=%.2f L/h\n", storedLevel, storedRate);
-    
-    // Only update the global variables if the stored values seem valid
-    if (!isnan(storedLevel) && storedLevel > 0 && storedLevel <= 100) {
-        fuelLevel = storedLevel;
-    } else {
-        fuelLevel = 12.0; // Default
-        DEBUG_PRINTLN("Using default fuel level: 12.0 L");
+    homeLatitude = settings.homeLatitude;
+    homeLongitude = settings.homeLongitude;
+    for (int i = 0; i < MAX_POIS; i++) {
+        poiLatitudes[i] = settings.poiLatitudes[i];
+        poiLongitudes[i] = settings.poiLongitudes[i];
+        poiEnabled[i] = settings.poiEnabled[i];
     }
-    
-    if (!isnan(storedRate) && storedRate > 0 && storedRate <= 10) {
-        fuelBurnRate = storedRate;
-    } else {
-        fuelBurnRate = 4.5; // Default
-        DEBUG_PRINTLN("Using default burn rate: 4.5 L/h");
+    fuelLevel = settings.fuelLevel;
+    fuelBurnRate = settings.fuelBurnRate;
+    operationMode = settings.operationMode;
+    if (operationMode != MODE_FLYING && operationMode != MODE_WALKING) {
+        operationMode = MODE_FLYING;
     }
-    
-    DEBUG_PRINTF("Final fuel data: Level=%.2f L, Rate=%.2f L/h\n", fuelLevel, fuelBurnRate);
-}
+    burnModelBegin(settings.burnModel, fuelBurnRate);
 
-double calculateDirectionToHome() {
-  if (gps.location.isValid() && homePointSet) {
-    double currentLatitude = gps.location.lat();
-    double currentLongitude = gps.location.lng();
-    double bearing = TinyGPSPlus::courseTo(currentLatitude, currentLongitude, homeLatitude, homeLongitude);
-    return bearing;
-  }
-  return 0.0;
+    // For backward compatibility
+    poiLatitude = poiLatitudes[0];
+    poiLongitude = poiLongitudes[0];
+    legacyPoiEnabled = poiEnabled[0];
+    updateNavTargets();
+
+    DEBUG_PRINTF("Settings loaded: Home=%.6f,%.6f Fuel=%.2f L, Rate=%.2f L/h, Mode=%d\n",
+                 homeLatitude, homeLongitude, fuelLevel, fuelBurnRate, operationMode);
+    for (int i = 0; i < MAX_POIS; i++) {
+        DEBUG_PRINTF("POI %d: Lat=%.6f, Lon=%.6f, Enabled=%d\n",
+                     i+1, poiLatitudes[i], poiLongitudes[i], poiEnabled[i]);
+    }
 }
 
 int calculateBatteryStatus() {
@@ -728,60 +801,17 @@ int calculateBatteryStatus() {
   return constrain(map(volt * 1000, 1630, 1850, 0, 100), 0, 100);
 }
 
-double calculateRelativeBearing(double homeBearing, double pilotHeading) {
-  // Calculate the relative bearing
-  double relativeBearing = homeBearing - pilotHeading;
-
-  // Normalize to the range -180° to 180°
-  if (relativeBearing > 180) {
-    relativeBearing -= 360;
-  } else if (relativeBearing < -180) {
-    relativeBearing += 360;
-  }
-
-  return relativeBearing;
-}
-
-void drawNavigationDisplay(int centerX, int centerY, double homeBearing, double pilotHeading) {
-  // Draw a 200x200 box around the screen
-  display.drawRect(0, 0, 200, 200, GxEPD_BLACK);
-
-  // Replace the inner circle with a jerry can icon
-  // Jerry can outline
-  int canLeft = centerX - 32;
-  int canTop = centerY - 20;
-  int canWidth = 64;
-  int canHeight = 50;
-  
-  // Draw the main body of the jerry can
-  display.drawRect(canLeft, canTop, canWidth, canHeight, GxEPD_BLACK);
-  display.drawLine(canLeft + 5, canTop, canLeft + 5, canTop + canHeight, GxEPD_BLACK); // Left vertical ridge
-  display.drawLine(canLeft + canWidth - 5, canTop, canLeft + canWidth - 5, canTop + canHeight, GxEPD_BLACK); // Right vertical ridge
-  
-  // Draw the cap/lid on top that appears open
-  display.drawLine(canLeft + 20, canTop - 10, canLeft + 44, canTop - 10, GxEPD_BLACK); // Cap top
-  display.drawLine(canLeft + 20, canTop - 10, canLeft + 24, canTop, GxEPD_BLACK); // Cap left side
-  display.drawLine(canLeft + 44, canTop - 10, canLeft + 40, canTop, GxEPD_BLACK); // Cap right side
-  
-  // Draw fuel dripping/pouring from the can
-  display.drawLine(canLeft + 32, canTop - 10, canLeft + 32, canTop - 15, GxEPD_BLACK); // Fuel stream
-  display.drawLine(canLeft + 33, canTop - 12, canLeft + 35, canTop - 18, GxEPD_BLACK); // Drip 1
-  display.drawLine(canLeft + 30, canTop - 14, canLeft + 28, canTop - 19, GxEPD_BLACK); // Drip 2
-
-  // Draw handle
-  display.drawLine(canLeft + canWidth, canTop + 10, canLeft + canWidth + 10, canTop + 10, GxEPD_BLACK);
-  display.drawLine(canLeft + canWidth, canTop + 40, canLeft + canWidth + 10, canTop + 40, GxEPD_BLACK);
-  display.drawLine(canLeft + canWidth + 10, canTop + 10, canLeft + canWidth + 10, canTop + 40, GxEPD_BLACK);
+void drawNavigationDisplay(int centerX, int centerY) {
+  const NavTarget &home = navTargets[NAV_TARGET_HOME];
 
-  // Keep the middle and outer circles for navigation display
-  display.drawCircle(centerX, centerY, 70, GxEPD_BLACK); // Middle circle
-  display.drawCircle(centerX, centerY, 95, GxEPD_BLACK); // Outer circle
-  display.drawCircle(centerX, centerY, 96, GxEPD_BLACK); // Thicker outer circle
+  // Border, jerry can, rings and mode icon come from the cached background,
+  // which also clears whatever the previous screen left in the frame
+  blitNavigationBackground();
 
   // Calculate the position of the "H" circle based on the relative bearing
-  double relativeBearingRad = calculateRelativeBearing(homeBearing, pilotHeading) * DEG_TO_RAD; // Convert to radians
-  int hCircleX = centerX + 80 * sin(relativeBearingRad);    // Move inward slightly
-  int hCircleY = centerY - 80 * cos(relativeBearingRad);
+  int16_t hCircleX, hCircleY;
+  uint16_t relativeAngle = dialAngleFromDegrees(home.relativeBearing);
+  dialPolarToScreen(centerX, centerY, 80, relativeAngle, &hCircleX, &hCircleY); // Move inward slightly
 
   // Draw the "H" circle filled with black
   display.fillCircle(hCircleX, hCircleY, 12, GxEPD_BLACK); // Larger circle for "H"
@@ -812,8 +842,20 @@ void drawNavigationDisplay(int centerX, int centerY, double homeBearing, double
   display.setCursor(centerX - (textWidth / 2), centerY - 5); // Moved up a bit from centerY + 3
   display.print(fuelText);
 
+  // Endurance above and still-air range below the fuel level, small text inside the can
+  FuelPrediction prediction = fuelPredict(fuelLevel, burnModelRate(fuelBurnRate), gps);
+  char predictionText[10];
+  int enduranceMinutes = min((int)prediction.enduranceMinutes, 599);
+  sprintf(predictionText, "%d:%02d", enduranceMinutes / 60, enduranceMinutes % 60);
+  display.setTextSize(1);
+  display.setCursor(centerX - (strlen(predictionText) * 6) / 2, centerY - 16);
+  display.print(predictionText);
+  sprintf(predictionText, "%dkm", min((int)prediction.rangeKm, 999));
+  display.setCursor(centerX - (strlen(predictionText) * 6) / 2, centerY + 21);
+  display.print(predictionText);
+
   // Display distance to home at the bottom - moved down a bit
-  double distanceKm = homePointSet ? gps.distanceBetween(gps.location.lat(), gps.location.lng(), homeLatitude, homeLongitude) / 1000.0 : 0.0;
+  double distanceKm = home.distanceMeters / 1000.0;
   display.setTextSize(2); // Reduce the font size for the distance number
   char distanceText[10];
   if (distanceKm > 10) {
@@ -826,42 +868,41 @@ void drawNavigationDisplay(int centerX, int centerY, double homeBearing, double
   textWidth = strlen(distanceText) * 12; // Approximate width of text at size 2
   display.setCursor(centerX - (textWidth / 2), centerY + 45); // Moved down from centerY + 35
   display.print(distanceText);
-  
-  // Draw mode icon in top right corner - MAKE AIRPLANE ICON LARGER
-  if (operationMode == MODE_WALKING) {
-    // Draw walking person icon
-    int iconX = 180;
-    int iconY = 20;
-    // Head
-    display.fillCircle(iconX, iconY - 8, 3, GxEPD_BLACK);
-    // Body
-    display.drawLine(iconX, iconY - 5, iconX, iconY + 5, GxEPD_BLACK);
-    // Arms
-    display.drawLine(iconX, iconY, iconX - 4, iconY - 2, GxEPD_BLACK);
-    display.drawLine(iconX, iconY, iconX + 4, iconY + 2, GxEPD_BLACK);
-    // Legs
-    display.drawLine(iconX, iconY + 5, iconX - 4, iconY + 12, GxEPD_BLACK);
-    display.drawLine(iconX, iconY + 5, iconX + 4, iconY + 12, GxEPD_BLACK);
-  } else { // MODE_FLYING - Make airplane icon larger
-    int iconX = 180;
-    int iconY = 20;
-    // Fuselage - make longer
-    display.drawLine(iconX - 12, iconY, iconX + 12, iconY, GxEPD_BLACK);
-    display.drawLine(iconX - 12, iconY+1, iconX + 12, iconY+1, GxEPD_BLACK); // Make thicker
-    
-    // Wings - make wider
-    display.drawLine(iconX, iconY - 9, iconX, iconY + 9, GxEPD_BLACK);
-    display.drawLine(iconX+1, iconY - 9, iconX+1, iconY + 9, GxEPD_BLACK); // Make thicker
-    
-    display.drawLine(iconX - 8, iconY - 3, iconX + 8, iconY - 3, GxEPD_BLACK);
-    display.drawLine(iconX - 8, iconY - 2, iconX + 8, iconY - 2, GxEPD_BLACK); // Make thicker
-    
-    // Tail
-    display.drawLine(iconX - 8, iconY + 6, iconX + 2, iconY + 6, GxEPD_BLACK);
-    display.drawLine(iconX - 8, iconY + 5, iconX + 2, iconY + 5, GxEPD_BLACK); // Make thicker
+
+  // Airspace warning as an inverted banner across the top of the dial
+  const AirspaceStatus &airspace = airspaceStatus();
+  if (operationMode == MODE_FLYING && airspace.level != AIRSPACE_LEVEL_NONE) {
+    char warningText[21];
+    if (airspace.level == AIRSPACE_LEVEL_INSIDE) {
+      snprintf(warningText, sizeof(warningText), "IN %s", airspaceName(airspace.area));
+    } else if (airspace.horizontalMeters > 0.0f) {
+      snprintf(warningText, sizeof(warningText), "%.11s %.1fkm", airspaceName(airspace.area),
+               airspace.horizontalMeters / 1000.0);
+    } else {
+      snprintf(warningText, sizeof(warningText), "%.12s %dm", airspaceName(airspace.area),
+               (int)airspace.verticalMeters);
+    }
+    display.fillRect(centerX - 60, 2, 120, 12, GxEPD_BLACK);
+    display.setTextColor(GxEPD_WHITE);
+    display.setTextSize(1);
+    display.setCursor(centerX - (strlen(warningText) * 6) / 2, 4);
+    display.print(warningText);
+    display.setTextColor(GxEPD_BLACK);
   }
 }
 
+// Pre-render the dial background for both operation modes
+void renderNavigationBackgrounds() {
+  drawNavigationBackground(flyingBackground, 100, 100, MODE_FLYING);
+  drawNavigationBackground(walkingBackground, 100, 100, MODE_WALKING);
+  DEBUG_PRINTLN("Navigation backgrounds rendered");
+}
+
+// Start a navigation screen from the cached background of the current mode
+void blitNavigationBackground() {
+  display.copyFrom(operationMode == MODE_WALKING ? walkingBackground : flyingBackground);
+}
+
 // This function is now empty - it's kept for compatibility but does nothing
 // since we've removed the speedometer needle functionality
 void drawSpeedometer(int centerX, int centerY, int speed) {
@@ -909,6 +950,37 @@ void vibrateMotor(unsigned long duration) {
   digitalWrite(PIN_MOTOR, LOW);
 }
 
+// Height above the terrain under the last fix, NAN without terrain data or altitude
+float heightAboveGround() {
+  return gps.altitude.isValid() ? gps.altitude.value - groundElevation : NAN;
+}
+
+// Evaluate airspace at the new fix; alert when the warning gets worse and keep alerting while inside
+void checkAirspace() {
+  static uint8_t lastLevel = AIRSPACE_LEVEL_NONE;
+  static unsigned long lastAlertTime = 0;
+
+  const AirspaceStatus &airspace = airspaceEvaluate(gps, groundElevation);
+  if (airspace.level > lastLevel ||
+      (airspace.level == AIRSPACE_LEVEL_INSIDE && millis() - lastAlertTime >= AIRSPACE_ALERT_REPEAT_MS)) {
+    if (airspace.level == AIRSPACE_LEVEL_INSIDE) {
+      buzz(2000, 300);
+      vibrateMotor(300);
+    } else {
+      vibrateMotor(150);
+    }
+    lastAlertTime = millis();
+    DEBUG_PRINTF("Airspace %s: %s, %.0f m / %.0f m\n", airspace.level == AIRSPACE_LEVEL_INSIDE ? "inside" : "near",
+                 airspaceName(airspace.area), airspace.horizontalMeters, airspace.verticalMeters);
+  }
+
+  // Show or clear the banner straight away
+  if (airspace.level != lastLevel && isHomePointScreen) {
+    displayHomePointScreen();
+  }
+  lastLevel = airspace.level;
+}
+
 void displaySleepScreen() {
   display.fillScreen(GxEPD_WHITE);
 
@@ -946,7 +1018,10 @@ void enterSleepMode() {
   
   // Power down GPS module
   DEBUG_PRINTLN("Powering down GPS module");
-  gpsSerial.end(); // Close the GPS serial port
+  gpsAidSave(gps); // Last fix for hot-start aiding on wake
+  settingsFlush(); // Don't lose settings still waiting for their deferred commit
+  fuelJournalFlush(fuelLevel, fuelBurnRate);
+  gpsIngestEnd(); // Stop the ingest task feeding and close the GPS serial port
   
   // Set GPS_RES pin to LOW and hold it during sleep
   //pinMode(GPS_RES, OUTPUT);
@@ -978,7 +1053,8 @@ void enterSleepMode() {
   
   // More aggressive power-down of peripherals
   esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_OFF);
-  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_SLOW_MEM, ESP_PD_OPTION_OFF);
+  // RTC slow memory stays on: it holds the GPS link state and last fix for aiding
+  esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_SLOW_MEM, ESP_PD_OPTION_ON);
   esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_FAST_MEM, ESP_PD_OPTION_OFF);
   digitalWrite(GPS_RES, LOW); 
   // Disable all wakeup sources first 
@@ -1024,7 +1100,7 @@ void handleWakeUp() {
       digitalWrite(GPS_RES, HIGH);
       delay(200); // Give GPS module time to initialize
       
-      gpsSerial.begin(9600, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+      gpsIngestBegin(gpsSerial, 9600, GPS_RX_PIN, GPS_TX_PIN);
       
       // Vibrate briefly to indicate wake-up
       pinMode(PIN_MOTOR, OUTPUT);
@@ -1042,8 +1118,42 @@ void handleWakeUp() {
   }
 }
 
+// Runs on the BLE task: only queue the command, loop() handles it
+class ReceiveCallbacks : public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic *characteristic) {
+        bleCommandPush(characteristic->getData(), characteristic->getLength());
+        eventPost(EVENT_BLE);
+    }
+};
+
+// Bulk upload packets, queued the same way
+class BulkCallbacks : public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic *characteristic) {
+        bulkTransferPush(characteristic->getData(), characteristic->getLength());
+        eventPost(EVENT_BLE);
+    }
+};
+
+// notify() reports how it went through onStatus() before it returns
+static bool telemetryNotified = false;
+
+class TelemetryCallbacks : public BLECharacteristicCallbacks {
+    void onStatus(BLECharacteristic *characteristic, Status status, uint32_t code) {
+        telemetryNotified = status == SUCCESS_NOTIFY;
+    }
+};
+
+// The central may change the connection interval at any time; the stream paces itself by it
+static void handleGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+    if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT && param->update_conn_params.status == 0) {
+        bleConnectionIntervalMs = param->update_conn_params.conn_int * 5 / 4;
+    }
+}
+
 void setupBLE() {
     BLEDevice::init("ENAV_BLE");
+    BLEDevice::setMTU(BLE_LOCAL_MTU); // Otherwise the MTU exchange can't go above the default 23
+    BLEDevice::setCustomGapHandler(handleGapEvent);
     pServer = BLEDevice::createServer();
     pServer->setCallbacks(new MyServerCallbacks());
 
@@ -1062,6 +1172,23 @@ void setupBLE() {
         BLECharacteristic::PROPERTY_WRITE
     );
     pReceiveCharacteristic->addDescriptor(new BLE2902()); // Add descriptor for compatibility
+    pReceiveCharacteristic->setCallbacks(new ReceiveCallbacks());
+
+    // Binary telemetry, next to the text status while clients migrate
+    pTelemetryCharacteristic = pService->createCharacteristic(
+        TELEMETRY_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+    );
+    pTelemetryCharacteristic->addDescriptor(new BLE2902());
+    pTelemetryCharacteristic->setCallbacks(new TelemetryCallbacks());
+
+    // Bulk uploads: chunks come as writes without response, acknowledgements go out as notifications
+    pBulkCharacteristic = pService->createCharacteristic(
+        BULK_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_NOTIFY
+    );
+    pBulkCharacteristic->addDescriptor(new BLE2902());
+    pBulkCharacteristic->setCallbacks(new BulkCallbacks());
 
     pService->start();
 
@@ -1070,14 +1197,17 @@ void setupBLE() {
     pAdvertising->setScanResponse(true);
     pAdvertising->setMinPreferred(0x06);  // Functions that help with iPhone connections issue
     pAdvertising->setMinPreferred(0x12);
+    BleAdvertisingParams advertising = bleGovernorAdvertising();
+    pAdvertising->setMinInterval(advertising.minInterval);
+    pAdvertising->setMaxInterval(advertising.maxInterval);
     BLEDevice::startAdvertising();
     DEBUG_PRINTLN("BLE started");
 }
 
 void sendBLEData() {
     if (deviceConnected) {
-        char bleString[512]; // Increased buffer size for more data
-        float voltage = getBatteryVoltage();
+        char bleString[1024]; // Increased buffer size for more data
+        float voltage = batteryVoltage;
         
         // Format the string with all POIs and battery voltage
         char poiData[256] = "";
@@ -1088,241 +1218,479 @@ void sendBLEData() {
             strcat(poiData, poiStr);
         }
         
+        GpsIngestStats gpsStats = gpsIngestStats();
+        GpsTtff ttff = gpsAidTtff();
+        FuelPrediction prediction = fuelPredict(fuelLevel, burnModelRate(fuelBurnRate), gps);
+
+        // Distance, course and ETA to home and each enabled POI from the last fix
+        const NavSolution &nav = navSolution();
+        char navData[192] = "";
+        for (int i = -1; i < MAX_POIS; i++) {
+            const NavTarget &target = navTargets[NAV_TARGET_POI + i]; // -1 is home
+            if (!target.enabled || !nav.valid) {
+                continue;
+            }
+            char targetStr[48];
+            char label[4] = "H";
+            if (i >= 0) {
+                snprintf(label, sizeof(label), "P%d", i + 1);
+            }
+            if (target.etaSeconds >= 0.0f) {
+                snprintf(targetStr, sizeof(targetStr), "%s%s %.2f km %.0f deg ETA %lu min", navData[0] ? ", " : "",
+                         label, target.distanceMeters / 1000.0, (double)target.courseDegrees,
+                         (unsigned long)(target.etaSeconds / 60.0f + 0.5f));
+            } else {
+                snprintf(targetStr, sizeof(targetStr), "%s%s %.2f km %.0f deg", navData[0] ? ", " : "",
+                         label, target.distanceMeters / 1000.0, (double)target.courseDegrees);
+            }
+            strcat(navData, targetStr);
+        }
+
+        char nearData[96] = "";
+        for (int i = 0; i < nearestWaypointCount; i++) {
+            char nearStr[32];
+            snprintf(nearStr, sizeof(nearStr), "%s%.12s %.1f km", i ? ", " : "",
+                     waypointDbName(*waypointDbRecord(nearestWaypoints[i].index)),
+                     nearestWaypoints[i].distanceMeters / 1000.0);
+            strcat(nearData, nearStr);
+        }
+
+        const AirspaceStatus &airspace = airspaceStatus();
+        AirspaceStats airspaceTiming = airspaceStats();
+        char airspaceData[64] = "clear";
+        if (operationMode == MODE_FLYING && airspace.level != AIRSPACE_LEVEL_NONE) {
+            snprintf(airspaceData, sizeof(airspaceData), "%s %.24s (%c) %.1f km, %.0f m",
+                     airspace.level == AIRSPACE_LEVEL_INSIDE ? "IN" : "near", airspaceName(airspace.area),
+                     airspaceArea(airspace.area)->airspaceClass, airspace.horizontalMeters / 1000.0,
+                     (double)airspace.verticalMeters);
+        }
+
+        TerrainStats terrain = terrainStats();
+        char aglData[64] = "unknown";
+        float agl = heightAboveGround();
+        if (!isnan(agl)) {
+            snprintf(aglData, sizeof(aglData), "%.0f m, ground %.0f m, cache %lu%%, %lu us max", (double)agl,
+                     (double)groundElevation,
+                     (unsigned long)(100ULL * terrain.hits / max<uint32_t>(terrain.hits + terrain.misses, 1)),
+                     (unsigned long)terrain.maxMicros);
+        }
+
         snprintf(bleString, sizeof(bleString),
-                 "Home Lat: %.6f, Lon: %.6f | %sMode: %d | Fuel: %.2f, Burn Rate: %.2f | Batt: %.2fV",
+                 "Home Lat: %.6f, Lon: %.6f | %sMode: %d | Fuel: %.2f, Burn Rate: %.2f | Batt: %.2fV"
+                 " | Endurance: %.0f min, Range: %.1f km, Model: %.2f L/h (%u fits)"
+                 " | GPS: %u/s, CRC %lu, OVR %lu | TTFF: %lu ms%s, prev %lu ms%s | Nav: %s | Near: %s"
+                 " | Airspace: %s, eval %lu us | AGL: %s",
                  homeLatitude, homeLongitude, poiData, operationMode,
-                 (double)fuelLevel, (double)fuelBurnRate, voltage);
+                 (double)fuelLevel, (double)fuelBurnRate, voltage,
+                 (double)prediction.enduranceMinutes, (double)prediction.rangeKm,
+                 burnModelRate(fuelBurnRate), (unsigned)burnModelState().events,
+                 gpsStats.sentencesPerSecond, (unsigned long)gpsStats.checksumFailures,
+                 (unsigned long)gpsStats.overruns,
+                 (unsigned long)ttff.ms, ttff.aided ? " aided" : "",
+                 (unsigned long)ttff.previousMs, ttff.previousAided ? " aided" : "",
+                 navData[0] ? navData : "no fix", nearData[0] ? nearData : "none",
+                 airspaceData, (unsigned long)airspaceTiming.lastMicros, aglData);
 
         pCharacteristic->setValue(bleString);
         pCharacteristic->notify();
         DEBUG_PRINTLN("BLE Data Sent:");
         DEBUG_PRINTLN(bleString);
+
+        sendTelemetryFrames();
     }
+}
 
-    // Handle BLE disconnection or timeout
-    if (!deviceConnected && oldDeviceConnected) {
-        delay(400); // Give the Bluetooth stack time to process disconnection events
-        pServer->startAdvertising(); // Restart advertising
-        DEBUG_PRINTLN("BLE disconnected, restarting advertising...");
+// Stream, command queue, radio, loop and power profile counters
+static_assert(POWER_PROFILES == TELEMETRY_PROFILE_COUNT, "Diagnostics frame has a timing slot per power profile");
+
+void fillTelemetryDiagnostics(TelemetryDiagnostics &diagnostics) {
+    telemetryBegin(diagnostics, TELEMETRY_FRAME_DIAGNOSTICS);
+    TelemetryStreamStats stream = telemetryStreamStats();
+    BleCommandStats commands = bleCommandStats();
+    BleRadioStats radio = bleGovernorStats();
+    EventLoopStats loopStats = eventLoopStats();
+    PowerProfileStats power = powerProfileStats();
+    uint32_t advertisingMs = radio.advertisingMs[0] + radio.advertisingMs[1] + radio.advertisingMs[2];
+    uint32_t connectedMs = radio.connectedMs[BLE_LINK_IDLE] + radio.connectedMs[BLE_LINK_ACTIVE] +
+                           radio.connectedMs[BLE_LINK_BULK];
+
+    diagnostics.streamHz = telemetryStreamRate();
+    diagnostics.linkProfile = bleGovernorLinkProfile();
+    diagnostics.streamIntervalMs = stream.intervalMs;
+    diagnostics.streamBytesPerSecond = stream.bytesPerSecond;
+    diagnostics.streamBackoffs = min<uint32_t>(stream.backoffs, UINT16_MAX);
+    diagnostics.commands = min<uint32_t>(commands.received, UINT16_MAX);
+    diagnostics.commandsDropped = min<uint32_t>(commands.dropped + commands.oversized, UINT16_MAX);
+    diagnostics.advertisingSeconds = advertisingMs / 1000;
+    diagnostics.connectedSeconds = connectedMs / 1000;
+    diagnostics.idleLinkSeconds = radio.connectedMs[BLE_LINK_IDLE] / 1000;
+    diagnostics.radioOffSeconds = radio.offMs / 1000;
+    diagnostics.linkUpdates = min<uint32_t>(radio.linkUpdates, UINT16_MAX);
+    diagnostics.loopIdleMs = loopStats.idleMs;
+    diagnostics.loopActiveMs = loopStats.activeMs;
+    diagnostics.loopWakeups = loopStats.wakeups;
+    diagnostics.cpuMhz = loopStats.maxMhz;
+    diagnostics.flags = (loopStats.frequencyScaling ? TELEMETRY_DIAG_FREQUENCY_SCALING : 0) |
+                        (powerProfileMoving() ? TELEMETRY_DIAG_MOVING : 0);
+    diagnostics.powerProfile = powerProfileId();
+    diagnostics.profileSwitches = min<uint32_t>(power.switches, UINT16_MAX);
+    for (uint8_t i = 0; i < TELEMETRY_PROFILE_COUNT; i++) {
+        const PowerTiming &frames = power.frames[i];
+        const PowerTiming &fixes = power.fixes[i];
+        TelemetryProfileTiming &timing = diagnostics.profiles[i];
+        timing.frameAvgMs = frames.count ? min<uint64_t>(frames.totalUs / frames.count / 1000, UINT16_MAX) : 0;
+        timing.frameMaxMs = min<uint32_t>(frames.maxUs / 1000, UINT16_MAX);
+        timing.fixAvgUs = fixes.count ? min<uint64_t>(fixes.totalUs / fixes.count, UINT16_MAX) : 0;
+        timing.fixMaxUs = min<uint32_t>(fixes.maxUs, UINT16_MAX);
     }
-    oldDeviceConnected = deviceConnected;
-
-    if (!deviceConnected && millis() - bleConnectionTime > bleTimeout && bleConnectionTime != 0) {
-        DEBUG_PRINTLN("BLE timeout reached, turning off BLE and WiFi...");
-        BLEDevice::deinit(true); // Turn off BLE
-        WiFi.disconnect(true);   // Ensure WiFi is off
-        WiFi.mode(WIFI_OFF);
-        bleConnectionTime = 0;   // Reset the timeout timer
-    } else if (deviceConnected) {
-        bleConnectionTime = millis(); // Update the connection time if a device is connected
+}
+
+// Live frame from the current fix, shared by the full frame and the delta stream
+void fillTelemetryLive(TelemetryLive &live) {
+    telemetryBegin(live, TELEMETRY_FRAME_LIVE);
+    const NavSolution &nav = navSolution();
+    const NavTarget &home = navTargets[NAV_TARGET_HOME];
+    FuelPrediction prediction = fuelPredict(fuelLevel, burnModelRate(fuelBurnRate), gps);
+    live.lat = gps.location.point.lat;
+    live.lon = gps.location.point.lon;
+    live.altitude = telemetryI16(gps.altitude.isValid() ? gps.altitude.value : NAN, 1.0f);
+    live.agl = telemetryI16(heightAboveGround(), 1.0f);
+    live.speed = telemetryU16(gps.speed.isValid() ? gps.speed.value : NAN, 0.1f);
+    live.course = telemetryU16(gps.course.isValid() ? gps.course.value : NAN, 0.01f);
+    live.satellites = min<uint32_t>(gps.satellites.value(), 255);
+    live.flags = (gps.location.isValid() ? TELEMETRY_FLAG_FIX : 0) |
+                 (gps.altitude.isValid() ? TELEMETRY_FLAG_ALTITUDE : 0) |
+                 (home.enabled ? TELEMETRY_FLAG_HOME : 0) |
+                 ((operationMode == MODE_FLYING ? airspaceStatus().level : 0) << TELEMETRY_FLAG_AIRSPACE_SHIFT);
+    live.fuel = telemetryU16(fuelLevel, 0.01f);
+    live.batteryMv = telemetryU16(batteryVoltage, 0.001f);
+    live.enduranceMinutes = telemetryU16(prediction.enduranceMinutes, 1.0f);
+    live.homeDistance = home.enabled && nav.valid ? telemetryU16(home.distanceMeters, 10.0f) : TELEMETRY_UNKNOWN_U16;
+    live.homeBearing = home.enabled && nav.valid ? telemetryI16(home.relativeBearing, 0.1f) : TELEMETRY_UNKNOWN_I16;
+}
+
+// Config and live frames on the binary telemetry characteristic
+void sendTelemetryFrames() {
+    TelemetryConfig config;
+    telemetryBegin(config, TELEMETRY_FRAME_CONFIG);
+    NavPoint home = navPointFromDegrees(homeLatitude, homeLongitude);
+    config.home = {home.lat, home.lon};
+    config.poiEnabled = 0;
+    for (int i = 0; i < TELEMETRY_POI_COUNT; i++) {
+        NavPoint poi = i < MAX_POIS ? navPointFromDegrees(poiLatitudes[i], poiLongitudes[i]) : NavPoint{0, 0};
+        config.pois[i] = {poi.lat, poi.lon};
+        if (i < MAX_POIS && poiEnabled[i]) config.poiEnabled |= 1 << i;
+    }
+    config.mode = operationMode;
+    config.burnRate = telemetryU16(fuelBurnRate, 0.01f);
+    // A notification would cut it short at a smaller MTU
+    if (telemetryFits(bleMtu, sizeof(config))) {
+        pTelemetryCharacteristic->setValue((uint8_t *)&config, sizeof(config));
+        pTelemetryCharacteristic->notify();
+    }
+
+    TelemetryLive live;
+    fillTelemetryLive(live);
+    if (telemetryFits(bleMtu, sizeof(live))) {
+        pTelemetryCharacteristic->setValue((uint8_t *)&live, sizeof(live));
+        pTelemetryCharacteristic->notify();
+    }
+
+    TelemetryDiagnostics diagnostics;
+    fillTelemetryDiagnostics(diagnostics);
+    if (telemetryFits(bleMtu, sizeof(diagnostics))) {
+        pTelemetryCharacteristic->setValue((uint8_t *)&diagnostics, sizeof(diagnostics));
+        pTelemetryCharacteristic->notify();
     }
 }
 
-// Add these diagnostic functions for verification
-void verifyPOIStorage() {
-    // First read what was stored
-    double storedLats[MAX_POIS];
-    double storedLons[MAX_POIS];
-    bool storedEnabled[MAX_POIS];
-    
-    EEPROM.begin(512);
-    int poiOffset = sizeof(homeLatitude) + sizeof(homeLongitude);
-    
-    EEPROM.get(poiOffset, storedLats);
-    EEPROM.get(poiOffset + sizeof(poiLatitudes), storedLons);
-    EEPROM.get(poiOffset + sizeof(poiLatitudes) + sizeof(poiLongitudes), storedEnabled);
-    
-    // Print verification results
-    DEBUG_PRINTLN("POI EEPROM Storage Verification:");
-    DEBUG_PRINTLN("Current POI values in memory:");
-    for (int i = 0; i < MAX_POIS; i++) {
-        DEBUG_PRINTF("POI %d: Lat=%.6f, Lon=%.6f, Enabled=%d\n", 
-                     i+1, poiLatitudes[i], poiLongitudes[i], poiEnabled[i]);
+// Delta frame for the live stream when one is due, held back while the link is congested
+void serviceTelemetryStream() {
+    if (!deviceConnected) {
+        telemetryStreamSetRate(0); // The next client asks again
+        return;
     }
-    
-    DEBUG_PRINTLN("Values read from EEPROM:");
-    for (int i = 0; i < MAX_POIS; i++) {
-        DEBUG_PRINTF("POI %d: Lat=%.6f, Lon=%.6f, Enabled=%d\n", 
-                     i+1, storedLats[i], storedLons[i], storedEnabled[i]);
-        
-        // Check if values match
-        bool matches = (storedLats[i] == poiLatitudes[i]) && 
-                      (storedLons[i] == poiLongitudes[i]) && 
-                      (storedEnabled[i] == poiEnabled[i]);
-        DEBUG_PRINTF("Values match: %s\n", matches ? "YES" : "NO");
+    unsigned long now = millis();
+    if (!telemetryStreamDue(now)) {
+        return;
+    }
+    telemetryStreamSetLink(bleMtu, bleConnectionIntervalMs);
+    if (esp_ble_get_cur_sendable_packets_num(bleConnId) < BLE_MIN_SENDABLE_PACKETS) {
+        telemetryStreamSent(now, 0, true);
+        return;
     }
+
+    TelemetryLive live;
+    fillTelemetryLive(live);
+    uint8_t frame[TELEMETRY_STREAM_MAX_FRAME];
+    size_t length = telemetryStreamEncode(live, now, frame);
+    bool failed = false;
+    if (length) {
+        telemetryNotified = false;
+        pTelemetryCharacteristic->setValue(frame, length);
+        pTelemetryCharacteristic->notify();
+        failed = !telemetryNotified; // The changes stay due and go out with the next frame
+    }
+    telemetryStreamSent(now, failed ? 0 : length, failed);
 }
 
-void verifyFuelStorage() {
-    double storedLevel, storedRate;
-    
-    EEPROM.begin(512);
-    int fuelLevelOffset = sizeof(homeLatitude) + sizeof(homeLongitude) + 
-                          sizeof(poiLatitude) + sizeof(poiLongitude) + 
-                          sizeof(legacyPoiEnabled);
-    int fuelBurnRateOffset = fuelLevelOffset + sizeof(double);
-    
-    EEPROM.get(fuelLevelOffset, storedLevel);
-    EEPROM.get(fuelBurnRateOffset, storedRate);
-    
-    DEBUG_PRINTLN("Fuel EEPROM Storage Verification:");
-    DEBUG_PRINTF("Current values in memory: Level=%.2f L, Rate=%.2f L/h\n", fuelLevel, fuelBurnRate);
-    DEBUG_PRINTF("Values read from EEPROM: Level=%.2f L, Rate=%.2f L/h\n", storedLevel, storedRate);
-    
-    bool levelsMatch = (fabs(storedLevel - fuelLevel) < 0.01); // Compare with small tolerance
-    bool ratesMatch = (fabs(storedRate - fuelBurnRate) < 0.01);
-    
-    DEBUG_PRINTF("Level values match: %s\n", levelsMatch ? "YES" : "NO");
-    DEBUG_PRINTF("Rate values match: %s\n", ratesMatch ? "YES" : "NO");
+// Store queued upload chunks and acknowledge them
+void serviceBulkTransfer() {
+    BulkAck ack;
+    bool sendAck;
+    uint8_t event = bulkTransferService(ack, sendAck);
+    if (sendAck && deviceConnected) {
+        pBulkCharacteristic->setValue((uint8_t *)&ack, sizeof(ack));
+        pBulkCharacteristic->notify();
+    }
+
+    if (event == BULK_EVENT_STARTED) {
+        DEBUG_PRINTLN("Waypoint upload started");
+    } else if (event == BULK_EVENT_COMMITTED) {
+        nearestWaypointCount = 0; // Their indices point into the database that was replaced
+        BulkStats stats = bulkTransferStats();
+        DEBUG_PRINTF("Waypoint upload committed: %lu waypoints, %lu bytes in %lu ms\n",
+                     (unsigned long)waypointDbCount(), (unsigned long)stats.lastBytes, (unsigned long)stats.lastMillis);
+    } else if (event == BULK_EVENT_FAILED) {
+        DEBUG_PRINTF("Waypoint upload failed, status %u\n", ack.status);
+    }
 }
 
-// Modify handleBLECommand() to add verification after POI and fuel updates
-void handleBLECommand(const std::string &command) {
-    DEBUG_PRINTF("Received BLE command: %s\n", command.c_str());
-
-    // Handle POI commands in format "POI:<index>:<lat>:<lon>:<enabled>"
-    if (command.rfind("POI:", 0) == 0) {
-        int index;
-        double lat, lon;
-        int enabled;
-
-        if (sscanf(command.c_str(), "POI:%d:%lf:%lf:%d", &index, &lat, &lon, &enabled) == 4) {
-            if (index >= 1 && index <= MAX_POIS) {
-                index--; // Convert to 0-based index
-                poiLatitudes[index] = lat;
-                poiLongitudes[index] = lon;
-                poiEnabled[index] = (enabled == 1);
-
-                // Update the first POI for backward compatibility
-                if (index == 0) {
-                    poiLatitude = lat;
-                    poiLongitude = lon;
-                    legacyPoiEnabled = (enabled == 1);
-                }
+// Handle queued commands until the queue is empty or the loop's budget is spent.
+// True if there were any.
+bool serviceBLECommands() {
+    char command[BLE_COMMAND_MAX_LENGTH + 1];
+    bool handled = false;
+    unsigned long started = millis();
+    while (millis() - started < BLE_COMMAND_BUDGET_MS && bleCommandPop(command)) {
+        handleBLECommand(command);
+        handled = true;
+    }
+    return handled;
+}
+
+// Advertising, connection parameters and radio power as the governor decides
+void serviceBLERadio(bool commandsHandled) {
+    uint8_t demand = BLE_LINK_IDLE;
+    if (bulkTransferActive()) {
+        demand = BLE_LINK_BULK;
+    } else if (telemetryStreamRate() > 0 || commandsHandled) {
+        demand = BLE_LINK_ACTIVE;
+    }
 
-                savePOIs();
-                DEBUG_PRINTF("Updated POI %d: Lat=%.6f, Lon=%.6f, Enabled=%d\n",
-                              index + 1, poiLatitudes[index], poiLongitudes[index], poiEnabled[index]);
+    // The stack and the GATT table stay up from setup() on: the Arduino BLE
+    // classes can't register their services again after a deinit(). With
+    // nothing advertised and no connection the controller leaves the radio off.
+    switch (bleGovernorService(millis(), deviceConnected, demand)) {
+    case BLE_GOVERNOR_RADIO_ON:
+    case BLE_GOVERNOR_ADVERTISE: {
+        BleAdvertisingParams advertising = bleGovernorAdvertising();
+        BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
+        pAdvertising->stop();
+        pAdvertising->setMinInterval(advertising.minInterval);
+        pAdvertising->setMaxInterval(advertising.maxInterval);
+        pAdvertising->start();
+        DEBUG_PRINTF("Advertising every %.1f-%.1f ms\n", advertising.minInterval * 0.625, advertising.maxInterval * 0.625);
+        break;
+    }
 
-                sendBLEData();
-            } else {
-                DEBUG_PRINTF("Invalid POI index: %d\n", index);
+    case BLE_GOVERNOR_LINK: {
+        BleLinkParams link = bleGovernorLink();
+        pServer->updateConnParams(bleRemoteAddress, link.minInterval, link.maxInterval, link.latency, link.timeout);
+        DEBUG_PRINTF("Requested %.2f-%.2f ms connection interval, latency %u\n",
+                     link.minInterval * 1.25, link.maxInterval * 1.25, link.latency);
+        break;
+    }
+
+    case BLE_GOVERNOR_RADIO_OFF: {
+        BLEDevice::getAdvertising()->stop();
+        BleRadioStats radio = bleGovernorStats();
+        DEBUG_PRINTF("No connection, not advertising until the button is held 1-2 s. Advertised %lu/%lu/%lu s, connected %lu/%lu/%lu s\n",
+                     (unsigned long)(radio.advertisingMs[0] / 1000), (unsigned long)(radio.advertisingMs[1] / 1000),
+                     (unsigned long)(radio.advertisingMs[2] / 1000), (unsigned long)(radio.connectedMs[BLE_LINK_IDLE] / 1000),
+                     (unsigned long)(radio.connectedMs[BLE_LINK_ACTIVE] / 1000),
+                     (unsigned long)(radio.connectedMs[BLE_LINK_BULK] / 1000));
+        break;
+    }
+    }
+}
+
+// Modify handleBLECommand() to add verification after POI and fuel updates
+void handleBLECommand(const char *command) {
+    DEBUG_PRINTF("Received BLE command: %s\n", command);
+
+    BleCommand parsed;
+    uint8_t result = bleCommandParse(command, parsed);
+    if (result == BLE_PARSE_UNKNOWN) {
+        DEBUG_PRINTLN("Error: Unrecognized BLE command format");
+        return;
+    } else if (result != BLE_PARSE_OK) {
+        DEBUG_PRINTF("Invalid command format (error %u). Expected %s\n", result, parsed.usage);
+        return;
+    }
+    const BleArg *args = parsed.args;
+
+    switch (parsed.verb) {
+    // POI:<index>:<lat>:<lon>:<enabled>
+    case BLE_VERB_POI: {
+        int index = args[0].integer;
+        // The app sends NaN for an empty coordinate box; only a disabled POI may have none
+        bool hasCoordinates = !isnan(args[1].decimal) && !isnan(args[2].decimal);
+        if (!hasCoordinates && args[3].integer == 1) {
+            DEBUG_PRINTF("POI %d enabled without coordinates\n", index);
+        } else if (index >= 1 && index <= MAX_POIS) {
+            index--; // Convert to 0-based index
+            poiLatitudes[index] = hasCoordinates ? args[1].decimal : 0.0;
+            poiLongitudes[index] = hasCoordinates ? args[2].decimal : 0.0;
+            poiEnabled[index] = (args[3].integer == 1);
+
+            // Update the first POI for backward compatibility
+            if (index == 0) {
+                poiLatitude = poiLatitudes[0];
+                poiLongitude = poiLongitudes[0];
+                legacyPoiEnabled = poiEnabled[0];
             }
+
+            saveSettings();
+            DEBUG_PRINTF("Updated POI %d: Lat=%.6f, Lon=%.6f, Enabled=%d\n",
+                          index + 1, poiLatitudes[index], poiLongitudes[index], poiEnabled[index]);
+
+            sendBLEData();
         } else {
-            DEBUG_PRINTLN("Invalid POI command format. Expected POI:<index>:<lat>:<lon>:<enabled>");
+            DEBUG_PRINTF("Invalid POI index: %d\n", index);
         }
-        return;
+        break;
     }
 
-    // Parse the command in the format <latitude>:<longitude>:<enabled>  (legacy format)
-    double lat, lon;
-    int enabled;
-    if (sscanf(command.c_str(), "%lf:%lf:%d", &lat, &lon, &enabled) == 3) {
-        poiLatitude = lat;
-        poiLongitude = lon;
-        legacyPoiEnabled = (enabled == 1);
+    // <latitude>:<longitude>:<enabled> (legacy format)
+    case BLE_VERB_LEGACY_POI: {
+        bool hasCoordinates = !isnan(args[0].decimal) && !isnan(args[1].decimal);
+        if (!hasCoordinates && args[2].integer == 1) {
+            DEBUG_PRINTLN("POI enabled without coordinates");
+            break;
+        }
+        poiLatitude = hasCoordinates ? args[0].decimal : 0.0;
+        poiLongitude = hasCoordinates ? args[1].decimal : 0.0;
+        legacyPoiEnabled = (args[2].integer == 1);
 
         // Update first POI in the array for new structure
-        poiLatitudes[0] = lat;
-        poiLongitudes[0] = lon;
-        poiEnabled[0] = (enabled == 1);
+        poiLatitudes[0] = poiLatitude;
+        poiLongitudes[0] = poiLongitude;
+        poiEnabled[0] = legacyPoiEnabled;
 
-        // Save the POI to EEPROM and confirm via Serial
-        savePOI();
-        savePOIs();
+        // Save the POI and confirm via Serial
+        saveSettings();
         DEBUG_PRINTF("BLE SET_POI received: Lat=%.6f, Lon=%.6f, Enabled=%d\n", 
                      poiLatitude, poiLongitude, legacyPoiEnabled);
         sendBLEData(); // Send confirmation data back to the client
-    } 
+        break;
+    }
+
     // Special command for retrieving data
-    else if (command == "GET_DATA") {
+    case BLE_VERB_GET_DATA:
         DEBUG_PRINTLN("Received GET_DATA command, sending current data");
         sendBLEData();
-    }
-    // Handle fuel update command
-    else if (command.compare(0, 5, "FUEL:") == 0) {
-        double newFuelLevel, newBurnRate;
-        // Debug the FUEL command parsing
-        DEBUG_PRINTF("Parsing FUEL command: %s\n", command.c_str());
-        
-        if (sscanf(command.c_str(), "FUEL:%lf:%lf", &newFuelLevel, &newBurnRate) == 2) {
-            DEBUG_PRINTF("Parsed values: Level=%.2f L, Burn Rate=%.2f L/h\n", newFuelLevel, newBurnRate);
-            
-            // Track if values were updated
-            bool valuesChanged = false;
-            
-            // Validate and update fuel level
-            if (newFuelLevel > 0 && newFuelLevel <= 100) {
-                if (fuelLevel != newFuelLevel) {
-                    fuelLevel = newFuelLevel;
-                    valuesChanged = true;
-                    DEBUG_PRINTF("Updated fuel level to %.2f L\n", fuelLevel);
+        break;
+
+    // FUEL:<level>:<rate>[:<added>]
+    case BLE_VERB_FUEL: {
+        double newFuelLevel = args[0].decimal;
+        double newBurnRate = args[1].decimal;
+        double litresAdded = parsed.argCount > 2 ? args[2].decimal : -1.0; // Litres poured in at this refuel
+        DEBUG_PRINTF("Parsed values: Level=%.2f L, Burn Rate=%.2f L/h\n", newFuelLevel, newBurnRate);
+
+        // Track if values were updated
+        bool valuesChanged = false;
+
+        // Validate and update fuel level
+        if (newFuelLevel > 0 && newFuelLevel <= 100) {
+            if (fuelLevel != newFuelLevel || litresAdded >= 0) {
+                // Closes the burn model's segment and starts the next one; only
+                // a refuel with the litres added is learned from
+                if (burnModelRefuel(newFuelLevel, litresAdded)) {
+                    DEBUG_PRINTF("Burn model updated, now %.2f L/h here\n", burnModelRate(fuelBurnRate));
                 }
-            } else {
-                DEBUG_PRINTF("Invalid fuel level: %.2f L (must be between 0-100)\n", newFuelLevel);
+                fuelLevel = newFuelLevel;
+                valuesChanged = true;
+                DEBUG_PRINTF("Updated fuel level to %.2f L\n", fuelLevel);
             }
-            
-            // Validate and update burn rate
-            if (newBurnRate > 0 && newBurnRate <= 10) {
-                if (fuelBurnRate != newBurnRate) {
-                    fuelBurnRate = newBurnRate;
-                    valuesChanged = true;
-                    DEBUG_PRINTF("Updated burn rate to %.2f L/h\n", fuelBurnRate);
-                }
-            } else {
-                DEBUG_PRINTF("Invalid burn rate: %.2f L/h (must be between 0-10)\n", newBurnRate);
+        } else {
+            DEBUG_PRINTF("Invalid fuel level: %.2f L (must be between 0-100)\n", newFuelLevel);
+        }
+
+        // Validate and update burn rate
+        if (newBurnRate > 0 && newBurnRate <= 10) {
+            if (fuelBurnRate != newBurnRate) {
+                fuelBurnRate = newBurnRate;
+                valuesChanged = true;
+                DEBUG_PRINTF("Updated burn rate to %.2f L/h\n", fuelBurnRate);
             }
-            
-            // Only save if values changed
-            if (valuesChanged) {
-                // Save to EEPROM and confirm
-                saveFuelData();
-                DEBUG_PRINTF("Fuel data after update: Level=%.2f L, Burn Rate=%.2f L/h\n", fuelLevel, fuelBurnRate);
-                
-                // Add verification after saving
-                verifyFuelStorage();
-                
-                // Force an update to the display if we're on the home point screen
-                if (isHomePointScreen) {
-                    displayHomePointScreen();
-                }
-                
-                // Send updated data back to the web app
-                sendBLEData();
-            } else {
-                DEBUG_PRINTLN("No fuel values were changed");
+        } else {
+            DEBUG_PRINTF("Invalid burn rate: %.2f L/h (must be between 0-10)\n", newBurnRate);
+        }
+
+        // Only save if values changed
+        if (valuesChanged) {
+            saveSettings();
+            fuelJournalAppend(fuelLevel, fuelBurnRate);
+            DEBUG_PRINTF("Fuel data after update: Level=%.2f L, Burn Rate=%.2f L/h\n", fuelLevel, fuelBurnRate);
+
+            // Force an update to the display if we're on the home point screen
+            if (isHomePointScreen) {
+                displayHomePointScreen();
             }
+
+            // Send updated data back to the web app
+            sendBLEData();
         } else {
-            DEBUG_PRINTLN("Error: Could not parse FUEL command format. Expected FUEL:<level>:<rate>");
+            DEBUG_PRINTLN("No fuel values were changed");
         }
-    } else if (command.rfind("MODE:", 0) == 0) {
-        int mode;
-        if (sscanf(command.c_str(), "MODE:%d", &mode) == 1) {
-            if (mode == MODE_FLYING || mode == MODE_WALKING) {
-                operationMode = mode;
-                saveOperationMode();
-                DEBUG_PRINTF("Mode updated to: %s\n", mode == MODE_FLYING ? "Flying" : "Walking");
-                sendBLEData(); // Send confirmation back
-            } else {
-                DEBUG_PRINTF("Invalid mode: %d\n", mode);
+        break;
+    }
+
+    // MODE:<mode>
+    case BLE_VERB_MODE: {
+        int mode = args[0].integer;
+        if (mode == MODE_FLYING || mode == MODE_WALKING) {
+            operationMode = mode;
+            saveSettings();
+            if (powerProfileUpdate(operationMode == MODE_FLYING, gps, millis())) {
+                applyPowerProfile();
             }
+            DEBUG_PRINTF("Mode updated to: %s\n", mode == MODE_FLYING ? "Flying" : "Walking");
+            sendBLEData(); // Send confirmation back
         } else {
-            DEBUG_PRINTLN("Invalid MODE command format. Expected MODE:<mode>");
+            DEBUG_PRINTF("Invalid mode: %d\n", mode);
         }
-        return;
-    } else {
-        DEBUG_PRINTLN("Error: Unrecognized BLE command format");
+        break;
+    }
+
+    // STREAM:<hz>
+    case BLE_VERB_STREAM: {
+        int hz = args[0].integer;
+        if (hz >= 0 && hz <= TELEMETRY_STREAM_MAX_HZ) {
+            telemetryStreamSetRate(hz);
+            telemetryStreamReset(); // Whoever asked starts from absolute values
+            DEBUG_PRINTF("Live stream at %d Hz\n", hz);
+        } else {
+            DEBUG_PRINTF("Invalid stream rate: %d (must be 0-%d)\n", hz, TELEMETRY_STREAM_MAX_HZ);
+        }
+        break;
+    }
     }
 }
 
 // Add a test verification function call to the setup function (optional)
 void setup() {
     Serial.begin(115200);
+    eventLoopBegin(); // Before any source can post
   
     // Call handleWakeUp at the beginning to properly restore state if waking from sleep
     handleWakeUp();
   
-    gpsSerial.begin(9600, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN); // Initialize GPS serial
+    gpsIngestBegin(gpsSerial, 9600, GPS_RX_PIN, GPS_TX_PIN); // Initialize GPS serial and ingest task
+    gpsIngestOnFix(handleGpsFix);
+    gpsAidBegin(); // Receiver is powered from here on, start the TTFF clock
 
     delay(10);
     DEBUG_PRINTLN("ESP32 Send Image test");
@@ -1332,6 +1700,7 @@ void setup() {
     pinMode(PIN_KEY, INPUT_PULLUP); // Set button pin as input with pull-up resistor
     pinMode(Backlight, OUTPUT);
     pinMode(BAT_ADC, INPUT); // Set battery ADC pin as input
+    sampleBattery(); // The first screens show it
     pinMode(BUZZER_PIN, OUTPUT); // Set buzzer pin as output
 
     // Initialize GPS reset pin
@@ -1353,6 +1722,7 @@ void setup() {
     display.init();
     display.setRotation(1);
     display.setTextColor(GxEPD_BLACK);
+    renderNavigationBackgrounds();
 
     // Display welcome screen
     displayWelcomeScreen();
@@ -1375,36 +1745,68 @@ void setup() {
     buttonConfig->setLongPressDelay(3000); 
     buttonConfig->setDebounceDelay(20);
 
-    // Remove the interrupt attachment for the button as we'll poll it directly
-    // attachInterrupt(digitalPinToInterrupt(PIN_KEY), handleButtonInterrupt, FALLING);
+    // Both edges wake loop()
+    attachInterrupt(digitalPinToInterrupt(PIN_KEY), handleButtonInterrupt, CHANGE);
 
     lastButtonPressTime = millis(); // Initialize the last button press time
 
+    bleGovernorBegin(millis()); // Fast advertising for the first half minute
     setupBLE(); // Initialize BLE
-    loadHomePoint(); // Load home point from EEPROM
-    loadPOI();       // Load POI from EEPROM
-    loadPOIs();      // Load all POIs from EEPROM
-    loadFuelData();  // Load fuel data from EEPROM or set defaults
-    loadOperationMode(); // Load operation mode from EEPROM
-    
-    // Verify that saved data was loaded correctly
-    DEBUG_PRINTLN("\n=== EEPROM Data Verification at Startup ===");
-    verifyPOIStorage();
-    verifyFuelStorage();
-    DEBUG_PRINTLN("==========================================\n");
+    loadSettings(); // Home point, POIs, fuel and mode in one read
+
+    // The fuel journal is newer than the fuel values in the settings record
+    FuelCheckpoint fuelCheckpoint;
+    if (!fuelJournalBegin()) {
+        DEBUG_PRINTLN("No fuel journal partition, fuel level is only saved with the settings");
+    } else if (fuelJournalLast(fuelCheckpoint)) {
+        fuelLevel = fuelCheckpoint.level;
+        fuelBurnRate = fuelCheckpoint.burnRate;
+        DEBUG_PRINTF("Fuel journal: Level=%.2f L, Rate=%.2f L/h\n", fuelLevel, fuelBurnRate);
+    }
+
+    if (waypointDbBegin()) {
+        DEBUG_PRINTF("Waypoint database: %lu waypoints\n", (unsigned long)waypointDbCount());
+    } else {
+        DEBUG_PRINTLN("No waypoint database, nearest fields are not shown");
+    }
+
+    if (airspaceBegin()) {
+        DEBUG_PRINTF("Airspace: %lu areas\n", (unsigned long)airspaceCount());
+    } else {
+        DEBUG_PRINTLN("No airspace data, airspace warnings are off");
+    }
+
+    if (!terrainBegin()) {
+        DEBUG_PRINTLN("No terrain data, height above ground is not shown");
+    }
+
+    // Needs the operation mode; the receiver has had the welcome screen to boot
+    powerProfileUpdate(operationMode == MODE_FLYING, gps, millis());
+    if (gpsNegotiateLink(powerProfile().gpsRateHz, GPS_USE_UBX)) {
+        GpsLinkState link = gpsLinkState();
+        DEBUG_PRINTF("GPS link: %lu baud, %u Hz, %s, rate %s\n", (unsigned long)link.baud, link.rateHz,
+                     link.ubx ? "UBX" : "NMEA", link.verified ? "verified" : "not verified");
+    } else {
+        DEBUG_PRINTLN("GPS receiver not answering, staying at 9600 baud NMEA");
+    }
+    if (gpsAidInject()) {
+        DEBUG_PRINTLN("GPS aided with last fix from before sleep");
+    }
+    applyPowerProfile();
 }
 
 void loop() {
-    static unsigned long lastFuelUpdateTime = 0;
-    const double fuelConsumptionRate = fuelBurnRate / 3600.0;
-    
     // Simple button state variables
     static bool lastButtonState = HIGH;
     static unsigned long buttonPressTime = 0;
     static unsigned long buttonReleaseTime = 0;
     static bool buttonHandled = false;
-    
-    // Direct button polling - simplest approach
+    static unsigned long lastLoopReportTime = 0;
+
+    // Block until a fix, the button, a BLE write or the next scheduled job
+    eventWait(loopTimeoutMs(lastButtonState == LOW));
+
+    // Read the button on every pass; its interrupt only makes sure there is one
     bool buttonState = digitalRead(PIN_KEY);
     
     // Button press detection (transition from HIGH to LOW)
@@ -1509,14 +1911,18 @@ void loop() {
                     DEBUG_PRINTLN("Button press during satellite search - setting home point");
                     homeLatitude = gps.location.lat();
                     homeLongitude = gps.location.lng();
-                    saveHomePoint();
                     homePointSet = true;
+                    saveSettings();
                     isWaitingForSatsScreen = false;
                     isHomePointScreen = true;
                     displayHomePointScreen();
                     buttonHandled = true;
                 }
             }
+        } else if (!buttonHandled && pressDuration < 2000) {  // Medium press (1-2 seconds)
+            DEBUG_PRINTLN("Medium press - waking BLE");
+            bleGovernorWake(buttonReleaseTime);
+            buttonHandled = true;
         }
     }
     
@@ -1529,10 +1935,51 @@ void loop() {
     
     lastButtonState = buttonState;
     
-    // Process GPS data
-    while (gpsSerial.available() > 0) {
-        gps.encode(gpsSerial.read());
+    // Pick up whatever the GPS ingest task parsed since the last pass
+    if (gpsIngestSync(gps)) {
+        unsigned long fixStarted = micros();
+        gpsAidUpdate(gps);
+        navSolutionUpdate(gps, navTargets, NAV_TARGETS);
+        nearestWaypointCount = gps.location.isValid() ?
+            waypointDbNearest(gps.location.point, 1 << WAYPOINT_TYPE_LANDABLE, nearestWaypoints, NEAREST_WAYPOINTS) : 0;
+        groundElevation = gps.location.isValid() ? terrainElevation(gps.location.point) : NAN;
+        if (operationMode == MODE_FLYING) {
+            checkAirspace();
+        }
+        powerProfileRecordFix(micros() - fixStarted);
+
+        // Standing still or moving again switches the profile
+        if (powerProfileUpdate(operationMode == MODE_FLYING, gps, millis())) {
+            applyPowerProfile();
+        }
     }
+
+    bool commandsHandled = serviceBLECommands();
+    serviceBulkTransfer();
+    serviceTelemetryStream();
+    serviceBLERadio(commandsHandled);
+
+    // Burn fuel while flying with the engine running, at the learned rate; the journal checkpoints the running level
+    double engineHours = fuelBurnTick(operationMode == MODE_FLYING, gps);
+    burnModelAccumulate(gps, engineHours);
+    fuelLevel = max(0.0, fuelLevel - burnModelRate(fuelBurnRate) * engineHours);
+
+    const PowerProfile &profile = powerProfile();
+    if (millis() - lastBatterySampleTime >= profile.batterySampleMs) {
+        sampleBattery();
+    }
+
+    // Redraw the current screen at the profile's cadence
+    if (homePointSet && !isWaitingForSatsScreen && millis() - lastDisplayRefreshTime >= profile.displayRefreshMs) {
+        unsigned long frameStarted = micros();
+        updateDisplay();
+        powerProfileRecordFrame(micros() - frameStarted);
+        lastDisplayRefreshTime = millis();
+    }
+
+    // Write settings to flash once changes have settled
+    settingsService();
+    fuelJournalService(fuelLevel, fuelBurnRate);
     
     // Handle waiting for satellites
     if (!homePointSet) {
@@ -1553,7 +2000,6 @@ void loop() {
 
         if (gps.satellites.value() >= 3) {
             DEBUG_PRINTLN("More than 3 satellites found.");
-            loadHomePoint();  // Load the last saved home point after 3 satellites are found
 
             // Show the countdown screen
             for (int i = 10; i >= 1; i--) {
@@ -1562,16 +2008,17 @@ void loop() {
                 // Check for button press without blocking
                 unsigned long startTime = millis();
                 while (millis() - startTime < 1000) {
+                    gpsIngestSync(gps);
                     if (digitalRead(PIN_KEY) == LOW) {  // Direct button reading
                         DEBUG_PRINTLN("Button pressed during countdown - setting new home point");
                         delay(50);  // Simple debounce
                         homeLatitude = gps.location.lat();
                         homeLongitude = gps.location.lng();
-                        saveHomePoint();
+                        homePointSet = true;
+                        saveSettings();
                         DEBUG_PRINTLN("New home point set");
                         
                         // Exit the countdown and show the home screen
-                        homePointSet = true;
                         isWaitingForSatsScreen = false;
                         isHomePointScreen = true;
                         displayHomePointScreen();
@@ -1585,6 +2032,7 @@ void loop() {
             if (isWaitingForSatsScreen) {  // If we didn't set a new home point
                 DEBUG_PRINTLN("Using last saved home point");
                 homePointSet = true;
+                updateNavTargets();
                 isWaitingForSatsScreen = false;
                 isHomePointScreen = true;
                 displayHomePointScreen();
@@ -1592,10 +2040,40 @@ void loop() {
         }
     }
 
+    if (millis() - lastLoopReportTime >= LOOP_REPORT_MS) {
+        EventLoopStats loopStats = eventLoopStats();
+        char powerData[192];
+        formatPowerTimings(powerData, sizeof(powerData));
+        DEBUG_PRINTF("Loop: idle %u ms, active %u ms, %u wakeups in the last second | Power: %s\n",
+                     loopStats.idleMs, loopStats.activeMs, loopStats.wakeups, powerData);
+        lastLoopReportTime = millis();
+    }
+
     // Rest of the loop (fuel updates, display refresh, etc.)
     // ...existing code...
 }
 
+// How long loop() may sleep: GPS fixes, the button and BLE wake it anyway,
+// so this only covers the jobs that run on time
+uint32_t loopTimeoutMs(bool buttonHeld) {
+    if (buttonHeld) {
+        return BUTTON_HELD_POLL_MS; // Long and medium presses are timed while held
+    }
+    if (bleCommandPending() || bulkTransferPending()) {
+        return 0; // The budget ran out with writes still queued; their events are already consumed
+    }
+    uint32_t timeout = EVENT_LOOP_IDLE_MS;
+    if (homePointSet && !isWaitingForSatsScreen) {
+        uint32_t sinceRefresh = millis() - lastDisplayRefreshTime;
+        uint32_t refresh = powerProfile().displayRefreshMs;
+        timeout = min(timeout, sinceRefresh >= refresh ? 0 : refresh - sinceRefresh);
+    }
+    if (deviceConnected) {
+        timeout = min(timeout, telemetryStreamWaitMs(millis()));
+    }
+    return timeout;
+}
+
 float getBatteryVoltage() {
   int bat = 0;
   for (uint8_t i = 0; i < 25; i++) {
@@ -1606,69 +2084,6 @@ float getBatteryVoltage() {
   return volt;
 }
 
-// Save operation mode to EEPROM
-void saveOperationMode() {
-    EEPROM.begin(512);
-    int modeOffset = sizeof(homeLatitude) + sizeof(homeLongitude) + 
-                     sizeof(poiLatitudes) + sizeof(poiLongitudes) + 
-                     sizeof(poiEnabled) + sizeof(fuelLevel) + sizeof(fuelBurnRate);
-    EEPROM.put(modeOffset, operationMode);
-    EEPROM.commit();
-    DEBUG_PRINTF("Operation mode saved to EEPROM: %d\n", operationMode);
-}
-
-// Load operation mode from EEPROM
-void loadOperationMode() {
-    EEPROM.begin(512);
-    int modeOffset = sizeof(homeLatitude) + sizeof(homeLongitude) + 
-                     sizeof(poiLatitudes) + sizeof(poiLongitudes) + 
-                     sizeof(poiEnabled) + sizeof(fuelLevel) + sizeof(fuelBurnRate);
-    EEPROM.get(modeOffset, operationMode);
-    
-    // Validate mode
-    if (operationMode != MODE_FLYING && operationMode != MODE_WALKING) {
-        operationMode = MODE_FLYING; // Default to flying mode if invalid
-    }
-    
-    DEBUG_PRINTF("Operation mode loaded from EEPROM: %d\n", operationMode);
-}
-
-// Save all POIs to EEPROM
-void savePOIs() {
-    EEPROM.begin(512);
-    int poiOffset = sizeof(homeLatitude) + sizeof(homeLongitude);
-    
-    // Save POI coordinates and enabled flags
-    EEPROM.put(poiOffset, poiLatitudes);
-    EEPROM.put(poiOffset + sizeof(poiLatitudes), poiLongitudes);
-    EEPROM.put(poiOffset + sizeof(poiLatitudes) + sizeof(poiLongitudes), poiEnabled);
-    
-    EEPROM.commit();
-    DEBUG_PRINTLN("All POIs saved to EEPROM");
-}
-
-// Load all POIs from EEPROM
-void loadPOIs() {
-    EEPROM.begin(512);
-    int poiOffset = sizeof(homeLatitude) + sizeof(homeLongitude);
-    
-    // Load POI coordinates and enabled flags
-    EEPROM.get(poiOffset, poiLatitudes);
-    EEPROM.get(poiOffset + sizeof(poiLatitudes), poiLongitudes);
-    EEPROM.get(poiOffset + sizeof(poiLatitudes) + sizeof(poiLongitudes), poiEnabled);
-    
-    // For backward compatibility
-    poiLatitude = poiLatitudes[0];
-    poiLongitude = poiLongitudes[0];
-    legacyPoiEnabled = poiEnabled[0];
-    
-    DEBUG_PRINTLN("All POIs loaded from EEPROM");
-    for (int i = 0; i < MAX_POIS; i++) {
-        DEBUG_PRINTF("POI %d: Lat=%.6f, Lon=%.6f, Enabled=%d\n", 
-                     i+1, poiLatitudes[i], poiLongitudes[i], poiEnabled[i]);
-    }
-}
-
 // Add new POI screens (6, 7, 8)
 void displayPOIScreen(int poiIndex) {
   if (poiIndex < 0 || poiIndex >= MAX_POIS || !poiEnabled[poiIndex]) {
@@ -1676,48 +2091,12 @@ void displayPOIScreen(int poiIndex) {
     return;
   }
   
-  display.fillScreen(GxEPD_WHITE);
-  
-  // Calculate direction to POI and pilot's heading
-  double poiBearing = gps.location.isValid() ?
-    TinyGPSPlus::courseTo(gps.location.lat(), gps.location.lng(), poiLatitudes[poiIndex], poiLongitudes[poiIndex]) : 0.0;
-  double pilotHeading = gps.course.isValid() ? gps.course.deg() : 0.0;
-  
-  // Draw the basic navigation display but use poiBearing instead of homeBearing
-  // Start with a white inner circle with black outline
-  display.drawRect(0, 0, 200, 200, GxEPD_BLACK); // Box around screen
-  
-  // Replace the inner circle with a jerry can icon
-  // Jerry can outline
-  int canLeft = 100 - 32;
-  int canTop = 100 - 20;
-  int canWidth = 64;
-  int canHeight = 50;
-  
-  // Draw the main body of the jerry can
-  display.drawRect(canLeft, canTop, canWidth, canHeight, GxEPD_BLACK);
-  display.drawLine(canLeft + 5, canTop, canLeft + 5, canTop + canHeight, GxEPD_BLACK); // Left vertical ridge
-  display.drawLine(canLeft + canWidth - 5, canTop, canLeft + canWidth - 5, canTop + canHeight, GxEPD_BLACK); // Right vertical ridge
-  
-  // Draw the cap/lid on top that appears open
-  display.drawLine(canLeft + 20, canTop - 10, canLeft + 44, canTop - 10, GxEPD_BLACK); // Cap top
-  display.drawLine(canLeft + 20, canTop - 10, canLeft + 24, canTop, GxEPD_BLACK); // Cap left side
-  display.drawLine(canLeft + 44, canTop - 10, canLeft + 40, canTop, GxEPD_BLACK); // Cap right side
+  // Direction and distance to the POI and home, worked out at the last fix
+  const NavTarget &poi = navTargets[NAV_TARGET_POI + poiIndex];
+  const NavTarget &home = navTargets[NAV_TARGET_HOME];
   
-  // Draw fuel dripping/pouring from the can
-  display.drawLine(canLeft + 32, canTop - 10, canLeft + 32, canTop - 15, GxEPD_BLACK); // Fuel stream
-  display.drawLine(canLeft + 33, canTop - 12, canLeft + 35, canTop - 18, GxEPD_BLACK); // Drip 1
-  display.drawLine(canLeft + 30, canTop - 14, canLeft + 28, canTop - 19, GxEPD_BLACK); // Drip 2
-
-  // Draw handle
-  display.drawLine(canLeft + canWidth, canTop + 10, canLeft + canWidth + 10, canTop + 10, GxEPD_BLACK);
-  display.drawLine(canLeft + canWidth, canTop + 40, canLeft + canWidth + 10, canTop + 40, GxEPD_BLACK);
-  display.drawLine(canLeft + canWidth + 10, canTop + 10, canLeft + canWidth + 10, canTop + 40, GxEPD_BLACK);
-  
-  // Keep the middle and outer circles for navigation display
-  display.drawCircle(100, 100, 70, GxEPD_BLACK); // Middle circle
-  display.drawCircle(100, 100, 95, GxEPD_BLACK); // Outer circle
-  display.drawCircle(100, 100, 96, GxEPD_BLACK); // Thicker outer circle
+  // Border, jerry can, rings and mode icon come from the cached background
+  blitNavigationBackground();
   
   // Display current speed in digital style with increased size and moved further left
   int speed = gps.speed.isValid() ? (int)gps.speed.kmph() : 0; // Get speed in km/h
@@ -1738,9 +2117,9 @@ void displayPOIScreen(int poiIndex) {
   display.print(fuelText);
   
   // Draw the POI number circle
-  double relativeBearingRad = calculateRelativeBearing(poiBearing, pilotHeading) * DEG_TO_RAD;
-  int poiCircleX = 100 + 80 * sin(relativeBearingRad);
-  int poiCircleY = 100 - 80 * cos(relativeBearingRad);
+  int16_t poiCircleX, poiCircleY;
+  dialPolarToScreen(100, 100, 80, dialAngleFromDegrees(poi.relativeBearing),
+                    &poiCircleX, &poiCircleY);
   
   display.fillCircle(poiCircleX, poiCircleY, 12, GxEPD_BLACK);
   display.setTextColor(GxEPD_WHITE);
@@ -1749,13 +2128,8 @@ void displayPOIScreen(int poiIndex) {
   display.print(poiIndex + 1);
   
   // Draw the home point
-  double homeBearing = gps.location.isValid() && homePointSet ?
-    TinyGPSPlus::courseTo(gps.location.lat(), gps.location.lng(), homeLatitude, homeLongitude) : 0.0;
-  double homeRelativeBearing = calculateRelativeBearing(homeBearing, pilotHeading);
-  double homeRelativeBearingRad = homeRelativeBearing * DEG_TO_RAD;
-  
-  int homeCircleX = 100 + 80 * sin(homeRelativeBearingRad);
-  int homeCircleY = 100 - 80 * cos(homeRelativeBearingRad);
+  int16_t homeCircleX, homeCircleY;
+  dialPolarToScreen(100, 100, 80, dialAngleFromDegrees(home.relativeBearing), &homeCircleX, &homeCircleY);
   
   display.fillCircle(homeCircleX, homeCircleY, 12, GxEPD_BLACK);
   display.setTextColor(GxEPD_WHITE);
@@ -1765,43 +2139,12 @@ void displayPOIScreen(int poiIndex) {
   display.setTextColor(GxEPD_BLACK); // Reset text color
   
   // Display battery percentage on the top left
-  int batteryPercentage = calculateBatteryStatus();
+  int batteryPercentage = batteryPercent;
   display.setTextSize(1);
   display.setCursor(0, 0);
   display.print(batteryPercentage);
   display.print("%");
   
-  // Draw mode icon in top right corner
-  if (operationMode == MODE_WALKING) {
-    // Walk icon - keep as is
-    int iconX = 180;
-    int iconY = 20;
-    display.fillCircle(iconX, iconY - 8, 3, GxEPD_BLACK);
-    display.drawLine(iconX, iconY - 5, iconX, iconY + 5, GxEPD_BLACK);
-    display.drawLine(iconX, iconY, iconX - 4, iconY - 2, GxEPD_BLACK);
-    display.drawLine(iconX, iconY, iconX + 4, iconY + 2, GxEPD_BLACK);
-    display.drawLine(iconX, iconY + 5, iconX - 4, iconY + 12, GxEPD_BLACK);
-    display.drawLine(iconX, iconY + 5, iconX + 4, iconY + 12, GxEPD_BLACK);
-  } else {
-    // Airplane icon - make bigger
-    int iconX = 180;
-    int iconY = 20;
-    // Fuselage - make longer
-    display.drawLine(iconX - 12, iconY, iconX + 12, iconY, GxEPD_BLACK);
-    display.drawLine(iconX - 12, iconY+1, iconX + 12, iconY+1, GxEPD_BLACK); // Make thicker
-    
-    // Wings - make wider
-    display.drawLine(iconX, iconY - 9, iconX, iconY + 9, GxEPD_BLACK);
-    display.drawLine(iconX+1, iconY - 9, iconX+1, iconY + 9, GxEPD_BLACK); // Make thicker
-    
-    display.drawLine(iconX - 8, iconY - 3, iconX + 8, iconY - 3, GxEPD_BLACK);
-    display.drawLine(iconX - 8, iconY - 2, iconX + 8, iconY - 2, GxEPD_BLACK); // Make thicker
-    
-    // Tail
-    display.drawLine(iconX - 8, iconY + 6, iconX + 2, iconY + 6, GxEPD_BLACK);
-    display.drawLine(iconX - 8, iconY + 5, iconX + 2, iconY + 5, GxEPD_BLACK); // Make thicker
-  }
-  
   // Add P1, P2, or P3 label instead of screen number
   display.setTextSize(3); // Larger and bolder
   display.setCursor(5, display.height() - 22); // Adjusted position for larger text
@@ -1809,8 +2152,7 @@ void displayPOIScreen(int poiIndex) {
   display.print(poiIndex + 1); // Will print P1, P2, or P3
   
   // Display distance to POI at the bottom instead of distance to home
-  double distanceKm = gps.location.isValid() ?
-    gps.distanceBetween(gps.location.lat(), gps.location.lng(), poiLatitudes[poiIndex], poiLongitudes[poiIndex]) / 1000.0 : 0.0;
+  double distanceKm = poi.distanceMeters / 1000.0;
   
   display.setTextSize(2);
   char distanceText[10];
@@ -1827,8 +2169,9 @@ void displayPOIScreen(int poiIndex) {
   display.setCursor(100 - (textWidth / 2), 145); // Moved down from 135
   display.print(distanceText);
   
-  display.updateWindow(0, 0, display.width(), display.height(), false);
-  DEBUG_PRINTF("Screen %d: POI %d Screen\n", 6 + poiIndex, poiIndex + 1);
+  display.refresh();
+  DEBUG_PRINTF("Screen %d: POI %d Screen (%lu bytes, %u windows)\n", 6 + poiIndex, poiIndex + 1,
+               (unsigned long)display.lastPushBytes(), display.lastPushWindows());
 }
 
 // Add new Screen 9 for coordinates display
@@ -1885,7 +2228,7 @@ void displayCoordinatesScreen() {
   display.setCursor(5, display.height() - 10);
   display.print("9");
   
-  display.updateWindow(0, 0, display.width(), display.height(), false);
+  display.refresh();
   DEBUG_PRINTLN("Screen 9: Coordinates Screen");
 }
 
@@ -0,0 +1,76 @@
+#include "nav_dial.h"
+
+// Draw the parts of the navigation dial that never change
+void drawNavigationBackground(Adafruit_GFX &gfx, int centerX, int centerY, uint8_t mode) {
+  gfx.fillScreen(GxEPD_WHITE);
+
+  // Draw a 200x200 box around the screen
+  gfx.drawRect(0, 0, 200, 200, GxEPD_BLACK);
+
+  // Replace the inner circle with a jerry can icon
+  // Jerry can outline
+  int canLeft = centerX - 32;
+  int canTop = centerY - 20;
+  int canWidth = 64;
+  int canHeight = 50;
+  
+  // Draw the main body of the jerry can
+  gfx.drawRect(canLeft, canTop, canWidth, canHeight, GxEPD_BLACK);
+  gfx.drawLine(canLeft + 5, canTop, canLeft + 5, canTop + canHeight, GxEPD_BLACK); // Left vertical ridge
+  gfx.drawLine(canLeft + canWidth - 5, canTop, canLeft + canWidth - 5, canTop + canHeight, GxEPD_BLACK); // Right vertical ridge
+  
+  // Draw the cap/lid on top that appears open
+  gfx.drawLine(canLeft + 20, canTop - 10, canLeft + 44, canTop - 10, GxEPD_BLACK); // Cap top
+  gfx.drawLine(canLeft + 20, canTop - 10, canLeft + 24, canTop, GxEPD_BLACK); // Cap left side
+  gfx.drawLine(canLeft + 44, canTop - 10, canLeft + 40, canTop, GxEPD_BLACK); // Cap right side
+  
+  // Draw fuel dripping/pouring from the can
+  gfx.drawLine(canLeft + 32, canTop - 10, canLeft + 32, canTop - 15, GxEPD_BLACK); // Fuel stream
+  gfx.drawLine(canLeft + 33, canTop - 12, canLeft + 35, canTop - 18, GxEPD_BLACK); // Drip 1
+  gfx.drawLine(canLeft + 30, canTop - 14, canLeft + 28, canTop - 19, GxEPD_BLACK); // Drip 2
+
+  // Draw handle
+  gfx.drawLine(canLeft + canWidth, canTop + 10, canLeft + canWidth + 10, canTop + 10, GxEPD_BLACK);
+  gfx.drawLine(canLeft + canWidth, canTop + 40, canLeft + canWidth + 10, canTop + 40, GxEPD_BLACK);
+  gfx.drawLine(canLeft + canWidth + 10, canTop + 10, canLeft + canWidth + 10, canTop + 40, GxEPD_BLACK);
+
+  // Keep the middle and outer circles for navigation display
+  gfx.drawCircle(centerX, centerY, 70, GxEPD_BLACK); // Middle circle
+  gfx.drawCircle(centerX, centerY, 95, GxEPD_BLACK); // Outer circle
+  gfx.drawCircle(centerX, centerY, 96, GxEPD_BLACK); // Thicker outer circle
+
+  drawModeIcon(gfx, mode);
+}
+
+// Draw the walking or flying icon in the top right corner
+void drawModeIcon(Adafruit_GFX &gfx, uint8_t mode) {
+  int iconX = 180;
+  int iconY = 20;
+  if (mode == MODE_WALKING) {
+    // Head
+    gfx.fillCircle(iconX, iconY - 8, 3, GxEPD_BLACK);
+    // Body
+    gfx.drawLine(iconX, iconY - 5, iconX, iconY + 5, GxEPD_BLACK);
+    // Arms
+    gfx.drawLine(iconX, iconY, iconX - 4, iconY - 2, GxEPD_BLACK);
+    gfx.drawLine(iconX, iconY, iconX + 4, iconY + 2, GxEPD_BLACK);
+    // Legs
+    gfx.drawLine(iconX, iconY + 5, iconX - 4, iconY + 12, GxEPD_BLACK);
+    gfx.drawLine(iconX, iconY + 5, iconX + 4, iconY + 12, GxEPD_BLACK);
+  } else { // MODE_FLYING
+    // Fuselage
+    gfx.drawLine(iconX - 12, iconY, iconX + 12, iconY, GxEPD_BLACK);
+    gfx.drawLine(iconX - 12, iconY+1, iconX + 12, iconY+1, GxEPD_BLACK); // Make thicker
+
+    // Wings
+    gfx.drawLine(iconX, iconY - 9, iconX, iconY + 9, GxEPD_BLACK);
+    gfx.drawLine(iconX+1, iconY - 9, iconX+1, iconY + 9, GxEPD_BLACK); // Make thicker
+
+    gfx.drawLine(iconX - 8, iconY - 3, iconX + 8, iconY - 3, GxEPD_BLACK);
+    gfx.drawLine(iconX - 8, iconY - 2, iconX + 8, iconY - 2, GxEPD_BLACK); // Make thicker
+
+    // Tail
+    gfx.drawLine(iconX - 8, iconY + 6, iconX + 2, iconY + 6, GxEPD_BLACK);
+    gfx.drawLine(iconX - 8, iconY + 5, iconX + 2, iconY + 5, GxEPD_BLACK); // Make thicker
+  }
+}
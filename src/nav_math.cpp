@@ -0,0 +1,96 @@
+#include "nav_math.h"
+
+#include <math.h>
+
+#define NAV_RAD_PER_UNIT 1.745329252e-9f // (pi / 180) / NAV_COORD_SCALE
+#define NAV_DEG_PER_RAD 57.29577951f
+#define NAV_FLAT_SPAN_UNITS (NAV_FLAT_SPAN_DEG * NAV_COORD_SCALE)
+#define NAV_HALF_TURN_UNITS (180L * NAV_COORD_SCALE)
+
+NavPoint navPointFromDegrees(double lat, double lon) {
+  NavPoint p;
+  p.lat = (int32_t)lround(lat * NAV_COORD_SCALE);
+  p.lon = (int32_t)lround(lon * NAV_COORD_SCALE);
+  return p;
+}
+
+NavPoint navPointFromRaw(uint16_t latDeg, uint32_t latBillionths, bool latNegative,
+                         uint16_t lonDeg, uint32_t lonBillionths, bool lonNegative) {
+  NavPoint p;
+  p.lat = (int32_t)latDeg * NAV_COORD_SCALE + (int32_t)((latBillionths + 50) / 100);
+  p.lon = (int32_t)lonDeg * NAV_COORD_SCALE + (int32_t)((lonBillionths + 50) / 100);
+  if (latNegative) p.lat = -p.lat;
+  if (lonNegative) p.lon = -p.lon;
+  return p;
+}
+
+double navLatDegrees(const NavPoint &p) {
+  return p.lat / (double)NAV_COORD_SCALE;
+}
+
+double navLonDegrees(const NavPoint &p) {
+  return p.lon / (double)NAV_COORD_SCALE;
+}
+
+NavOrigin navOrigin(const NavPoint &p) {
+  NavOrigin o;
+  o.point = p;
+  o.latRad = p.lat * NAV_RAD_PER_UNIT;
+  o.cosLat = cosf(o.latRad);
+  o.sinLat = sinf(o.latRad);
+  return o;
+}
+
+void navDistanceCourse(const NavOrigin &from, const NavPoint &to, float *meters, float *course) {
+  // Exact integer deltas, longitude wrapped across the antimeridian
+  int32_t dLat = to.lat - from.point.lat;
+  int64_t dLonWide = (int64_t)to.lon - from.point.lon;
+  if (dLonWide > NAV_HALF_TURN_UNITS) dLonWide -= 2 * (int64_t)NAV_HALF_TURN_UNITS;
+  if (dLonWide < -NAV_HALF_TURN_UNITS) dLonWide += 2 * (int64_t)NAV_HALF_TURN_UNITS;
+  int32_t dLon = (int32_t)dLonWide;
+
+  float dLatRad = dLat * NAV_RAD_PER_UNIT;
+  float dLonRad = dLon * NAV_RAD_PER_UNIT;
+  float distance, bearing;
+
+  if (labs(dLat) < NAV_FLAT_SPAN_UNITS && labs(dLon) < NAV_FLAT_SPAN_UNITS) {
+    // Equirectangular around the mid latitude, cos/sin(mid) from a first order
+    // expansion. The mid latitude course is turned back to the initial
+    // great-circle course by half the meridian convergence.
+    float cosMid = from.cosLat - from.sinLat * dLatRad * 0.5f;
+    float sinMid = from.sinLat + from.cosLat * dLatRad * 0.5f;
+    float north = dLatRad;
+    float east = dLonRad * cosMid;
+    distance = sqrtf(north * north + east * east) * NAV_EARTH_RADIUS_M;
+    bearing = atan2f(east, north) - dLonRad * sinMid * 0.5f;
+  } else {
+    // Haversine distance and great-circle initial bearing
+    float lat2 = from.latRad + dLatRad;
+    float cosLat2 = cosf(lat2);
+    float sinLat2 = sinf(lat2);
+    float sinHalfLat = sinf(dLatRad * 0.5f);
+    float sinHalfLon = sinf(dLonRad * 0.5f);
+    float a = sinHalfLat * sinHalfLat + from.cosLat * cosLat2 * sinHalfLon * sinHalfLon;
+    if (a > 1.0f) a = 1.0f;
+    distance = 2.0f * atan2f(sqrtf(a), sqrtf(1.0f - a)) * NAV_EARTH_RADIUS_M;
+    bearing = atan2f(sinf(dLonRad) * cosLat2, from.cosLat * sinLat2 - from.sinLat * cosLat2 * cosf(dLonRad));
+  }
+
+  bearing *= NAV_DEG_PER_RAD;
+  if (bearing < 0.0f) bearing += 360.0f;
+
+  if (meters) *meters = distance;
+  if (course) *course = bearing;
+}
+
+float navDistanceMeters(const NavOrigin &from, const NavPoint &to) {
+  float meters;
+  navDistanceCourse(from, to, &meters, nullptr);
+  return meters;
+}
+
+float navCourseDegrees(const NavOrigin &from, const NavPoint &to) {
+  float course;
+  navDistanceCourse(from, to, nullptr, &course);
+  return course;
+}
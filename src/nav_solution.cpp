@@ -0,0 +1,49 @@
+#include "nav_solution.h"
+
+#include <math.h>
+
+#define NAV_RAD_PER_DEG 0.01745329252f
+
+static NavSolution solution = {};
+
+static void solveTarget(NavTarget &target) {
+  if (!target.enabled || !solution.valid) {
+    target.distanceMeters = 0.0f;
+    target.courseDegrees = 0.0f;
+    target.relativeBearing = 0.0f;
+    target.etaSeconds = -1.0f;
+    return;
+  }
+
+  navDistanceCourse(solution.origin, target.point, &target.distanceMeters, &target.courseDegrees);
+
+  float relative = target.courseDegrees - solution.headingDegrees;
+  if (relative > 180.0f) {
+    relative -= 360.0f;
+  } else if (relative < -180.0f) {
+    relative += 360.0f;
+  }
+  target.relativeBearing = relative;
+
+  // Only the part of the ground speed that points at the target closes the distance
+  float closingKmh = solution.speedKmh * cosf(relative * NAV_RAD_PER_DEG);
+  target.etaSeconds = closingKmh >= NAV_ETA_MIN_CLOSING_KMH ? target.distanceMeters / (closingKmh / 3.6f) : -1.0f;
+}
+
+void navSolutionUpdate(const GpsFix &fix, NavTarget *targets, size_t count) {
+  solution.valid = fix.location.isValid();
+  if (solution.valid) {
+    solution.origin = navOrigin(fix.location.point);
+  }
+  solution.headingDegrees = fix.course.isValid() ? fix.course.value : 0.0f;
+  solution.speedKmh = fix.speed.isValid() ? fix.speed.value : 0.0f;
+  solution.fixMillis = fix.updateMillis;
+
+  for (size_t i = 0; i < count; i++) {
+    solveTarget(targets[i]);
+  }
+}
+
+const NavSolution &navSolution() {
+  return solution;
+}
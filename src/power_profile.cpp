@@ -0,0 +1,87 @@
+#include "power_profile.h"
+
+#define NO_PROFILE 0xff
+
+static const PowerProfile profiles[POWER_PROFILES] = {
+  // Fast fixes and a screen that keeps up with the aircraft
+  {"flying", 240, 5, 2000, 0, 10000},
+  // The walking screen changes slowly; 80 MHz is the lowest clock that keeps BLE and the UARTs running
+  {"walking", 80, 1, 10000, 244, 30000},
+  // Standing still in walking mode
+  {"resting", 80, 1, 30000, 1636, 60000},
+};
+
+static uint8_t current = NO_PROFILE;
+static bool moving = true; // Until the fixes show otherwise
+static uint32_t slowSinceMs;
+static bool slow = false;
+static PowerProfileStats stats = {};
+
+static void track(const GpsFix &fix, uint32_t nowMs) {
+  if (!fix.speed.isValid()) {
+    return; // No evidence either way
+  }
+  float kmph = fix.speed.kmph();
+  if (kmph > POWER_MOVING_KMH) {
+    moving = true;
+    slow = false;
+  } else if (kmph < POWER_STOPPED_KMH) {
+    if (!slow) {
+      slow = true;
+      slowSinceMs = nowMs;
+    } else if (nowMs - slowSinceMs >= POWER_STOPPED_MS) {
+      moving = false;
+    }
+  } else {
+    slow = false; // In between: keep the current state
+  }
+}
+
+bool powerProfileUpdate(bool flying, const GpsFix &fix, uint32_t nowMs) {
+  track(fix, nowMs);
+  // Ground speed says nothing about being on the ground when flying into a
+  // headwind, so only walking drops to resting
+  uint8_t wanted = flying ? POWER_PROFILE_FLYING : moving ? POWER_PROFILE_WALKING : POWER_PROFILE_RESTING;
+  if (wanted == current) {
+    return false;
+  }
+  if (current != NO_PROFILE) {
+    stats.switches++;
+  }
+  current = wanted;
+  return true;
+}
+
+uint8_t powerProfileId() {
+  return current == NO_PROFILE ? POWER_PROFILE_FLYING : current;
+}
+
+const PowerProfile &powerProfile() {
+  return profiles[powerProfileId()];
+}
+
+const PowerProfile &powerProfileAt(uint8_t id) {
+  return profiles[id < POWER_PROFILES ? id : POWER_PROFILE_FLYING];
+}
+
+bool powerProfileMoving() {
+  return moving;
+}
+
+static void record(PowerTiming &timing, uint32_t micros) {
+  timing.count++;
+  timing.totalUs += micros;
+  if (micros > timing.maxUs) timing.maxUs = micros;
+}
+
+void powerProfileRecordFrame(uint32_t micros) {
+  record(stats.frames[powerProfileId()], micros);
+}
+
+void powerProfileRecordFix(uint32_t micros) {
+  record(stats.fixes[powerProfileId()], micros);
+}
+
+PowerProfileStats powerProfileStats() {
+  return stats;
+}
@@ -0,0 +1,145 @@
+#include "settings.h"
+
+#include <EEPROM.h>
+#include <stddef.h>
+#include <string.h>
+#include "crc32.h"
+
+#define SETTINGS_HEADER_SIZE offsetof(Settings, homeLatitude)
+
+// Pre-versioned layout, each save function computed its own offsets and
+// several of them overlap: the fuel values sit on top of POI 3's latitude
+// and POI 1's longitude. Every field is range checked on migration and
+// whatever was clobbered falls back to its default.
+#define LEGACY_HOME_OFFSET 0
+#define LEGACY_POI_OFFSET 16
+#define LEGACY_FUEL_OFFSET 33
+#define LEGACY_MODE_OFFSET 83
+
+static Settings stored;           // What is in flash
+static Settings pending;          // What should be
+static bool dirty = false;
+static unsigned long dirtySince = 0;   // First change not yet committed
+static unsigned long lastChangeAt = 0; // Latest change
+
+static uint32_t settingsCrc(const Settings &s) {
+  return crc32Update(0, (const uint8_t *)&s + SETTINGS_HEADER_SIZE, s.length - SETTINGS_HEADER_SIZE);
+}
+
+static bool validLatLon(double lat, double lon) {
+  return !isnan(lat) && !isnan(lon) && fabs(lat) <= 90.0 && fabs(lon) <= 180.0;
+}
+
+static void setDefaults(Settings &s) {
+  memset(&s, 0, sizeof(s));
+  s.fuelLevel = SETTINGS_DEFAULT_FUEL_LEVEL;
+  s.fuelBurnRate = SETTINGS_DEFAULT_BURN_RATE;
+  s.operationMode = SETTINGS_DEFAULT_MODE;
+}
+
+// Recover what we can from the old layout, already in EEPROM's RAM copy
+static bool migrateLegacy(Settings &s) {
+  double home[2], lats[SETTINGS_POI_COUNT], lons[SETTINGS_POI_COUNT], fuel[2];
+  uint8_t enabled[SETTINGS_POI_COUNT], mode;
+  EEPROM.get(LEGACY_HOME_OFFSET, home);
+  EEPROM.get(LEGACY_POI_OFFSET, lats);
+  EEPROM.get(LEGACY_POI_OFFSET + sizeof(lats), lons);
+  EEPROM.get(LEGACY_POI_OFFSET + sizeof(lats) + sizeof(lons), enabled);
+  EEPROM.get(LEGACY_FUEL_OFFSET, fuel);
+  EEPROM.get(LEGACY_MODE_OFFSET, mode);
+
+  bool any = false;
+  if (validLatLon(home[0], home[1])) {
+    s.homeLatitude = home[0];
+    s.homeLongitude = home[1];
+    any = true;
+  }
+  for (uint8_t i = 0; i < SETTINGS_POI_COUNT; i++) {
+    if (validLatLon(lats[i], lons[i]) && enabled[i] <= 1) {
+      s.poiLatitudes[i] = lats[i];
+      s.poiLongitudes[i] = lons[i];
+      s.poiEnabled[i] = enabled[i];
+      any = true;
+    }
+  }
+  if (!isnan(fuel[0]) && fuel[0] > 0 && fuel[0] <= 100) {
+    s.fuelLevel = fuel[0];
+    any = true;
+  }
+  if (!isnan(fuel[1]) && fuel[1] > 0 && fuel[1] <= 10) {
+    s.fuelBurnRate = fuel[1];
+    any = true;
+  }
+  if (mode == 1 || mode == 2) {
+    s.operationMode = mode;
+  }
+  return any;
+}
+
+bool settingsLoad(Settings &s) {
+  setDefaults(s);
+  EEPROM.begin(SETTINGS_EEPROM_SIZE); // The one flash read, into EEPROM's RAM copy
+
+  Settings record;
+  EEPROM.get(0, record);
+  bool loaded = false;
+  if (record.magic == SETTINGS_MAGIC && record.length > SETTINGS_HEADER_SIZE &&
+      record.length <= sizeof(Settings) && record.crc == settingsCrc(record)) {
+    // Fields added after this record was written keep their defaults
+    memcpy((uint8_t *)&s + SETTINGS_HEADER_SIZE, (const uint8_t *)&record + SETTINGS_HEADER_SIZE,
+           record.length - SETTINGS_HEADER_SIZE);
+    loaded = true;
+  } else if (record.magic != SETTINGS_MAGIC) {
+    loaded = migrateLegacy(s);
+  }
+
+  s.magic = SETTINGS_MAGIC;
+  s.version = SETTINGS_VERSION;
+  s.length = sizeof(Settings);
+  s.crc = settingsCrc(s);
+  stored = record;
+  pending = s;
+  // Migrated or upgraded records get rewritten in the new format on the next commit
+  dirty = memcmp(&stored, &pending, sizeof(Settings)) != 0;
+  dirtySince = lastChangeAt = millis();
+  return loaded;
+}
+
+void settingsStore(const Settings &s) {
+  Settings next = s;
+  next.magic = SETTINGS_MAGIC;
+  next.version = SETTINGS_VERSION;
+  next.length = sizeof(Settings);
+  next.crc = settingsCrc(next);
+  if (memcmp(&next, &pending, sizeof(Settings)) == 0) {
+    return;
+  }
+  pending = next;
+  lastChangeAt = millis();
+  if (!dirty) {
+    dirty = true;
+    dirtySince = lastChangeAt;
+  }
+}
+
+void settingsService() {
+  if (!dirty) {
+    return;
+  }
+  unsigned long now = millis();
+  if (now - lastChangeAt >= SETTINGS_COMMIT_DELAY_MS || now - dirtySince >= SETTINGS_COMMIT_MAX_DELAY_MS) {
+    settingsFlush();
+  }
+}
+
+void settingsFlush() {
+  if (!dirty) {
+    return;
+  }
+  if (memcmp(&pending, &stored, sizeof(Settings)) != 0) {
+    EEPROM.put(0, pending);
+    EEPROM.commit();
+    stored = pending;
+  }
+  dirty = false;
+}
@@ -0,0 +1,191 @@
+#include "telemetry_stream.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define ALL_FIELDS ((1 << TELEMETRY_STREAM_FIELDS) - 1)
+#define STATS_WINDOW_MS 5000
+
+struct StreamField {
+  uint8_t offset;    // In TelemetryLive
+  uint8_t size;
+  bool isSigned;
+  uint16_t deadband; // Changes up to this many units don't make the field due
+};
+
+// In mask bit order
+static const StreamField fields[TELEMETRY_STREAM_FIELDS] = {
+  {offsetof(TelemetryLive, lat), 4, true, 0},
+  {offsetof(TelemetryLive, lon), 4, true, 0},
+  {offsetof(TelemetryLive, altitude), 2, true, 0},
+  {offsetof(TelemetryLive, speed), 2, false, 1},
+  {offsetof(TelemetryLive, course), 2, false, 50}, // Half a degree; wanders when stopped
+  {offsetof(TelemetryLive, fuel), 2, false, 0},
+  {offsetof(TelemetryLive, batteryMv), 2, false, 20}, // ADC noise
+};
+
+static uint8_t rateHz = 0;
+static uint16_t mtu = 23;
+static uint16_t connectionIntervalMs = 30;
+static uint16_t intervalMs = 1000;
+static uint32_t lastSlot = 0;
+static uint32_t lastKeyframe = 0;
+static uint8_t sequence = 0;
+static uint8_t owedAbsolute = ALL_FIELDS;
+static int32_t reference[TELEMETRY_STREAM_FIELDS]; // What the client has
+// Encoded but not yet sent
+static int32_t staged[TELEMETRY_STREAM_FIELDS];
+static uint8_t stagedFields = 0;
+static uint8_t stagedAbsolute = 0;
+static uint32_t windowStart = 0;
+static uint32_t windowBytes = 0;
+static TelemetryStreamStats stats = {0, 0, 0, 1000, 0};
+
+// Shortest interval the rate and the link allow
+static uint16_t floorInterval() {
+  uint16_t rateInterval = rateHz ? 1000 / rateHz : TELEMETRY_STREAM_MAX_INTERVAL_MS;
+  uint16_t linkInterval = connectionIntervalMs * TELEMETRY_STREAM_LINK_EVENTS;
+  return rateInterval > linkInterval ? rateInterval : linkInterval;
+}
+
+static int32_t fieldValue(const TelemetryLive &live, const StreamField &field) {
+  const uint8_t *at = (const uint8_t *)&live + field.offset;
+  if (field.size == 4) {
+    int32_t value;
+    memcpy(&value, at, sizeof(value));
+    return value;
+  }
+  uint16_t value;
+  memcpy(&value, at, sizeof(value));
+  return field.isSigned ? (int32_t)(int16_t)value : (int32_t)value;
+}
+
+static uint8_t writeVarint(int32_t value, uint8_t *out) {
+  uint32_t raw = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); // Zigzag
+  uint8_t length = 0;
+  while (raw >= 0x80) {
+    out[length++] = (uint8_t)raw | 0x80;
+    raw >>= 7;
+  }
+  out[length++] = (uint8_t)raw;
+  return length;
+}
+
+void telemetryStreamSetRate(uint8_t hz) {
+  if (hz > TELEMETRY_STREAM_MAX_HZ) hz = TELEMETRY_STREAM_MAX_HZ;
+  if (hz && !rateHz) {
+    telemetryStreamReset();
+  }
+  rateHz = hz;
+  intervalMs = floorInterval();
+  stats.intervalMs = intervalMs;
+}
+
+uint8_t telemetryStreamRate() {
+  return rateHz;
+}
+
+void telemetryStreamSetLink(uint16_t newMtu, uint16_t newConnectionIntervalMs) {
+  mtu = newMtu;
+  connectionIntervalMs = newConnectionIntervalMs;
+  if (intervalMs < floorInterval()) {
+    intervalMs = floorInterval();
+    stats.intervalMs = intervalMs;
+  }
+}
+
+void telemetryStreamReset() {
+  owedAbsolute = ALL_FIELDS;
+}
+
+bool telemetryStreamDue(uint32_t nowMs) {
+  return rateHz && nowMs - lastSlot >= intervalMs;
+}
+
+uint32_t telemetryStreamWaitMs(uint32_t nowMs) {
+  if (!rateHz) {
+    return UINT32_MAX;
+  }
+  uint32_t elapsed = nowMs - lastSlot;
+  return elapsed >= intervalMs ? 0 : intervalMs - elapsed;
+}
+
+size_t telemetryStreamEncode(const TelemetryLive &live, uint32_t nowMs, uint8_t *out) {
+  if (nowMs - lastKeyframe >= TELEMETRY_STREAM_KEYFRAME_MS) {
+    owedAbsolute = ALL_FIELDS;
+    lastKeyframe = nowMs;
+  }
+
+  size_t capacity = mtu > 3 ? mtu - 3 : 0; // ATT notification header
+  if (capacity > TELEMETRY_STREAM_MAX_FRAME) capacity = TELEMETRY_STREAM_MAX_FRAME;
+  TelemetryDeltaHeader header = {{TELEMETRY_VERSION, TELEMETRY_FRAME_DELTA, 0}, 0, 0, 0};
+  size_t length = sizeof(header);
+
+  for (uint8_t i = 0; i < TELEMETRY_STREAM_FIELDS; i++) {
+    uint8_t bit = 1 << i;
+    int32_t value = fieldValue(live, fields[i]);
+    int64_t difference = (int64_t)value - reference[i];
+    bool absolute = (owedAbsolute & bit) || difference < INT32_MIN || difference > INT32_MAX;
+    if (!absolute && (difference < 0 ? -difference : difference) <= fields[i].deadband) {
+      continue;
+    }
+
+    uint8_t varint[5];
+    uint8_t varintLength = writeVarint(absolute ? value : (int32_t)difference, varint);
+    if (length + varintLength > capacity) {
+      continue; // Stays due for the next frame
+    }
+    memcpy(out + length, varint, varintLength);
+    length += varintLength;
+    header.fields |= bit;
+    if (absolute) header.absolute |= bit;
+    staged[i] = value;
+  }
+
+  stagedFields = header.fields;
+  stagedAbsolute = header.absolute;
+  if (!header.fields) {
+    return 0;
+  }
+  header.header.length = length;
+  header.sequence = sequence;
+  memcpy(out, &header, sizeof(header));
+  return length;
+}
+
+void telemetryStreamSent(uint32_t nowMs, size_t bytes, bool congested) {
+  lastSlot = nowMs;
+  uint16_t floor = floorInterval();
+  if (congested) {
+    // Double until the queue drains, then give a quarter back per clean frame
+    stats.backoffs++;
+    intervalMs = intervalMs * 2 > TELEMETRY_STREAM_MAX_INTERVAL_MS ? TELEMETRY_STREAM_MAX_INTERVAL_MS : intervalMs * 2;
+  } else {
+    intervalMs -= intervalMs / 4;
+  }
+  if (intervalMs < floor) intervalMs = floor;
+  stats.intervalMs = intervalMs;
+
+  if (bytes) {
+    // The client has the frame: its fields become the reference
+    for (uint8_t i = 0; i < TELEMETRY_STREAM_FIELDS; i++) {
+      if (stagedFields & (1 << i)) reference[i] = staged[i];
+    }
+    owedAbsolute &= ~stagedAbsolute;
+    sequence++;
+    stats.frames++;
+    stats.bytes += bytes;
+    windowBytes += bytes;
+  }
+  stagedFields = 0;
+  stagedAbsolute = 0;
+  if (nowMs - windowStart >= STATS_WINDOW_MS) {
+    stats.bytesPerSecond = windowBytes * 1000 / (nowMs - windowStart);
+    windowStart = nowMs;
+    windowBytes = 0;
+  }
+}
+
+TelemetryStreamStats telemetryStreamStats() {
+  return stats;
+}
@@ -0,0 +1,160 @@
+#include "terrain.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+#define TILE_INTERVALS (TERRAIN_TILE_SAMPLES - 1)
+#define TILE_SAMPLE_COUNT (TERRAIN_TILE_SAMPLES * TERRAIN_TILE_SAMPLES)
+
+struct CachedTile {
+  int32_t tile;     // Index in the image, -1 if the slot is free
+  uint32_t lastUse;
+  int16_t samples[TILE_SAMPLE_COUNT];
+};
+
+static AssetImage image;
+static const TerrainHeader *header = nullptr;
+static AssetArray<uint32_t> tileIndex;
+static AssetArray<uint8_t> tileData;
+static CachedTile cache[TERRAIN_CACHE_TILES];
+static uint32_t useCounter = 0;
+static TerrainStats stats = {0, 0, 0, 0};
+
+bool terrainBegin() {
+  header = nullptr;
+  if (!assetOpen(TERRAIN_PARTITION, ASSET_SUBTYPE_TERRAIN, TERRAIN_MAGIC, TERRAIN_VERSION, image)) {
+    return false;
+  }
+
+  const TerrainHeader *h = assetHeader<TerrainHeader>(image);
+  bool ok = h && h->cols > 0 && h->rows > 0 && h->tileSize > 0 &&
+            assetArray(image, h->indexOffset, (uint32_t)h->cols * h->rows + 1, tileIndex) &&
+            assetArray(image, h->dataOffset, h->dataSize, tileData) &&
+            tileIndex[0] == 0 && tileIndex[tileIndex.count - 1] == h->dataSize;
+  for (uint32_t i = 0; ok && i + 1 < tileIndex.count; i++) {
+    ok = tileIndex[i] <= tileIndex[i + 1];
+  }
+  if (!ok) {
+    assetClose(image);
+    return false;
+  }
+
+  header = h;
+  for (uint8_t i = 0; i < TERRAIN_CACHE_TILES; i++) {
+    cache[i].tile = -1;
+  }
+  return true;
+}
+
+TerrainStats terrainStats() {
+  return stats;
+}
+
+static bool readVarint(uint32_t &position, uint32_t end, int32_t &value) {
+  uint32_t raw = 0;
+  for (uint8_t shift = 0; shift < 32; shift += 7) {
+    if (position >= end) {
+      return false;
+    }
+    uint8_t byte = tileData[position++];
+    raw |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1); // Zigzag
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decode one tile into a cache slot; false if its data is short or malformed
+static bool decodeTile(uint32_t tile, CachedTile &slot) {
+  uint32_t position = tileIndex[tile];
+  uint32_t end = tileIndex[tile + 1];
+  TerrainTileHeader tileHeader;
+  if (end - position < sizeof(tileHeader)) {
+    return false;
+  }
+  memcpy(&tileHeader, &tileData[position], sizeof(tileHeader));
+  position += sizeof(tileHeader);
+  if (tileHeader.step == 0) {
+    return false;
+  }
+
+  // Each sample follows the one to its west; the first of a row follows the first of the row below
+  int32_t rowStart = 0;
+  int32_t west = 0;
+  for (uint16_t i = 0; i < TILE_SAMPLE_COUNT; i++) {
+    int32_t delta;
+    if (!readVarint(position, end, delta)) {
+      return false;
+    }
+    int32_t quantized = (i % TERRAIN_TILE_SAMPLES == 0 ? rowStart : west) + delta;
+    if (i % TERRAIN_TILE_SAMPLES == 0) {
+      rowStart = quantized;
+    }
+    west = quantized;
+    slot.samples[i] = (int16_t)constrain(tileHeader.base + quantized * tileHeader.step, INT16_MIN, INT16_MAX);
+  }
+  slot.tile = tile;
+  return true;
+}
+
+// Cached tile, decoding it into the least recently used slot on a miss
+static const CachedTile *loadTile(uint32_t tile) {
+  if (tileIndex[tile] == tileIndex[tile + 1]) {
+    return nullptr; // No data here, e.g. over the sea; don't spend a slot on it
+  }
+  CachedTile *oldest = &cache[0];
+  for (uint8_t i = 0; i < TERRAIN_CACHE_TILES; i++) {
+    if (cache[i].tile == (int32_t)tile) {
+      cache[i].lastUse = ++useCounter;
+      stats.hits++;
+      return &cache[i];
+    }
+    if (cache[i].tile < 0 || (oldest->tile >= 0 && cache[i].lastUse < oldest->lastUse)) {
+      oldest = &cache[i];
+    }
+  }
+
+  stats.misses++;
+  if (!decodeTile(tile, *oldest)) {
+    oldest->tile = -1;
+    return nullptr;
+  }
+  oldest->lastUse = ++useCounter;
+  return oldest;
+}
+
+float terrainElevation(const NavPoint &point) {
+  if (!header) {
+    return NAN;
+  }
+  uint32_t started = micros();
+  float elevation = NAN;
+
+  int64_t lat = (int64_t)point.lat - header->originLat;
+  int64_t lon = (int64_t)point.lon - header->originLon;
+  int64_t row = lat / header->tileSize;
+  int64_t col = lon / header->tileSize;
+  if (lat >= 0 && lon >= 0 && row < header->rows && col < header->cols) {
+    const CachedTile *tile = loadTile((uint32_t)(row * header->cols + col));
+    if (tile) {
+      // Position inside the tile in sample intervals, then a bilinear blend of the four around it
+      float v = (float)(lat - row * header->tileSize) * TILE_INTERVALS / header->tileSize;
+      float u = (float)(lon - col * header->tileSize) * TILE_INTERVALS / header->tileSize;
+      uint8_t y = min((int)v, TILE_INTERVALS - 1);
+      uint8_t x = min((int)u, TILE_INTERVALS - 1);
+      float fy = v - y;
+      float fx = u - x;
+      const int16_t *south = &tile->samples[y * TERRAIN_TILE_SAMPLES + x];
+      const int16_t *north = south + TERRAIN_TILE_SAMPLES;
+      float southElevation = south[0] + (south[1] - south[0]) * fx;
+      float northElevation = north[0] + (north[1] - north[0]) * fx;
+      elevation = southElevation + (northElevation - southElevation) * fy;
+    }
+  }
+
+  stats.lastMicros = micros() - started;
+  if (stats.lastMicros > stats.maxMicros) stats.maxMicros = stats.lastMicros;
+  return elevation;
+}
@@ -0,0 +1,203 @@
+#include "ubx.h"
+
+#include <string.h>
+
+enum {
+  UBX_WAIT_SYNC1 = 0,
+  UBX_WAIT_SYNC2,
+  UBX_WAIT_CLASS,
+  UBX_WAIT_ID,
+  UBX_WAIT_LEN1,
+  UBX_WAIT_LEN2,
+  UBX_WAIT_PAYLOAD,
+  UBX_WAIT_CK_A,
+  UBX_WAIT_CK_B,
+  UBX_SKIP_PAYLOAD // Frame too large for the buffer, swallow it
+};
+
+static inline uint16_t ubxU16(const uint8_t *p) {
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline uint32_t ubxU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int32_t ubxI32(const uint8_t *p) {
+  return (int32_t)ubxU32(p);
+}
+
+bool UbxDecoder::feed(uint8_t byte) {
+  switch (state) {
+    case UBX_WAIT_SYNC1:
+      if (byte == UBX_SYNC1) state = UBX_WAIT_SYNC2;
+      return false;
+    case UBX_WAIT_SYNC2:
+      state = (byte == UBX_SYNC2) ? UBX_WAIT_CLASS : UBX_WAIT_SYNC1;
+      return false;
+    case UBX_WAIT_CLASS:
+      cls = byte;
+      ckA = byte;
+      ckB = ckA;
+      state = UBX_WAIT_ID;
+      return false;
+    case UBX_WAIT_ID:
+      id = byte;
+      ckA += byte;
+      ckB += ckA;
+      state = UBX_WAIT_LEN1;
+      return false;
+    case UBX_WAIT_LEN1:
+      len = byte;
+      ckA += byte;
+      ckB += ckA;
+      state = UBX_WAIT_LEN2;
+      return false;
+    case UBX_WAIT_LEN2:
+      len |= (uint16_t)byte << 8;
+      ckA += byte;
+      ckB += ckA;
+      pos = 0;
+      if (len > UBX_MAX_PAYLOAD) {
+        state = UBX_SKIP_PAYLOAD;
+      } else {
+        state = len ? UBX_WAIT_PAYLOAD : UBX_WAIT_CK_A;
+      }
+      return false;
+    case UBX_WAIT_PAYLOAD:
+      buffer[pos++] = byte;
+      ckA += byte;
+      ckB += ckA;
+      if (pos == len) state = UBX_WAIT_CK_A;
+      return false;
+    case UBX_WAIT_CK_A:
+      if (byte == ckA) {
+        state = UBX_WAIT_CK_B;
+      } else {
+        failureCount++;
+        state = UBX_WAIT_SYNC1;
+      }
+      return false;
+    case UBX_WAIT_CK_B:
+      state = UBX_WAIT_SYNC1;
+      if (byte == ckB) {
+        frameCount++;
+        return true;
+      }
+      failureCount++;
+      return false;
+    case UBX_SKIP_PAYLOAD:
+      // Payload plus the two checksum bytes
+      if (++pos >= len + 2) state = UBX_WAIT_SYNC1;
+      return false;
+  }
+  state = UBX_WAIT_SYNC1;
+  return false;
+}
+
+size_t ubxBuildFrame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t payloadLength, uint8_t *out) {
+  out[0] = UBX_SYNC1;
+  out[1] = UBX_SYNC2;
+  out[2] = cls;
+  out[3] = id;
+  out[4] = payloadLength & 0xFF;
+  out[5] = payloadLength >> 8;
+  if (payloadLength) {
+    memcpy(out + 6, payload, payloadLength);
+  }
+
+  uint8_t ckA = 0, ckB = 0;
+  for (size_t i = 2; i < 6 + (size_t)payloadLength; i++) {
+    ckA += out[i];
+    ckB += ckA;
+  }
+  out[6 + payloadLength] = ckA;
+  out[7 + payloadLength] = ckB;
+  return payloadLength + UBX_FRAME_OVERHEAD;
+}
+
+bool ubxApplyNav(const UbxDecoder &frame, GpsFix &fix) {
+  if (frame.msgClass() != UBX_CLASS_NAV) {
+    return false;
+  }
+  const uint8_t *p = frame.payload();
+
+  switch (frame.msgId()) {
+    case UBX_NAV_PVT: { // u-blox 7 and later, everything in one message
+      if (frame.length() < 92) return false;
+      uint8_t valid = p[11];
+      uint8_t fixType = p[20];
+      bool fixOk = p[21] & 0x01;
+      fix.satellites.count = p[23];
+      fix.fixType = fixOk ? fixType : 0;
+      if (valid & 0x01) {
+        fix.date.valid = true;
+        fix.date.y = ubxU16(p + 4);
+        fix.date.mo = p[6];
+        fix.date.d = p[7];
+      }
+      if (valid & 0x02) {
+        fix.time.valid = true;
+        fix.time.h = p[8];
+        fix.time.m = p[9];
+        fix.time.s = p[10];
+      }
+      if (fix.fixType >= 2) {
+        fix.location.valid = true;
+        fix.location.point.lon = ubxI32(p + 24);
+        fix.location.point.lat = ubxI32(p + 28);
+        fix.altitude.valid = true;
+        fix.altitude.value = ubxI32(p + 36) * 0.001f;
+        fix.hAccMeters = ubxU32(p + 40) * 0.001f;
+        fix.speed.valid = true;
+        fix.speed.value = ubxI32(p + 60) * 0.0036f; // mm/s to km/h
+        fix.course.valid = true;
+        fix.course.value = ubxI32(p + 64) * 1e-5f;
+      }
+      return true;
+    }
+
+    case UBX_NAV_SOL: // NEO-6M: fix status and satellites
+      if (frame.length() < 52) return false;
+      fix.fixType = (p[11] & 0x01) ? p[10] : 0;
+      fix.satellites.count = p[47];
+      return true;
+
+    case UBX_NAV_POSLLH: // NEO-6M: position
+      if (frame.length() < 28) return false;
+      if (fix.fixType >= 2) {
+        fix.location.valid = true;
+        fix.location.point.lon = ubxI32(p + 4);
+        fix.location.point.lat = ubxI32(p + 8);
+        fix.altitude.valid = true;
+        fix.altitude.value = ubxI32(p + 16) * 0.001f;
+        fix.hAccMeters = ubxU32(p + 20) * 0.001f;
+      }
+      return true;
+
+    case UBX_NAV_VELNED: // NEO-6M: ground speed and course
+      if (frame.length() < 36) return false;
+      if (fix.fixType >= 2) {
+        fix.speed.valid = true;
+        fix.speed.value = ubxU32(p + 20) * 0.036f; // cm/s to km/h
+        fix.course.valid = true;
+        fix.course.value = ubxI32(p + 24) * 1e-5f;
+      }
+      return true;
+
+    case UBX_NAV_TIMEUTC: // NEO-6M: UTC date and time
+      if (frame.length() < 20) return false;
+      if (p[19] & 0x04) {
+        fix.date.valid = true;
+        fix.date.y = ubxU16(p + 12);
+        fix.date.mo = p[14];
+        fix.date.d = p[15];
+        fix.time.valid = true;
+        fix.time.h = p[16];
+        fix.time.m = p[17];
+        fix.time.s = p[18];
+      }
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,179 @@
+#include "waypoint_db.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+using std::max;
+using std::min;
+
+#define RAD_PER_UNIT 1.745329252e-9f // Per 1e-7 degree
+#define MAX_ABS_LAT_UNITS (89L * NAV_COORD_SCALE)
+
+static AssetImage image;
+static const WaypointDbHeader *header = nullptr;
+static AssetArray<uint32_t> cellStart;
+static AssetArray<WaypointRecord> records;
+static AssetStrings names;
+static int32_t gridMaxAbsLat = 0; // Furthest grid edge from the equator, 1e-7 degrees
+
+static int32_t floorDiv(int64_t a, int32_t b) {
+  int64_t q = a / b;
+  if ((a % b != 0) && (a < 0)) q--;
+  return (int32_t)max<int64_t>(INT32_MIN / 2, min<int64_t>(INT32_MAX / 2, q));
+}
+
+bool waypointDbBegin() {
+  waypointDbEnd();
+  static const char *const slots[ASSET_SLOTS] = {WAYPOINT_DB_PARTITION, WAYPOINT_DB_PARTITION_B};
+  if (!assetOpenSlots(slots, ASSET_SUBTYPE_WAYPOINTS, WAYPOINT_DB_MAGIC, WAYPOINT_DB_VERSION, image)) {
+    return false;
+  }
+
+  // The views are bounds-checked; on top of that the cell table must be a
+  // monotonic index into the records so queries never step outside them
+  const WaypointDbHeader *h = assetHeader<WaypointDbHeader>(image);
+  bool ok = h && h->cols > 0 && h->rows > 0 && h->cellSize > 0 &&
+            assetArray(image, h->cellsOffset, (uint32_t)h->cols * h->rows + 1, cellStart) &&
+            assetArray(image, h->recordsOffset, h->count, records) &&
+            assetStrings(image, h->namesOffset, h->namesSize, names) &&
+            cellStart[0] == 0 && cellStart[cellStart.count - 1] == h->count;
+  for (uint32_t i = 0; ok && i + 1 < cellStart.count; i++) {
+    ok = cellStart[i] <= cellStart[i + 1];
+  }
+  if (!ok) {
+    assetClose(image);
+    return false;
+  }
+
+  header = h;
+  int64_t northEdge = (int64_t)h->originLat + (int64_t)h->rows * h->cellSize;
+  gridMaxAbsLat = (int32_t)min<int64_t>(MAX_ABS_LAT_UNITS, max<int64_t>(llabs(h->originLat), llabs(northEdge)));
+  return true;
+}
+
+void waypointDbEnd() {
+  header = nullptr;
+  cellStart = {};
+  records = {};
+  names = {};
+  assetClose(image);
+}
+
+const AssetImage &waypointDbImage() {
+  return image;
+}
+
+uint32_t waypointDbCount() {
+  return header ? header->count : 0;
+}
+
+const WaypointRecord *waypointDbRecord(uint32_t index) {
+  return header ? records.at(index) : nullptr;
+}
+
+const char *waypointDbName(const WaypointRecord &record) {
+  return names.at(record.nameOffset);
+}
+
+// Keep hits sorted by distance, dropping the furthest once it is full
+static void insertHit(WaypointHit *hits, uint16_t &found, uint16_t maxHits, uint32_t index, float meters) {
+  if (found == maxHits && meters >= hits[found - 1].distanceMeters) {
+    return;
+  }
+  uint16_t i = found < maxHits ? found++ : found - 1;
+  while (i > 0 && hits[i - 1].distanceMeters > meters) {
+    hits[i] = hits[i - 1];
+    i--;
+  }
+  hits[i].index = index;
+  hits[i].distanceMeters = meters;
+}
+
+static void searchCell(uint32_t cell, const NavOrigin &origin, float maxMeters, uint8_t typeMask,
+                       WaypointHit *hits, uint16_t &found, uint16_t maxHits) {
+  for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+    const WaypointRecord &record = records[i];
+    if (!(record.flags & WAYPOINT_FLAG_ENABLED) || record.type > 7 || !((typeMask >> record.type) & 1)) {
+      continue;
+    }
+    float meters = navDistanceMeters(origin, record.point);
+    if (meters <= maxMeters) {
+      insertHit(hits, found, maxHits, i, meters);
+    }
+  }
+}
+
+static uint16_t search(const NavPoint &at, float maxMeters, uint8_t typeMask, WaypointHit *hits, uint16_t maxHits) {
+  if (!header || maxHits == 0) {
+    return 0;
+  }
+  const int32_t cols = header->cols;
+  const int32_t rows = header->rows;
+  NavOrigin origin = navOrigin(at);
+
+  // Cell of the query point, which may lie outside the grid
+  int32_t col = floorDiv((int64_t)at.lon - header->originLon, header->cellSize);
+  int32_t row = floorDiv((int64_t)at.lat - header->originLat, header->cellSize);
+
+  // Anything in ring k is at least k - 1 cell edges away in latitude or in
+  // longitude. A longitude gap is shortest at the latitude furthest from the
+  // equator, and on a sphere: sin(d / 2) >= cos(maxLat) * sin(gap / 2). Going
+  // the other way round, the far side of the grid is never more than
+  // wrapRad of longitude away, whatever its column.
+  int32_t maxAbsLat = min<int32_t>(MAX_ABS_LAT_UNITS, max<int32_t>(gridMaxAbsLat, abs(at.lat)));
+  float cosMaxLat = cosf(maxAbsLat * RAD_PER_UNIT);
+  float cellRad = header->cellSize * RAD_PER_UNIT;
+  int64_t eastEdge = (int64_t)header->originLon + (int64_t)cols * header->cellSize;
+  int64_t lonSpan = max<int64_t>(llabs((int64_t)at.lon - header->originLon), llabs((int64_t)at.lon - eastEdge));
+  float wrapRad = max(0.0f, 2.0f * (float)M_PI - lonSpan * RAD_PER_UNIT);
+
+  // Rings before this one are all outside the grid
+  int32_t firstRing = max(max(0, max(-col, col - (cols - 1))), max(-row, row - (rows - 1)));
+
+  uint16_t found = 0;
+  for (int32_t ring = firstRing;; ring++) {
+    float nearest = 0.0f;
+    if (ring > 0) {
+      float gap = min((ring - 1) * cellRad, (float)M_PI);
+      nearest = NAV_EARTH_RADIUS_M * min(gap, 2.0f * asinf(cosMaxLat * sinf(min(gap, wrapRad) / 2)));
+    }
+    if (nearest > maxMeters || (found == maxHits && nearest >= hits[found - 1].distanceMeters)) {
+      break;
+    }
+
+    int32_t rowFirst = max(row - ring, 0);
+    int32_t rowLast = min(row + ring, rows - 1);
+    int32_t colFirst = max(col - ring, 0);
+    int32_t colLast = min(col + ring, cols - 1);
+    for (int32_t r = rowFirst; r <= rowLast; r++) {
+      if (r == row - ring || r == row + ring) {
+        for (int32_t c = colFirst; c <= colLast; c++) {
+          searchCell((uint32_t)r * cols + c, origin, maxMeters, typeMask, hits, found, maxHits);
+        }
+      } else {
+        // Only the left and right edges of the ring
+        if (col - ring >= 0) {
+          searchCell((uint32_t)r * cols + col - ring, origin, maxMeters, typeMask, hits, found, maxHits);
+        }
+        if (col + ring < cols) {
+          searchCell((uint32_t)r * cols + col + ring, origin, maxMeters, typeMask, hits, found, maxHits);
+        }
+      }
+    }
+
+    if (row - ring <= 0 && row + ring >= rows - 1 && col - ring <= 0 && col + ring >= cols - 1) {
+      break; // The whole grid has been visited
+    }
+  }
+  return found;
+}
+
+uint16_t waypointDbNearest(const NavPoint &at, uint8_t typeMask, WaypointHit *hits, uint16_t maxHits) {
+  return search(at, INFINITY, typeMask, hits, maxHits);
+}
+
+uint16_t waypointDbWithin(const NavPoint &at, float radiusMeters, uint8_t typeMask,
+                          WaypointHit *hits, uint16_t maxHits) {
+  return search(at, radiusMeters, typeMask, hits, maxHits);
+}
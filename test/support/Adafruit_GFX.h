@@ -0,0 +1,204 @@
+#pragma once
+
+// Host stand-in for the Adafruit GFX canvas that the dial art draws into.
+// Lines, rectangles and circles use the library's own algorithms, so frames
+// come out pixel for pixel as on the device. Text has no font: each glyph is
+// a 5x7 pattern made up from the character code, wide and tall enough to
+// dirty the same cells as the real one.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+class Adafruit_GFX {
+  public:
+    Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h) {}
+    virtual ~Adafruit_GFX() {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+      for (int16_t i = 0; i < h; i++) drawPixel(x, y + i, color);
+    }
+
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+      for (int16_t i = 0; i < w; i++) drawPixel(x + i, y, color);
+    }
+
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+      for (int16_t i = x; i < x + w; i++) drawFastVLine(i, y, h, color);
+    }
+
+    virtual void fillScreen(uint16_t color) { fillRect(0, 0, WIDTH, HEIGHT, color); }
+    virtual void setRotation(uint8_t r) { rotation = r; }
+
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+      if (x0 == x1) {
+        if (y0 > y1) std::swap(y0, y1);
+        drawFastVLine(x0, y0, y1 - y0 + 1, color);
+        return;
+      }
+      if (y0 == y1) {
+        if (x0 > x1) std::swap(x0, x1);
+        drawFastHLine(x0, y0, x1 - x0 + 1, color);
+        return;
+      }
+      bool steep = abs(y1 - y0) > abs(x1 - x0);
+      if (steep) {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+      }
+      if (x0 > x1) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+      }
+      int16_t dx = x1 - x0;
+      int16_t dy = abs(y1 - y0);
+      int16_t err = dx / 2;
+      int16_t ystep = y0 < y1 ? 1 : -1;
+      for (; x0 <= x1; x0++) {
+        if (steep) {
+          drawPixel(y0, x0, color);
+        } else {
+          drawPixel(x0, y0, color);
+        }
+        err -= dy;
+        if (err < 0) {
+          y0 += ystep;
+          err += dx;
+        }
+      }
+    }
+
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+      drawFastHLine(x, y, w, color);
+      drawFastHLine(x, y + h - 1, w, color);
+      drawFastVLine(x, y, h, color);
+      drawFastVLine(x + w - 1, y, h, color);
+    }
+
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+      int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+      drawPixel(x0, y0 + r, color);
+      drawPixel(x0, y0 - r, color);
+      drawPixel(x0 + r, y0, color);
+      drawPixel(x0 - r, y0, color);
+      while (x < y) {
+        if (f >= 0) {
+          y--;
+          ddF_y += 2;
+          f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        drawPixel(x0 + x, y0 + y, color);
+        drawPixel(x0 - x, y0 + y, color);
+        drawPixel(x0 + x, y0 - y, color);
+        drawPixel(x0 - x, y0 - y, color);
+        drawPixel(x0 + y, y0 + x, color);
+        drawPixel(x0 - y, y0 + x, color);
+        drawPixel(x0 + y, y0 - x, color);
+        drawPixel(x0 - y, y0 - x, color);
+      }
+    }
+
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+      drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+      int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r, px = x, py = y;
+      while (x < y) {
+        if (f >= 0) {
+          y--;
+          ddF_y += 2;
+          f += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f += ddF_x;
+        if (x < y + 1) {
+          drawFastVLine(x0 + x, y0 - y, 2 * y + 1, color);
+          drawFastVLine(x0 - x, y0 - y, 2 * y + 1, color);
+        }
+        if (y != py) {
+          drawFastVLine(x0 + py, y0 - px, 2 * px + 1, color);
+          drawFastVLine(x0 - py, y0 - px, 2 * px + 1, color);
+          py = y;
+        }
+        px = x;
+      }
+    }
+
+    void setCursor(int16_t x, int16_t y) {
+      cursor_x = x;
+      cursor_y = y;
+    }
+
+    void setTextColor(uint16_t color) { textcolor = color; }
+    void setTextSize(uint8_t size) { textsize = size ? size : 1; }
+
+    size_t write(uint8_t c) {
+      if (c == '\n') {
+        cursor_x = 0;
+        cursor_y += textsize * 8;
+        return 1;
+      }
+      for (int8_t col = 0; c != ' ' && col < 5; col++) {
+        uint8_t bits = (uint8_t)((c * 37 + col * 101) ^ (c >> 1)) & 0x7F;
+        for (int8_t row = 0; row < 7; row++) {
+          if (!(bits & (1 << row))) continue;
+          fillRect(cursor_x + col * textsize, cursor_y + row * textsize, textsize, textsize, textcolor);
+        }
+      }
+      cursor_x += textsize * 6;
+      return 1;
+    }
+
+    size_t print(const char *text) {
+      size_t n = 0;
+      while (*text) n += write((uint8_t)*text++);
+      return n;
+    }
+
+    int16_t width() const { return WIDTH; }
+    int16_t height() const { return HEIGHT; }
+
+  protected:
+    int16_t WIDTH, HEIGHT;
+    int16_t cursor_x = 0, cursor_y = 0;
+    uint16_t textcolor = 0xFFFF;
+    uint8_t textsize = 1;
+    uint8_t rotation = 0;
+};
+
+// 1bpp, rows padded to whole bytes, most significant bit first, set = white
+class GFXcanvas1 : public Adafruit_GFX {
+  public:
+    GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {
+      buffer = (uint8_t *)calloc((size_t)((w + 7) / 8) * h, 1);
+    }
+    ~GFXcanvas1() { free(buffer); }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+      if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return;
+      uint8_t *ptr = &buffer[(x / 8) + y * ((WIDTH + 7) / 8)];
+      if (color) {
+        *ptr |= 0x80 >> (x & 7);
+      } else {
+        *ptr &= ~(0x80 >> (x & 7));
+      }
+    }
+
+    void fillScreen(uint16_t color) override {
+      memset(buffer, color ? 0xFF : 0x00, (size_t)((WIDTH + 7) / 8) * HEIGHT);
+    }
+
+    bool getPixel(int16_t x, int16_t y) const {
+      if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return false;
+      return buffer[(x / 8) + y * ((WIDTH + 7) / 8)] & (0x80 >> (x & 7));
+    }
+
+    uint8_t *getBuffer() const { return buffer; }
+
+  private:
+    uint8_t *buffer;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+// Host stand-in for the little of the Arduino core that the modules built by
+// [env:native] use. millis() is a clock the tests set and advance, so delays
+// and timeouts run instantly; micros() is real time, for the benchmarks.
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define TWO_PI 6.283185307179586476925286766559
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * 57.295779513082320876798154814105)
+#define sq(x) ((x) * (x))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline unsigned long testMillis = 0;
+
+inline unsigned long millis() {
+  return testMillis;
+}
+
+inline void testAdvanceMillis(unsigned long ms) {
+  testMillis += ms;
+}
+
+inline unsigned long micros() {
+  using namespace std::chrono;
+  return (unsigned long)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Host stand-in for the ESP32 EEPROM library: a RAM copy that begin() loads
+// from "flash" and commit() writes back. Tests can edit flash directly, e.g.
+// to plant an older record layout, and see what a reboot would find.
+#include <Arduino.h>
+
+#define TEST_EEPROM_FLASH_SIZE 4096
+
+class EEPROMClass {
+  public:
+    uint8_t flash[TEST_EEPROM_FLASH_SIZE];
+    uint8_t ram[TEST_EEPROM_FLASH_SIZE];
+    size_t size = 0;
+    uint32_t commits = 0;
+
+    EEPROMClass() { erase(); }
+
+    // Blank flash, as on a new device
+    void erase() {
+      memset(flash, 0xFF, sizeof(flash));
+      memset(ram, 0xFF, sizeof(ram));
+    }
+
+    bool begin(size_t bytes) {
+      size = min(bytes, sizeof(flash));
+      memcpy(ram, flash, size);
+      return true;
+    }
+
+    bool commit() {
+      memcpy(flash, ram, size);
+      commits++;
+      return true;
+    }
+
+    template <typename T>
+    T &get(int address, T &value) {
+      memcpy(&value, ram + address, sizeof(T));
+      return value;
+    }
+
+    template <typename T>
+    const T &put(int address, const T &value) {
+      memcpy(ram + address, &value, sizeof(T));
+      return value;
+    }
+};
+
+inline EEPROMClass EEPROM;
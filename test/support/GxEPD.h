@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for the GxEPD panel interface. Tests implement it to count
+// what EpdFrame pushes instead of driving a display.
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+class GxEPD : public Adafruit_GFX {
+  public:
+    GxEPD(int16_t w, int16_t h) : Adafruit_GFX(w, h) {}
+    virtual void init(uint32_t serial_diag_bitrate = 0) = 0;
+    virtual void update() = 0;
+    virtual void updateWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h, bool using_rotation = true) = 0;
+    virtual void powerDown() = 0;
+};
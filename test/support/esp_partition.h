@@ -0,0 +1,92 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF partition API, with partitions in RAM that
+// the tests create. Writes behave like NOR flash: they can only clear bits,
+// so writing over data that wasn't erased first shows up as corruption.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0, ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+
+#define TEST_PARTITIONS 4
+#define TEST_SECTOR_SIZE 4096
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+inline esp_partition_t testPartitions[TEST_PARTITIONS];
+inline std::vector<uint8_t> testPartitionData[TEST_PARTITIONS];
+inline uint8_t testPartitionCount = 0;
+
+// Erased partition of size bytes, a multiple of the sector size
+inline const esp_partition_t *testPartitionAdd(const char *label, uint8_t subtype, uint32_t size) {
+  esp_partition_t &partition = testPartitions[testPartitionCount];
+  partition = {ESP_PARTITION_TYPE_DATA, subtype, 0, size, {}};
+  strncpy(partition.label, label, sizeof(partition.label) - 1);
+  testPartitionData[testPartitionCount].assign(size, 0xFF);
+  return &testPartitions[testPartitionCount++];
+}
+
+inline void testPartitionsClear() {
+  testPartitionCount = 0;
+}
+
+inline std::vector<uint8_t> &testPartitionBytes(const esp_partition_t *partition) {
+  return testPartitionData[partition - testPartitions];
+}
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                        const char *label) {
+  for (uint8_t i = 0; i < testPartitionCount; i++) {
+    const esp_partition_t &partition = testPartitions[i];
+    if (partition.type == type && partition.subtype == subtype && (!label || strcmp(partition.label, label) == 0)) {
+      return &partition;
+    }
+  }
+  return nullptr;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *data, size_t length) {
+  if (offset + length > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memcpy(data, testPartitionBytes(partition).data() + offset, length);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *data,
+                                     size_t length) {
+  if (offset + length > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  uint8_t *flash = testPartitionBytes(partition).data() + offset;
+  for (size_t i = 0; i < length; i++) {
+    flash[i] &= ((const uint8_t *)data)[i];
+  }
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t length) {
+  if (offset % TEST_SECTOR_SIZE || length % TEST_SECTOR_SIZE) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (offset + length > partition->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  memset(testPartitionBytes(partition).data() + offset, 0xFF, length);
+  return ESP_OK;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Host stand-in: RTC memory is ordinary memory, there is no deep sleep to survive
+#define RTC_DATA_ATTR
@@ -0,0 +1,351 @@
+#include <filesystem>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "airspace.h"
+#include "crc32.h"
+
+#define METERS_PER_UNIT (NAV_EARTH_RADIUS_M * 1.745329252e-9) // Along a meridian, per 1e-7 degree
+#define MARGIN_M 1000
+
+// One area as tools/airspace.py would compile it
+struct TestArea {
+  std::vector<NavPoint> points; // A circle has one, its centre
+  uint32_t radiusMeters;        // Circles only
+  uint8_t flags;
+  int16_t floorMeters;
+  int16_t ceilingMeters;
+};
+
+static std::string directory;
+
+static NavPoint offset(const NavPoint &from, double eastMeters, double northMeters) {
+  double latUnits = northMeters / METERS_PER_UNIT;
+  double lonUnits = eastMeters / (METERS_PER_UNIT * cos(from.lat * 1.745329252e-9));
+  return {(int32_t)lround(from.lat + latUnits), (int32_t)lround(from.lon + lonUnits)};
+}
+
+static TestArea polygon(const NavPoint &centre, double radiusMeters, int sides, int16_t floor, int16_t ceiling) {
+  TestArea area = {{}, 0, 0, floor, ceiling};
+  for (int i = 0; i < sides; i++) {
+    double angle = 2 * M_PI * i / sides + M_PI / sides;
+    area.points.push_back(offset(centre, radiusMeters * sin(angle), radiusMeters * cos(angle)));
+  }
+  return area;
+}
+
+static TestArea square(const NavPoint &centre, double halfSideMeters, int16_t floor, int16_t ceiling) {
+  TestArea area = {{}, 0, 0, floor, ceiling};
+  area.points.push_back(offset(centre, -halfSideMeters, -halfSideMeters));
+  area.points.push_back(offset(centre, -halfSideMeters, halfSideMeters));
+  area.points.push_back(offset(centre, halfSideMeters, halfSideMeters));
+  area.points.push_back(offset(centre, halfSideMeters, -halfSideMeters));
+  return area;
+}
+
+static TestArea circle(const NavPoint &centre, uint32_t radiusMeters, int16_t floor, int16_t ceiling) {
+  return {{centre}, radiusMeters, AIRSPACE_FLAG_CIRCLE, floor, ceiling};
+}
+
+template <typename T>
+static void append(std::vector<uint8_t> &image, const T &value) {
+  image.insert(image.end(), (const uint8_t *)&value, (const uint8_t *)&value + sizeof(T));
+}
+
+static void pad(std::vector<uint8_t> &image) {
+  while (image.size() % 4) image.push_back(0);
+}
+
+// Lay the areas out like the compiler does and write the image as the airspace partition
+static bool store(const std::vector<TestArea> &list, double cellDegrees) {
+  std::vector<AirspaceArea> records;
+  std::vector<NavPoint> vertices;
+  std::string names;
+  for (size_t i = 0; i < list.size(); i++) {
+    const TestArea &a = list[i];
+    AirspaceArea record = {};
+    record.minLat = record.minLon = INT32_MAX;
+    record.maxLat = record.maxLon = INT32_MIN;
+    std::vector<NavPoint> extent = a.points;
+    if (a.flags & AIRSPACE_FLAG_CIRCLE) {
+      extent = {offset(a.points[0], -1.0 * a.radiusMeters, -1.0 * a.radiusMeters),
+                offset(a.points[0], a.radiusMeters, a.radiusMeters)};
+    }
+    for (const NavPoint &p : extent) {
+      record.minLat = std::min(record.minLat, p.lat);
+      record.minLon = std::min(record.minLon, p.lon);
+      record.maxLat = std::max(record.maxLat, p.lat);
+      record.maxLon = std::max(record.maxLon, p.lon);
+    }
+    record.firstVertex = vertices.size();
+    record.vertexCount = a.points.size();
+    record.airspaceClass = 'C';
+    record.flags = a.flags;
+    record.floorMeters = a.floorMeters;
+    record.ceilingMeters = a.ceilingMeters;
+    record.radiusMeters = a.radiusMeters;
+    record.nameOffset = names.size();
+    names += "Area " + std::to_string(i) + '\0';
+    vertices.insert(vertices.end(), a.points.begin(), a.points.end());
+    records.push_back(record);
+  }
+
+  double marginLat = MARGIN_M / METERS_PER_UNIT;
+  int32_t minLat = INT32_MAX, minLon = INT32_MAX, maxLat = INT32_MIN, maxLon = INT32_MIN;
+  for (const AirspaceArea &r : records) {
+    minLat = std::min(minLat, r.minLat);
+    minLon = std::min(minLon, r.minLon);
+    maxLat = std::max(maxLat, r.maxLat);
+    maxLon = std::max(maxLon, r.maxLon);
+  }
+  double widest = cos(std::max(fabs((double)minLat), fabs((double)maxLat)) * 1.745329252e-9);
+  double marginLon = marginLat / std::max(widest, 0.01);
+  int32_t originLat = (int32_t)floor(minLat - marginLat), originLon = (int32_t)floor(minLon - marginLon);
+  int32_t cell = (int32_t)lround(cellDegrees * NAV_COORD_SCALE);
+  uint16_t cols = (uint16_t)((maxLon + marginLon - originLon) / cell) + 1;
+  uint16_t rows = (uint16_t)((maxLat + marginLat - originLat) / cell) + 1;
+  std::vector<std::vector<uint16_t>> cells(cols * rows);
+  for (size_t i = 0; i < records.size(); i++) {
+    const AirspaceArea &r = records[i];
+    int row0 = std::max(0, (int)floor((r.minLat - marginLat - originLat) / cell));
+    int row1 = std::min(rows - 1, (int)floor((r.maxLat + marginLat - originLat) / cell));
+    int col0 = std::max(0, (int)floor((r.minLon - marginLon - originLon) / cell));
+    int col1 = std::min(cols - 1, (int)floor((r.maxLon + marginLon - originLon) / cell));
+    for (int row = row0; row <= row1; row++) {
+      for (int col = col0; col <= col1; col++) cells[row * cols + col].push_back(i);
+    }
+  }
+
+  AirspaceHeader header = {};
+  std::vector<uint8_t> image(sizeof(header));
+  header.areasOffset = image.size();
+  for (const AirspaceArea &r : records) append(image, r);
+  pad(image);
+  header.verticesOffset = image.size();
+  for (const NavPoint &p : vertices) append(image, p);
+  header.cellsOffset = image.size();
+  uint32_t start = 0;
+  std::vector<uint16_t> cellList;
+  append(image, start);
+  for (const std::vector<uint16_t> &c : cells) {
+    cellList.insert(cellList.end(), c.begin(), c.end());
+    append(image, (uint32_t)cellList.size());
+  }
+  header.cellListOffset = image.size();
+  for (uint16_t index : cellList) append(image, index);
+  pad(image);
+  header.namesOffset = image.size();
+  image.insert(image.end(), names.begin(), names.end());
+
+  header.asset = {AIRSPACE_MAGIC, AIRSPACE_VERSION, sizeof(AirspaceHeader), (uint32_t)image.size(), 0};
+  header.asset.crc = crc32Update(0, image.data() + sizeof(header), image.size() - sizeof(header));
+  header.areaCount = records.size();
+  header.vertexCount = vertices.size();
+  header.originLat = originLat;
+  header.originLon = originLon;
+  header.cellSize = cell;
+  header.cols = cols;
+  header.rows = rows;
+  header.marginMeters = MARGIN_M;
+  header.cellListCount = cellList.size();
+  header.namesSize = names.size();
+  memcpy(image.data(), &header, sizeof(header));
+
+  FILE *file = fopen((directory + "/" AIRSPACE_PARTITION ".bin").c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  fwrite(image.data(), 1, image.size(), file);
+  fclose(file);
+  return airspaceBegin();
+}
+
+static void install(const std::vector<TestArea> &list, double cellDegrees) {
+  TEST_ASSERT_TRUE(store(list, cellDegrees));
+  TEST_ASSERT_EQUAL(list.size(), airspaceCount());
+}
+
+static GpsFix fixAt(const NavPoint &point, float altitude) {
+  GpsFix fix = {};
+  fix.location.valid = true;
+  fix.location.point = point;
+  fix.altitude.valid = !isnan(altitude);
+  fix.altitude.value = altitude;
+  return fix;
+}
+
+// Evaluate until a whole pass over the cell has run at this position
+static AirspaceStatus settle(const GpsFix &fix, float ground) {
+  AirspaceStatus status = {};
+  for (int passes = 0; passes < 2;) {
+    uint32_t deferred = airspaceStats().deferredPasses;
+    status = airspaceEvaluate(fix, ground);
+    TEST_ASSERT_LESS_OR_EQUAL(AIRSPACE_VERTEX_BUDGET, airspaceStats().lastVertices);
+    if (airspaceStats().deferredPasses == deferred) passes++;
+  }
+  return status;
+}
+
+static const NavPoint centre = navPointFromDegrees(46.0, 8.0);
+
+void setUp(void) {
+  std::string path = (std::filesystem::temp_directory_path() / "airspace_XXXXXX").string();
+  directory = mkdtemp(&path[0]);
+  assetSetHostDirectory(directory.c_str());
+}
+
+void tearDown(void) {
+  std::filesystem::remove_all(directory);
+}
+
+void test_polygon_levels(void) {
+  install({square(centre, 5000, 1000, 3000)}, 0.25);
+
+  AirspaceStatus status = settle(fixAt(centre, 2000), NAN);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, status.level);
+  TEST_ASSERT_EQUAL(0, status.area);
+  TEST_ASSERT_EQUAL_FLOAT(0, status.horizontalMeters);
+  TEST_ASSERT_EQUAL_FLOAT(0, status.verticalMeters);
+  TEST_ASSERT_EQUAL_STRING("Area 0", airspaceName(status.area));
+
+  status = settle(fixAt(centre, 3050), NAN);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NEAR, status.level);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, 50, status.verticalMeters);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, settle(fixAt(centre, 3200), NAN).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NEAR, settle(fixAt(centre, 950), NAN).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, settle(fixAt(centre, 800), NAN).level);
+
+  status = settle(fixAt(offset(centre, 5500, 1000), 2000), NAN);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NEAR, status.level);
+  TEST_ASSERT_FLOAT_WITHIN(5, 500, status.horizontalMeters);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, settle(fixAt(offset(centre, 7000, 0), 2000), NAN).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, settle(fixAt(navPointFromDegrees(40, 0), 2000), NAN).level);
+
+  // Without an altitude, assume we are between floor and ceiling
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, settle(fixAt(centre, NAN), NAN).level);
+}
+
+void test_circle_and_ground_relative_limits(void) {
+  TestArea agl = circle(centre, 3000, 500, 2500);
+  agl.flags |= AIRSPACE_FLAG_FLOOR_AGL;
+  install({agl}, 0.25);
+
+  NavPoint inside = offset(centre, 2000, 0);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, settle(fixAt(inside, 1600), 1000).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NEAR, settle(fixAt(inside, 1420), 1000).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, settle(fixAt(inside, 1200), 1000).level);
+  // Unknown ground: the floor is taken above sea level
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, settle(fixAt(inside, 1200), NAN).level);
+
+  AirspaceStatus status = settle(fixAt(offset(centre, 0, 3400), 1600), 1000);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NEAR, status.level);
+  TEST_ASSERT_FLOAT_WITHIN(5, 400, status.horizontalMeters);
+}
+
+void test_worsening_is_raised_at_once(void) {
+  std::vector<TestArea> list;
+  for (int i = 0; i < 250; i++) list.push_back(polygon(centre, 8000, 100, 0, 100));
+  list.push_back(square(centre, 5000, 1000, 3000));
+  install(list, 1.0);
+
+  // One cell with far more vertices than one evaluation may test, in areas
+  // that don't divide the budget: the one that doesn't fit waits
+  settle(fixAt(centre, 5000), NAN);
+  uint32_t deferred = airspaceStats().deferredPasses;
+  airspaceEvaluate(fixAt(centre, 2000), NAN);
+  TEST_ASSERT_GREATER_THAN(deferred, airspaceStats().deferredPasses);
+  TEST_ASSERT_EQUAL(AIRSPACE_VERTEX_BUDGET / 100 * 100, airspaceStats().lastVertices);
+  AirspaceStatus status = settle(fixAt(centre, 2000), NAN);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, status.level);
+  TEST_ASSERT_EQUAL(250, status.area);
+
+  // Leaving eases only after a whole pass
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, airspaceEvaluate(fixAt(centre, 5000), NAN).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, settle(fixAt(centre, 5000), NAN).level);
+}
+
+// Brute-force crossing test in double over every area
+static bool insideAny(const std::vector<TestArea> &list, const NavPoint &at, float altitude) {
+  double xScale = cos(at.lat * 1.745329252e-9);
+  for (const TestArea &a : list) {
+    if (altitude < a.floorMeters || altitude > a.ceilingMeters) continue;
+    bool inside = false;
+    for (size_t i = 0, j = a.points.size() - 1; i < a.points.size(); j = i++) {
+      double yi = a.points[i].lat - at.lat, yj = a.points[j].lat - at.lat;
+      double xi = (a.points[i].lon - at.lon) * xScale, xj = (a.points[j].lon - at.lon) * xScale;
+      if ((yi > 0) != (yj > 0) && xi + (xj - xi) * (-yi) / (yj - yi) > 0) inside = !inside;
+    }
+    if (inside) return true;
+  }
+  return false;
+}
+
+void test_dense_airspace_benchmark(void) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::vector<TestArea> list;
+  for (int i = 0; i < 1500; i++) {
+    NavPoint at = navPointFromDegrees(45 + 0.5 * unit(rng), 7 + 0.5 * unit(rng));
+    int16_t floor = (int16_t)(unit(rng) * 3000);
+    int16_t ceiling = floor + 200 + (int16_t)(unit(rng) * 3000);
+    list.push_back(polygon(at, 2000 + 8000 * unit(rng), 8 + rng() % 57, floor, ceiling));
+  }
+  install(list, 0.25);
+
+  int mismatches = 0, inside = 0;
+  uint32_t worstMicros = 0;
+  const int queries = 2000;
+  for (int q = 0; q < queries; q++) {
+    NavPoint at = navPointFromDegrees(45 + 0.5 * unit(rng), 7 + 0.5 * unit(rng));
+    float altitude = unit(rng) * 6000;
+    AirspaceStatus status = settle(fixAt(at, altitude), NAN);
+    worstMicros = std::max(worstMicros, airspaceStats().maxMicros);
+    bool expected = insideAny(list, at, altitude);
+    inside += expected;
+    mismatches += expected != (status.level == AIRSPACE_LEVEL_INSIDE);
+  }
+  char message[120];
+  snprintf(message, sizeof(message), "%d queries, %d inside, %d mismatches, worst evaluation %u us, %u deferred passes",
+           queries, inside, mismatches, (unsigned)worstMicros, (unsigned)airspaceStats().deferredPasses);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_GREATER_THAN(queries / 20, inside);
+  TEST_ASSERT_LESS_OR_EQUAL(queries / 1000, mismatches); // Float rounding right on an edge
+  TEST_ASSERT_GREATER_THAN(0, airspaceStats().deferredPasses);
+}
+
+// The compiler simplifies larger polygons; a store with one anyway isn't opened
+void test_area_over_the_budget_is_rejected(void) {
+  install({polygon(centre, 8000, AIRSPACE_VERTEX_BUDGET, 0, 3000), square(centre, 5000, 1000, 3000)}, 0.25);
+  // The whole budget goes to the big area; the square waits a fix
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_INSIDE, airspaceEvaluate(fixAt(centre, 2000), NAN).level);
+  TEST_ASSERT_EQUAL(AIRSPACE_VERTEX_BUDGET, airspaceStats().lastVertices);
+  airspaceEvaluate(fixAt(centre, 2000), NAN);
+  TEST_ASSERT_EQUAL(4, airspaceStats().lastVertices);
+
+  TEST_ASSERT_FALSE(store({polygon(centre, 8000, AIRSPACE_VERTEX_BUDGET + 1, 0, 3000)}, 0.25));
+  TEST_ASSERT_EQUAL(0, airspaceCount());
+}
+
+void test_corrupt_store_is_rejected(void) {
+  install({square(centre, 5000, 1000, 3000)}, 0.25);
+  std::string path = directory + "/" AIRSPACE_PARTITION ".bin";
+  FILE *file = fopen(path.c_str(), "r+b");
+  fseek(file, sizeof(AirspaceHeader) + 3, SEEK_SET);
+  fputc(0x5A, file);
+  fclose(file);
+  TEST_ASSERT_FALSE(airspaceBegin());
+  TEST_ASSERT_EQUAL(AIRSPACE_LEVEL_NONE, airspaceEvaluate(fixAt(centre, 2000), NAN).level);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_polygon_levels);
+  RUN_TEST(test_circle_and_ground_relative_limits);
+  RUN_TEST(test_worsening_is_raised_at_once);
+  RUN_TEST(test_dense_airspace_benchmark);
+  RUN_TEST(test_area_over_the_budget_is_rejected);
+  RUN_TEST(test_corrupt_store_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+#include <vector>
+#include "ble_commands.h"
+
+static bool push(const char *text) {
+  return bleCommandPush((const uint8_t *)text, strlen(text));
+}
+
+// Command number i, varying in length up to the longest accepted
+static size_t format(char *out, uint32_t i) {
+  int length = snprintf(out, BLE_COMMAND_MAX_LENGTH + 1, "POI:%u:", (unsigned)i);
+  size_t padding = i % (BLE_COMMAND_MAX_LENGTH - length + 1);
+  for (size_t j = 0; j < padding; j++) out[length + j] = 'a' + (i + j) % 26;
+  out[length + padding] = '\0';
+  return length + padding;
+}
+
+void setUp(void) {
+  char out[BLE_COMMAND_MAX_LENGTH + 1];
+  while (bleCommandPop(out)) {
+  }
+}
+
+void tearDown(void) {}
+
+void test_trims_line_endings(void) {
+  char out[BLE_COMMAND_MAX_LENGTH + 1];
+  TEST_ASSERT_FALSE(bleCommandPending());
+  TEST_ASSERT_FALSE(bleCommandPop(out));
+  TEST_ASSERT_TRUE(push("GET_DATA\r\n"));
+  TEST_ASSERT_TRUE(bleCommandPush((const uint8_t *)"MODE:1\0", 7));
+  TEST_ASSERT_TRUE(push(""));
+  TEST_ASSERT_TRUE(bleCommandPending());
+  TEST_ASSERT_TRUE(bleCommandPop(out));
+  TEST_ASSERT_EQUAL_STRING("GET_DATA", out);
+  TEST_ASSERT_TRUE(bleCommandPop(out));
+  TEST_ASSERT_EQUAL_STRING("MODE:1", out);
+  TEST_ASSERT_TRUE(bleCommandPop(out));
+  TEST_ASSERT_EQUAL_STRING("", out);
+  TEST_ASSERT_FALSE(bleCommandPending());
+}
+
+void test_oversized_commands_are_dropped(void) {
+  char longest[BLE_COMMAND_MAX_LENGTH + 3];
+  memset(longest, 'x', sizeof(longest));
+  BleCommandStats before = bleCommandStats();
+  TEST_ASSERT_TRUE(bleCommandPush((const uint8_t *)longest, BLE_COMMAND_MAX_LENGTH));
+  TEST_ASSERT_FALSE(bleCommandPush((const uint8_t *)longest, BLE_COMMAND_MAX_LENGTH + 1));
+  memcpy(longest + BLE_COMMAND_MAX_LENGTH, "\r\n", 2);
+  TEST_ASSERT_TRUE(bleCommandPush((const uint8_t *)longest, BLE_COMMAND_MAX_LENGTH + 2));
+  TEST_ASSERT_EQUAL(before.oversized + 1, bleCommandStats().oversized);
+  TEST_ASSERT_EQUAL(before.received + 2, bleCommandStats().received);
+
+  char out[BLE_COMMAND_MAX_LENGTH + 1];
+  for (int i = 0; i < 2; i++) {
+    TEST_ASSERT_TRUE(bleCommandPop(out));
+    TEST_ASSERT_EQUAL(BLE_COMMAND_MAX_LENGTH, strlen(out));
+  }
+}
+
+void test_full_queue_refuses(void) {
+  BleCommandStats before = bleCommandStats();
+  char command[BLE_COMMAND_MAX_LENGTH + 1];
+  for (uint32_t i = 0; i < BLE_COMMAND_SLOTS; i++) {
+    TEST_ASSERT_TRUE(bleCommandPush((const uint8_t *)command, format(command, i)));
+  }
+  TEST_ASSERT_FALSE(push("FULL"));
+  TEST_ASSERT_EQUAL(before.dropped + 1, bleCommandStats().dropped);
+
+  char out[BLE_COMMAND_MAX_LENGTH + 1];
+  TEST_ASSERT_TRUE(bleCommandPop(out));
+  TEST_ASSERT_TRUE(push("ROOM"));
+  for (uint32_t i = 1; i < BLE_COMMAND_SLOTS; i++) {
+    TEST_ASSERT_TRUE(bleCommandPop(out));
+    format(command, i);
+    TEST_ASSERT_EQUAL_STRING(command, out);
+  }
+  TEST_ASSERT_TRUE(bleCommandPop(out));
+  TEST_ASSERT_EQUAL_STRING("ROOM", out);
+}
+
+// The BLE task writes as fast as it can while loop() drains. Every accepted
+// command comes out whole and in order; a refused one is counted, never lost
+// silently.
+static void flood(bool retry) {
+  const uint32_t count = 200000;
+  BleCommandStats before = bleCommandStats();
+  std::vector<uint8_t> accepted(count);
+  std::atomic<bool> finished(false);
+  std::thread producer([&] {
+    char command[BLE_COMMAND_MAX_LENGTH + 1];
+    for (uint32_t i = 0; i < count; i++) {
+      size_t length = format(command, i);
+      while (!(accepted[i] = bleCommandPush((const uint8_t *)command, length)) && retry) {
+        std::this_thread::yield(); // Let loop() drain, even on a single CPU
+      }
+      if (i % 64 == 0) std::this_thread::yield();
+    }
+    finished.store(true, std::memory_order_release);
+  });
+
+  char out[BLE_COMMAND_MAX_LENGTH + 1];
+  char expected[BLE_COMMAND_MAX_LENGTH + 1];
+  uint32_t next = 0, received = 0, mismatches = 0;
+  bool done = false;
+  while (!done) {
+    done = finished.load(std::memory_order_acquire);
+    while (bleCommandPop(out)) {
+      unsigned number = 0;
+      sscanf(out, "POI:%u:", &number);
+      mismatches += number < next;
+      next = number;
+      format(expected, number);
+      mismatches += strcmp(expected, out) != 0;
+      next++;
+      received++;
+    }
+    std::this_thread::yield();
+  }
+  producer.join();
+
+  uint32_t acceptedCount = 0;
+  for (uint8_t a : accepted) acceptedCount += a;
+  BleCommandStats stats = bleCommandStats();
+  char message[120];
+  snprintf(message, sizeof(message), "%u written, %u accepted, %u pushes refused while full", (unsigned)count,
+           (unsigned)acceptedCount, (unsigned)(stats.dropped - before.dropped));
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(0, mismatches);
+  TEST_ASSERT_EQUAL(acceptedCount, received);
+  TEST_ASSERT_EQUAL(acceptedCount, stats.received - before.received);
+  if (retry) {
+    TEST_ASSERT_EQUAL(count, received);
+  } else {
+    TEST_ASSERT_EQUAL(count - acceptedCount, stats.dropped - before.dropped);
+  }
+}
+
+void test_flood_with_retries_loses_nothing(void) {
+  flood(true);
+}
+
+void test_flood_accounts_for_every_refusal(void) {
+  flood(false);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_trims_line_endings);
+  RUN_TEST(test_oversized_commands_are_dropped);
+  RUN_TEST(test_full_queue_refuses);
+  RUN_TEST(test_flood_with_retries_loses_nothing);
+  RUN_TEST(test_flood_accounts_for_every_refusal);
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include "ble_governor.h"
+
+#define STEP_MS 20 // loop() cadence
+
+static uint32_t now;
+static uint32_t linkRequests;
+static uint32_t advertiseRequests;
+
+// loop() passes for this long with the link in this state; returns the last action other than NONE
+static uint8_t run(uint32_t ms, bool connected, uint8_t demand) {
+  uint8_t last = BLE_GOVERNOR_NONE;
+  for (uint32_t end = now + ms; now < end; now += STEP_MS) {
+    uint8_t action = bleGovernorService(now, connected, demand);
+    if (action == BLE_GOVERNOR_LINK) linkRequests++;
+    if (action == BLE_GOVERNOR_ADVERTISE) advertiseRequests++;
+    if (action != BLE_GOVERNOR_NONE) last = action;
+  }
+  return last;
+}
+
+// Boots this long after power-on, as setup() does
+static void boot(uint32_t atMs) {
+  now = atMs;
+  linkRequests = 0;
+  advertiseRequests = 0;
+  bleGovernorSetAdvertisingFloor(0, now);
+  bleGovernorBegin(now);
+}
+
+void setUp(void) {
+  boot(700);
+}
+
+void tearDown(void) {}
+
+// A phone that connects right after boot gets the active profile, not bulk or
+// anything else nobody asked for, and is slowed down once the active hold passes
+void test_connection_right_after_boot(void) {
+  run(300, false, BLE_LINK_IDLE);
+  run(14000, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_RADIO_CONNECTED, bleGovernorState());
+  TEST_ASSERT_EQUAL(BLE_LINK_ACTIVE, bleGovernorLinkProfile());
+  TEST_ASSERT_EQUAL(0, linkRequests);
+
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_LINK, run(2000, true, BLE_LINK_IDLE));
+  TEST_ASSERT_EQUAL(BLE_LINK_IDLE, bleGovernorLinkProfile());
+  TEST_ASSERT_EQUAL(1, linkRequests);
+  BleLinkParams idle = bleGovernorLink();
+  TEST_ASSERT_EQUAL(4, idle.latency);
+}
+
+// The same right at millis() 0, where every demand time started out as "now"
+void test_connection_at_power_on(void) {
+  boot(0);
+  run(STEP_MS, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_LINK_ACTIVE, bleGovernorLinkProfile());
+  TEST_ASSERT_EQUAL(0, linkRequests);
+}
+
+// Faster at once, slower only after each hold time
+void test_bulk_upload_steps_down(void) {
+  run(1000, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_LINK, run(STEP_MS, true, BLE_LINK_BULK));
+  TEST_ASSERT_EQUAL(BLE_LINK_BULK, bleGovernorLinkProfile());
+  run(10000, true, BLE_LINK_BULK);
+  TEST_ASSERT_EQUAL(1, linkRequests);
+
+  run(2900, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_LINK_BULK, bleGovernorLinkProfile());
+  run(200, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_LINK_ACTIVE, bleGovernorLinkProfile());
+  run(11800, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_LINK_ACTIVE, bleGovernorLinkProfile());
+  run(200, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_LINK_IDLE, bleGovernorLinkProfile());
+  TEST_ASSERT_EQUAL(3, linkRequests);
+}
+
+// A reconnect soon after an upload was cut off starts over at the active profile
+void test_reconnect_forgets_the_last_connection(void) {
+  run(1000, true, BLE_LINK_BULK);
+  TEST_ASSERT_EQUAL(BLE_LINK_BULK, bleGovernorLinkProfile());
+  run(1000, false, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_RADIO_ADVERTISING, bleGovernorState());
+  linkRequests = 0;
+  run(STEP_MS, true, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(BLE_LINK_ACTIVE, bleGovernorLinkProfile());
+  TEST_ASSERT_EQUAL(0, linkRequests);
+}
+
+void test_advertising_steps_down_and_stops(void) {
+  TEST_ASSERT_EQUAL(BLE_RADIO_ADVERTISING, bleGovernorState());
+  TEST_ASSERT_EQUAL(32, bleGovernorAdvertising().minInterval);
+  run(30000, false, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(0, advertiseRequests);
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_ADVERTISE, run(STEP_MS, false, BLE_LINK_IDLE));
+  TEST_ASSERT_EQUAL(244, bleGovernorAdvertising().minInterval);
+  run(90000, false, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(1636, bleGovernorAdvertising().minInterval);
+  TEST_ASSERT_EQUAL(2, advertiseRequests);
+
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_RADIO_OFF, run(BLE_RADIO_TIMEOUT_MS - 120000, false, BLE_LINK_IDLE));
+  TEST_ASSERT_EQUAL(BLE_RADIO_OFF, bleGovernorState());
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_NONE, run(60000, false, BLE_LINK_IDLE));
+
+  // The button brings it back at the fast rate
+  uint32_t wakes = bleGovernorStats().wakes;
+  bleGovernorWake(now);
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_RADIO_ON, run(STEP_MS, false, BLE_LINK_IDLE));
+  TEST_ASSERT_EQUAL(BLE_RADIO_ADVERTISING, bleGovernorState());
+  TEST_ASSERT_EQUAL(32, bleGovernorAdvertising().minInterval);
+  TEST_ASSERT_EQUAL(wakes + 1, bleGovernorStats().wakes);
+}
+
+// A power profile that doesn't allow the fast phase advertises at the medium rate from the start
+void test_advertising_floor(void) {
+  bleGovernorSetAdvertisingFloor(200, now);
+  TEST_ASSERT_EQUAL(BLE_GOVERNOR_ADVERTISE, run(STEP_MS, false, BLE_LINK_IDLE));
+  TEST_ASSERT_EQUAL(244, bleGovernorAdvertising().minInterval);
+  run(60000, false, BLE_LINK_IDLE);
+  TEST_ASSERT_EQUAL(1, advertiseRequests);
+}
+
+// Every millisecond is charged to exactly one state
+void test_time_is_accounted(void) {
+  BleRadioStats before = bleGovernorStats();
+  run(20000, false, BLE_LINK_IDLE);
+  run(40000, true, BLE_LINK_IDLE);
+  run(400000, false, BLE_LINK_IDLE);
+  BleRadioStats after = bleGovernorStats();
+  uint32_t total = after.offMs - before.offMs;
+  for (int i = 0; i < BLE_ADVERTISING_PHASES; i++) total += after.advertisingMs[i] - before.advertisingMs[i];
+  for (int i = 0; i < BLE_LINK_PROFILES; i++) total += after.connectedMs[i] - before.connectedMs[i];
+  TEST_ASSERT_UINT32_WITHIN(STEP_MS, 460000, total);
+  TEST_ASSERT_UINT32_WITHIN(STEP_MS, 15000, after.connectedMs[BLE_LINK_ACTIVE] - before.connectedMs[BLE_LINK_ACTIVE]);
+  TEST_ASSERT_UINT32_WITHIN(STEP_MS, 25000, after.connectedMs[BLE_LINK_IDLE] - before.connectedMs[BLE_LINK_IDLE]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_connection_right_after_boot);
+  RUN_TEST(test_connection_at_power_on);
+  RUN_TEST(test_bulk_upload_steps_down);
+  RUN_TEST(test_reconnect_forgets_the_last_connection);
+  RUN_TEST(test_advertising_steps_down_and_stops);
+  RUN_TEST(test_advertising_floor);
+  RUN_TEST(test_time_is_accounted);
+  return UNITY_END();
+}
@@ -0,0 +1,329 @@
+#include <Arduino.h>
+#include <deque>
+#include <filesystem>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "bulk_transfer.h"
+#include "crc32.h"
+#include "waypoint_db.h"
+
+#define CHUNK 241
+
+typedef std::vector<uint8_t> Bytes;
+
+static std::string directory;
+static std::mt19937 rng;
+
+// A database of count random points as tools/waypoint_db.py lays it out, in one cell
+static Bytes database(uint32_t count) {
+  std::vector<WaypointRecord> records;
+  std::string names;
+  int32_t minLat = INT32_MAX, minLon = INT32_MAX, maxLat = INT32_MIN, maxLon = INT32_MIN;
+  for (uint32_t i = 0; i < count; i++) {
+    WaypointRecord record = {};
+    record.point = {(int32_t)(460000000 + rng() % 10000000), (int32_t)(70000000 + rng() % 10000000)};
+    record.nameOffset = names.size();
+    record.type = i % 3;
+    record.flags = WAYPOINT_FLAG_ENABLED;
+    record.elevation = (int16_t)(rng() % 3000);
+    names += "WP" + std::to_string(i) + '\0';
+    minLat = std::min(minLat, record.point.lat);
+    minLon = std::min(minLon, record.point.lon);
+    maxLat = std::max(maxLat, record.point.lat);
+    maxLon = std::max(maxLon, record.point.lon);
+    records.push_back(record);
+  }
+
+  WaypointDbHeader header = {};
+  header.count = count;
+  header.originLat = minLat;
+  header.originLon = minLon;
+  header.cellSize = std::max(maxLat - minLat, maxLon - minLon) + 1;
+  header.cols = 1;
+  header.rows = 1;
+  header.cellsOffset = sizeof(header);
+  header.recordsOffset = header.cellsOffset + 2 * sizeof(uint32_t);
+  header.namesOffset = header.recordsOffset + count * sizeof(WaypointRecord);
+  header.namesSize = names.size();
+  Bytes image(sizeof(header));
+  const uint32_t cells[2] = {0, count};
+  image.insert(image.end(), (const uint8_t *)cells, (const uint8_t *)(cells + 2));
+  image.insert(image.end(), (const uint8_t *)records.data(), (const uint8_t *)(records.data() + count));
+  image.insert(image.end(), names.begin(), names.end());
+  header.asset = {WAYPOINT_DB_MAGIC, WAYPOINT_DB_VERSION, sizeof(header), (uint32_t)image.size(), 0};
+  header.asset.crc = crc32Update(0, image.data() + sizeof(header), image.size() - sizeof(header));
+  memcpy(image.data(), &header, sizeof(header));
+  return image;
+}
+
+static std::string path(const char *label) {
+  return directory + "/" + label + ".bin";
+}
+
+static Bytes load(const char *label) {
+  Bytes data;
+  FILE *file = fopen(path(label).c_str(), "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  for (int c; (c = fgetc(file)) != EOF;) data.push_back(c);
+  fclose(file);
+  return data;
+}
+
+static void store(const char *label, const Bytes &image) {
+  FILE *file = fopen(path(label).c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  fwrite(image.data(), 1, image.size(), file);
+  fclose(file);
+}
+
+static void flipByte(const char *label, long offset) {
+  FILE *file = fopen(path(label).c_str(), "r+b");
+  TEST_ASSERT_NOT_NULL(file);
+  fseek(file, offset, SEEK_SET);
+  int c = fgetc(file);
+  fseek(file, offset, SEEK_SET);
+  fputc(c ^ 1, file);
+  fclose(file);
+}
+
+static void push(const Bytes &packet) {
+  TEST_ASSERT_TRUE(bulkTransferPush(packet.data(), packet.size()));
+}
+
+static Bytes beginPacket(const Bytes &image, uint32_t crc) {
+  BulkBegin begin = {BULK_OP_BEGIN, BULK_TARGET_WAYPOINTS, (uint32_t)image.size(), crc, CHUNK};
+  return Bytes((const uint8_t *)&begin, (const uint8_t *)&begin + sizeof(begin));
+}
+
+static Bytes chunkPacket(const Bytes &image, uint32_t sequence) {
+  Bytes packet = {BULK_OP_CHUNK, (uint8_t)sequence, (uint8_t)(sequence >> 8)};
+  uint32_t offset = sequence * CHUNK;
+  uint32_t length = std::min<uint32_t>(CHUNK, image.size() - offset);
+  packet.insert(packet.end(), image.begin() + offset, image.begin() + offset + length);
+  return packet;
+}
+
+// Push one packet and handle it like loop() does
+static uint8_t exchange(const Bytes &packet, BulkAck &ack) {
+  push(packet);
+  bool sendAck = false;
+  uint8_t event = bulkTransferService(ack, sendAck);
+  TEST_ASSERT_FALSE(bulkTransferPending());
+  return event;
+}
+
+// What the phone does: BEGIN, a window of chunks per round, END, resending
+// whatever the ACKs show missing. Packets in both directions are lost at
+// this rate and reordered on the way in. Checks that readers keep the old
+// database until the commit. With abortAfter, sends ABORT after that many rounds.
+static bool upload(const Bytes &image, double loss, uint32_t oldCount, int abortAfter = 0) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::deque<Bytes> air;
+  auto send = [&](const Bytes &packet) {
+    if (unit(rng) < loss) return;
+    size_t at = air.size();
+    if (unit(rng) < 0.3) at = rng() % (air.size() + 1);
+    air.insert(air.begin() + at, packet);
+  };
+
+  uint32_t count = (image.size() + CHUNK - 1) / CHUNK;
+  std::vector<bool> acked(count, false);
+  uint32_t base = 0;
+  bool began = false, done = false, committed = false;
+  for (int round = 1; !done && round < 20000; round++) {
+    if (round == abortAfter) {
+      TEST_ASSERT_TRUE(began);
+      BulkAck ack;
+      TEST_ASSERT_EQUAL(BULK_EVENT_FAILED, exchange({BULK_OP_ABORT}, ack));
+      return false;
+    }
+    if (!began) {
+      send(beginPacket(image, crc32Update(0, image.data(), image.size())));
+    } else if (base < count) {
+      for (uint32_t s = base; s < count && s < base + BULK_WINDOW; s++) {
+        if (!acked[s]) send(chunkPacket(image, s));
+      }
+    } else {
+      send({BULK_OP_END});
+    }
+    for (int k = 0; k < 12 && !air.empty(); k++) {
+      bulkTransferPush(air.front().data(), air.front().size());
+      air.pop_front();
+    }
+
+    BulkAck ack;
+    bool sendAck;
+    do {
+      uint8_t event = bulkTransferService(ack, sendAck);
+      committed |= event == BULK_EVENT_COMMITTED;
+      TEST_ASSERT_NOT_EQUAL(BULK_EVENT_FAILED, event);
+      if (!committed) TEST_ASSERT_EQUAL(oldCount, waypointDbCount());
+      if (!sendAck || unit(rng) < loss) continue;
+      if (ack.request == BULK_OP_BEGIN) {
+        TEST_ASSERT_EQUAL(BULK_STATUS_OK, ack.status);
+        began = true;
+      } else if (ack.request == BULK_OP_END && ack.status == BULK_STATUS_OK) {
+        done = true;
+      } else if (ack.request == BULK_OP_CHUNK && ack.status == BULK_STATUS_STATE) {
+        continue; // A late chunk after the commit
+      } else if (began && (ack.request == BULK_OP_CHUNK || ack.status == BULK_STATUS_INCOMPLETE)) {
+        TEST_ASSERT_TRUE(ack.status == BULK_STATUS_OK || ack.status == BULK_STATUS_INCOMPLETE);
+        for (uint32_t s = 0; s < ack.next && s < count; s++) acked[s] = true;
+        for (uint32_t i = 0; i < BULK_WINDOW; i++) {
+          if (ack.next + i < count) acked[ack.next + i] = (ack.received >> i) & 1;
+        }
+        base = ack.next;
+      } else if (ack.status != BULK_STATUS_OK) {
+        TEST_FAIL_MESSAGE("Unexpected ACK status");
+      }
+    } while (sendAck);
+  }
+  TEST_ASSERT_TRUE(done);
+  TEST_ASSERT_TRUE(committed);
+  return true;
+}
+
+static Bytes first, second;
+
+void setUp(void) {
+  std::string base = (std::filesystem::temp_directory_path() / "bulk_XXXXXX").string();
+  directory = mkdtemp(&base[0]);
+  assetSetHostDirectory(directory.c_str());
+  rng.seed(1);
+  first = database(6000);
+  second = database(1999);
+  store(WAYPOINT_DB_PARTITION, first); // As flashed by the host tools, without a slot trailer
+  TEST_ASSERT_TRUE(waypointDbBegin());
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+  TEST_ASSERT_EQUAL(0, waypointDbImage().slot);
+  TEST_ASSERT_EQUAL(0, waypointDbImage().generation);
+}
+
+void tearDown(void) {
+  BulkAck ack;
+  bool sendAck;
+  uint8_t abort = BULK_OP_ABORT;
+  bulkTransferPush(&abort, 1);
+  while (bulkTransferPending()) bulkTransferService(ack, sendAck);
+  waypointDbEnd();
+  std::filesystem::remove_all(directory);
+}
+
+void test_lossy_upload_switches_slots_at_end(void) {
+  TEST_ASSERT_TRUE(upload(second, 0.1, 6000));
+  TEST_ASSERT_EQUAL(1999, waypointDbCount());
+  TEST_ASSERT_EQUAL(1, waypointDbImage().slot);
+  TEST_ASSERT_EQUAL(1, waypointDbImage().generation);
+  Bytes written = load(WAYPOINT_DB_PARTITION_B);
+  TEST_ASSERT_GREATER_OR_EQUAL(second.size(), written.size());
+  TEST_ASSERT_EQUAL_MEMORY(second.data(), written.data(), second.size());
+  TEST_ASSERT_EQUAL(second.size(), bulkTransferStats().lastBytes);
+
+  // A reboot opens the newest slot
+  TEST_ASSERT_TRUE(waypointDbBegin());
+  TEST_ASSERT_EQUAL(1, waypointDbImage().slot);
+  TEST_ASSERT_EQUAL(1999, waypointDbCount());
+
+  // The next upload goes back to the first slot
+  TEST_ASSERT_TRUE(upload(first, 0.2, 1999));
+  TEST_ASSERT_EQUAL(0, waypointDbImage().slot);
+  TEST_ASSERT_EQUAL(2, waypointDbImage().generation);
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+  TEST_ASSERT_GREATER_THAN(0, bulkTransferStats().duplicates);
+}
+
+void test_abort_keeps_the_old_database(void) {
+  TEST_ASSERT_FALSE(upload(second, 0.1, 6000, 20));
+  TEST_ASSERT_FALSE(bulkTransferActive());
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+  TEST_ASSERT_EQUAL(0, waypointDbImage().slot);
+  // The half-written slot never opens
+  TEST_ASSERT_TRUE(waypointDbBegin());
+  TEST_ASSERT_EQUAL(0, waypointDbImage().slot);
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+}
+
+void test_incomplete_end_reports_the_gaps(void) {
+  BulkAck ack;
+  uint32_t crc = crc32Update(0, second.data(), second.size());
+  TEST_ASSERT_EQUAL(BULK_EVENT_STARTED, exchange(beginPacket(second, crc), ack));
+  TEST_ASSERT_TRUE(bulkTransferActive());
+  exchange(chunkPacket(second, 0), ack);
+  exchange(chunkPacket(second, 2), ack);
+  exchange(chunkPacket(second, 5), ack);
+  exchange(chunkPacket(second, 2), ack);
+  exchange(chunkPacket(second, 1 + BULK_WINDOW), ack);
+  exchange({BULK_OP_END}, ack);
+  TEST_ASSERT_EQUAL(BULK_OP_END, ack.request);
+  TEST_ASSERT_EQUAL(BULK_STATUS_INCOMPLETE, ack.status);
+  TEST_ASSERT_EQUAL(1, ack.next);
+  TEST_ASSERT_EQUAL_HEX32(0x12, ack.received); // Chunks 2 and 5
+  TEST_ASSERT_TRUE(bulkTransferActive());
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+}
+
+void test_bad_images_are_refused(void) {
+  BulkAck ack;
+  // Every chunk arrives, but the CRC is wrong
+  uint32_t count = (second.size() + CHUNK - 1) / CHUNK;
+  exchange(beginPacket(second, 0x12345678), ack);
+  for (uint32_t s = 0; s < count; s++) exchange(chunkPacket(second, s), ack);
+  TEST_ASSERT_EQUAL(BULK_EVENT_FAILED, exchange({BULK_OP_END}, ack));
+  TEST_ASSERT_EQUAL(BULK_STATUS_CRC, ack.status);
+
+  // The CRC matches, but it is not a waypoint database
+  Bytes other = second;
+  other[0] ^= 0xFF;
+  exchange(beginPacket(other, crc32Update(0, other.data(), other.size())), ack);
+  for (uint32_t s = 0; s < count; s++) exchange(chunkPacket(other, s), ack);
+  TEST_ASSERT_EQUAL(BULK_EVENT_FAILED, exchange({BULK_OP_END}, ack));
+  TEST_ASSERT_EQUAL(BULK_STATUS_IMAGE, ack.status);
+
+  exchange({BULK_OP_END}, ack);
+  TEST_ASSERT_EQUAL(BULK_STATUS_STATE, ack.status);
+  BulkBegin begin = {BULK_OP_BEGIN, 7, 1000, 0, CHUNK};
+  exchange(Bytes((const uint8_t *)&begin, (const uint8_t *)&begin + sizeof(begin)), ack);
+  TEST_ASSERT_EQUAL(BULK_STATUS_TARGET, ack.status);
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+  TEST_ASSERT_EQUAL(0, waypointDbImage().slot);
+}
+
+void test_silent_upload_times_out(void) {
+  BulkAck ack;
+  exchange(beginPacket(second, crc32Update(0, second.data(), second.size())), ack);
+  exchange(chunkPacket(second, 0), ack);
+  bool sendAck;
+  testAdvanceMillis(BULK_TIMEOUT_MS - 1);
+  TEST_ASSERT_EQUAL(BULK_EVENT_NONE, bulkTransferService(ack, sendAck));
+  testAdvanceMillis(1);
+  TEST_ASSERT_EQUAL(BULK_EVENT_FAILED, bulkTransferService(ack, sendAck));
+  TEST_ASSERT_FALSE(bulkTransferActive());
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+}
+
+void test_corrupt_newest_slot_falls_back(void) {
+  TEST_ASSERT_TRUE(upload(second, 0.0, 6000));
+  TEST_ASSERT_EQUAL(1, waypointDbImage().slot);
+  flipByte(WAYPOINT_DB_PARTITION_B, 100);
+  TEST_ASSERT_TRUE(waypointDbBegin());
+  TEST_ASSERT_EQUAL(0, waypointDbImage().slot);
+  TEST_ASSERT_EQUAL(6000, waypointDbCount());
+  flipByte(WAYPOINT_DB_PARTITION, 100);
+  TEST_ASSERT_FALSE(waypointDbBegin());
+  TEST_ASSERT_EQUAL(0, waypointDbCount());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lossy_upload_switches_slots_at_end);
+  RUN_TEST(test_abort_keeps_the_old_database);
+  RUN_TEST(test_incomplete_end_reports_the_gaps);
+  RUN_TEST(test_bad_images_are_refused);
+  RUN_TEST(test_silent_upload_times_out);
+  RUN_TEST(test_corrupt_newest_slot_falls_back);
+  return UNITY_END();
+}
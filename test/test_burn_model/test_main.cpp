@@ -0,0 +1,163 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "burn_model.h"
+
+#define CONSTANT_RATE 4.8
+#define TANK 30.0
+
+// The engine being fitted: L/h = B0 + B1 * speed / 100 km/h + B2 * climb km/h
+#define B0 3.2
+#define B1 2.0
+#define B2 1.5
+
+struct Phase {
+  float kmh;
+  float climbMs; // Vertical speed, negative sinking
+  uint32_t seconds;
+};
+
+static GpsFix fix;
+static uint32_t fixMillis;
+static float altitude;
+
+static double uniform(double lo, double hi) {
+  return lo + (hi - lo) * rand() / RAND_MAX;
+}
+
+static double gaussian(double sigma) {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sigma * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+// Fly the phases at 1 Hz through the model; returns the litres the engine really burnt
+static double fly(const Phase *phases, uint8_t count) {
+  double burnt = 0.0;
+  for (uint8_t p = 0; p < count; p++) {
+    for (uint32_t s = 0; s < phases[p].seconds; s++) {
+      fixMillis += 1000;
+      altitude += phases[p].climbMs;
+      fix.speed = {true, phases[p].kmh};
+      fix.altitude = {true, altitude};
+      fix.updateMillis = fixMillis;
+      burnModelAccumulate(fix, 1.0 / 3600.0);
+    }
+    double hours = phases[p].seconds / 3600.0;
+    burnt += (B0 + B1 * phases[p].kmh / 100.0 + B2 * fmax(phases[p].climbMs, 0.0) * 3.6) * hours;
+  }
+  return burnt;
+}
+
+// A flight between two refuels: climb out, cruise at some speed, soar a thermal or two, descend
+static double randomFlight() {
+  Phase phases[] = {
+    {(float)uniform(35, 45), (float)uniform(1.0, 3.0), (uint32_t)uniform(120, 900)},
+    {(float)uniform(40, 95), 0.0f, (uint32_t)uniform(1200, 4800)},
+    {(float)uniform(25, 35), (float)uniform(0.5, 2.5), (uint32_t)uniform(0, 1200)},
+    {(float)uniform(40, 95), 0.0f, (uint32_t)uniform(600, 2400)},
+    {(float)uniform(45, 60), (float)-uniform(0.5, 2.0), (uint32_t)uniform(300, 900)},
+  };
+  return fly(phases, sizeof(phases) / sizeof(phases[0]));
+}
+
+// Land, read the tank to within the gauge's noise and fill it up again
+static bool refuel(double burnt, double gaugeSigma) {
+  double reading = TANK - burnt + gaussian(gaugeSigma);
+  return burnModelRefuel(TANK, TANK - reading);
+}
+
+void setUp(void) {
+  srand(1);
+  fix = {};
+  fixMillis = 1000;
+  altitude = 400.0f;
+  burnModelBegin({}, CONSTANT_RATE);
+  burnModelRefuel(TANK, -1.0); // Starts the first segment
+}
+
+void tearDown(void) {}
+
+void test_recovers_the_coefficients(void) {
+  for (int i = 0; i < 60; i++) {
+    TEST_ASSERT_TRUE(refuel(randomFlight(), 0.2));
+  }
+  BurnModelState state = burnModelState();
+  char message[120];
+  snprintf(message, sizeof(message), "fitted %.2f + %.2f speed + %.2f climb, true %.2f + %.2f speed + %.2f climb",
+           state.coeff[0], state.coeff[1], state.coeff[2], B0, B1, B2);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_FLOAT_WITHIN(0.4, B0, state.coeff[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, B1, state.coeff[1]);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, B2, state.coeff[2]);
+
+  // Predict fresh flights from the current conditions, against the constant rate
+  double modelError = 0.0, constantError = 0.0;
+  const int flights = 20;
+  for (int i = 0; i < flights; i++) {
+    Phase cruise = {(float)uniform(40, 95), 0.0f, 600};
+    Phase climb = {40.0f, (float)uniform(1.0, 3.0), 600};
+    double trueRate = fly(&cruise, 1) * 6.0;
+    modelError += sq(burnModelRate(CONSTANT_RATE) - trueRate);
+    constantError += sq(CONSTANT_RATE - trueRate);
+    trueRate = fly(&climb, 1) * 6.0;
+    modelError += sq(burnModelRate(CONSTANT_RATE) - trueRate);
+    constantError += sq(CONSTANT_RATE - trueRate);
+  }
+  modelError = sqrt(modelError / (2 * flights));
+  constantError = sqrt(constantError / (2 * flights));
+  snprintf(message, sizeof(message), "rate RMS error %.2f L/h, constant rate %.2f L/h", modelError, constantError);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(0.5, modelError);
+  TEST_ASSERT_LESS_THAN(constantError / 3, modelError);
+}
+
+// Until enough segments are fitted the constant rate stands
+void test_constant_rate_until_trained(void) {
+  TEST_ASSERT_EQUAL_FLOAT(CONSTANT_RATE, burnModelRate(CONSTANT_RATE));
+  for (int i = 0; i < BURN_MODEL_MIN_EVENTS; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(CONSTANT_RATE, burnModelRate(CONSTANT_RATE));
+    TEST_ASSERT_TRUE(refuel(randomFlight(), 0.2));
+  }
+  TEST_ASSERT_EQUAL(BURN_MODEL_MIN_EVENTS, burnModelState().events);
+  TEST_ASSERT_NOT_EQUAL(CONSTANT_RATE, burnModelRate(CONSTANT_RATE));
+}
+
+// A level with no litres added may be our own estimate sent back: it only restarts the segment
+void test_unknown_refuel_leaves_the_model(void) {
+  for (int i = 0; i < 30; i++) refuel(randomFlight(), 0.2);
+  BurnModelState before = burnModelState();
+
+  double level = TANK - randomFlight();
+  TEST_ASSERT_FALSE(burnModelRefuel(level, -1.0));
+  TEST_ASSERT_FALSE(burnModelRefuel(level, -5.0));
+  BurnModelState after = burnModelState();
+  TEST_ASSERT_EQUAL_MEMORY(&before, &after, sizeof(before));
+
+  // The next segment starts at that level, not at the last full tank
+  double reading = level - randomFlight();
+  TEST_ASSERT_TRUE(burnModelRefuel(TANK, TANK - reading));
+  after = burnModelState();
+  TEST_ASSERT_EQUAL(before.events + 1, after.events);
+  TEST_ASSERT_FLOAT_WITHIN(0.4, B0, after.coeff[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, B1, after.coeff[1]);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, B2, after.coeff[2]);
+}
+
+void test_short_segment_is_not_learned(void) {
+  Phase taxi = {20.0f, 0.0f, (uint32_t)(BURN_MODEL_MIN_SEGMENT_H * 3600) - 60};
+  BurnModelState before = burnModelState();
+  TEST_ASSERT_FALSE(refuel(fly(&taxi, 1), 0.0));
+  BurnModelState after = burnModelState();
+  TEST_ASSERT_EQUAL_MEMORY(&before, &after, sizeof(before));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_recovers_the_coefficients);
+  RUN_TEST(test_constant_rate_until_trained);
+  RUN_TEST(test_unknown_refuel_leaves_the_model);
+  RUN_TEST(test_short_segment_is_not_learned);
+  return UNITY_END();
+}
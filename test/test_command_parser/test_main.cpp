@@ -0,0 +1,234 @@
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include "ble_command_parser.h"
+#include "ble_commands.h"
+
+static BleCommand command;
+
+static uint8_t parse(const std::string &text) {
+  return bleCommandParse(text.c_str(), command);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Every form web/app.js, web/ble-poi.js and web/script.js send
+void test_app_commands(void) {
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("POI:1:47.123456:-122.5:1"));
+  TEST_ASSERT_EQUAL(BLE_VERB_POI, command.verb);
+  TEST_ASSERT_EQUAL(4, command.argCount);
+  TEST_ASSERT_EQUAL(1, command.args[0].integer);
+  TEST_ASSERT_EQUAL_FLOAT(47.123456, command.args[1].decimal);
+  TEST_ASSERT_EQUAL_FLOAT(-122.5, command.args[2].decimal);
+  TEST_ASSERT_EQUAL(1, command.args[3].integer);
+
+  // parseFloat of an empty box, sent for a disabled POI
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("POI:3:NaN:NaN:0"));
+  TEST_ASSERT_TRUE(isnan(command.args[1].decimal));
+  TEST_ASSERT_TRUE(isnan(command.args[2].decimal));
+
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("47.5:8.25:1"));
+  TEST_ASSERT_EQUAL(BLE_VERB_LEGACY_POI, command.verb);
+  TEST_ASSERT_EQUAL(3, command.argCount);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("-33.9:151.2:0"));
+  TEST_ASSERT_EQUAL_FLOAT(-33.9, command.args[0].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("NaN:NaN:0"));
+  TEST_ASSERT_EQUAL(BLE_VERB_LEGACY_POI, command.verb);
+
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:40.50:7.20"));
+  TEST_ASSERT_EQUAL(BLE_VERB_FUEL, command.verb);
+  TEST_ASSERT_EQUAL(2, command.argCount);
+  TEST_ASSERT_EQUAL_FLOAT(40.5, command.args[0].decimal);
+  TEST_ASSERT_EQUAL_FLOAT(7.2, command.args[1].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:12.00:6.75:8.00"));
+  TEST_ASSERT_EQUAL(3, command.argCount);
+  TEST_ASSERT_EQUAL_FLOAT(8, command.args[2].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:40:7"));
+
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("MODE:2"));
+  TEST_ASSERT_EQUAL(BLE_VERB_MODE, command.verb);
+  TEST_ASSERT_EQUAL(2, command.args[0].integer);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("STREAM:5"));
+  TEST_ASSERT_EQUAL(BLE_VERB_STREAM, command.verb);
+  TEST_ASSERT_EQUAL(5, command.args[0].integer);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("GET_DATA"));
+  TEST_ASSERT_EQUAL(BLE_VERB_GET_DATA, command.verb);
+  TEST_ASSERT_EQUAL(0, command.argCount);
+}
+
+// Number forms JavaScript's number to string produces
+void test_javascript_numbers(void) {
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("POI:1:1e-7:-5e-7:1"));
+  TEST_ASSERT_EQUAL_FLOAT(1e-7, command.args[1].decimal);
+  TEST_ASSERT_EQUAL_FLOAT(-5e-7, command.args[2].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("POI:1:1.5e-7:2.5E+1:1"));
+  TEST_ASSERT_EQUAL_FLOAT(1.5e-7, command.args[1].decimal);
+  TEST_ASSERT_EQUAL_FLOAT(25, command.args[2].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("POI:1:-0:0:1"));
+  TEST_ASSERT_EQUAL_FLOAT(0, command.args[1].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:.5:5.:1e0"));
+  TEST_ASSERT_EQUAL_FLOAT(0.5, command.args[0].decimal);
+  TEST_ASSERT_EQUAL_FLOAT(5, command.args[1].decimal);
+  TEST_ASSERT_EQUAL_FLOAT(1, command.args[2].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:Infinity:-infinity"));
+  TEST_ASSERT_TRUE(isnan(command.args[0].decimal)); // Not set
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:5e-324:0.000000000000000000000000001"));
+  TEST_ASSERT_TRUE(command.args[0].decimal >= 0 && command.args[0].decimal < 1e-300);
+  TEST_ASSERT_EQUAL_FLOAT(1e-27, command.args[1].decimal);
+  TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse("FUEL:123456789012345678901234567890:1"));
+  TEST_ASSERT_FLOAT_WITHIN(1e16, 1.2345678901234568e29, command.args[0].decimal);
+}
+
+// A coordinate printed with up to 15 significant digits reads back as the double strtod gives
+void test_coordinates_match_strtod(void) {
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> lat(-90, 90), lon(-180, 180);
+  char text[80];
+  for (int i = 0; i < 100000; i++) {
+    int decimals = rng() % 13;
+    double a = lat(rng), b = lon(rng);
+    snprintf(text, sizeof(text), "POI:%d:%.*f:%.*f:%d", 1 + i % 3, decimals, a, decimals, b, i % 2);
+    TEST_ASSERT_EQUAL(BLE_PARSE_OK, parse(text));
+    const char *latText = strchr(text + 4, ':') + 1;
+    const char *lonText = strchr(latText, ':') + 1;
+    TEST_ASSERT_TRUE(command.args[1].decimal == strtod(latText, nullptr));
+    TEST_ASSERT_TRUE(command.args[2].decimal == strtod(lonText, nullptr));
+  }
+}
+
+void test_malformed_commands(void) {
+  struct Case {
+    const char *text;
+    uint8_t result;
+    uint8_t verb;
+  };
+  static const Case cases[] = {
+    {"", BLE_PARSE_UNKNOWN, BLE_VERB_NONE},
+    {"HELLO", BLE_PARSE_UNKNOWN, BLE_VERB_NONE},
+    {"get_data", BLE_PARSE_UNKNOWN, BLE_VERB_NONE},
+    {"GET_DATA:1", BLE_PARSE_ARGS, BLE_VERB_GET_DATA},
+    {"GET_DATAX", BLE_PARSE_UNKNOWN, BLE_VERB_NONE},
+    {"POI", BLE_PARSE_ARGS, BLE_VERB_POI},
+    {"POI:1:1:2", BLE_PARSE_ARGS, BLE_VERB_POI},
+    {"POI:1:1.5:2:1:9", BLE_PARSE_ARGS, BLE_VERB_POI},
+    {"POI:1:91:0:1", BLE_PARSE_RANGE, BLE_VERB_POI},
+    {"POI:1:0:-180.0001:1", BLE_PARSE_RANGE, BLE_VERB_POI},
+    {"POI:1.5:0:0:1", BLE_PARSE_NUMBER, BLE_VERB_POI},
+    {"POI:NaN:0:0:1", BLE_PARSE_NUMBER, BLE_VERB_POI},
+    {"POI:1:0:0:1e0", BLE_PARSE_NUMBER, BLE_VERB_POI},
+    {"POI:1:1e999:0:1", BLE_PARSE_RANGE, BLE_VERB_POI},
+    {"POI:1: 47:8:1", BLE_PARSE_NUMBER, BLE_VERB_POI},
+    {"POI:1:47,5:8:1", BLE_PARSE_NUMBER, BLE_VERB_POI},
+    {"POI:99999999999:0:0:1", BLE_PARSE_NUMBER, BLE_VERB_POI},
+    {"91:0:1", BLE_PARSE_RANGE, BLE_VERB_LEGACY_POI},
+    {"47.5:8.25", BLE_PARSE_ARGS, BLE_VERB_LEGACY_POI},
+    {"FUEL:1", BLE_PARSE_ARGS, BLE_VERB_FUEL},
+    {"FUEL:1:2:3:4", BLE_PARSE_ARGS, BLE_VERB_FUEL},
+    {"FUEL:1.2.3:4", BLE_PARSE_NUMBER, BLE_VERB_FUEL},
+    {"FUEL:1e:4", BLE_PARSE_NUMBER, BLE_VERB_FUEL},
+    {"FUEL:e5:4", BLE_PARSE_NUMBER, BLE_VERB_FUEL},
+    {"FUEL:-:4", BLE_PARSE_NUMBER, BLE_VERB_FUEL},
+    {"FUEL::4", BLE_PARSE_NUMBER, BLE_VERB_FUEL},
+    {"MODE:x", BLE_PARSE_NUMBER, BLE_VERB_MODE},
+    {"MODE:", BLE_PARSE_NUMBER, BLE_VERB_MODE},
+    {"STREAM:", BLE_PARSE_NUMBER, BLE_VERB_STREAM},
+    {"::::::::", BLE_PARSE_ARGS, BLE_VERB_NONE},
+  };
+  for (const Case &c : cases) {
+    char message[80];
+    snprintf(message, sizeof(message), "\"%s\"", c.text);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(c.result, bleCommandParse(c.text, command), message);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(c.verb, command.verb, message);
+    TEST_ASSERT_TRUE_MESSAGE(command.usage != nullptr, message);
+  }
+}
+
+// Whatever it is given, the parser stays inside the text and hands out only
+// what the verb's table entry allows
+static void checkParsed(const std::string &text) {
+  uint8_t result = parse(text);
+  TEST_ASSERT_TRUE(result <= BLE_PARSE_RANGE);
+  TEST_ASSERT_NOT_NULL(command.usage);
+  if (result != BLE_PARSE_OK) return;
+  switch (command.verb) {
+    case BLE_VERB_POI:
+      TEST_ASSERT_EQUAL(4, command.argCount);
+      TEST_ASSERT_TRUE(isnan(command.args[1].decimal) || fabs(command.args[1].decimal) <= 90);
+      TEST_ASSERT_TRUE(isnan(command.args[2].decimal) || fabs(command.args[2].decimal) <= 180);
+      break;
+    case BLE_VERB_LEGACY_POI:
+      TEST_ASSERT_EQUAL(3, command.argCount);
+      TEST_ASSERT_TRUE(isnan(command.args[0].decimal) || fabs(command.args[0].decimal) <= 90);
+      TEST_ASSERT_TRUE(isnan(command.args[1].decimal) || fabs(command.args[1].decimal) <= 180);
+      break;
+    case BLE_VERB_FUEL:
+      TEST_ASSERT_TRUE(command.argCount == 2 || command.argCount == 3);
+      for (int i = 0; i < command.argCount; i++) TEST_ASSERT_FALSE(isinf(command.args[i].decimal));
+      break;
+    case BLE_VERB_MODE:
+    case BLE_VERB_STREAM:
+      TEST_ASSERT_EQUAL(1, command.argCount);
+      break;
+    case BLE_VERB_GET_DATA:
+      TEST_ASSERT_EQUAL(0, command.argCount);
+      break;
+    default:
+      TEST_FAIL_MESSAGE(text.c_str());
+  }
+}
+
+void test_fuzz_corpus(void) {
+  static const char *const corpus[] = {
+    "POI:1:47.123456:-122.5:1", "POI:2:NaN:NaN:0", "47.5:8.25:1", "FUEL:40.50:7.20", "FUEL:12.00:6.75:8.00",
+    "MODE:1", "STREAM:5", "GET_DATA", "POI:3:1e-7:-1.5e-7:1", "-Infinity:Infinity:0",
+  };
+  static const char alphabet[] = "0123456789:.-+eEPOIFUELGETDAMSRN_ axIinfty\x7f\xff";
+  std::mt19937 rng(1);
+  for (int i = 0; i < 300000; i++) {
+    std::string text = corpus[rng() % (sizeof(corpus) / sizeof(corpus[0]))];
+    // Mutate a command the app really sends: flip, insert, delete, splice
+    for (int edits = 1 + rng() % 4; edits > 0; edits--) {
+      size_t at = text.empty() ? 0 : rng() % (text.size() + 1);
+      char c = alphabet[rng() % (sizeof(alphabet) - 1)];
+      switch (rng() % 4) {
+        case 0:
+          if (at < text.size()) text[at] = c;
+          break;
+        case 1:
+          text.insert(at, 1, c);
+          break;
+        case 2:
+          if (at < text.size()) text.erase(at, 1 + rng() % 3);
+          break;
+        case 3:
+          text.insert(at, corpus[rng() % (sizeof(corpus) / sizeof(corpus[0]))]);
+          break;
+      }
+    }
+    if (text.size() > BLE_COMMAND_MAX_LENGTH) text.resize(BLE_COMMAND_MAX_LENGTH);
+    checkParsed(text);
+  }
+  // Random strings, and fields longer than any command the queue accepts
+  for (int i = 0; i < 200000; i++) {
+    std::string text(rng() % (BLE_COMMAND_MAX_LENGTH + 1), ' ');
+    for (char &c : text) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    checkParsed(text);
+  }
+  checkParsed("FUEL:" + std::string(300, '9') + ":1");
+  checkParsed("POI:1:" + std::string(300, '0') + "1:0:1");
+  checkParsed("FUEL:1e" + std::string(40, '9') + ":1");
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_app_commands);
+  RUN_TEST(test_javascript_numbers);
+  RUN_TEST(test_coordinates_match_strtod);
+  RUN_TEST(test_malformed_commands);
+  RUN_TEST(test_fuzz_corpus);
+  return UNITY_END();
+}
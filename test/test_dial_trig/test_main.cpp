@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include "dial_trig.h"
+
+#define ROUNDS 1000000
+
+// How drawNavigationDisplay() placed the markers before the table: double trig, truncated to int
+static void doublePolarToScreen(int centerX, int centerY, int radius, float degrees, int *x, int *y) {
+  double radians = degrees * DEG_TO_RAD;
+  *x = centerX + radius * sin(radians);
+  *y = centerY - radius * cos(radians);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_table_matches_libm(void) {
+  for (int angle = 0; angle < DIAL_ANGLE_STEPS; angle++) {
+    double radians = angle * 2 * M_PI / DIAL_ANGLE_STEPS;
+    TEST_ASSERT_INT_WITHIN(1, lround(sin(radians) * DIAL_TRIG_ONE), dialSin(angle));
+    TEST_ASSERT_INT_WITHIN(1, lround(cos(radians) * DIAL_TRIG_ONE), dialCos(angle));
+  }
+  TEST_ASSERT_EQUAL(DIAL_TRIG_ONE, dialSin(DIAL_QUARTER_STEPS));
+  TEST_ASSERT_EQUAL(-DIAL_TRIG_ONE, dialCos(DIAL_ANGLE_STEPS / 2));
+}
+
+void test_degrees_wrap(void) {
+  TEST_ASSERT_EQUAL(0, dialAngleFromDegrees(0.0f));
+  TEST_ASSERT_EQUAL(0, dialAngleFromDegrees(360.0f));
+  TEST_ASSERT_EQUAL(DIAL_QUARTER_STEPS, dialAngleFromDegrees(90.0f));
+  TEST_ASSERT_EQUAL(DIAL_QUARTER_STEPS, dialAngleFromDegrees(-270.0f));
+  TEST_ASSERT_EQUAL(DIAL_ANGLE_STEPS - DIAL_QUARTER_STEPS, dialAngleFromDegrees(-90.0f));
+  TEST_ASSERT_EQUAL(DIAL_ANGLE_STEPS / 2, dialAngleFromDegrees(540.0f));
+  TEST_ASSERT_EQUAL(DIAL_ANGLE_STEPS - 1, dialAngleFromDegrees(-0.3f));
+}
+
+// Anywhere on the full circle, at every radius the dial uses, the marker lands within a pixel of where it did
+void test_placement_within_a_pixel(void) {
+  int worst = 0;
+  for (int radius = 1; radius <= 96; radius++) {
+    for (float degrees = -360.0f; degrees <= 360.0f; degrees += 0.05f) {
+      int16_t x, y;
+      int oldX, oldY;
+      dialPolarToScreen(100, 100, radius, dialAngleFromDegrees(degrees), &x, &y);
+      doublePolarToScreen(100, 100, radius, degrees, &oldX, &oldY);
+      worst = std::max(worst, std::max(abs(x - oldX), abs(y - oldY)));
+    }
+  }
+  char message[60];
+  snprintf(message, sizeof(message), "largest difference %d px", worst);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_OR_EQUAL(1, worst);
+}
+
+void test_placement_timing(void) {
+  volatile int sink = 0;
+  unsigned long start = micros();
+  for (int i = 0; i < ROUNDS; i++) {
+    int x, y;
+    doublePolarToScreen(100, 100, 80, (i % 3600) * 0.1f, &x, &y);
+    sink = sink + x + y;
+  }
+  unsigned long doubleUs = micros() - start;
+
+  start = micros();
+  for (int i = 0; i < ROUNDS; i++) {
+    int16_t x, y;
+    dialPolarToScreen(100, 100, 80, dialAngleFromDegrees((i % 3600) * 0.1f), &x, &y);
+    sink = sink + x + y;
+  }
+  unsigned long tableUs = micros() - start;
+
+  char message[100];
+  snprintf(message, sizeof(message), "double sin/cos %.1f ns, table %.1f ns per marker", doubleUs * 1000.0 / ROUNDS,
+           tableUs * 1000.0 / ROUNDS);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(doubleUs, tableUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_matches_libm);
+  RUN_TEST(test_degrees_wrap);
+  RUN_TEST(test_placement_within_a_pixel);
+  RUN_TEST(test_placement_timing);
+  return UNITY_END();
+}
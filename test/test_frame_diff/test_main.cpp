@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "dial_trig.h"
+#include "epd_frame.h"
+#include "frame_diff.h"
+#include "nav_dial.h"
+
+#define WIDTH 200
+#define HEIGHT 200
+#define STRIDE ((WIDTH + 7) / 8)
+
+static uint8_t frame[STRIDE * HEIGHT];
+static uint8_t previous[STRIDE * HEIGHT];
+
+static void fillRect(int x, int y, int w, int h) {
+  for (int row = y; row < y + h; row++) {
+    for (int col = x; col < x + w; col++) {
+      frame[row * STRIDE + col / 8] &= ~(0x80 >> (col & 7));
+    }
+  }
+}
+
+static uint8_t dirtyRects(FrameRect *rects, uint8_t maxRects) {
+  return frameDirtyRects(frame, previous, STRIDE, HEIGHT, rects, maxRects);
+}
+
+static bool covered(const FrameRect *rects, uint8_t count, int byteX, int y) {
+  for (uint8_t i = 0; i < count; i++) {
+    const FrameRect &r = rects[i];
+    if (byteX * 8 >= r.x && byteX * 8 < r.x + r.w && y >= r.y && y < r.y + r.h) return true;
+  }
+  return false;
+}
+
+// Every changed byte is pushed, and every window is byte aligned and inside the frame
+static void checkRects(const FrameRect *rects, uint8_t count, uint8_t maxRects) {
+  TEST_ASSERT_LESS_OR_EQUAL(maxRects, count);
+  for (uint8_t i = 0; i < count; i++) {
+    TEST_ASSERT_EQUAL(0, rects[i].x % 8);
+    TEST_ASSERT_EQUAL(0, rects[i].w % 8);
+    TEST_ASSERT_GREATER_THAN(0, rects[i].w);
+    TEST_ASSERT_GREATER_THAN(0, rects[i].h);
+    TEST_ASSERT_LESS_OR_EQUAL(STRIDE * 8, rects[i].x + rects[i].w);
+    TEST_ASSERT_LESS_OR_EQUAL(HEIGHT, rects[i].y + rects[i].h);
+  }
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int bx = 0; bx < STRIDE; bx++) {
+      if (frame[y * STRIDE + bx] != previous[y * STRIDE + bx]) {
+        TEST_ASSERT_TRUE(covered(rects, count, bx, y));
+      }
+    }
+  }
+}
+
+static uint32_t pushedBytes(const FrameRect *rects, uint8_t count) {
+  uint32_t bytes = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    bytes += (uint32_t)(rects[i].w / 8) * rects[i].h;
+  }
+  return bytes;
+}
+
+void setUp(void) {
+  memset(frame, 0xFF, sizeof(frame));
+  memset(previous, 0xFF, sizeof(previous));
+}
+
+void tearDown(void) {}
+
+void test_unchanged_frame_has_no_rects(void) {
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  TEST_ASSERT_EQUAL(0, dirtyRects(rects, FRAME_MAX_WINDOWS));
+}
+
+void test_single_pixel_is_one_byte(void) {
+  fillRect(123, 77, 1, 1);
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  TEST_ASSERT_EQUAL(1, dirtyRects(rects, FRAME_MAX_WINDOWS));
+  TEST_ASSERT_EQUAL(120, rects[0].x);
+  TEST_ASSERT_EQUAL(77, rects[0].y);
+  TEST_ASSERT_EQUAL(8, rects[0].w);
+  TEST_ASSERT_EQUAL(1, rects[0].h);
+}
+
+void test_distant_changes_get_separate_windows(void) {
+  fillRect(30, 35, 70, 30);
+  fillRect(170, 90, 20, 20);
+  fillRect(90, 145, 30, 15);
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  uint8_t count = dirtyRects(rects, FRAME_MAX_WINDOWS);
+  checkRects(rects, count, FRAME_MAX_WINDOWS);
+  TEST_ASSERT_EQUAL(3, count);
+  // Far less than one window around all three would cost
+  TEST_ASSERT_LESS_THAN(STRIDE * HEIGHT / 3, pushedBytes(rects, count));
+}
+
+void test_nearby_changes_are_merged(void) {
+  fillRect(40, 40, 8, 8);
+  fillRect(56, 40, 8, 8);
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  uint8_t count = dirtyRects(rects, FRAME_MAX_WINDOWS);
+  checkRects(rects, count, FRAME_MAX_WINDOWS);
+  TEST_ASSERT_EQUAL(1, count);
+}
+
+void test_window_budget_is_kept(void) {
+  for (int i = 0; i < 6; i++) {
+    fillRect(i * 33, i * 33, 3, 3);
+  }
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  uint8_t count = dirtyRects(rects, FRAME_MAX_WINDOWS);
+  checkRects(rects, count, FRAME_MAX_WINDOWS);
+
+  count = dirtyRects(rects, 1);
+  checkRects(rects, count, 1);
+  TEST_ASSERT_EQUAL(1, count);
+}
+
+void test_random_changes_are_always_covered(void) {
+  std::mt19937 rng(1);
+  FrameRect rects[FRAME_MAX_WINDOWS];
+  for (int round = 0; round < 500; round++) {
+    setUp();
+    int blobs = 1 + rng() % 12;
+    for (int i = 0; i < blobs; i++) {
+      int x = rng() % WIDTH, y = rng() % HEIGHT;
+      fillRect(x, y, 1 + rng() % (WIDTH - x), 1 + rng() % std::min(HEIGHT - y, 1 + (int)(rng() % 40)));
+    }
+    uint8_t maxRects = 1 + rng() % FRAME_MAX_WINDOWS;
+    checkRects(rects, dirtyRects(rects, maxRects), maxRects);
+  }
+}
+
+// Counts what EpdFrame pushes; the pixels themselves go nowhere
+class CountingPanel : public GxEPD {
+  public:
+    CountingPanel() : GxEPD(WIDTH, HEIGHT) {}
+    void drawPixel(int16_t, int16_t, uint16_t) override {}
+    void init(uint32_t) override {}
+    void update() override {}
+    void updateWindow(uint16_t, uint16_t, uint16_t, uint16_t, bool) override { windows++; }
+    void powerDown() override {}
+    uint32_t windows = 0;
+};
+
+// What drawNavigationDisplay() shows
+struct NavState {
+  float homeBearing; // Relative to the course
+  int speedKmh;
+  float fuel;
+  int enduranceMinutes;
+  int rangeKm;
+  float homeKm;
+  bool airspaceWarning;
+};
+
+// The overlays of drawNavigationDisplay() on the cached background, at the same places and sizes
+static void drawNavigation(EpdFrame &display, const GFXcanvas1 &background, const NavState &state) {
+  display.copyFrom(background);
+  int16_t hx, hy;
+  dialPolarToScreen(100, 100, 80, dialAngleFromDegrees(state.homeBearing), &hx, &hy);
+  display.fillCircle(hx, hy, 12, GxEPD_BLACK);
+  display.setTextColor(GxEPD_WHITE);
+  display.setTextSize(2);
+  display.setCursor(hx - 6, hy - 8);
+  display.print("H");
+  display.setTextColor(GxEPD_BLACK);
+
+  char text[24];
+  snprintf(text, sizeof(text), "%3d", state.speedKmh);
+  display.setTextSize(4);
+  display.setCursor(30, 35);
+  display.print(text);
+
+  snprintf(text, sizeof(text), "%.0f", state.fuel);
+  display.setTextSize(3);
+  display.setCursor(100 - strlen(text) * 18 / 2, 95);
+  display.print(text);
+
+  display.setTextSize(1);
+  snprintf(text, sizeof(text), "%d:%02d", state.enduranceMinutes / 60, state.enduranceMinutes % 60);
+  display.setCursor(100 - strlen(text) * 6 / 2, 84);
+  display.print(text);
+  snprintf(text, sizeof(text), "%dkm", state.rangeKm);
+  display.setCursor(100 - strlen(text) * 6 / 2, 121);
+  display.print(text);
+
+  snprintf(text, sizeof(text), state.homeKm > 10 ? "%.0f" : state.homeKm > 1 ? "%.1f" : "%.2f", state.homeKm);
+  display.setTextSize(2);
+  display.setCursor(100 - strlen(text) * 12 / 2, 145);
+  display.print(text);
+
+  if (state.airspaceWarning) {
+    display.fillRect(40, 2, 120, 12, GxEPD_BLACK);
+    display.setTextColor(GxEPD_WHITE);
+    display.setTextSize(1);
+    const char *banner = "CTR ZURICH 2.4km";
+    display.setCursor(100 - strlen(banner) * 6 / 2, 4);
+    display.print(banner);
+    display.setTextColor(GxEPD_BLACK);
+  }
+}
+
+struct Replay {
+  uint32_t refreshes;
+  uint32_t bytes;
+  uint32_t windows;
+  uint8_t maxWindows;
+};
+
+// One refresh per state, as loop() does once per fix, through EpdFrame::refresh()
+static Replay replay(const char *name, NavState (*sequence)(int), int length) {
+  static GFXcanvas1 background(WIDTH, HEIGHT);
+  drawNavigationBackground(background, 100, 100, MODE_FLYING);
+  CountingPanel panel;
+  EpdFrame display(panel, WIDTH, HEIGHT);
+  display.init();
+  drawNavigation(display, background, sequence(0));
+  display.update();
+
+  Replay run = {0, 0, 0, 0};
+  for (int i = 1; i < length; i++) {
+    drawNavigation(display, background, sequence(i));
+    uint32_t windows = panel.windows;
+    display.refresh();
+    TEST_ASSERT_EQUAL(display.lastPushWindows(), panel.windows - windows);
+    // Whatever was pushed brought the panel in line with the frame
+    FrameRect rects[FRAME_MAX_WINDOWS];
+    TEST_ASSERT_EQUAL(0, display.findDirtyRects(rects, FRAME_MAX_WINDOWS));
+    run.refreshes++;
+    run.bytes += display.lastPushBytes();
+    run.windows += display.lastPushWindows();
+    run.maxWindows = std::max(run.maxWindows, display.lastPushWindows());
+  }
+
+  // The old path pushed the whole 200x200 window on every refresh
+  uint32_t fullBytes = run.refreshes * STRIDE * HEIGHT;
+  char message[160];
+  snprintf(message, sizeof(message), "%s: %u refreshes, %u B in %u windows, full window %u B (%.1f%%)", name,
+           (unsigned)run.refreshes, (unsigned)run.bytes, (unsigned)run.windows, (unsigned)fullBytes,
+           100.0 * run.bytes / fullBytes);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_OR_EQUAL(FRAME_MAX_WINDOWS, run.maxWindows);
+  return run;
+}
+
+// Cruising home at 1 Hz: the speed jitters, the distance counts down, the fuel drops now and then
+static NavState cruise(int second) {
+  return {(float)(8 * sin(second * 0.05)), 54 + (second * 7 % 5), 14.0f - second / 180.0f, 170 - second / 60,
+          95 - second / 40, 12.5f - second * 0.015f, false};
+}
+
+// Circling in a thermal: the home marker runs round the dial
+static NavState circling(int second) {
+  return {(float)(second * 12 % 360), 38 + (second % 4), 11.0f, 140, 60, 4.2f + (second % 20) * 0.01f, false};
+}
+
+// An airspace warning comes and goes while cruising
+static NavState warning(int second) {
+  NavState state = cruise(second);
+  state.airspaceWarning = (second / 15) % 2 == 1;
+  return state;
+}
+
+void test_replay_cruise(void) {
+  Replay run = replay("cruise", cruise, 600);
+  TEST_ASSERT_LESS_THAN(run.refreshes * STRIDE * HEIGHT / 10, run.bytes);
+}
+
+void test_replay_circling(void) {
+  Replay run = replay("circling", circling, 300);
+  TEST_ASSERT_LESS_THAN(run.refreshes * STRIDE * HEIGHT / 6, run.bytes);
+}
+
+void test_replay_airspace_warning(void) {
+  Replay run = replay("airspace warning", warning, 300);
+  TEST_ASSERT_LESS_THAN(run.refreshes * STRIDE * HEIGHT / 10, run.bytes);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unchanged_frame_has_no_rects);
+  RUN_TEST(test_single_pixel_is_one_byte);
+  RUN_TEST(test_distant_changes_get_separate_windows);
+  RUN_TEST(test_nearby_changes_are_merged);
+  RUN_TEST(test_window_budget_is_kept);
+  RUN_TEST(test_random_changes_are_always_covered);
+  RUN_TEST(test_replay_cruise);
+  RUN_TEST(test_replay_circling);
+  RUN_TEST(test_replay_airspace_warning);
+  return UNITY_END();
+}
@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "fuel_burn.h"
+
+#define TICK_MS 50     // loop() cadence
+#define BURN_RATE 4.8  // L/h
+#define TANK 20.0      // Litres at the start of each test
+
+static GpsFix fix;
+static uint32_t gpsClock; // Seconds since the start of the month
+static double hours;
+static double level;      // The tank, as loop() draws it down
+
+// One GPS second: the fix stamped with it if the receiver has one, then
+// loop() ticks for as long as millis() thinks that second lasts
+static void second(float kmh, bool received, uint32_t millisPerSecond) {
+  if (received) {
+    fix.time = {true, (uint8_t)(gpsClock / 3600 % 24), (uint8_t)(gpsClock / 60 % 60), (uint8_t)(gpsClock % 60)};
+    fix.date = {true, 2026, 6, (uint8_t)(1 + gpsClock / 86400)};
+    fix.location.valid = true;
+    fix.speed = {true, kmh};
+    fix.altitude = {true, 420.0f};
+    fix.updateMillis = millis();
+  }
+  gpsClock++;
+  for (uint32_t elapsed = 0; elapsed < millisPerSecond; elapsed += TICK_MS) {
+    double engineHours = fuelBurnTick(true, fix);
+    hours += engineHours;
+    level -= BURN_RATE * engineHours;
+    testAdvanceMillis(millisPerSecond - elapsed < TICK_MS ? millisPerSecond - elapsed : TICK_MS);
+  }
+}
+
+static void fly(uint32_t seconds, float kmh, uint32_t millisPerSecond = 1000) {
+  for (uint32_t i = 0; i < seconds; i++) second(kmh, true, millisPerSecond);
+}
+
+static void dropout(uint32_t seconds) {
+  for (uint32_t i = 0; i < seconds; i++) second(0.0f, false, 1000);
+}
+
+// Engine time and fuel burnt both match this many seconds of running
+static void assertBurnt(uint32_t seconds) {
+  TEST_ASSERT_FLOAT_WITHIN(0.01, seconds, hours * 3600.0);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001, TANK - BURN_RATE * seconds / 3600.0, level);
+}
+
+void setUp(void) {
+  testMillis = 5000;
+  fix = {};
+  gpsClock = 12 * 3600;
+  hours = 0.0;
+  level = TANK;
+  fuelBurnReset();
+}
+
+void tearDown(void) {}
+
+// The first fix starts the clock, each one after it adds a second
+void test_constant_cruise(void) {
+  fly(3600, 60.0f);
+  assertBurnt(3599);
+}
+
+// Without fixes millis() carries on, and neither side of the gap is lost or counted twice
+void test_gps_dropouts(void) {
+  fly(600, 60.0f);
+  dropout(30);
+  fly(600, 60.0f);
+  dropout(5);
+  fly(600, 60.0f);
+  dropout(1);
+  fly(60, 60.0f);
+  assertBurnt(600 + 30 + 600 + 5 + 600 + 1 + 60 - 1);
+}
+
+// A crystal a few percent off doesn't matter while GPS time is there
+void test_clock_skew(void) {
+  fly(1800, 60.0f, 1020);
+  assertBurnt(1799);
+
+  setUp();
+  fly(1800, 60.0f, 980);
+  assertBurnt(1799);
+
+  // The receiver corrects its clock by an hour mid-flight: that interval comes from millis()
+  setUp();
+  fly(600, 60.0f);
+  gpsClock += 3600;
+  fly(600, 60.0f);
+  assertBurnt(1199);
+}
+
+// Taxiing out, waiting and standing after landing cost nothing; the engine is taken
+// as stopped FUEL_BURN_STOP_MS after the fixes go slow
+void test_ground_time_before_and_after_flight(void) {
+  fly(600, 0.0f);
+  fly(120, 2.5f);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, hours);
+  fly(1800, 60.0f);
+  fly(600, 0.0f);
+  assertBurnt(1800 + FUEL_BURN_STOP_MS / 1000);
+}
+
+// After deep sleep millis() starts again and nothing from before the wake is counted
+void test_sleep_is_not_counted(void) {
+  fly(600, 60.0f);
+  fuelBurnReset();
+  testMillis = 800;
+  gpsClock += 2 * 3600;
+  fly(600, 60.0f);
+  assertBurnt(599 + 599);
+}
+
+void test_walking_burns_nothing(void) {
+  fix.time.valid = true;
+  for (uint32_t i = 0; i < 600; i++) {
+    fix.speed = {true, 60.0f};
+    fix.updateMillis = millis();
+    testAdvanceMillis(1000);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, fuelBurnTick(false, fix));
+  }
+}
+
+void test_prediction(void) {
+  fix.speed = {true, 60.0f};
+  FuelPrediction prediction = fuelPredict(12.0, BURN_RATE, fix);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 150.0f, prediction.enduranceMinutes);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 150.0f, prediction.rangeKm);
+
+  fix.speed.valid = false;
+  prediction = fuelPredict(12.0, BURN_RATE, fix);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 150.0f, prediction.enduranceMinutes);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, prediction.rangeKm);
+
+  prediction = fuelPredict(12.0, 0.0, fix);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, prediction.enduranceMinutes);
+  prediction = fuelPredict(0.0, BURN_RATE, fix);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, prediction.enduranceMinutes);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_constant_cruise);
+  RUN_TEST(test_gps_dropouts);
+  RUN_TEST(test_clock_skew);
+  RUN_TEST(test_ground_time_before_and_after_flight);
+  RUN_TEST(test_sleep_is_not_counted);
+  RUN_TEST(test_walking_burns_nothing);
+  RUN_TEST(test_prediction);
+  return UNITY_END();
+}
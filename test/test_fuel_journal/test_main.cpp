@@ -0,0 +1,162 @@
+#include <esp_partition.h>
+#include <unity.h>
+#include "crc32.h"
+#include "fuel_journal.h"
+
+#define SECTORS 4
+#define RECORD_SIZE 16
+#define RECORDS_PER_SECTOR (FUEL_JOURNAL_SECTOR_SIZE / RECORD_SIZE - 1)
+
+// Sector header layout, see fuel_journal.cpp
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t reserved;
+  uint32_t crc;
+};
+
+static const esp_partition_t *partition;
+
+static SectorHeader sectorHeader(uint8_t sector) {
+  SectorHeader header;
+  memcpy(&header, testPartitionBytes(partition).data() + sector * FUEL_JOURNAL_SECTOR_SIZE, sizeof(header));
+  return header;
+}
+
+// Reboot and check what is recovered
+static void assertRecovers(float level, float burnRate) {
+  TEST_ASSERT_TRUE(fuelJournalBegin());
+  FuelCheckpoint checkpoint;
+  TEST_ASSERT_TRUE(fuelJournalLast(checkpoint));
+  TEST_ASSERT_EQUAL_FLOAT(level, checkpoint.level);
+  TEST_ASSERT_EQUAL_FLOAT(burnRate, checkpoint.burnRate);
+}
+
+static uint8_t activeSector() {
+  uint8_t active = 0;
+  for (uint8_t sector = 1; sector < SECTORS; sector++) {
+    if (sectorHeader(sector).magic == sectorHeader(active).magic &&
+        sectorHeader(sector).sequence > sectorHeader(active).sequence) {
+      active = sector;
+    }
+  }
+  return active;
+}
+
+void setUp(void) {
+  testPartitionsClear();
+  partition = testPartitionAdd(FUEL_JOURNAL_PARTITION, FUEL_JOURNAL_SUBTYPE, SECTORS * FUEL_JOURNAL_SECTOR_SIZE);
+  testMillis = 0;
+}
+
+void tearDown(void) {}
+
+void test_without_partition(void) {
+  testPartitionsClear();
+  TEST_ASSERT_FALSE(fuelJournalBegin());
+  TEST_ASSERT_FALSE(fuelJournalAppend(10, 4));
+}
+
+void test_empty_journal(void) {
+  TEST_ASSERT_TRUE(fuelJournalBegin());
+  FuelCheckpoint checkpoint;
+  TEST_ASSERT_FALSE(fuelJournalLast(checkpoint));
+  TEST_ASSERT_TRUE(fuelJournalAppend(11.5, 4.25));
+  assertRecovers(11.5, 4.25);
+}
+
+void test_recovers_across_many_sectors(void) {
+  TEST_ASSERT_TRUE(fuelJournalBegin());
+  float level = 20;
+  const int appends = RECORDS_PER_SECTOR * SECTORS * 5 + 17;
+  for (int i = 0; i < appends; i++) {
+    level -= 0.001f;
+    TEST_ASSERT_TRUE(fuelJournalAppend(level, 4.5f));
+    if (i % 97 == 0) {
+      assertRecovers(level, 4.5f);
+    }
+  }
+  assertRecovers(level, 4.5f);
+
+  // Round robin: the sectors hold the last SECTORS sequence numbers, one each
+  uint32_t newest = sectorHeader(activeSector()).sequence;
+  uint32_t seen = 0;
+  for (uint8_t sector = 0; sector < SECTORS; sector++) {
+    uint32_t age = newest - sectorHeader(sector).sequence;
+    TEST_ASSERT_LESS_THAN(SECTORS, age);
+    seen |= 1 << age;
+  }
+  TEST_ASSERT_EQUAL((1 << SECTORS) - 1, seen);
+}
+
+void test_torn_record_is_skipped(void) {
+  fuelJournalBegin();
+  fuelJournalAppend(15, 4);
+  fuelJournalAppend(14, 4);
+
+  // Power lost halfway through writing the third record
+  uint8_t *slot = testPartitionBytes(partition).data() + activeSector() * FUEL_JOURNAL_SECTOR_SIZE + 3 * RECORD_SIZE;
+  memset(slot, 0x00, RECORD_SIZE / 2);
+  assertRecovers(14, 4);
+
+  // The next record goes after the torn one and wins
+  TEST_ASSERT_TRUE(fuelJournalAppend(13, 4));
+  assertRecovers(13, 4);
+}
+
+void test_new_sector_without_records_falls_back(void) {
+  fuelJournalBegin();
+  fuelJournalAppend(9, 3.5);
+
+  // Power lost right after the next sector was started
+  uint8_t next = (activeSector() + 1) % SECTORS;
+  SectorHeader header = {sectorHeader(activeSector()).magic, sectorHeader(activeSector()).sequence + 1, 0xFFFFFFFF, 0};
+  header.crc = crc32Update(0, &header, 12);
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_erase_range(partition, next * FUEL_JOURNAL_SECTOR_SIZE,
+                                                      FUEL_JOURNAL_SECTOR_SIZE));
+  TEST_ASSERT_EQUAL(ESP_OK, esp_partition_write(partition, next * FUEL_JOURNAL_SECTOR_SIZE, &header, sizeof(header)));
+
+  assertRecovers(9, 3.5);
+  TEST_ASSERT_TRUE(fuelJournalAppend(8.5, 3.5));
+  assertRecovers(8.5, 3.5);
+}
+
+void test_service_limits_the_rate(void) {
+  fuelJournalBegin();
+  fuelJournalService(10, 4); // First one at once
+  assertRecovers(10, 4);
+
+  testAdvanceMillis(FUEL_JOURNAL_INTERVAL_MS - 1);
+  fuelJournalService(9.9f, 4);
+  assertRecovers(10, 4);
+  testAdvanceMillis(1);
+  fuelJournalService(9.9f, 4);
+  assertRecovers(9.9f, 4);
+
+  // Unchanged values are never written again
+  uint8_t before[FUEL_JOURNAL_SECTOR_SIZE];
+  memcpy(before, testPartitionBytes(partition).data() + activeSector() * FUEL_JOURNAL_SECTOR_SIZE, sizeof(before));
+  testAdvanceMillis(10 * FUEL_JOURNAL_INTERVAL_MS);
+  fuelJournalService(9.9f, 4);
+  fuelJournalFlush(9.9f, 4);
+  TEST_ASSERT_EQUAL_MEMORY(before, testPartitionBytes(partition).data() + activeSector() * FUEL_JOURNAL_SECTOR_SIZE,
+                           sizeof(before));
+
+  // Flush writes a pending change without waiting
+  fuelJournalService(9.8f, 4);
+  fuelJournalService(9.7f, 4);
+  assertRecovers(9.8f, 4);
+  fuelJournalFlush(9.7f, 4);
+  assertRecovers(9.7f, 4);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_without_partition);
+  RUN_TEST(test_empty_journal);
+  RUN_TEST(test_recovers_across_many_sectors);
+  RUN_TEST(test_torn_record_is_skipped);
+  RUN_TEST(test_new_sector_without_records_falls_back);
+  RUN_TEST(test_service_limits_the_rate);
+  return UNITY_END();
+}
@@ -0,0 +1,253 @@
+#include <Arduino.h>
+#include <string.h>
+#include <unity.h>
+#include <vector>
+#include "gps_link.h"
+#include "ubx.h"
+
+// A u-blox receiver at the other end of the UART
+struct Receiver {
+  bool present;
+  unsigned long baud;       // What it talks at
+  unsigned long maxBaud;    // CFG-PRT above this is ignored
+  unsigned long garbledBaud; // At this rate our commands reach it, but its output arrives garbled
+  bool pvt;                 // u-blox 7 and later
+  bool ignoresRate;         // ACKs CFG-RATE but keeps its rate
+  uint16_t measRateMs;
+  uint32_t nmeaDisabled;    // Bit per NMEA sentence id turned off with CFG-MSG
+  uint32_t messageCommands; // CFG-MSG received
+  uint32_t saves;           // CFG-CFG received
+  bool ubx;
+  uint32_t sentences;       // Valid sentences our side has received
+  unsigned long nextOutputMs;
+};
+
+static Receiver receiver;
+static unsigned long hostBaud;
+static std::vector<unsigned long> hostBauds; // Every rate our side was set to
+
+static bool reachesReceiver() {
+  return receiver.present && hostBaud == receiver.baud;
+}
+
+static bool heard() {
+  return reachesReceiver() && receiver.baud != receiver.garbledBaud;
+}
+
+static uint32_t sentences() {
+  return receiver.sentences;
+}
+
+static void setBaud(unsigned long baud) {
+  hostBaud = baud;
+  hostBauds.push_back(baud);
+}
+
+static void switchBaud(unsigned long baud) {
+  if (reachesReceiver() && baud <= receiver.maxBaud) {
+    receiver.baud = baud;
+  }
+  setBaud(baud);
+}
+
+static unsigned long currentBaud() {
+  return hostBaud;
+}
+
+static bool sendUbx(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length) {
+  // No answer we can read means no ACK
+  if (!heard() || cls != UBX_CLASS_CFG) {
+    return false;
+  }
+  switch (id) {
+    case UBX_CFG_MSG:
+      receiver.messageCommands++;
+      if (length == 3 && payload[0] == UBX_CLASS_NMEA && payload[2] == 0) {
+        receiver.nmeaDisabled |= 1u << payload[1];
+        return true;
+      }
+      return length == 3 && payload[0] == UBX_CLASS_NAV && (payload[1] != UBX_NAV_PVT || receiver.pvt);
+    case UBX_CFG_RATE:
+      if (length < 6) return false;
+      if (!receiver.ignoresRate) receiver.measRateMs = payload[0] | payload[1] << 8;
+      return true;
+    case UBX_CFG_CFG:
+      receiver.saves++;
+      return true;
+  }
+  return false;
+}
+
+static int16_t pollUbx(uint8_t cls, uint8_t id, uint8_t *out, uint16_t maxLength) {
+  if (!heard() || cls != UBX_CLASS_CFG || id != UBX_CFG_RATE || maxLength < 6) {
+    return -1;
+  }
+  uint8_t rate[6] = {(uint8_t)receiver.measRateMs, (uint8_t)(receiver.measRateMs >> 8), 1, 0, 1, 0};
+  memcpy(out, rate, sizeof(rate));
+  return sizeof(rate);
+}
+
+// What gpsConfigureUbx() does over the same link
+static bool configureUbx() {
+  uint8_t pvt[3] = {UBX_CLASS_NAV, UBX_NAV_PVT, 1};
+  uint8_t posllh[3] = {UBX_CLASS_NAV, UBX_NAV_POSLLH, 1};
+  if (!sendUbx(UBX_CLASS_CFG, UBX_CFG_MSG, pvt, 3) && !sendUbx(UBX_CLASS_CFG, UBX_CFG_MSG, posllh, 3)) {
+    return false;
+  }
+  receiver.ubx = true;
+  return true;
+}
+
+// Time passes; the receiver sends GGA and RMC every navigation epoch
+static void wait(uint32_t ms) {
+  testAdvanceMillis(ms);
+  while (receiver.present && millis() >= receiver.nextOutputMs) {
+    receiver.nextOutputMs += receiver.measRateMs;
+    if (heard()) receiver.sentences += 2;
+  }
+}
+
+static const GpsLinkTransport simulated = {sentences, setBaud, switchBaud, currentBaud,
+                                           sendUbx, pollUbx, configureUbx, wait};
+
+// A receiver as it comes from the factory
+static void factoryReceiver() {
+  receiver = {};
+  receiver.present = true;
+  receiver.baud = GPS_DEFAULT_BAUD;
+  receiver.maxBaud = 921600;
+  receiver.pvt = true;
+  receiver.measRateMs = 1000;
+  receiver.nextOutputMs = millis() + 300;
+  hostBaud = GPS_DEFAULT_BAUD;
+  hostBauds.clear();
+}
+
+void setUp(void) {
+  testMillis = 10000;
+  gpsLinkSetTransport(&simulated);
+  // Nobody answering also clears the link remembered in RTC memory
+  receiver = {};
+  gpsNegotiateLink(1, false);
+  factoryReceiver();
+}
+
+void tearDown(void) {}
+
+void test_factory_receiver_moves_to_the_fast_rate(void) {
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  GpsLinkState link = gpsLinkState();
+  TEST_ASSERT_EQUAL_UINT32(GPS_FAST_BAUD, link.baud);
+  TEST_ASSERT_EQUAL(GPS_FAST_BAUD, receiver.baud);
+  TEST_ASSERT_EQUAL(5, link.rateHz);
+  TEST_ASSERT_EQUAL(200, receiver.measRateMs);
+  TEST_ASSERT_TRUE(link.verified);
+  TEST_ASSERT_FALSE(link.ubx);
+  TEST_ASSERT_EQUAL_HEX32(1u << UBX_NMEA_GSV | 1u << UBX_NMEA_GLL | 1u << UBX_NMEA_VTG, receiver.nmeaDisabled);
+  TEST_ASSERT_EQUAL(1, receiver.saves);
+}
+
+void test_receiver_left_at_the_fallback_rate_is_found(void) {
+  receiver.baud = GPS_FALLBACK_BAUD;
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  // 9600 and 115200 are tried first
+  TEST_ASSERT_EQUAL(GPS_DEFAULT_BAUD, hostBauds[0]);
+  TEST_ASSERT_EQUAL(GPS_FAST_BAUD, hostBauds[1]);
+  TEST_ASSERT_EQUAL(GPS_FALLBACK_BAUD, hostBauds[2]);
+  TEST_ASSERT_EQUAL_UINT32(GPS_FAST_BAUD, gpsLinkState().baud);
+  TEST_ASSERT_TRUE(gpsLinkState().verified);
+}
+
+void test_refused_fast_rate_falls_back(void) {
+  receiver.maxBaud = 57600;
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  TEST_ASSERT_EQUAL_UINT32(GPS_FALLBACK_BAUD, gpsLinkState().baud);
+  TEST_ASSERT_EQUAL(GPS_FALLBACK_BAUD, receiver.baud);
+  TEST_ASSERT_TRUE(gpsLinkState().verified);
+  TEST_ASSERT_EQUAL(200, receiver.measRateMs);
+}
+
+// The receiver takes 115200 but its output doesn't survive the wiring at that rate
+void test_garbled_fast_rate_falls_back(void) {
+  receiver.garbledBaud = GPS_FAST_BAUD;
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  TEST_ASSERT_EQUAL_UINT32(GPS_FALLBACK_BAUD, gpsLinkState().baud);
+  TEST_ASSERT_EQUAL(GPS_FALLBACK_BAUD, receiver.baud);
+  TEST_ASSERT_TRUE(gpsLinkState().verified);
+  TEST_ASSERT_EQUAL(1, receiver.saves);
+}
+
+// Neither faster rate works: NMEA at 9600 only carries two epochs a second
+void test_slow_link_caps_the_rate(void) {
+  receiver.maxBaud = GPS_DEFAULT_BAUD;
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  TEST_ASSERT_EQUAL_UINT32(GPS_DEFAULT_BAUD, gpsLinkState().baud);
+  TEST_ASSERT_EQUAL(GPS_SLOW_LINK_MAX_RATE_HZ, gpsLinkState().rateHz);
+  TEST_ASSERT_EQUAL(1000 / GPS_SLOW_LINK_MAX_RATE_HZ, receiver.measRateMs);
+  TEST_ASSERT_TRUE(gpsLinkState().verified);
+}
+
+// An ACK isn't enough: the rate read back has to match, and an unverified setup isn't saved
+void test_rate_is_verified_by_polling(void) {
+  receiver.ignoresRate = true;
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  TEST_ASSERT_FALSE(gpsLinkState().verified);
+  TEST_ASSERT_EQUAL(0, receiver.saves);
+
+  receiver.ignoresRate = false;
+  TEST_ASSERT_TRUE(gpsSetNavRate(2));
+  TEST_ASSERT_EQUAL(500, receiver.measRateMs);
+  TEST_ASSERT_TRUE(gpsSetNavRate(1));
+  TEST_ASSERT_EQUAL(1000, receiver.measRateMs);
+  TEST_ASSERT_TRUE(gpsSetNavRate(50)); // Clamped to what the link is set up for
+  TEST_ASSERT_EQUAL(1000 / GPS_MAX_RATE_HZ, receiver.measRateMs);
+}
+
+// After deep sleep the remembered rate is tried first and the receiver isn't set up again
+void test_remembered_link_after_sleep(void) {
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  uint32_t commands = receiver.messageCommands;
+  hostBauds.clear();
+  hostBaud = GPS_DEFAULT_BAUD; // The UART comes up at the default after a wake
+
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, false));
+  TEST_ASSERT_EQUAL(GPS_FAST_BAUD, hostBauds[0]);
+  TEST_ASSERT_EQUAL(1, hostBauds.size());
+  TEST_ASSERT_EQUAL(commands, receiver.messageCommands);
+  TEST_ASSERT_EQUAL(1, receiver.saves);
+  TEST_ASSERT_TRUE(gpsLinkState().verified);
+}
+
+void test_ubx_navigation(void) {
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, true));
+  TEST_ASSERT_TRUE(gpsLinkState().ubx);
+
+  // A NEO-6M NAKs NAV-PVT and gets the separate messages
+  setUp();
+  receiver.pvt = false;
+  TEST_ASSERT_TRUE(gpsNegotiateLink(5, true));
+  TEST_ASSERT_TRUE(gpsLinkState().ubx);
+  TEST_ASSERT_TRUE(receiver.ubx);
+}
+
+void test_silent_receiver(void) {
+  receiver.present = false;
+  TEST_ASSERT_FALSE(gpsNegotiateLink(5, false));
+  TEST_ASSERT_EQUAL_UINT32(0, gpsLinkState().baud);
+  TEST_ASSERT_EQUAL(GPS_DEFAULT_BAUD, hostBaud);
+  TEST_ASSERT_FALSE(gpsSetNavRate(5));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_factory_receiver_moves_to_the_fast_rate);
+  RUN_TEST(test_receiver_left_at_the_fallback_rate_is_found);
+  RUN_TEST(test_refused_fast_rate_falls_back);
+  RUN_TEST(test_garbled_fast_rate_falls_back);
+  RUN_TEST(test_slow_link_caps_the_rate);
+  RUN_TEST(test_rate_is_verified_by_polling);
+  RUN_TEST(test_remembered_link_after_sleep);
+  RUN_TEST(test_ubx_navigation);
+  RUN_TEST(test_silent_receiver);
+  return UNITY_END();
+}
@@ -0,0 +1,247 @@
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <mutex>
+#include <random>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <unity.h>
+#include <vector>
+#include "gps_stream.h"
+
+#define EPOCHS 600 // A minute at 10 Hz
+
+// A capture in the shape a u-blox receiver at 10 Hz sends: GGA and RMC every
+// epoch, GSA and three GSV once a second, a few sentences hit by line noise
+struct Capture {
+  std::string bytes;
+  uint32_t sentences;
+  uint32_t corrupted;
+};
+
+static std::string sentence(const char *body) {
+  uint8_t checksum = 0;
+  for (const char *c = body; *c; c++) checksum ^= *c;
+  char line[120];
+  snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+  return line;
+}
+
+static std::string coordinate(double degrees, int degreeDigits) {
+  double whole = floor(fabs(degrees));
+  char text[20];
+  snprintf(text, sizeof(text), "%0*d%08.5f", degreeDigits, (int)whole, (fabs(degrees) - whole) * 60);
+  return text;
+}
+
+// Where the capture puts the receiver at each epoch: flying east at 90 km/h
+static double epochLat(int epoch) {
+  return 47.3977 + epoch * 1e-6;
+}
+
+static double epochLon(int epoch) {
+  return 8.5456 + epoch * 3.7e-5;
+}
+
+static double epochKnots(int epoch) {
+  return 48.6 + (epoch % 7) * 0.1;
+}
+
+static Capture record(uint32_t seed, bool noise = true, bool gga = true) {
+  std::mt19937 rng(seed);
+  Capture capture = {"", 0, 0};
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    int centis = epoch * 10;
+    char stamp[16];
+    snprintf(stamp, sizeof(stamp), "1200%02d.%02d", centis / 100 % 60, centis % 100);
+    std::string lat = coordinate(epochLat(epoch), 2), lon = coordinate(epochLon(epoch), 3);
+    char body[100];
+    std::vector<std::string> lines;
+    snprintf(body, sizeof(body), "GNGGA,%s,%s,N,%s,E,1,09,0.9,%.1f,M,47.0,M,,", stamp, lat.c_str(), lon.c_str(),
+             812.4 + epoch * 0.1);
+    if (gga) lines.push_back(sentence(body));
+    snprintf(body, sizeof(body), "GNRMC,%s,A,%s,N,%s,E,%.2f,%.2f,170926,,,A", stamp, lat.c_str(), lon.c_str(),
+             epochKnots(epoch), 88.5 + (epoch % 5) * 0.2);
+    lines.push_back(sentence(body));
+    if (epoch % 10 == 9) {
+      lines.push_back(sentence("GNGSA,A,3,02,05,12,15,18,24,25,29,,,,,1.6,0.9,1.3"));
+      for (int i = 1; i <= 3; i++) {
+        snprintf(body, sizeof(body), "GPGSV,3,%d,11,%02d,45,120,38,%02d,30,200,35,%02d,12,310,29,%02d,70,050,41", i,
+                 i * 4, i * 4 + 1, i * 4 + 2, i * 4 + 3);
+        lines.push_back(sentence(body));
+      }
+    }
+    for (std::string &line : lines) {
+      if (noise && rng() % 100 == 0) {
+        // A digit in the time stamp flips: still a well-formed sentence, but the checksum fails
+        line[8] = line[8] == '0' ? '1' : '0';
+        capture.corrupted++;
+      } else {
+        capture.sentences++;
+      }
+      capture.bytes += line;
+    }
+  }
+  return capture;
+}
+
+// The snapshot handoff of gps_ingest, with a std::mutex for the FreeRTOS one
+static std::mutex snapshotLock;
+static GpsFix snapshot;
+static bool snapshotFresh;
+static std::vector<GpsFix> published;
+
+static void onFix(const GpsFix &fix) {
+  published.push_back(fix);
+  std::lock_guard<std::mutex> hold(snapshotLock);
+  snapshot = fix;
+  snapshotFresh = true;
+}
+
+static bool sync(GpsFix &fix) {
+  std::lock_guard<std::mutex> hold(snapshotLock);
+  if (!snapshotFresh) return false;
+  fix = snapshot;
+  snapshotFresh = false;
+  return true;
+}
+
+void setUp(void) {
+  testMillis = 1000;
+  gpsStreamReset();
+  gpsStreamOnFix(onFix);
+  snapshotFresh = false;
+  published.clear();
+}
+
+void tearDown(void) {
+  gpsStreamOnFix(nullptr);
+}
+
+// The ingest side feeds the capture in UART-sized reads at its own pace while
+// the UI side keeps stalling for whole screen refreshes. Nothing the receiver
+// sent may go missing, and the UI always catches up with the newest fix.
+void test_replay_with_a_stalled_consumer(void) {
+  Capture capture = record(1);
+  std::atomic<bool> finished(false);
+  uint32_t synced = 0;
+  GpsFix latest = {};
+
+  std::thread ui([&] {
+    std::mt19937 rng(2);
+    while (!finished.load()) {
+      if (sync(latest)) synced++;
+      if (rng() % 4 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5)); // Refreshing the panel
+      std::this_thread::yield();
+    }
+    if (sync(latest)) synced++;
+  });
+
+  std::mt19937 rng(3);
+  size_t epochBytes = capture.bytes.size() / EPOCHS;
+  for (size_t at = 0, nextEpoch = epochBytes; at < capture.bytes.size();) {
+    size_t count = std::min((size_t)(1 + rng() % 128), capture.bytes.size() - at);
+    gpsStreamFeed((const uint8_t *)capture.bytes.data() + at, count);
+    at += count;
+    if (at >= nextEpoch) {
+      testAdvanceMillis(100);
+      nextEpoch += epochBytes;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  finished.store(true);
+  ui.join();
+
+  GpsStreamStats stats = gpsStreamStats();
+  char message[120];
+  snprintf(message, sizeof(message), "%u sentences, %u checksum failures, %u fixes published, %u picked up",
+           (unsigned)stats.sentences, (unsigned)stats.checksumFailures, (unsigned)stats.fixes, (unsigned)synced);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(capture.sentences, stats.sentences);
+  TEST_ASSERT_EQUAL_UINT32(capture.corrupted, stats.checksumFailures);
+  TEST_ASSERT_GREATER_THAN(0, capture.corrupted);
+  TEST_ASSERT_EQUAL(GPS_SOURCE_NMEA, stats.source);
+
+  // One fix per epoch, give or take the last one losing a sentence; the UI
+  // skipped some while it stalled, but ended on the last one
+  TEST_ASSERT_UINT32_WITHIN(1, EPOCHS, stats.fixes);
+  TEST_ASSERT_LESS_THAN(stats.fixes, synced);
+  TEST_ASSERT_EQUAL_MEMORY(&published.back(), &latest, sizeof(GpsFix));
+  TEST_ASSERT_EQUAL(59, latest.time.s);
+  TEST_ASSERT_INT32_WITHIN(2, navPointFromDegrees(epochLat(EPOCHS - 1), epochLon(EPOCHS - 1)).lat,
+                           latest.location.point.lat);
+  TEST_ASSERT_INT32_WITHIN(2, navPointFromDegrees(epochLat(EPOCHS - 1), epochLon(EPOCHS - 1)).lon,
+                           latest.location.point.lon);
+}
+
+static void feed(const Capture &capture) {
+  gpsStreamFeed((const uint8_t *)capture.bytes.data(), capture.bytes.size());
+}
+
+static void assertEpoch(const GpsFix &fix, int epoch) {
+  NavPoint expected = navPointFromDegrees(epochLat(epoch), epochLon(epoch));
+  TEST_ASSERT_INT32_WITHIN(2, expected.lat, fix.location.point.lat);
+  TEST_ASSERT_INT32_WITHIN(2, expected.lon, fix.location.point.lon);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, epochKnots(epoch) * 1.852, fix.speed.value);
+  TEST_ASSERT_EQUAL(epoch * 10 / 100 % 60, fix.time.s);
+}
+
+// GGA and RMC of an epoch go out together: the position never comes with the previous epoch's speed
+void test_one_fix_per_epoch(void) {
+  feed(record(5, false));
+  TEST_ASSERT_EQUAL(EPOCHS, published.size());
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    assertEpoch(published[epoch], epoch);
+  }
+}
+
+// A receiver that only sends RMC: the first epoch waits for the second, then every RMC is a fix
+void test_rmc_only_receiver(void) {
+  feed(record(6, false, false));
+  TEST_ASSERT_EQUAL(EPOCHS, published.size());
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    TEST_ASSERT_INT32_WITHIN(2, navPointFromDegrees(epochLat(epoch), epochLon(epoch)).lat,
+                             published[epoch].location.point.lat);
+  }
+}
+
+// A lost RMC leaves its epoch and the next one with the old speed, then GGA and RMC are paired again
+void test_lost_sentence_recovers(void) {
+  Capture capture = record(7, false);
+  size_t rmc = capture.bytes.find("$GNRMC,120010.00"); // Epoch 100
+  capture.bytes[rmc + 1] = 'X';
+  feed(capture);
+  TEST_ASSERT_EQUAL(EPOCHS, published.size());
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    if (epoch == 100 || epoch == 101) {
+      TEST_ASSERT_FLOAT_WITHIN(0.01, epochKnots(99) * 1.852, published[epoch].speed.value);
+    } else {
+      assertEpoch(published[epoch], epoch);
+    }
+  }
+}
+
+// However the reads split the capture, the same sentences come out
+void test_read_sizes_do_not_matter(void) {
+  Capture capture = record(4);
+  for (size_t chunk : {(size_t)1, (size_t)7, (size_t)128, capture.bytes.size()}) {
+    setUp();
+    for (size_t at = 0; at < capture.bytes.size(); at += chunk) {
+      gpsStreamFeed((const uint8_t *)capture.bytes.data() + at, std::min(chunk, capture.bytes.size() - at));
+    }
+    TEST_ASSERT_EQUAL_UINT32(capture.sentences, gpsStreamStats().sentences);
+    TEST_ASSERT_EQUAL_UINT32(capture.corrupted, gpsStreamStats().checksumFailures);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_with_a_stalled_consumer);
+  RUN_TEST(test_one_fix_per_epoch);
+  RUN_TEST(test_rmc_only_receiver);
+  RUN_TEST(test_lost_sentence_recovers);
+  RUN_TEST(test_read_sizes_do_not_matter);
+  return UNITY_END();
+}
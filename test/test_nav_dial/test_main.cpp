@@ -0,0 +1,85 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "nav_dial.h"
+
+#define SIZE 200
+#define FRAME_BYTES ((SIZE + 7) / 8 * SIZE)
+#define ROUNDS 500
+
+static GFXcanvas1 frame(SIZE, SIZE);
+static GFXcanvas1 flying(SIZE, SIZE);
+static GFXcanvas1 walking(SIZE, SIZE);
+
+static bool black(const GFXcanvas1 &canvas, int x, int y) {
+  return !canvas.getPixel(x, y);
+}
+
+void setUp(void) {
+  drawNavigationBackground(flying, 100, 100, MODE_FLYING);
+  drawNavigationBackground(walking, 100, 100, MODE_WALKING);
+}
+
+void tearDown(void) {}
+
+void test_background_art(void) {
+  for (int i = 0; i < SIZE; i++) {
+    TEST_ASSERT_TRUE(black(flying, i, 0));
+    TEST_ASSERT_TRUE(black(flying, 0, i));
+    TEST_ASSERT_TRUE(black(flying, i, SIZE - 1));
+    TEST_ASSERT_TRUE(black(flying, SIZE - 1, i));
+  }
+  // Both outer rings, the middle one, and the jerry can around the fuel digits
+  TEST_ASSERT_TRUE(black(flying, 100, 5));
+  TEST_ASSERT_TRUE(black(flying, 100, 4));
+  TEST_ASSERT_TRUE(black(flying, 30, 100));
+  TEST_ASSERT_TRUE(black(flying, 68, 100));
+  TEST_ASSERT_FALSE(black(flying, 100, 100));
+  TEST_ASSERT_FALSE(black(flying, 100, 50));
+}
+
+void test_modes_differ_only_in_the_icon(void) {
+  int differing = 0;
+  for (int y = 0; y < SIZE; y++) {
+    for (int x = 0; x < SIZE; x++) {
+      if (flying.getPixel(x, y) == walking.getPixel(x, y)) continue;
+      differing++;
+      TEST_ASSERT_INT_WITHIN(12, 180, x);
+      TEST_ASSERT_INT_WITHIN(12, 20, y);
+    }
+  }
+  TEST_ASSERT_GREATER_THAN(0, differing);
+}
+
+// Every navigation screen starts from the dial: drawn again, or copied from
+// the cached layer the way EpdFrame::copyFrom() does
+void test_blit_beats_redraw(void) {
+  unsigned long start = micros();
+  for (int i = 0; i < ROUNDS; i++) {
+    drawNavigationBackground(frame, 100, 100, i & 1 ? MODE_WALKING : MODE_FLYING);
+  }
+  unsigned long redrawUs = micros() - start;
+  TEST_ASSERT_EQUAL_MEMORY(walking.getBuffer(), frame.getBuffer(), FRAME_BYTES);
+
+  start = micros();
+  for (int i = 0; i < ROUNDS; i++) {
+    memcpy(frame.getBuffer(), (i & 1 ? walking : flying).getBuffer(), FRAME_BYTES);
+  }
+  unsigned long blitUs = micros() - start;
+  TEST_ASSERT_EQUAL_MEMORY(walking.getBuffer(), frame.getBuffer(), FRAME_BYTES);
+
+  char message[100];
+  snprintf(message, sizeof(message), "dial redraw %.2f us, background blit %.2f us", (double)redrawUs / ROUNDS,
+           (double)blitUs / ROUNDS);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(redrawUs / 10, blitUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_background_art);
+  RUN_TEST(test_modes_differ_only_in_the_icon);
+  RUN_TEST(test_blit_beats_redraw);
+  return UNITY_END();
+}
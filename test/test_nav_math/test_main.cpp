@@ -0,0 +1,134 @@
+#include <math.h>
+#include <random>
+#include <unity.h>
+#include "nav_math.h"
+
+// TinyGPSPlus::distanceBetween and courseTo, in double, as the reference
+static double radians(double degrees) {
+  return degrees * M_PI / 180;
+}
+
+static double referenceDistance(double lat1, double lon1, double lat2, double lon2) {
+  double delta = radians(lon1 - lon2);
+  double sdlong = sin(delta), cdlong = cos(delta);
+  lat1 = radians(lat1);
+  lat2 = radians(lat2);
+  double slat1 = sin(lat1), clat1 = cos(lat1), slat2 = sin(lat2), clat2 = cos(lat2);
+  delta = clat1 * slat2 - slat1 * clat2 * cdlong;
+  delta = delta * delta + (clat2 * sdlong) * (clat2 * sdlong);
+  delta = sqrt(delta);
+  double denom = slat1 * slat2 + clat1 * clat2 * cdlong;
+  return atan2(delta, denom) * 6372795;
+}
+
+static double referenceCourse(double lat1, double lon1, double lat2, double lon2) {
+  double dlon = radians(lon2 - lon1);
+  lat1 = radians(lat1);
+  lat2 = radians(lat2);
+  double a1 = sin(dlon) * cos(lat2);
+  double a2 = cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(dlon);
+  double course = atan2(a1, a2);
+  if (course < 0) course += 2 * M_PI;
+  return course * 180 / M_PI;
+}
+
+static double courseError(double a, double b) {
+  double error = fabs(a - b);
+  return error > 180 ? 360 - error : error;
+}
+
+// Random pairs between 70S and 70N with both deltas within span degrees,
+// checked against the accuracy nav_math.h promises
+static void checkSpan(double span, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0, 1);
+  for (int i = 0; i < 20000; i++) {
+    double lat = -70 + 140 * unit(rng), lon = -180 + 360 * unit(rng);
+    double lat2 = lat + span * (2 * unit(rng) - 1), lon2 = lon + span * (2 * unit(rng) - 1);
+    if (lon2 > 180) lon2 -= 360;
+    if (lon2 < -180) lon2 += 360;
+    NavPoint a = navPointFromDegrees(lat, lon), b = navPointFromDegrees(lat2, lon2);
+    // Compare on the quantised points, so only the kernels' error is measured
+    double expected = referenceDistance(navLatDegrees(a), navLonDegrees(a), navLatDegrees(b), navLonDegrees(b));
+    double expectedCourse = referenceCourse(navLatDegrees(a), navLonDegrees(a), navLatDegrees(b), navLonDegrees(b));
+
+    float meters, course;
+    navDistanceCourse(navOrigin(a), b, &meters, &course);
+    double allowed = span <= 0.45 ? 0.5 : 0.5 + expected * 0.00015;
+    TEST_ASSERT_FLOAT_WITHIN(allowed, expected, meters);
+    TEST_ASSERT_TRUE(course >= 0 && course < 360);
+    if (expected > 10) {
+      TEST_ASSERT_LESS_THAN(0.003, courseError(course, expectedCourse));
+    }
+    TEST_ASSERT_EQUAL_FLOAT(meters, navDistanceMeters(navOrigin(a), b));
+    TEST_ASSERT_EQUAL_FLOAT(course, navCourseDegrees(navOrigin(a), b));
+  }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_short_distances(void) {
+  checkSpan(0.0005, 1);
+  checkSpan(0.005, 2);
+  checkSpan(0.05, 3);
+}
+
+void test_flat_projection_range(void) {
+  checkSpan(0.45, 4);
+  checkSpan(1.9, 5);
+}
+
+void test_great_circle_range(void) {
+  checkSpan(2.1, 6);
+  checkSpan(10, 7);
+  checkSpan(60, 8);
+}
+
+void test_same_point_is_zero(void) {
+  NavPoint p = navPointFromDegrees(47.123456, 8.654321);
+  float meters, course;
+  navDistanceCourse(navOrigin(p), p, &meters, &course);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0, meters);
+}
+
+void test_cardinal_courses(void) {
+  NavOrigin origin = navOrigin(navPointFromDegrees(46, 7));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 0, navCourseDegrees(origin, navPointFromDegrees(46.01, 7)));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 90, navCourseDegrees(origin, navPointFromDegrees(46, 7.01)));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 180, navCourseDegrees(origin, navPointFromDegrees(45.99, 7)));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 270, navCourseDegrees(origin, navPointFromDegrees(46, 6.99)));
+}
+
+void test_across_the_antimeridian(void) {
+  NavOrigin origin = navOrigin(navPointFromDegrees(-17, 179.99));
+  NavPoint east = navPointFromDegrees(-17, -179.99);
+  TEST_ASSERT_FLOAT_WITHIN(0.5, referenceDistance(-17, 179.99, -17, -179.99), navDistanceMeters(origin, east));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 90, navCourseDegrees(origin, east));
+}
+
+void test_points_from_raw_and_degrees(void) {
+  // TinyGPSPlus raw degrees: whole degrees plus billionths
+  NavPoint p = navPointFromRaw(47, 123456789, false, 8, 987654321, true);
+  TEST_ASSERT_EQUAL_INT32(471234568, p.lat);
+  TEST_ASSERT_EQUAL_INT32(-89876543, p.lon);
+  TEST_ASSERT_FLOAT_WITHIN(1e-7, 47.1234568, navLatDegrees(p));
+  TEST_ASSERT_FLOAT_WITHIN(1e-7, -8.9876543, navLonDegrees(p));
+
+  NavPoint q = navPointFromDegrees(-33.8567844, 151.2152967);
+  TEST_ASSERT_EQUAL_INT32(-338567844, q.lat);
+  TEST_ASSERT_EQUAL_INT32(1512152967, q.lon);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_short_distances);
+  RUN_TEST(test_flat_projection_range);
+  RUN_TEST(test_great_circle_range);
+  RUN_TEST(test_same_point_is_zero);
+  RUN_TEST(test_cardinal_courses);
+  RUN_TEST(test_across_the_antimeridian);
+  RUN_TEST(test_points_from_raw_and_degrees);
+  return UNITY_END();
+}
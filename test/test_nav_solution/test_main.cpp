@@ -0,0 +1,123 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+#include "nav_solution.h"
+
+static GpsFix fix;
+
+static void setFix(double lat, double lon, float course, float kmh) {
+  fix.location = {true, navPointFromDegrees(lat, lon)};
+  fix.course = {true, course};
+  fix.speed = {true, kmh};
+  fix.updateMillis = millis();
+}
+
+// Targets scattered up to about 30 km around the fix, a few of them disabled
+static std::vector<NavTarget> scatter(size_t count) {
+  std::vector<NavTarget> targets(count);
+  for (NavTarget &target : targets) {
+    target = {};
+    target.point = navPointFromDegrees(47.0 + (rand() % 6000 - 3000) / 10000.0, 8.0 + (rand() % 8000 - 4000) / 10000.0);
+    target.enabled = rand() % 8 != 0;
+  }
+  return targets;
+}
+
+static NavTarget enabledAt(double lat, double lon) {
+  NavTarget target = {};
+  target.point = navPointFromDegrees(lat, lon);
+  target.enabled = true;
+  return target;
+}
+
+void setUp(void) {
+  srand(1);
+  fix = {};
+  testMillis = 1000;
+  setFix(47.0, 8.0, 90.0f, 60.0f);
+}
+
+void tearDown(void) {}
+
+// Every enabled target gets the same answer as computing it on its own
+void test_targets_match_the_kernel(void) {
+  std::vector<NavTarget> targets = scatter(50);
+  navSolutionUpdate(fix, targets.data(), targets.size());
+  TEST_ASSERT_TRUE(navSolution().valid);
+  TEST_ASSERT_EQUAL_FLOAT(90.0f, navSolution().headingDegrees);
+  NavOrigin origin = navOrigin(fix.location.point);
+  for (const NavTarget &target : targets) {
+    if (!target.enabled) {
+      TEST_ASSERT_EQUAL_FLOAT(0.0f, target.distanceMeters);
+      TEST_ASSERT_LESS_THAN(0.0f, target.etaSeconds);
+      continue;
+    }
+    float meters, course;
+    navDistanceCourse(origin, target.point, &meters, &course);
+    TEST_ASSERT_EQUAL_FLOAT(meters, target.distanceMeters);
+    TEST_ASSERT_EQUAL_FLOAT(course, target.courseDegrees);
+    TEST_ASSERT_TRUE(target.relativeBearing >= -180.0f && target.relativeBearing <= 180.0f);
+    float relative = fmodf(course - 90.0f + 540.0f, 360.0f) - 180.0f;
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, relative, target.relativeBearing);
+  }
+}
+
+void test_eta_from_closing_speed(void) {
+  NavTarget targets[3] = {
+    enabledAt(47.0, 8.1),  // Ahead, east
+    enabledAt(47.0, 7.9),  // Behind
+    enabledAt(47.05, 8.0), // Abeam, north
+  };
+  navSolutionUpdate(fix, targets, 3);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, targets[0].distanceMeters / (60.0f / 3.6f), targets[0].etaSeconds);
+  TEST_ASSERT_LESS_THAN(0.0f, targets[1].etaSeconds);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, -90.0f, targets[2].relativeBearing);
+  TEST_ASSERT_LESS_THAN(0.0f, targets[2].etaSeconds);
+}
+
+// Without a position every target is cleared, whatever it held before
+void test_lost_fix_clears_targets(void) {
+  std::vector<NavTarget> targets = scatter(10);
+  navSolutionUpdate(fix, targets.data(), targets.size());
+  fix.location.valid = false;
+  navSolutionUpdate(fix, targets.data(), targets.size());
+  TEST_ASSERT_FALSE(navSolution().valid);
+  for (const NavTarget &target : targets) {
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, target.distanceMeters);
+    TEST_ASSERT_LESS_THAN(0.0f, target.etaSeconds);
+  }
+}
+
+// The three POIs as on the device, then a route and a waypoint set
+void test_update_timing(void) {
+  const size_t counts[] = {3, 100, 1000};
+  double nsPerTarget[3];
+  for (uint8_t c = 0; c < 3; c++) {
+    std::vector<NavTarget> targets = scatter(counts[c]);
+    const uint32_t rounds = 200000 / counts[c];
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < rounds; i++) {
+      fix.course.value = (float)(i % 360);
+      navSolutionUpdate(fix, targets.data(), targets.size());
+    }
+    unsigned long elapsedUs = micros() - start;
+    nsPerTarget[c] = elapsedUs * 1000.0 / rounds / counts[c];
+    char message[120];
+    snprintf(message, sizeof(message), "%u targets: %.2f us per fix, %.1f ns per target", (unsigned)counts[c],
+             (double)elapsedUs / rounds, nsPerTarget[c]);
+    TEST_MESSAGE(message);
+  }
+  // Linear: the per-target cost doesn't grow with the count
+  TEST_ASSERT_LESS_THAN(nsPerTarget[1] * 3, nsPerTarget[2]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_targets_match_the_kernel);
+  RUN_TEST(test_eta_from_closing_speed);
+  RUN_TEST(test_lost_fix_clears_targets);
+  RUN_TEST(test_update_timing);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <EEPROM.h>
+#include <stddef.h>
+#include <unity.h>
+#include "crc32.h"
+#include "settings.h"
+
+// Offsets of the pre-versioned layout, see settings.cpp
+#define LEGACY_HOME_OFFSET 0
+#define LEGACY_POI_OFFSET 16
+#define LEGACY_FUEL_OFFSET 33
+#define LEGACY_MODE_OFFSET 83
+
+#define HEADER_SIZE offsetof(Settings, homeLatitude)
+
+template <typename T>
+static void plant(int offset, const T &value) {
+  memcpy(EEPROM.flash + offset, &value, sizeof(T));
+}
+
+static Settings flashRecord() {
+  Settings record;
+  memcpy(&record, EEPROM.flash, sizeof(record));
+  return record;
+}
+
+// Reboot: a fresh load of whatever flash holds now
+static bool reload(Settings &s) {
+  return settingsLoad(s);
+}
+
+void setUp(void) {
+  EEPROM.erase();
+  EEPROM.commits = 0;
+  testMillis = 1000;
+}
+
+void tearDown(void) {}
+
+void test_blank_eeprom_gives_defaults_and_writes_them(void) {
+  Settings s;
+  TEST_ASSERT_FALSE(settingsLoad(s));
+  TEST_ASSERT_EQUAL_FLOAT(SETTINGS_DEFAULT_FUEL_LEVEL, s.fuelLevel);
+  TEST_ASSERT_EQUAL_FLOAT(SETTINGS_DEFAULT_BURN_RATE, s.fuelBurnRate);
+  TEST_ASSERT_EQUAL(SETTINGS_DEFAULT_MODE, s.operationMode);
+
+  settingsFlush();
+  TEST_ASSERT_EQUAL(1, EEPROM.commits);
+  Settings again;
+  TEST_ASSERT_TRUE(reload(again));
+  TEST_ASSERT_EQUAL_MEMORY(&s, &again, sizeof(Settings));
+}
+
+void test_legacy_layout_is_migrated(void) {
+  // Saved the old way: POIs first, then the fuel values on top of them, then the mode
+  double home[2] = {46.5, 7.25};
+  double lats[SETTINGS_POI_COUNT] = {46.1, 46.2, 46.3};
+  double lons[SETTINGS_POI_COUNT] = {7.1, 7.2, 7.3};
+  uint8_t enabled[SETTINGS_POI_COUNT] = {1, 1, 0};
+  double fuel[2] = {9.5, 3.75};
+  uint8_t mode = 2;
+  plant(LEGACY_HOME_OFFSET, home);
+  plant(LEGACY_POI_OFFSET, lats);
+  plant(LEGACY_POI_OFFSET + sizeof(lats), lons);
+  plant(LEGACY_POI_OFFSET + sizeof(lats) + sizeof(lons), enabled);
+  plant(LEGACY_FUEL_OFFSET, fuel);
+  plant(LEGACY_MODE_OFFSET, mode);
+
+  Settings s;
+  TEST_ASSERT_TRUE(settingsLoad(s));
+  TEST_ASSERT_EQUAL_FLOAT(46.5, s.homeLatitude);
+  TEST_ASSERT_EQUAL_FLOAT(7.25, s.homeLongitude);
+  // POI 2 is the only one the fuel values didn't overwrite
+  TEST_ASSERT_EQUAL_FLOAT(46.2, s.poiLatitudes[1]);
+  TEST_ASSERT_EQUAL_FLOAT(7.2, s.poiLongitudes[1]);
+  TEST_ASSERT_EQUAL(1, s.poiEnabled[1]);
+  TEST_ASSERT_EQUAL_FLOAT(9.5, s.fuelLevel);
+  TEST_ASSERT_EQUAL_FLOAT(3.75, s.fuelBurnRate);
+  TEST_ASSERT_EQUAL(2, s.operationMode);
+  TEST_ASSERT_EQUAL(0, s.burnModel.events);
+
+  // Rewritten in the current format, and read back as such
+  settingsFlush();
+  Settings record = flashRecord();
+  TEST_ASSERT_EQUAL_HEX32(SETTINGS_MAGIC, record.magic);
+  TEST_ASSERT_EQUAL(SETTINGS_VERSION, record.version);
+  TEST_ASSERT_EQUAL(sizeof(Settings), record.length);
+  Settings again;
+  TEST_ASSERT_TRUE(reload(again));
+  TEST_ASSERT_EQUAL_MEMORY(&s, &again, sizeof(Settings));
+}
+
+void test_legacy_garbage_falls_back_to_defaults(void) {
+  double nan2[2] = {NAN, NAN};
+  plant(LEGACY_HOME_OFFSET, nan2);
+  plant(LEGACY_FUEL_OFFSET, nan2);
+  uint8_t mode = 7;
+  plant(LEGACY_MODE_OFFSET, mode);
+
+  Settings s;
+  settingsLoad(s);
+  TEST_ASSERT_EQUAL_FLOAT(0, s.homeLatitude);
+  TEST_ASSERT_EQUAL_FLOAT(SETTINGS_DEFAULT_FUEL_LEVEL, s.fuelLevel);
+  TEST_ASSERT_EQUAL_FLOAT(SETTINGS_DEFAULT_BURN_RATE, s.fuelBurnRate);
+  TEST_ASSERT_EQUAL(SETTINGS_DEFAULT_MODE, s.operationMode);
+}
+
+void test_version_1_record_is_upgraded(void) {
+  // Version 1 ended before the burn model
+  Settings v1 = {};
+  v1.magic = SETTINGS_MAGIC;
+  v1.version = 1;
+  v1.length = offsetof(Settings, burnModel);
+  v1.homeLatitude = -33.5;
+  v1.homeLongitude = 151.25;
+  v1.fuelLevel = 7;
+  v1.fuelBurnRate = 5;
+  v1.operationMode = 2;
+  v1.crc = crc32Update(0, (const uint8_t *)&v1 + HEADER_SIZE, v1.length - HEADER_SIZE);
+  memset(&v1.burnModel, 0xA5, sizeof(v1.burnModel)); // Whatever followed the old record
+  plant(0, v1);
+
+  Settings s;
+  TEST_ASSERT_TRUE(settingsLoad(s));
+  TEST_ASSERT_EQUAL_FLOAT(-33.5, s.homeLatitude);
+  TEST_ASSERT_EQUAL_FLOAT(151.25, s.homeLongitude);
+  TEST_ASSERT_EQUAL_FLOAT(7, s.fuelLevel);
+  TEST_ASSERT_EQUAL(2, s.operationMode);
+  TEST_ASSERT_EQUAL(0, s.burnModel.events); // Defaults, not the bytes after the old record
+
+  settingsFlush();
+  TEST_ASSERT_EQUAL(sizeof(Settings), flashRecord().length);
+  TEST_ASSERT_EQUAL(SETTINGS_VERSION, flashRecord().version);
+}
+
+void test_corrupt_record_is_not_loaded(void) {
+  Settings s;
+  settingsLoad(s);
+  s.fuelLevel = 5;
+  settingsStore(s);
+  settingsFlush();
+  EEPROM.flash[offsetof(Settings, fuelLevel)] ^= 0x10;
+
+  Settings again;
+  TEST_ASSERT_FALSE(reload(again));
+  TEST_ASSERT_EQUAL_FLOAT(SETTINGS_DEFAULT_FUEL_LEVEL, again.fuelLevel);
+}
+
+void test_burst_of_changes_is_one_commit(void) {
+  Settings s;
+  settingsLoad(s);
+  settingsFlush();
+  EEPROM.commits = 0;
+
+  for (int i = 0; i < 5; i++) {
+    s.fuelLevel = 10 - i;
+    settingsStore(s);
+    testAdvanceMillis(2000);
+    settingsService();
+  }
+  TEST_ASSERT_EQUAL(0, EEPROM.commits);
+  testAdvanceMillis(SETTINGS_COMMIT_DELAY_MS - 2000 - 1);
+  settingsService();
+  TEST_ASSERT_EQUAL(0, EEPROM.commits);
+  testAdvanceMillis(1);
+  settingsService();
+  TEST_ASSERT_EQUAL(1, EEPROM.commits);
+  TEST_ASSERT_EQUAL_FLOAT(6, flashRecord().fuelLevel);
+
+  // Nothing more to write
+  testAdvanceMillis(SETTINGS_COMMIT_MAX_DELAY_MS);
+  settingsService();
+  TEST_ASSERT_EQUAL(1, EEPROM.commits);
+}
+
+void test_steady_changes_commit_by_the_max_delay(void) {
+  Settings s;
+  settingsLoad(s);
+  settingsFlush();
+  EEPROM.commits = 0;
+
+  unsigned long first = testMillis;
+  while (EEPROM.commits == 0) {
+    s.fuelLevel -= 0.01;
+    settingsStore(s);
+    testAdvanceMillis(1000);
+    settingsService();
+    TEST_ASSERT_LESS_OR_EQUAL(SETTINGS_COMMIT_MAX_DELAY_MS, testMillis - first);
+  }
+}
+
+void test_unchanged_store_writes_nothing(void) {
+  Settings s;
+  settingsLoad(s);
+  settingsFlush();
+  EEPROM.commits = 0;
+  settingsStore(s);
+  testAdvanceMillis(SETTINGS_COMMIT_MAX_DELAY_MS);
+  settingsService();
+  settingsFlush();
+  TEST_ASSERT_EQUAL(0, EEPROM.commits);
+}
+
+void test_flush_commits_at_once(void) {
+  Settings s;
+  settingsLoad(s);
+  settingsFlush();
+  EEPROM.commits = 0;
+  s.homeLatitude = 12.5;
+  settingsStore(s);
+  settingsFlush();
+  TEST_ASSERT_EQUAL(1, EEPROM.commits);
+  Settings again;
+  TEST_ASSERT_TRUE(reload(again));
+  TEST_ASSERT_EQUAL_FLOAT(12.5, again.homeLatitude);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_blank_eeprom_gives_defaults_and_writes_them);
+  RUN_TEST(test_legacy_layout_is_migrated);
+  RUN_TEST(test_legacy_garbage_falls_back_to_defaults);
+  RUN_TEST(test_version_1_record_is_upgraded);
+  RUN_TEST(test_corrupt_record_is_not_loaded);
+  RUN_TEST(test_burst_of_changes_is_one_commit);
+  RUN_TEST(test_steady_changes_commit_by_the_max_delay);
+  RUN_TEST(test_unchanged_store_writes_nothing);
+  RUN_TEST(test_flush_commits_at_once);
+  return UNITY_END();
+}
@@ -0,0 +1,200 @@
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+#include "nav_math.h"
+#include "telemetry.h"
+
+// Little-endian reads at byte offsets, the way web/app.js reads a DataView
+static uint8_t getUint8(const uint8_t *view, size_t offset) {
+  return view[offset];
+}
+
+static uint16_t getUint16(const uint8_t *view, size_t offset) {
+  return view[offset] | view[offset + 1] << 8;
+}
+
+static int16_t getInt16(const uint8_t *view, size_t offset) {
+  return (int16_t)getUint16(view, offset);
+}
+
+static uint32_t getUint32(const uint8_t *view, size_t offset) {
+  return getUint16(view, offset) | (uint32_t)getUint16(view, offset + 2) << 16;
+}
+
+static int32_t getInt32(const uint8_t *view, size_t offset) {
+  return (int32_t)getUint32(view, offset);
+}
+
+// Sent bytes as the client receives them
+template <typename F>
+static void send(const F &frame, uint8_t *view) {
+  memcpy(view, &frame, sizeof(frame));
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_header(void) {
+  TelemetryLive live;
+  telemetryBegin(live, TELEMETRY_FRAME_LIVE);
+  uint8_t view[sizeof(live)];
+  send(live, view);
+  TEST_ASSERT_EQUAL(TELEMETRY_VERSION, getUint8(view, 0));
+  TEST_ASSERT_EQUAL(TELEMETRY_FRAME_LIVE, getUint8(view, 1));
+  TEST_ASSERT_EQUAL(32, getUint16(view, 2));
+
+  TelemetryConfig config;
+  telemetryBegin(config, TELEMETRY_FRAME_CONFIG);
+  TEST_ASSERT_EQUAL(40, config.header.length);
+  TelemetryDiagnostics diagnostics;
+  telemetryBegin(diagnostics, TELEMETRY_FRAME_DIAGNOSTICS);
+  TEST_ASSERT_EQUAL(70, diagnostics.header.length);
+}
+
+void test_live_round_trip(void) {
+  NavPoint at = navPointFromDegrees(-33.8688123, 151.2092955);
+  TelemetryLive live;
+  telemetryBegin(live, TELEMETRY_FRAME_LIVE);
+  live.lat = at.lat;
+  live.lon = at.lon;
+  live.altitude = telemetryI16(1234.4f, 1.0f);
+  live.agl = telemetryI16(-12.6f, 1.0f);
+  live.speed = telemetryU16(87.46f, 0.1f);
+  live.course = telemetryU16(359.99f, 0.01f);
+  live.satellites = 11;
+  live.flags = TELEMETRY_FLAG_FIX | TELEMETRY_FLAG_HOME | 2 << TELEMETRY_FLAG_AIRSPACE_SHIFT;
+  live.fuel = telemetryU16(7.25f, 0.01f);
+  live.batteryMv = telemetryU16(3.912f, 0.001f);
+  live.enduranceMinutes = telemetryU16(95.4f, 1.0f);
+  live.homeDistance = telemetryU16(12345.0f, 10.0f);
+  live.homeBearing = telemetryI16(-172.35f, 0.1f);
+
+  uint8_t view[sizeof(live)];
+  send(live, view);
+  TEST_ASSERT_EQUAL_INT32(at.lat, getInt32(view, 4));
+  TEST_ASSERT_EQUAL_INT32(at.lon, getInt32(view, 8));
+  TEST_ASSERT_EQUAL(1234, getInt16(view, 12));
+  TEST_ASSERT_EQUAL(-13, getInt16(view, 14));
+  TEST_ASSERT_EQUAL(875, getUint16(view, 16));
+  TEST_ASSERT_EQUAL(35999, getUint16(view, 18));
+  TEST_ASSERT_EQUAL(11, getUint8(view, 20));
+  TEST_ASSERT_EQUAL(2, getUint8(view, 21) >> TELEMETRY_FLAG_AIRSPACE_SHIFT & 3);
+  TEST_ASSERT_FALSE(getUint8(view, 21) & TELEMETRY_FLAG_ALTITUDE);
+  TEST_ASSERT_EQUAL(725, getUint16(view, 22));
+  TEST_ASSERT_EQUAL(3912, getUint16(view, 24));
+  TEST_ASSERT_EQUAL(95, getUint16(view, 26));
+  TEST_ASSERT_EQUAL(1235, getUint16(view, 28));
+  TEST_ASSERT_EQUAL(-1724, getInt16(view, 30));
+}
+
+void test_config_round_trip(void) {
+  TelemetryConfig config;
+  telemetryBegin(config, TELEMETRY_FRAME_CONFIG);
+  config.home = {473977000, 85456000};
+  for (int i = 0; i < TELEMETRY_POI_COUNT; i++) config.pois[i] = {473000000 + i, -1220000000 - i};
+  config.poiEnabled = 0b101;
+  config.mode = 1;
+  config.burnRate = telemetryU16(4.5f, 0.01f);
+
+  uint8_t view[sizeof(config)];
+  send(config, view);
+  TEST_ASSERT_EQUAL_INT32(473977000, getInt32(view, 4));
+  TEST_ASSERT_EQUAL_INT32(85456000, getInt32(view, 8));
+  for (int i = 1; i <= 3; i++) {
+    size_t offset = 12 + (i - 1) * 8;
+    TEST_ASSERT_EQUAL_INT32(473000000 + i - 1, getInt32(view, offset));
+    TEST_ASSERT_EQUAL_INT32(-1220000000 - i + 1, getInt32(view, offset + 4));
+    TEST_ASSERT_EQUAL(i != 2, (getUint8(view, 36) & (1 << (i - 1))) != 0);
+  }
+  TEST_ASSERT_EQUAL(1, getUint8(view, 37));
+  TEST_ASSERT_EQUAL(450, getUint16(view, 38));
+}
+
+void test_diagnostics_round_trip(void) {
+  TelemetryDiagnostics diagnostics;
+  telemetryBegin(diagnostics, TELEMETRY_FRAME_DIAGNOSTICS);
+  diagnostics.streamHz = 5;
+  diagnostics.linkProfile = 2;
+  diagnostics.streamIntervalMs = 400;
+  diagnostics.streamBytesPerSecond = 61;
+  diagnostics.streamBackoffs = 3;
+  diagnostics.commands = 1000;
+  diagnostics.commandsDropped = 2;
+  diagnostics.advertisingSeconds = 70000;
+  diagnostics.connectedSeconds = 80000;
+  diagnostics.idleLinkSeconds = 90000;
+  diagnostics.radioOffSeconds = 100000;
+  diagnostics.linkUpdates = 17;
+  diagnostics.loopIdleMs = 950;
+  diagnostics.loopActiveMs = 50;
+  diagnostics.loopWakeups = 12;
+  diagnostics.cpuMhz = 80;
+  diagnostics.flags = TELEMETRY_DIAG_MOVING;
+  diagnostics.powerProfile = 1;
+  diagnostics.profileSwitches = 4;
+  for (int i = 0; i < TELEMETRY_PROFILE_COUNT; i++) {
+    diagnostics.profiles[i] = {(uint16_t)(100 + i), (uint16_t)(200 + i), (uint16_t)(300 + i), (uint16_t)(400 + i)};
+  }
+
+  uint8_t view[sizeof(diagnostics)];
+  send(diagnostics, view);
+  TEST_ASSERT_EQUAL(5, getUint8(view, 4));
+  TEST_ASSERT_EQUAL(2, getUint8(view, 5));
+  TEST_ASSERT_EQUAL(400, getUint16(view, 6));
+  TEST_ASSERT_EQUAL(61, getUint16(view, 8));
+  TEST_ASSERT_EQUAL(3, getUint16(view, 10));
+  TEST_ASSERT_EQUAL(1000, getUint16(view, 12));
+  TEST_ASSERT_EQUAL(2, getUint16(view, 14));
+  TEST_ASSERT_EQUAL_UINT32(70000, getUint32(view, 16));
+  TEST_ASSERT_EQUAL_UINT32(80000, getUint32(view, 20));
+  TEST_ASSERT_EQUAL_UINT32(90000, getUint32(view, 24));
+  TEST_ASSERT_EQUAL_UINT32(100000, getUint32(view, 28));
+  TEST_ASSERT_EQUAL(17, getUint16(view, 32));
+  TEST_ASSERT_EQUAL(950, getUint16(view, 34));
+  TEST_ASSERT_EQUAL(50, getUint16(view, 36));
+  TEST_ASSERT_EQUAL(12, getUint16(view, 38));
+  TEST_ASSERT_EQUAL(80, getUint16(view, 40));
+  TEST_ASSERT_EQUAL(TELEMETRY_DIAG_MOVING, getUint8(view, 42));
+  TEST_ASSERT_EQUAL(1, getUint8(view, 43));
+  TEST_ASSERT_EQUAL(4, getUint16(view, 44));
+  for (int i = 0; i < TELEMETRY_PROFILE_COUNT; i++) {
+    size_t offset = 46 + i * 8;
+    TEST_ASSERT_EQUAL(100 + i, getUint16(view, offset));
+    TEST_ASSERT_EQUAL(200 + i, getUint16(view, offset + 2));
+    TEST_ASSERT_EQUAL(300 + i, getUint16(view, offset + 4));
+    TEST_ASSERT_EQUAL(400 + i, getUint16(view, offset + 6));
+  }
+}
+
+void test_scaling_saturates_short_of_the_unknown_marker(void) {
+  TEST_ASSERT_EQUAL(TELEMETRY_UNKNOWN_I16, telemetryI16(NAN, 1.0f));
+  TEST_ASSERT_EQUAL(TELEMETRY_UNKNOWN_U16, telemetryU16(NAN, 1.0f));
+  TEST_ASSERT_EQUAL(INT16_MIN + 1, telemetryI16(-1e9f, 1.0f));
+  TEST_ASSERT_EQUAL(INT16_MAX, telemetryI16(1e9f, 1.0f));
+  TEST_ASSERT_EQUAL(UINT16_MAX - 1, telemetryU16(1e9f, 1.0f));
+  TEST_ASSERT_EQUAL(0, telemetryU16(-5.0f, 1.0f));
+  TEST_ASSERT_EQUAL(-3, telemetryI16(-2.5f, 1.0f)); // Half away from zero
+  TEST_ASSERT_EQUAL(3, telemetryI16(2.5f, 1.0f));
+  TEST_ASSERT_EQUAL(65534, telemetryU16(6553.45f, 0.1f));
+}
+
+void test_frames_fit_the_mtu(void) {
+  TEST_ASSERT_TRUE(telemetryFits(23, 20));
+  TEST_ASSERT_FALSE(telemetryFits(23, sizeof(TelemetryLive)));
+  TEST_ASSERT_TRUE(telemetryFits(35, sizeof(TelemetryLive)));
+  TEST_ASSERT_FALSE(telemetryFits(72, sizeof(TelemetryDiagnostics)));
+  TEST_ASSERT_TRUE(telemetryFits(73, sizeof(TelemetryDiagnostics)));
+  // The text status notification ran up to 512 bytes
+  TEST_ASSERT_LESS_OR_EQUAL(512 / 10, sizeof(TelemetryLive));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_header);
+  RUN_TEST(test_live_round_trip);
+  RUN_TEST(test_config_round_trip);
+  RUN_TEST(test_diagnostics_round_trip);
+  RUN_TEST(test_scaling_saturates_short_of_the_unknown_marker);
+  RUN_TEST(test_frames_fit_the_mtu);
+  return UNITY_END();
+}
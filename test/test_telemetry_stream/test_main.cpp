@@ -0,0 +1,254 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "telemetry_stream.h"
+
+// The phone's side, as web/app.js handleDeltaFrame() decodes the stream
+struct Client {
+  int sequence; // -1 before the first frame
+  bool known[TELEMETRY_STREAM_FIELDS];
+  int32_t values[TELEMETRY_STREAM_FIELDS];
+  uint32_t gaps;
+};
+
+static Client client;
+static uint32_t now = 0;
+
+static void clientReset() {
+  memset(&client, 0, sizeof(client));
+  client.sequence = -1;
+}
+
+static void receive(const uint8_t *frame, size_t length) {
+  TEST_ASSERT_GREATER_OR_EQUAL(sizeof(TelemetryDeltaHeader), length);
+  TEST_ASSERT_EQUAL(TELEMETRY_VERSION, frame[0]);
+  TEST_ASSERT_EQUAL(TELEMETRY_FRAME_DELTA, frame[1]);
+  TEST_ASSERT_EQUAL(length, frame[2] | frame[3] << 8);
+  if (client.sequence >= 0 && frame[4] != ((client.sequence + 1) & 0xFF)) {
+    // The differences no longer add up: drop everything and ask for a reset
+    memset(client.known, 0, sizeof(client.known));
+    client.gaps++;
+    telemetryStreamReset();
+  }
+  client.sequence = frame[4];
+  uint8_t fields = frame[5];
+  uint8_t absolute = frame[6];
+  size_t offset = sizeof(TelemetryDeltaHeader);
+  for (int i = 0; i < TELEMETRY_STREAM_FIELDS; i++) {
+    if (!(fields & (1 << i))) continue;
+    uint32_t raw = 0;
+    for (int shift = 0; offset < length; shift += 7) {
+      uint8_t byte = frame[offset++];
+      raw |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) break;
+    }
+    int32_t value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+    if (absolute & (1 << i)) {
+      client.values[i] = value;
+      client.known[i] = true;
+    } else if (client.known[i]) {
+      client.values[i] = (int32_t)((uint32_t)client.values[i] + (uint32_t)value);
+    }
+  }
+  TEST_ASSERT_EQUAL(length, offset);
+}
+
+// Recorded-style flight: a slow turn at 55 km/h, climbing, burning fuel, with GPS and ADC noise
+static void fly(TelemetryLive &live, uint32_t ms) {
+  double t = ms / 1000.0;
+  double heading = t * 0.002;
+  live.lat = (int32_t)lround(470000000 + 1500 * sin(heading) / 0.002);
+  live.lon = (int32_t)lround(80000000 + 2200 * (1 - cos(heading)) / 0.002);
+  live.altitude = (int16_t)(900 + t / 6);
+  live.speed = (uint16_t)(550 + rand() % 3);
+  live.course = (uint16_t)(fmod(heading * 180 / M_PI, 360) * 100 + rand() % 60);
+  live.fuel = (uint16_t)(1200 - t / 8);
+  live.batteryMv = (uint16_t)(3950 - t / 100 + rand() % 25);
+}
+
+static int32_t field(const TelemetryLive &live, int i) {
+  const int32_t values[TELEMETRY_STREAM_FIELDS] = {live.lat, live.lon, live.altitude, live.speed,
+                                                   live.course, live.fuel, live.batteryMv};
+  return values[i];
+}
+
+// Within each field's deadband of what the device has
+static void assertTracking(const TelemetryLive &live) {
+  const int32_t slack[TELEMETRY_STREAM_FIELDS] = {0, 0, 0, 1, 50, 0, 20};
+  for (int i = 0; i < TELEMETRY_STREAM_FIELDS; i++) {
+    TEST_ASSERT_TRUE(client.known[i]);
+    TEST_ASSERT_INT32_WITHIN(slack[i], field(live, i), client.values[i]);
+  }
+}
+
+struct Link {
+  uint16_t mtu;
+  int notifyFailPercent; // The stack refused the notification
+  int lostPercent;       // Sent, but the client never got it
+  int congestedPercent;
+};
+
+struct Run {
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t seconds;
+};
+
+// Drive the stream like loop() does, fixes at 5 Hz, for this long
+static Run simulate(const Link &link, uint32_t seconds, TelemetryLive &live) {
+  Run run = {0, 0, seconds};
+  telemetryStreamSetLink(link.mtu, 30);
+  for (uint32_t end = now + seconds * 1000; now < end; now += 10) {
+    if (now % 200 == 0) fly(live, now);
+    if (!telemetryStreamDue(now)) continue;
+    uint8_t frame[TELEMETRY_STREAM_MAX_FRAME];
+    size_t length = telemetryStreamEncode(live, now, frame);
+    TEST_ASSERT_LESS_OR_EQUAL((size_t)link.mtu - 3, length);
+    bool congested = rand() % 100 < link.congestedPercent;
+    if (length && rand() % 100 < link.notifyFailPercent) {
+      telemetryStreamSent(now, 0, congested);
+      continue;
+    }
+    if (length) {
+      if (rand() % 100 >= link.lostPercent) receive(frame, length);
+      run.frames++;
+      run.bytes += length;
+    }
+    telemetryStreamSent(now, length, congested);
+  }
+  return run;
+}
+
+// A clean link and a fix that holds still, so the client ends in step
+static void settle(TelemetryLive &live) {
+  telemetryStreamSetLink(247, 30);
+  for (uint32_t end = now + 3000; now < end; now += 10) {
+    if (!telemetryStreamDue(now)) continue;
+    uint8_t frame[TELEMETRY_STREAM_MAX_FRAME];
+    size_t length = telemetryStreamEncode(live, now, frame);
+    if (length) receive(frame, length);
+    telemetryStreamSent(now, length, false);
+  }
+}
+
+static void report(const char *name, const Run &run) {
+  char message[120];
+  snprintf(message, sizeof(message), "%s: %u frames, %.1f B/s, %.1f B/frame", name, (unsigned)run.frames,
+           (double)run.bytes / run.seconds, run.frames ? (double)run.bytes / run.frames : 0.0);
+  TEST_MESSAGE(message);
+}
+
+void setUp(void) {
+  srand(1);
+  clientReset();
+  telemetryStreamSetRate(0);
+  telemetryStreamSetRate(5); // A new subscriber: every field absolute first
+  telemetryStreamSetLink(247, 30);
+}
+
+void tearDown(void) {}
+
+void test_steady_flight(void) {
+  TelemetryLive live = {};
+  Run run = simulate({247, 0, 0, 0}, 600, live);
+  report("MTU 247", run);
+  settle(live);
+  assertTracking(live);
+  TEST_ASSERT_EQUAL(0, client.gaps);
+  // A full live frame at 5 Hz is 160 B/s
+  TEST_ASSERT_LESS_THAN(sizeof(TelemetryLive) * 5 / 2, run.bytes / run.seconds);
+  TEST_ASSERT_LESS_THAN(sizeof(TelemetryLive) / 2, run.bytes / run.frames);
+  TEST_ASSERT_GREATER_THAN(600 * 4, run.frames);
+}
+
+void test_smallest_mtu(void) {
+  TelemetryLive live = {};
+  Run run = simulate({23, 0, 0, 0}, 120, live);
+  report("MTU 23", run);
+  settle(live);
+  assertTracking(live);
+}
+
+void test_failed_notifications_are_encoded_again(void) {
+  TelemetryLive live = {};
+  Run run = simulate({247, 10, 0, 0}, 300, live);
+  report("10% refused", run);
+  TEST_ASSERT_EQUAL(0, client.gaps); // Refused frames never count in the sequence
+  settle(live);
+  assertTracking(live);
+}
+
+void test_lost_frames_resync(void) {
+  TelemetryLive live = {};
+  Run run = simulate({247, 0, 5, 0}, 300, live);
+  report("5% lost", run);
+  TEST_ASSERT_GREATER_THAN(0, client.gaps);
+  settle(live);
+  assertTracking(live);
+}
+
+void test_congestion_backs_off(void) {
+  TelemetryLive live = {};
+  fly(live, now);
+  telemetryStreamSetLink(247, 30);
+  TEST_ASSERT_EQUAL(200, telemetryStreamStats().intervalMs);
+  uint32_t backoffs = telemetryStreamStats().backoffs;
+  uint16_t expected = 200;
+  for (int i = 0; i < 6; i++) {
+    now += telemetryStreamWaitMs(now);
+    TEST_ASSERT_TRUE(telemetryStreamDue(now));
+    uint8_t frame[TELEMETRY_STREAM_MAX_FRAME];
+    telemetryStreamSent(now, telemetryStreamEncode(live, now, frame), true);
+    expected = expected * 2 > TELEMETRY_STREAM_MAX_INTERVAL_MS ? TELEMETRY_STREAM_MAX_INTERVAL_MS : expected * 2;
+    TEST_ASSERT_EQUAL(expected, telemetryStreamStats().intervalMs);
+  }
+  TEST_ASSERT_EQUAL(backoffs + 6, telemetryStreamStats().backoffs);
+
+  // Drained: back to the requested rate, never faster than the link allows
+  telemetryStreamSetLink(247, 150);
+  for (int i = 0; i < 30; i++) {
+    now += telemetryStreamWaitMs(now);
+    uint8_t frame[TELEMETRY_STREAM_MAX_FRAME];
+    telemetryStreamSent(now, telemetryStreamEncode(live, now, frame), false);
+  }
+  TEST_ASSERT_EQUAL(150 * TELEMETRY_STREAM_LINK_EVENTS, telemetryStreamStats().intervalMs);
+
+  telemetryStreamSetRate(0);
+  TEST_ASSERT_FALSE(telemetryStreamDue(now + 10000));
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, telemetryStreamWaitMs(now));
+}
+
+void test_keyframes(void) {
+  TelemetryLive live = {};
+  fly(live, now);
+  simulate({247, 0, 0, 0}, 5, live);
+  // Nothing moves; only the periodic keyframe is sent
+  uint32_t frames = telemetryStreamStats().frames;
+  uint8_t absolute = 0;
+  for (uint32_t end = now + TELEMETRY_STREAM_KEYFRAME_MS + 1000; now < end; now += 10) {
+    if (!telemetryStreamDue(now)) continue;
+    uint8_t frame[TELEMETRY_STREAM_MAX_FRAME];
+    size_t length = telemetryStreamEncode(live, now, frame);
+    if (length) {
+      receive(frame, length);
+      absolute |= frame[6];
+    }
+    telemetryStreamSent(now, length, false);
+  }
+  TEST_ASSERT_EQUAL(frames + 1, telemetryStreamStats().frames);
+  TEST_ASSERT_EQUAL((1 << TELEMETRY_STREAM_FIELDS) - 1, absolute);
+  assertTracking(live);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_steady_flight);
+  RUN_TEST(test_smallest_mtu);
+  RUN_TEST(test_failed_notifications_are_encoded_again);
+  RUN_TEST(test_lost_frames_resync);
+  RUN_TEST(test_congestion_backs_off);
+  RUN_TEST(test_keyframes);
+  return UNITY_END();
+}
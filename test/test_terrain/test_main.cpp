@@ -0,0 +1,195 @@
+#include <filesystem>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "crc32.h"
+#include "terrain.h"
+
+#define TILE_UNITS 100000 // 0.01 degrees
+#define COLS 5
+#define ROWS 4
+
+static std::string directory;
+static const NavPoint origin = navPointFromDegrees(47.0, 8.0);
+
+// A plane in whole metres per sample interval, so bilinear interpolation reproduces it exactly
+static double plane(double northSamples, double eastSamples) {
+  return 200 + 3 * eastSamples + 2 * northSamples;
+}
+
+static void appendVarint(std::vector<uint8_t> &data, int32_t value) {
+  uint32_t raw = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  do {
+    uint8_t byte = raw & 0x7F;
+    raw >>= 7;
+    data.push_back(raw ? byte | 0x80 : byte);
+  } while (raw);
+}
+
+// One tile as tools/terrain.py encodes it
+static void encodeTile(std::vector<uint8_t> &data, const std::vector<int16_t> &elevations, uint8_t step) {
+  int16_t base = INT16_MAX;
+  for (int16_t e : elevations) base = std::min(base, e);
+  TerrainTileHeader tileHeader = {base, step};
+  data.insert(data.end(), (const uint8_t *)&tileHeader, (const uint8_t *)&tileHeader + sizeof(tileHeader));
+  std::vector<int32_t> quantized;
+  for (int16_t e : elevations) quantized.push_back((int32_t)lround((e - base) / (double)step));
+  int32_t rowStart = 0;
+  for (int y = 0; y < TERRAIN_TILE_SAMPLES; y++) {
+    for (int x = 0; x < TERRAIN_TILE_SAMPLES; x++) {
+      int32_t q = quantized[y * TERRAIN_TILE_SAMPLES + x];
+      appendVarint(data, q - (x == 0 ? rowStart : quantized[y * TERRAIN_TILE_SAMPLES + x - 1]));
+      if (x == 0) rowStart = q;
+    }
+  }
+}
+
+// Lay out COLS x ROWS tiles of the surface, leaving out the tile at missing, and install the image
+static void install(double (*surface)(double, double), uint8_t step, int missing) {
+  std::vector<uint32_t> index = {0};
+  std::vector<uint8_t> data;
+  for (int row = 0; row < ROWS; row++) {
+    for (int col = 0; col < COLS; col++) {
+      if (row * COLS + col != missing) {
+        std::vector<int16_t> elevations;
+        for (int y = 0; y < TERRAIN_TILE_SAMPLES; y++) {
+          for (int x = 0; x < TERRAIN_TILE_SAMPLES; x++) {
+            elevations.push_back((int16_t)lround(surface(row * 32 + y, col * 32 + x)));
+          }
+        }
+        encodeTile(data, elevations, step);
+      }
+      index.push_back(data.size());
+    }
+  }
+
+  TerrainHeader header = {};
+  header.originLat = origin.lat;
+  header.originLon = origin.lon;
+  header.tileSize = TILE_UNITS;
+  header.cols = COLS;
+  header.rows = ROWS;
+  header.indexOffset = sizeof(header);
+  header.dataOffset = header.indexOffset + index.size() * sizeof(uint32_t);
+  header.dataSize = data.size();
+  std::vector<uint8_t> image(sizeof(header));
+  image.insert(image.end(), (const uint8_t *)index.data(), (const uint8_t *)(index.data() + index.size()));
+  image.insert(image.end(), data.begin(), data.end());
+  header.asset = {TERRAIN_MAGIC, TERRAIN_VERSION, sizeof(TerrainHeader), (uint32_t)image.size(), 0};
+  header.asset.crc = crc32Update(0, image.data() + sizeof(header), image.size() - sizeof(header));
+  memcpy(image.data(), &header, sizeof(header));
+
+  FILE *file = fopen((directory + "/" TERRAIN_PARTITION ".bin").c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  fwrite(image.data(), 1, image.size(), file);
+  fclose(file);
+  TEST_ASSERT_TRUE(terrainBegin());
+}
+
+// Position in samples north and east of the origin
+static NavPoint at(double northSamples, double eastSamples) {
+  return {(int32_t)lround(origin.lat + northSamples * TILE_UNITS / 32),
+          (int32_t)lround(origin.lon + eastSamples * TILE_UNITS / 32)};
+}
+
+static void lookupTile(int tile) {
+  terrainElevation(at((tile / COLS) * 32 + 16, (tile % COLS) * 32 + 16));
+}
+
+void setUp(void) {
+  std::string path = (std::filesystem::temp_directory_path() / "terrain_XXXXXX").string();
+  directory = mkdtemp(&path[0]);
+  assetSetHostDirectory(directory.c_str());
+}
+
+void tearDown(void) {
+  std::filesystem::remove_all(directory);
+}
+
+void test_bilinear_interpolation(void) {
+  install(plane, 1, -1);
+  for (double north = 0.25; north < ROWS * 32; north += 7.3) {
+    for (double east = 0.5; east < COLS * 32; east += 11.7) {
+      TEST_ASSERT_FLOAT_WITHIN(0.05, plane(north, east), terrainElevation(at(north, east)));
+    }
+  }
+  // Shared edges agree from either side
+  TEST_ASSERT_FLOAT_WITHIN(0.05, plane(32, 64), terrainElevation(at(32, 64)));
+  TEST_ASSERT_FLOAT_WITHIN(0.05, plane(31.999, 63.999), terrainElevation(at(31.999, 63.999)));
+}
+
+void test_quantization_step(void) {
+  install([](double north, double east) { return 1500 + 400 * sin(north * 0.07) * cos(east * 0.05); }, 5, -1);
+  for (double north = 0; north < ROWS * 32; north += 3) {
+    for (double east = 0; east < COLS * 32; east += 5) {
+      double expected = 1500 + 400 * sin(north * 0.07) * cos(east * 0.05);
+      TEST_ASSERT_FLOAT_WITHIN(3.0, expected, terrainElevation(at(north, east)));
+    }
+  }
+}
+
+void test_missing_tiles_and_outside(void) {
+  install(plane, 1, 7);
+  TerrainStats before = terrainStats();
+  lookupTile(7);
+  TEST_ASSERT_TRUE(isnan(terrainElevation(at(1 * 32 + 5, 2 * 32 + 5))));
+  TEST_ASSERT_EQUAL(before.misses, terrainStats().misses); // An empty tile never takes a cache slot
+  TEST_ASSERT_FALSE(isnan(terrainElevation(at(1 * 32 + 5, 3 * 32 + 5))));
+  TEST_ASSERT_TRUE(isnan(terrainElevation(at(-1, 10))));
+  TEST_ASSERT_TRUE(isnan(terrainElevation(at(10, -1))));
+  TEST_ASSERT_TRUE(isnan(terrainElevation(at(ROWS * 32 + 1, 10))));
+  TEST_ASSERT_TRUE(isnan(terrainElevation(at(10, COLS * 32 + 1))));
+}
+
+void test_cache_evicts_least_recently_used(void) {
+  static_assert(TERRAIN_CACHE_TILES + 2 <= COLS * ROWS, "Not enough tiles to overflow the cache");
+  install(plane, 1, -1);
+  TerrainStats before = terrainStats();
+  for (int tile = 0; tile < TERRAIN_CACHE_TILES; tile++) lookupTile(tile);
+  TEST_ASSERT_EQUAL(before.misses + TERRAIN_CACHE_TILES, terrainStats().misses);
+
+  // Every tile is cached; using tile 0 makes tile 1 the oldest
+  before = terrainStats();
+  lookupTile(0);
+  lookupTile(TERRAIN_CACHE_TILES - 1);
+  TEST_ASSERT_EQUAL(before.hits + 2, terrainStats().hits);
+  TEST_ASSERT_EQUAL(before.misses, terrainStats().misses);
+
+  before = terrainStats();
+  lookupTile(TERRAIN_CACHE_TILES); // Evicts tile 1
+  lookupTile(0);
+  lookupTile(2);
+  TEST_ASSERT_EQUAL(before.misses + 1, terrainStats().misses);
+  TEST_ASSERT_EQUAL(before.hits + 2, terrainStats().hits);
+  lookupTile(1);
+  TEST_ASSERT_EQUAL(before.misses + 2, terrainStats().misses);
+  TEST_ASSERT_FLOAT_WITHIN(0.05, plane(16, 48), terrainElevation(at(16, 48)));
+
+  // A flight along the tiles decodes each one once per pass at most
+  before = terrainStats();
+  for (double east = 0; east < COLS * 32; east += 0.25) terrainElevation(at(40, east));
+  TEST_ASSERT_LESS_OR_EQUAL(before.misses + COLS, terrainStats().misses);
+}
+
+void test_corrupt_store_is_rejected(void) {
+  install(plane, 1, -1);
+  FILE *file = fopen((directory + "/" TERRAIN_PARTITION ".bin").c_str(), "r+b");
+  fseek(file, -10, SEEK_END);
+  fputc(0x5A, file);
+  fclose(file);
+  TEST_ASSERT_FALSE(terrainBegin());
+  TEST_ASSERT_TRUE(isnan(terrainElevation(at(16, 16))));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bilinear_interpolation);
+  RUN_TEST(test_quantization_step);
+  RUN_TEST(test_missing_tiles_and_outside);
+  RUN_TEST(test_cache_evicts_least_recently_used);
+  RUN_TEST(test_corrupt_store_is_rejected);
+  return UNITY_END();
+}
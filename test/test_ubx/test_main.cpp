@@ -0,0 +1,280 @@
+#include <Arduino.h>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "gps_stream.h"
+#include "ubx.h"
+
+#define EPOCHS 600
+#define ROUNDS 20
+
+// What the receiver reports at each epoch of the captures
+struct Truth {
+  uint32_t iTow;
+  int32_t lat, lon; // 1e-7 degrees
+  int32_t hMslMm;
+  uint32_t speedMms;
+  int32_t heading; // 1e-5 degrees
+  uint8_t h, m, s;
+  uint8_t satellites;
+};
+
+static Truth truth(int epoch) {
+  Truth t;
+  t.iTow = 302400000 + epoch * 200; // 5 Hz
+  t.lat = 473977000 + epoch * 10;
+  t.lon = 85456000 + epoch * 370;
+  t.hMslMm = 812400 + epoch * 25;
+  t.speedMms = 25000 + (epoch % 7) * 50;
+  t.heading = 8850000 + (epoch % 5) * 20000;
+  uint32_t seconds = 12 * 3600 + epoch / 5;
+  t.h = seconds / 3600;
+  t.m = seconds / 60 % 60;
+  t.s = seconds % 60;
+  t.satellites = 9 + epoch % 3;
+  return t;
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  put16(p, v);
+  put16(p + 2, v >> 16);
+}
+
+static void append(std::string &stream, uint8_t id, const uint8_t *payload, uint16_t length) {
+  uint8_t frame[UBX_MAX_PAYLOAD + UBX_FRAME_OVERHEAD];
+  size_t size = ubxBuildFrame(UBX_CLASS_NAV, id, payload, length, frame);
+  stream.append((const char *)frame, size);
+}
+
+// u-blox 7 and later: one NAV-PVT per epoch
+static std::string pvtCapture() {
+  std::string stream;
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    Truth t = truth(epoch);
+    uint8_t p[92] = {};
+    put32(p, t.iTow);
+    put16(p + 4, 2026);
+    p[6] = 9;
+    p[7] = 17;
+    p[8] = t.h;
+    p[9] = t.m;
+    p[10] = t.s;
+    p[11] = 0x03; // Date and time valid
+    p[20] = 3;    // 3D
+    p[21] = 0x01; // gnssFixOK
+    p[23] = t.satellites;
+    put32(p + 24, t.lon);
+    put32(p + 28, t.lat);
+    put32(p + 32, t.hMslMm + 47000);
+    put32(p + 36, t.hMslMm);
+    put32(p + 40, 1800);
+    put32(p + 60, t.speedMms);
+    put32(p + 64, t.heading);
+    append(stream, UBX_NAV_PVT, p, sizeof(p));
+  }
+  return stream;
+}
+
+// NEO-6M: POSLLH, SOL, VELNED and TIMEUTC per epoch, in the receiver's output order
+static std::string legacyCapture() {
+  std::string stream;
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    Truth t = truth(epoch);
+    uint8_t posllh[28] = {};
+    put32(posllh, t.iTow);
+    put32(posllh + 4, t.lon);
+    put32(posllh + 8, t.lat);
+    put32(posllh + 12, t.hMslMm + 47000);
+    put32(posllh + 16, t.hMslMm);
+    put32(posllh + 20, 1800);
+    append(stream, UBX_NAV_POSLLH, posllh, sizeof(posllh));
+
+    uint8_t sol[52] = {};
+    put32(sol, t.iTow);
+    sol[10] = 3;
+    sol[11] = 0x01;
+    sol[47] = t.satellites;
+    append(stream, UBX_NAV_SOL, sol, sizeof(sol));
+
+    uint8_t velned[36] = {};
+    put32(velned, t.iTow);
+    put32(velned + 20, t.speedMms / 10);
+    put32(velned + 24, t.heading);
+    append(stream, UBX_NAV_VELNED, velned, sizeof(velned));
+
+    uint8_t timeutc[20] = {};
+    put32(timeutc, t.iTow);
+    put16(timeutc + 12, 2026);
+    timeutc[14] = 9;
+    timeutc[15] = 17;
+    timeutc[16] = t.h;
+    timeutc[17] = t.m;
+    timeutc[18] = t.s;
+    timeutc[19] = 0x07;
+    append(stream, UBX_NAV_TIMEUTC, timeutc, sizeof(timeutc));
+  }
+  return stream;
+}
+
+// The same epochs as GGA and RMC, for the NMEA path
+static std::string sentence(const char *body) {
+  uint8_t checksum = 0;
+  for (const char *c = body; *c; c++) checksum ^= *c;
+  char line[120];
+  snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+  return line;
+}
+
+static std::string coordinate(int32_t e7, int degreeDigits) {
+  double degrees = e7 / 1e7;
+  double whole = floor(degrees);
+  char text[20];
+  snprintf(text, sizeof(text), "%0*d%08.5f", degreeDigits, (int)whole, (degrees - whole) * 60);
+  return text;
+}
+
+static std::string nmeaCapture() {
+  std::string stream;
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    Truth t = truth(epoch);
+    char stamp[16], body[100];
+    snprintf(stamp, sizeof(stamp), "%02d%02d%02d.%02d", t.h, t.m, t.s, epoch % 5 * 20);
+    std::string lat = coordinate(t.lat, 2), lon = coordinate(t.lon, 3);
+    snprintf(body, sizeof(body), "GNGGA,%s,%s,N,%s,E,1,%02d,0.9,%.1f,M,47.0,M,,", stamp, lat.c_str(), lon.c_str(),
+             t.satellites, t.hMslMm / 1000.0);
+    stream += sentence(body);
+    snprintf(body, sizeof(body), "GNRMC,%s,A,%s,N,%s,E,%.3f,%.2f,170926,,,A", stamp, lat.c_str(), lon.c_str(),
+             t.speedMms * 0.0036 / 1.852, t.heading * 1e-5);
+    stream += sentence(body);
+  }
+  return stream;
+}
+
+static std::vector<GpsFix> published;
+
+static void onFix(const GpsFix &fix) {
+  published.push_back(fix);
+}
+
+static void feed(const std::string &stream) {
+  gpsStreamFeed((const uint8_t *)stream.data(), stream.size());
+}
+
+static void assertEpoch(const GpsFix &fix, int epoch) {
+  Truth t = truth(epoch);
+  TEST_ASSERT_EQUAL(GPS_SOURCE_UBX, fix.source);
+  TEST_ASSERT_TRUE(fix.location.valid);
+  TEST_ASSERT_EQUAL_INT32(t.lat, fix.location.point.lat);
+  TEST_ASSERT_EQUAL_INT32(t.lon, fix.location.point.lon);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, t.hMslMm / 1000.0, fix.altitude.value);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, t.speedMms * 0.0036, fix.speed.value);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, t.heading * 1e-5, fix.course.value);
+  TEST_ASSERT_EQUAL(t.h, fix.time.h);
+  TEST_ASSERT_EQUAL(t.m, fix.time.m);
+  TEST_ASSERT_EQUAL(t.s, fix.time.s);
+  TEST_ASSERT_EQUAL(2026, fix.date.y);
+  TEST_ASSERT_EQUAL(t.satellites, fix.satellites.count);
+  TEST_ASSERT_EQUAL(3, fix.fixType);
+}
+
+void setUp(void) {
+  testMillis = 1000;
+  gpsStreamReset();
+  gpsStreamOnFix(onFix);
+  published.clear();
+}
+
+void tearDown(void) {
+  gpsStreamOnFix(nullptr);
+}
+
+void test_nav_pvt_stream(void) {
+  feed(pvtCapture());
+  TEST_ASSERT_EQUAL_UINT32(EPOCHS, gpsStreamStats().sentences);
+  TEST_ASSERT_EQUAL(EPOCHS, published.size());
+  for (int epoch = 0; epoch < EPOCHS; epoch++) {
+    assertEpoch(published[epoch], epoch);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.8, published[epoch].hAccMeters);
+  }
+}
+
+// One fix per iTOW, with the position, velocity and time of that epoch
+void test_legacy_stream(void) {
+  feed(legacyCapture());
+  TEST_ASSERT_EQUAL_UINT32(EPOCHS * 4, gpsStreamStats().sentences);
+  TEST_ASSERT_EQUAL(EPOCHS, published.size());
+  // POSLLH comes before SOL, so the very first one is read before the receiver reported a fix
+  TEST_ASSERT_FALSE(published[0].location.valid);
+  for (int epoch = 1; epoch < EPOCHS; epoch++) {
+    assertEpoch(published[epoch], epoch);
+  }
+}
+
+void test_checksum_rejection(void) {
+  std::string stream = pvtCapture();
+  size_t frame = 92 + UBX_FRAME_OVERHEAD;
+  stream[100 * frame + 40] ^= 0x10;   // Payload of epoch 100
+  stream[200 * frame + 98] ^= 0x01;   // CK_A of epoch 200
+  stream[300 * frame + 99] ^= 0x80;   // CK_B of epoch 300
+  feed(stream);
+  GpsStreamStats stats = gpsStreamStats();
+  TEST_ASSERT_EQUAL_UINT32(3, stats.checksumFailures);
+  TEST_ASSERT_EQUAL_UINT32(EPOCHS - 3, stats.sentences);
+  TEST_ASSERT_EQUAL(EPOCHS - 3, published.size());
+  for (const GpsFix &fix : published) {
+    int epoch = (fix.location.point.lat - 473977000) / 10;
+    TEST_ASSERT_TRUE(epoch != 100 && epoch != 200 && epoch != 300);
+    assertEpoch(fix, epoch);
+  }
+}
+
+// A frame that doesn't fit the buffer is skipped without losing the ones after it
+void test_oversized_frame_is_skipped(void) {
+  uint8_t big[UBX_MAX_PAYLOAD + 20] = {};
+  uint8_t frame[sizeof(big) + UBX_FRAME_OVERHEAD];
+  size_t size = ubxBuildFrame(UBX_CLASS_NAV, 0x35, big, sizeof(big), frame);
+  std::string stream((const char *)frame, size);
+  stream += pvtCapture().substr(0, 3 * (92 + UBX_FRAME_OVERHEAD));
+  feed(stream);
+  TEST_ASSERT_EQUAL_UINT32(3, gpsStreamStats().sentences);
+  TEST_ASSERT_EQUAL_UINT32(0, gpsStreamStats().checksumFailures);
+}
+
+static double microsPerFix(const std::string &stream) {
+  unsigned long start = micros();
+  for (int round = 0; round < ROUNDS; round++) {
+    gpsStreamReset();
+    feed(stream);
+  }
+  return (double)(micros() - start) / (ROUNDS * EPOCHS);
+}
+
+void test_cost_per_fix(void) {
+  gpsStreamOnFix(nullptr);
+  std::string nmea = nmeaCapture(), pvt = pvtCapture(), legacy = legacyCapture();
+  double nmeaUs = microsPerFix(nmea), pvtUs = microsPerFix(pvt), legacyUs = microsPerFix(legacy);
+  TEST_ASSERT_EQUAL_UINT32(EPOCHS, gpsStreamStats().fixes);
+  char message[160];
+  snprintf(message, sizeof(message), "per fix: NMEA %.2f us (%u B), NAV-PVT %.2f us (%u B), NEO-6M %.2f us (%u B)",
+           nmeaUs, (unsigned)(nmea.size() / EPOCHS), pvtUs, (unsigned)(pvt.size() / EPOCHS), legacyUs,
+           (unsigned)(legacy.size() / EPOCHS));
+  TEST_MESSAGE(message);
+  TEST_ASSERT_LESS_THAN(nmeaUs, pvtUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_nav_pvt_stream);
+  RUN_TEST(test_legacy_stream);
+  RUN_TEST(test_checksum_rejection);
+  RUN_TEST(test_oversized_frame_is_skipped);
+  RUN_TEST(test_cost_per_fix);
+  return UNITY_END();
+}
@@ -0,0 +1,253 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "crc32.h"
+#include "waypoint_db.h"
+
+#define MAX_CELLS 16384 // As tools/waypoint_db.py
+
+typedef std::vector<uint8_t> Bytes;
+
+static std::string directory;
+static std::mt19937 rng;
+
+static int32_t units(double degrees) {
+  return (int32_t)lround(degrees * NAV_COORD_SCALE);
+}
+
+static double uniform(double lo, double hi) {
+  return std::uniform_real_distribution<double>(lo, hi)(rng);
+}
+
+// Airfields bunched in valleys and around towns, with some spread thinly in between
+static std::vector<WaypointRecord> waypoints(uint32_t count) {
+  std::vector<WaypointRecord> records(count);
+  double clusterLat = 0.0, clusterLon = 0.0;
+  for (uint32_t i = 0; i < count; i++) {
+    WaypointRecord &record = records[i];
+    record = {};
+    if (i % 40 == 0) {
+      clusterLat = uniform(45.5, 48.5);
+      clusterLon = uniform(5.5, 11.5);
+    }
+    if (i % 4 == 0) {
+      record.point = {units(uniform(45.0, 49.0)), units(uniform(5.0, 12.0))};
+    } else {
+      record.point = {units(clusterLat + uniform(-0.05, 0.05)), units(clusterLon + uniform(-0.08, 0.08))};
+    }
+    record.type = rng() % 3;
+    record.flags = rng() % 10 ? WAYPOINT_FLAG_ENABLED : 0;
+    record.elevation = (int16_t)(rng() % 3000);
+  }
+  return records;
+}
+
+// The image tools/waypoint_db.py builds: a grid of cellDeg cells over the
+// bounding box, grown until the cell table fits, records sorted by cell
+static Bytes database(std::vector<WaypointRecord> records, double cellDeg) {
+  int32_t minLat = INT32_MAX, minLon = INT32_MAX, maxLat = INT32_MIN, maxLon = INT32_MIN;
+  for (const WaypointRecord &record : records) {
+    minLat = std::min(minLat, record.point.lat);
+    minLon = std::min(minLon, record.point.lon);
+    maxLat = std::max(maxLat, record.point.lat);
+    maxLon = std::max(maxLon, record.point.lon);
+  }
+  int32_t cell = std::max(1, units(cellDeg));
+  uint32_t cols, rows;
+  while (true) {
+    cols = (uint32_t)((int64_t)maxLon - minLon) / cell + 1;
+    rows = (uint32_t)((int64_t)maxLat - minLat) / cell + 1;
+    if (cols * rows <= MAX_CELLS) break;
+    cell *= 2;
+  }
+  auto cellOf = [&](const WaypointRecord &record) {
+    uint32_t row = (uint32_t)((int64_t)record.point.lat - minLat) / cell;
+    return row * cols + (uint32_t)((int64_t)record.point.lon - minLon) / cell;
+  };
+  std::stable_sort(records.begin(), records.end(),
+                   [&](const WaypointRecord &a, const WaypointRecord &b) { return cellOf(a) < cellOf(b); });
+  std::vector<uint32_t> starts(cols * rows + 1, 0);
+  for (const WaypointRecord &record : records) starts[cellOf(record) + 1]++;
+  for (size_t i = 1; i < starts.size(); i++) starts[i] += starts[i - 1];
+
+  std::string names;
+  for (uint32_t i = 0; i < records.size(); i++) {
+    records[i].nameOffset = names.size();
+    names += "WP" + std::to_string(i) + '\0';
+  }
+
+  WaypointDbHeader header = {};
+  header.count = records.size();
+  header.originLat = minLat;
+  header.originLon = minLon;
+  header.cellSize = cell;
+  header.cols = cols;
+  header.rows = rows;
+  header.cellsOffset = sizeof(header);
+  header.recordsOffset = header.cellsOffset + starts.size() * sizeof(uint32_t);
+  header.namesOffset = header.recordsOffset + records.size() * sizeof(WaypointRecord);
+  header.namesSize = names.size();
+  Bytes image(sizeof(header));
+  image.insert(image.end(), (const uint8_t *)starts.data(), (const uint8_t *)(starts.data() + starts.size()));
+  image.insert(image.end(), (const uint8_t *)records.data(), (const uint8_t *)(records.data() + records.size()));
+  image.insert(image.end(), names.begin(), names.end());
+  header.asset = {WAYPOINT_DB_MAGIC, WAYPOINT_DB_VERSION, sizeof(header), (uint32_t)image.size(), 0};
+  header.asset.crc = crc32Update(0, image.data() + sizeof(header), image.size() - sizeof(header));
+  memcpy(image.data(), &header, sizeof(header));
+  return image;
+}
+
+static void open(const Bytes &image) {
+  waypointDbEnd();
+  FILE *file = fopen((directory + "/" WAYPOINT_DB_PARTITION ".bin").c_str(), "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  fwrite(image.data(), 1, image.size(), file);
+  fclose(file);
+  TEST_ASSERT_TRUE(waypointDbBegin());
+}
+
+// Every record, closest first
+static uint16_t bruteForce(const NavPoint &at, float radiusMeters, uint8_t typeMask, WaypointHit *hits,
+                           uint16_t maxHits) {
+  NavOrigin origin = navOrigin(at);
+  std::vector<WaypointHit> all;
+  for (uint32_t i = 0; i < waypointDbCount(); i++) {
+    const WaypointRecord *record = waypointDbRecord(i);
+    if (!(record->flags & WAYPOINT_FLAG_ENABLED) || !((typeMask >> record->type) & 1)) continue;
+    float meters = navDistanceMeters(origin, record->point);
+    if (meters <= radiusMeters) all.push_back({i, meters});
+  }
+  std::stable_sort(all.begin(), all.end(),
+                   [](const WaypointHit &a, const WaypointHit &b) { return a.distanceMeters < b.distanceMeters; });
+  uint16_t found = std::min<size_t>(all.size(), maxHits);
+  std::copy(all.begin(), all.begin() + found, hits);
+  return found;
+}
+
+// Ties may come in either order, so distances are compared and indices only where they differ
+static void assertSameHits(const WaypointHit *expected, uint16_t expectedCount, const WaypointHit *actual,
+                           uint16_t actualCount) {
+  TEST_ASSERT_EQUAL(expectedCount, actualCount);
+  for (uint16_t i = 0; i < actualCount; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(expected[i].distanceMeters, actual[i].distanceMeters);
+    bool tied = (i > 0 && expected[i - 1].distanceMeters == expected[i].distanceMeters) ||
+                (i + 1 < actualCount && expected[i + 1].distanceMeters == expected[i].distanceMeters);
+    if (!tied) TEST_ASSERT_EQUAL(expected[i].index, actual[i].index);
+  }
+}
+
+static NavPoint randomQuery() {
+  // Mostly over the area, some just outside the grid and a few far away
+  int kind = rng() % 10;
+  if (kind < 7) return {units(uniform(45.0, 49.0)), units(uniform(5.0, 12.0))};
+  if (kind < 9) return {units(uniform(43.0, 51.0)), units(uniform(3.0, 14.0))};
+  return {units(uniform(-60.0, 70.0)), units(uniform(-180.0, 180.0))};
+}
+
+void setUp(void) {
+  std::string base = (std::filesystem::temp_directory_path() / "waypoints_XXXXXX").string();
+  directory = mkdtemp(&base[0]);
+  assetSetHostDirectory(directory.c_str());
+  rng.seed(1);
+}
+
+void tearDown(void) {
+  waypointDbEnd();
+  std::filesystem::remove_all(directory);
+}
+
+void test_grid_layout(void) {
+  open(database(waypoints(12000), 0.1));
+  const WaypointDbHeader *header = assetHeader<WaypointDbHeader>(waypointDbImage());
+  TEST_ASSERT_EQUAL(12000, waypointDbCount());
+  TEST_ASSERT_GREATER_THAN(1000, header->cols * header->rows);
+  TEST_ASSERT_EQUAL_STRING("WP17", waypointDbName(*waypointDbRecord(17)));
+  TEST_ASSERT_NULL(waypointDbRecord(12000));
+}
+
+void test_nearest_matches_brute_force(void) {
+  const uint8_t masks[] = {WAYPOINT_TYPE_ANY, 1 << WAYPOINT_TYPE_LANDABLE, 1 << WAYPOINT_TYPE_FUEL,
+                           1 << WAYPOINT_TYPE_OTHER | 1 << WAYPOINT_TYPE_FUEL};
+  const double cells[] = {0.02, 0.1, 1.0};
+  for (double cellDeg : cells) {
+    open(database(waypoints(12000), cellDeg));
+    for (int q = 0; q < 300; q++) {
+      NavPoint at = randomQuery();
+      uint8_t mask = masks[q % 4];
+      uint16_t maxHits = 1 + q % 12;
+      WaypointHit expected[12], actual[12];
+      uint16_t expectedCount = bruteForce(at, INFINITY, mask, expected, maxHits);
+      uint16_t actualCount = waypointDbNearest(at, mask, actual, maxHits);
+      assertSameHits(expected, expectedCount, actual, actualCount);
+    }
+  }
+}
+
+void test_within_matches_brute_force(void) {
+  open(database(waypoints(12000), 0.1));
+  const float radii[] = {500.0f, 5000.0f, 25000.0f};
+  for (int q = 0; q < 300; q++) {
+    NavPoint at = randomQuery();
+    float radius = radii[q % 3];
+    WaypointHit expected[32], actual[32];
+    uint16_t expectedCount = bruteForce(at, radius, WAYPOINT_TYPE_ANY, expected, 32);
+    uint16_t actualCount = waypointDbWithin(at, radius, WAYPOINT_TYPE_ANY, actual, 32);
+    assertSameHits(expected, expectedCount, actual, actualCount);
+    for (uint16_t i = 0; i < actualCount; i++) TEST_ASSERT_TRUE(actual[i].distanceMeters <= radius);
+  }
+}
+
+// Nothing enabled of the type asked for
+void test_no_match(void) {
+  std::vector<WaypointRecord> records = waypoints(500);
+  for (WaypointRecord &record : records) record.type = WAYPOINT_TYPE_OTHER;
+  open(database(records, 0.1));
+  WaypointHit hits[4];
+  TEST_ASSERT_EQUAL(0, waypointDbNearest({units(47.0), units(8.0)}, 1 << WAYPOINT_TYPE_FUEL, hits, 4));
+  TEST_ASSERT_EQUAL(0, waypointDbNearest({units(47.0), units(8.0)}, WAYPOINT_TYPE_ANY, hits, 0));
+  waypointDbEnd();
+  TEST_ASSERT_EQUAL(0, waypointDbNearest({units(47.0), units(8.0)}, WAYPOINT_TYPE_ANY, hits, 4));
+}
+
+// Nearest landable fields each fix, as loop() asks for them
+void test_nearest_timing(void) {
+  const uint32_t counts[] = {10000, 50000};
+  for (uint32_t count : counts) {
+    open(database(waypoints(count), 0.1));
+    std::vector<NavPoint> queries(200);
+    for (NavPoint &query : queries) query = {units(uniform(45.5, 48.5)), units(uniform(5.5, 11.5))};
+
+    WaypointHit hits[5];
+    const int rounds = 10;
+    unsigned long start = micros();
+    for (int r = 0; r < rounds; r++) {
+      for (const NavPoint &query : queries) waypointDbNearest(query, 1 << WAYPOINT_TYPE_LANDABLE, hits, 5);
+    }
+    double gridUs = (double)(micros() - start) / (rounds * queries.size());
+    start = micros();
+    for (const NavPoint &query : queries) bruteForce(query, INFINITY, 1 << WAYPOINT_TYPE_LANDABLE, hits, 5);
+    double bruteUs = (double)(micros() - start) / queries.size();
+
+    char message[120];
+    snprintf(message, sizeof(message), "%u waypoints: nearest 5 in %.1f us, scanning all %.1f us",
+             (unsigned)count, gridUs, bruteUs);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(bruteUs / 10, gridUs);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_grid_layout);
+  RUN_TEST(test_nearest_matches_brute_force);
+  RUN_TEST(test_within_matches_brute_force);
+  RUN_TEST(test_no_match);
+  RUN_TEST(test_nearest_timing);
+  return UNITY_END();
+}
@@ -0,0 +1,313 @@
+#!/usr/bin/env python3
+"""Compile OpenAir airspace into the airspace partition image.
+
+Understands AC, AN, AL, AH, DP, V X=, V D=, DA, DB and DC. Arcs become
+polygon vertices every --arc-step degrees; DC circles are kept as circles.
+A polygon with more vertices than the device tests per area is simplified
+until it fits.
+Altitudes may be SFC/GND, UNL, FL<n>, or a number in ft (default) or m,
+followed by MSL/AMSL/AGL/GND.
+
+The layout matches include/airspace.h. Flash the image at the offset of the
+"airspace" partition in partitions.csv:
+
+  python3 tools/airspace.py region.txt -o airspace.bin
+  esptool.py write_flash 0x354000 airspace.bin
+"""
+
+import argparse
+import math
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0x53524941  # "AIRS"
+VERSION = 1
+COORD_SCALE = 10000000
+EARTH_RADIUS_M = 6372795.0
+NM = 1852.0
+FT = 0.3048
+HEADER = struct.Struct("<IHHII" "IIiiiHHIIIIIIII")
+AREA = struct.Struct("<iiiiIHBBhhII")
+FLAG_CIRCLE = 0x01
+FLAG_FLOOR_AGL = 0x02
+FLAG_CEILING_AGL = 0x04
+MAX_CELLS = 16384
+VERTEX_BUDGET = 2048  # AIRSPACE_VERTEX_BUDGET: the device rejects larger areas
+PARTITION_SIZE = 0x40000
+CLASS_CODES = {"CTR": "T", "TMZ": "Z", "RMZ": "M", "GP": "g", "GSEC": "s"}
+
+COORD = re.compile(r"(\d+):(\d+(?:\.\d+)?)(?::(\d+(?:\.\d+)?))?\s*([NS])\s*,?\s*"
+                   r"(\d+):(\d+(?:\.\d+)?)(?::(\d+(?:\.\d+)?))?\s*([EW])", re.I)
+
+
+def parse_coord(text):
+    m = COORD.search(text)
+    if not m:
+        raise ValueError(f"bad coordinate: {text}")
+    lat = int(m[1]) + float(m[2]) / 60 + float(m[3] or 0) / 3600
+    lon = int(m[5]) + float(m[6]) / 60 + float(m[7] or 0) / 3600
+    return (-lat if m[4].upper() == "S" else lat, -lon if m[8].upper() == "W" else lon), m.end()
+
+
+def parse_altitude(text):
+    """Metres and whether they are above ground."""
+    t = text.strip().upper()
+    if t in ("SFC", "GND", "0"):
+        return 0, True
+    if t.startswith("UNL"):
+        return 32767, False
+    m = re.match(r"FL\s*(\d+)", t)
+    if m:
+        return round(int(m[1]) * 100 * FT), False
+    m = re.match(r"(\d+(?:\.\d+)?)\s*(FT|F|M)?\s*(MSL|AMSL|AGL|AGND|GND|SFC|ASFC)?", t)
+    if not m:
+        raise ValueError(f"bad altitude: {text}")
+    value = float(m[1]) * (1.0 if m[2] == "M" else FT)
+    return round(value), m[3] in ("AGL", "AGND", "GND", "SFC", "ASFC")
+
+
+def destination(center, bearing_deg, distance_m):
+    lat1, lon1 = map(math.radians, center)
+    b = math.radians(bearing_deg)
+    d = distance_m / EARTH_RADIUS_M
+    lat2 = math.asin(math.sin(lat1) * math.cos(d) + math.cos(lat1) * math.sin(d) * math.cos(b))
+    lon2 = lon1 + math.atan2(math.sin(b) * math.sin(d) * math.cos(lat1), math.cos(d) - math.sin(lat1) * math.sin(lat2))
+    return math.degrees(lat2), (math.degrees(lon2) + 540) % 360 - 180
+
+
+def bearing_distance(center, point):
+    lat1, lon1 = map(math.radians, center)
+    lat2, lon2 = map(math.radians, point)
+    dlon = lon2 - lon1
+    a = math.sin((lat2 - lat1) / 2) ** 2 + math.cos(lat1) * math.cos(lat2) * math.sin(dlon / 2) ** 2
+    distance = 2 * EARTH_RADIUS_M * math.asin(math.sqrt(a))
+    bearing = math.degrees(math.atan2(math.sin(dlon) * math.cos(lat2),
+                                      math.cos(lat1) * math.sin(lat2) - math.sin(lat1) * math.cos(lat2) * math.cos(dlon)))
+    return bearing % 360, distance
+
+
+def arc(points, center, radius_m, start, end, clockwise, step):
+    sweep = (end - start) % 360 if clockwise else -((start - end) % 360)
+    if sweep == 0:
+        sweep = 360 if clockwise else -360
+    n = max(1, math.ceil(abs(sweep) / step))
+    for i in range(n + 1):
+        points.append(destination(center, start + sweep * i / n, radius_m))
+
+
+def parse(path, step):
+    areas = []
+    area = None
+    center = None
+    clockwise = True
+
+    def close():
+        if area and (area["points"] or area["circle"]):
+            areas.append(area)
+
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line_number, raw in enumerate(f, 1):
+            line = raw.split("*", 1)[0].strip()
+            if not line:
+                continue
+            key, _, rest = line.partition(" ")
+            key = key.upper()
+            rest = rest.strip()
+            try:
+                if key == "AC":
+                    close()
+                    area = {"class": rest.upper(), "name": "", "floor": (0, True), "ceiling": (32767, False),
+                            "points": [], "circle": None}
+                    center, clockwise = None, True
+                elif area is None:
+                    continue
+                elif key == "AN":
+                    area["name"] = rest
+                elif key == "AL":
+                    area["floor"] = parse_altitude(rest)
+                elif key == "AH":
+                    area["ceiling"] = parse_altitude(rest)
+                elif key == "DP":
+                    area["points"].append(parse_coord(rest)[0])
+                elif key == "V":
+                    name, _, value = rest.partition("=")
+                    if name.strip().upper() == "X":
+                        center = parse_coord(value)[0]
+                    elif name.strip().upper() == "D":
+                        clockwise = value.strip() != "-"
+                elif key == "DC":
+                    area["circle"] = (center, float(rest) * NM)
+                elif key == "DA":
+                    radius, start, end = (float(v) for v in rest.split(","))
+                    arc(area["points"], center, radius * NM, start, end, clockwise, step)
+                elif key == "DB":
+                    first, used = parse_coord(rest)
+                    second = parse_coord(rest[used:].lstrip(" ,"))[0]
+                    start, radius = bearing_distance(center, first)
+                    end, _ = bearing_distance(center, second)
+                    arc(area["points"], center, radius, start, end, clockwise, step)
+            except (ValueError, TypeError) as e:
+                sys.exit(f"{path}:{line_number}: {e}")
+    close()
+    return areas
+
+
+def segment_distance(p, a, b):
+    dx, dy = b[0] - a[0], b[1] - a[1]
+    length2 = dx * dx + dy * dy
+    t = 0.0 if length2 == 0 else max(0.0, min(1.0, ((p[0] - a[0]) * dx + (p[1] - a[1]) * dy) / length2))
+    return math.hypot(p[0] - a[0] - t * dx, p[1] - a[1] - t * dy)
+
+
+def simplify(points, budget):
+    """Douglas-Peucker on the closed ring, in metres on a local flat projection,
+    with the tolerance doubled until at most budget vertices are left. Returns
+    the vertices kept and the tolerance."""
+    scale = EARTH_RADIUS_M * math.pi / 180
+    cos_lat = math.cos(math.radians(sum(p[0] for p in points) / len(points)))
+    xy = [(p[1] * scale * cos_lat, p[0] * scale) for p in points]
+    n = len(xy)
+    far = max(range(n), key=lambda i: math.dist(xy[0], xy[i]))
+    tolerance = 1.0
+    while True:
+        keep = {0, far}
+        stack = [(0, far), (far, n)]
+        while stack:
+            a, b = stack.pop()
+            worst, worst_distance = None, tolerance
+            for i in range(a + 1, b):
+                d = segment_distance(xy[i], xy[a], xy[b % n])
+                if d > worst_distance:
+                    worst, worst_distance = i, d
+            if worst is not None:
+                keep.add(worst)
+                stack += [(a, worst), (worst, b)]
+        if len(keep) <= budget:
+            return [points[i] for i in sorted(keep)], tolerance
+        tolerance *= 2
+
+
+def to_units(point):
+    return round(point[0] * COORD_SCALE), round(point[1] * COORD_SCALE)
+
+
+def build(areas, cell_deg, margin_m, skip):
+    records = []
+    vertices = []
+    names = bytearray()
+    for a in areas:
+        if a["class"] in skip:
+            continue
+        if a["circle"]:
+            (clat, clon), radius = a["circle"]
+            points = [destination((clat, clon), b, radius) for b in (0, 90, 180, 270)]
+            stored = [to_units((clat, clon))]
+            flags = FLAG_CIRCLE
+        else:
+            points = a["points"]
+            if len(points) > 1 and points[0] == points[-1]:
+                points = points[:-1]
+            if len(points) < 3:
+                continue
+            if len(points) > VERTEX_BUDGET:
+                count = len(points)
+                points, tolerance = simplify(points, VERTEX_BUDGET)
+                print(f"{a['name']}: {count} vertices simplified to {len(points)}, within {tolerance:g} m",
+                      file=sys.stderr)
+            stored = [to_units(p) for p in points]
+            radius = 0
+            flags = 0
+        lats = [to_units(p)[0] for p in points]
+        lons = [to_units(p)[1] for p in points]
+        floor, floor_agl = a["floor"]
+        ceiling, ceiling_agl = a["ceiling"]
+        flags |= (FLAG_FLOOR_AGL if floor_agl else 0) | (FLAG_CEILING_AGL if ceiling_agl else 0)
+        code = CLASS_CODES.get(a["class"], a["class"][:1] or "?")
+        records.append([min(lats), min(lons), max(lats), max(lons), len(vertices), len(stored), ord(code), flags,
+                        max(-32768, min(32767, floor)), max(-32768, min(32767, ceiling)), round(radius), len(names)])
+        vertices += stored
+        names += a["name"].encode("utf-8") + b"\0"
+    if not records:
+        sys.exit("no airspace left to write")
+    if len(records) > 65535:
+        sys.exit("too many areas for 16-bit cell lists")
+
+    # Grid over everything, areas registered in every cell their grown box touches
+    margin_lat = margin_m / EARTH_RADIUS_M * 180 / math.pi * COORD_SCALE
+    min_lat = min(r[0] for r in records) - margin_lat
+    max_lat = max(r[2] for r in records) + margin_lat
+    widest = math.cos(math.radians(max(abs(min_lat), abs(max_lat)) / COORD_SCALE))
+    margin_lon = margin_lat / max(widest, 0.01)
+    min_lon = min(r[1] for r in records) - margin_lon
+    max_lon = max(r[3] for r in records) + margin_lon
+    origin_lat, origin_lon = math.floor(min_lat), math.floor(min_lon)
+    cell = max(1, round(cell_deg * COORD_SCALE))
+    while True:
+        cols = int((max_lon - origin_lon) // cell) + 1
+        rows = int((max_lat - origin_lat) // cell) + 1
+        if cols * rows <= MAX_CELLS:
+            break
+        cell *= 2
+
+    cells = [[] for _ in range(cols * rows)]
+    for index, r in enumerate(records):
+        row0 = max(0, int((r[0] - margin_lat - origin_lat) // cell))
+        row1 = min(rows - 1, int((r[2] + margin_lat - origin_lat) // cell))
+        col0 = max(0, int((r[1] - margin_lon - origin_lon) // cell))
+        col1 = min(cols - 1, int((r[3] + margin_lon - origin_lon) // cell))
+        for row in range(row0, row1 + 1):
+            for col in range(col0, col1 + 1):
+                cells[row * cols + col].append(index)
+    starts = [0]
+    cell_list = []
+    for c in cells:
+        cell_list += c
+        starts.append(len(cell_list))
+
+    def pad(data):
+        return data + bytes(-len(data) % 4)
+
+    body = bytearray()
+    areas_offset = HEADER.size + len(body)
+    body += b"".join(AREA.pack(*r) for r in records)
+    vertices_offset = HEADER.size + len(body)
+    body += b"".join(struct.pack("<ii", *v) for v in vertices)
+    cells_offset = HEADER.size + len(body)
+    body += struct.pack(f"<{len(starts)}I", *starts)
+    cell_list_offset = HEADER.size + len(body)
+    body = pad(body + struct.pack(f"<{len(cell_list)}H", *cell_list))
+    names_offset = HEADER.size + len(body)
+    body += names
+    total = HEADER.size + len(body)
+
+    header = HEADER.pack(MAGIC, VERSION, HEADER.size, total, zlib.crc32(body),
+                         len(records), len(vertices), int(origin_lat), int(origin_lon), cell, cols, rows,
+                         round(margin_m), areas_offset, vertices_offset, cells_offset,
+                         cell_list_offset, len(cell_list), names_offset, len(names))
+    return header + body, len(records), len(vertices), cols, rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("openair")
+    parser.add_argument("-o", "--output", default="airspace.bin")
+    parser.add_argument("--cell-deg", type=float, default=0.25, help="grid cell edge in degrees (default 0.25)")
+    parser.add_argument("--margin", type=float, default=1000, help="warning margin in metres (default 1000)")
+    parser.add_argument("--arc-step", type=float, default=5, help="degrees between arc vertices (default 5)")
+    parser.add_argument("--skip", default="G", help="comma separated AC classes to leave out (default G)")
+    parser.add_argument("--partition-size", type=lambda s: int(s, 0), default=PARTITION_SIZE)
+    args = parser.parse_args()
+
+    skip = {c.strip().upper() for c in args.skip.split(",") if c.strip()}
+    image, areas, vertices, cols, rows = build(parse(args.openair, args.arc_step), args.cell_deg, args.margin, skip)
+    if len(image) > args.partition_size:
+        sys.exit(f"image is {len(image)} bytes, the partition holds {args.partition_size}")
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{args.output}: {len(image)} bytes, {areas} areas, {vertices} vertices, {cols}x{rows} cells")
+
+
+if __name__ == "__main__":
+    main()
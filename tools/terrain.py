@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Build the terrain partition image from SRTM .hgt files.
+
+Each .hgt file is a 1x1 degree square of big-endian int16 elevations, 1201
+(3 arc-second) or 3601 (1 arc-second) samples on a side, named after its
+south-west corner, e.g. N47E008.hgt. Voids (-32768) are filled from their
+neighbours. Tiles with no .hgt data at all are left out and read as unknown.
+
+The layout matches include/terrain.h. Flash the image at the offset of the
+"terrain" partition in partitions.csv:
+
+  python3 tools/terrain.py --bounds 46.5,7.5,48,9.5 --hgt srtm/ -o terrain.bin
+  esptool.py write_flash 0x394000 terrain.bin
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4E525254  # "TRRN"
+VERSION = 1
+COORD_SCALE = 10000000
+SAMPLES = 33
+HEADER = struct.Struct("<IHHIIiiiHHIII")
+TILE_HEADER = struct.Struct("<hB")
+PARTITION_SIZE = 0x5C000
+VOID = -32768
+
+
+class Hgt:
+    def __init__(self, directory):
+        self.directory = directory
+        self.cache = {}
+
+    def square(self, lat, lon):
+        key = (lat, lon)
+        if key not in self.cache:
+            name = f"{'N' if lat >= 0 else 'S'}{abs(lat):02d}{'E' if lon >= 0 else 'W'}{abs(lon):03d}.hgt"
+            path = os.path.join(self.directory, name)
+            if os.path.exists(path):
+                with open(path, "rb") as f:
+                    data = f.read()
+                size = math.isqrt(len(data) // 2)
+                self.cache[key] = (size, struct.unpack(f">{size * size}h", data))
+            else:
+                self.cache[key] = None
+        return self.cache[key]
+
+    def sample(self, lat, lon):
+        """Bilinear elevation, None without data."""
+        square = self.square(math.floor(lat), math.floor(lon))
+        if square is None:
+            return None
+        size, data = square
+        # Row 0 of an .hgt file is its north edge
+        y = (math.floor(lat) + 1 - lat) * (size - 1)
+        x = (lon - math.floor(lon)) * (size - 1)
+        y0, x0 = min(int(y), size - 2), min(int(x), size - 2)
+        fy, fx = y - y0, x - x0
+        corners = [data[(y0 + dy) * size + x0 + dx] for dy in (0, 1) for dx in (0, 1)]
+        known = [c for c in corners if c != VOID]
+        if not known:
+            return None
+        fill = sum(known) / len(known)
+        a, b, c, d = (fill if v == VOID else v for v in corners)
+        top = a + (b - a) * fx
+        bottom = c + (d - c) * fx
+        return top + (bottom - top) * fy
+
+
+def zigzag_varint(value):
+    raw = (value << 1) ^ (value >> 31)
+    raw &= 0xFFFFFFFF
+    out = bytearray()
+    while True:
+        byte = raw & 0x7F
+        raw >>= 7
+        if raw:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return out
+
+
+def encode_tile(elevations, step):
+    base = min(elevations)
+    quantized = [round((e - base) / step) for e in elevations]
+    data = bytearray(TILE_HEADER.pack(base, step))
+    row_start = 0
+    for row in range(SAMPLES):
+        for col in range(SAMPLES):
+            q = quantized[row * SAMPLES + col]
+            predicted = row_start if col == 0 else quantized[row * SAMPLES + col - 1]
+            data += zigzag_varint(q - predicted)
+            if col == 0:
+                row_start = q
+    return data
+
+
+def build(hgt, bounds, tile_deg, step):
+    lat0, lon0, lat1, lon1 = bounds
+    tile = round(tile_deg * COORD_SCALE)
+    origin_lat = math.floor(lat0 * COORD_SCALE / tile) * tile
+    origin_lon = math.floor(lon0 * COORD_SCALE / tile) * tile
+    rows = math.ceil((lat1 * COORD_SCALE - origin_lat) / tile)
+    cols = math.ceil((lon1 * COORD_SCALE - origin_lon) / tile)
+
+    index = [0]
+    data = bytearray()
+    missing = 0
+    for row in range(rows):
+        for col in range(cols):
+            south = (origin_lat + row * tile) / COORD_SCALE
+            west = (origin_lon + col * tile) / COORD_SCALE
+            elevations = []
+            for y in range(SAMPLES):
+                for x in range(SAMPLES):
+                    elevations.append(hgt.sample(south + tile_deg * y / (SAMPLES - 1),
+                                                 west + tile_deg * x / (SAMPLES - 1)))
+            known = [e for e in elevations if e is not None]
+            if known:
+                fill = sum(known) / len(known)
+                data += encode_tile([max(-32000, min(32000, round(fill if e is None else e))) for e in elevations], step)
+            else:
+                missing += 1
+            index.append(len(data))
+
+    index_offset = HEADER.size
+    data_offset = index_offset + 4 * len(index)
+    body = struct.pack(f"<{len(index)}I", *index) + data
+    header = HEADER.pack(MAGIC, VERSION, HEADER.size, HEADER.size + len(body), zlib.crc32(body),
+                         origin_lat, origin_lon, tile, cols, rows, index_offset, data_offset, len(data))
+    return header + body, cols, rows, missing
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bounds", required=True, help="south,west,north,east in degrees")
+    parser.add_argument("--hgt", default=".", help="directory with the .hgt files")
+    parser.add_argument("-o", "--output", default="terrain.bin")
+    parser.add_argument("--tile-deg", type=float, default=0.1, help="tile edge in degrees (default 0.1)")
+    parser.add_argument("--step", type=int, default=2, help="quantization step in metres (default 2)")
+    parser.add_argument("--partition-size", type=lambda s: int(s, 0), default=PARTITION_SIZE)
+    args = parser.parse_args()
+
+    bounds = [float(v) for v in args.bounds.split(",")]
+    if len(bounds) != 4 or bounds[0] >= bounds[2] or bounds[1] >= bounds[3]:
+        sys.exit("--bounds must be south,west,north,east")
+    if not 1 <= args.step <= 255:
+        sys.exit("--step must be 1-255 metres")
+    image, cols, rows, missing = build(Hgt(args.hgt), bounds, args.tile_deg, args.step)
+    if len(image) > args.partition_size:
+        sys.exit(f"image is {len(image)} bytes, the partition holds {args.partition_size}; "
+                 "use a smaller region, larger tiles or a coarser step")
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{args.output}: {len(image)} bytes, {cols}x{rows} tiles, {missing} without data")
+
+
+if __name__ == "__main__":
+    main()
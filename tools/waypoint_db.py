@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Build the waypoint database partition image from a CSV file.
+
+CSV columns: name, lat, lon[, type[, elevation[, enabled]]]
+  type is landable, fuel or other (default other), or its number
+  elevation is metres MSL (default 0)
+  enabled is 1 or 0 (default 1)
+A header row is skipped if the lat column isn't a number.
+
+The layout matches include/waypoint_db.h. Flash the image at the offset of
+the "waypoints" partition in partitions.csv, and erase "waypoints_b", which
+holds databases uploaded over BLE; the device prefers those to a flashed one:
+
+  python3 tools/waypoint_db.py fields.csv -o waypoints.bin
+  esptool.py write_flash 0x314000 waypoints.bin
+  esptool.py erase_region 0x2D0000 0x40000
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import zlib
+
+MAGIC = 0x42445057  # "WPDB"
+VERSION = 1
+COORD_SCALE = 10000000
+HEADER = struct.Struct("<IHHIIIiiiHHIIII")
+RECORD = struct.Struct("<iiIBBh")
+TYPES = {"other": 0, "landable": 1, "fuel": 2}
+FLAG_ENABLED = 0x01
+MAX_CELLS = 16384  # Keeps the cell table under 64 KB
+PARTITION_SIZE = 0x40000
+
+
+def parse(path):
+    waypoints = []
+    with open(path, newline="", encoding="utf-8") as f:
+        for line, row in enumerate(csv.reader(f), 1):
+            if not row or row[0].startswith("#"):
+                continue
+            try:
+                lat, lon = float(row[1]), float(row[2])
+            except (IndexError, ValueError):
+                if line == 1:
+                    continue
+                sys.exit(f"{path}:{line}: expected name, lat, lon")
+            if not (-90 <= lat <= 90 and -180 <= lon <= 180):
+                sys.exit(f"{path}:{line}: coordinates out of range")
+            kind = row[3].strip().lower() if len(row) > 3 and row[3].strip() else "other"
+            kind = TYPES[kind] if kind in TYPES else int(kind)
+            elevation = int(float(row[4])) if len(row) > 4 and row[4].strip() else 0
+            enabled = row[5].strip() != "0" if len(row) > 5 and row[5].strip() else True
+            waypoints.append((row[0].strip(), round(lat * COORD_SCALE), round(lon * COORD_SCALE),
+                              kind, elevation, enabled))
+    if not waypoints:
+        sys.exit(f"{path}: no waypoints")
+    return waypoints
+
+
+def build(waypoints, cell_deg):
+    min_lat = min(w[1] for w in waypoints)
+    min_lon = min(w[2] for w in waypoints)
+    max_lat = max(w[1] for w in waypoints)
+    max_lon = max(w[2] for w in waypoints)
+
+    # Grow the cells until the grid fits the cell table budget
+    cell = max(1, round(cell_deg * COORD_SCALE))
+    while True:
+        cols = (max_lon - min_lon) // cell + 1
+        rows = (max_lat - min_lat) // cell + 1
+        if cols * rows <= MAX_CELLS:
+            break
+        cell *= 2
+
+    def cell_of(w):
+        return ((w[1] - min_lat) // cell) * cols + (w[2] - min_lon) // cell
+
+    waypoints = sorted(waypoints, key=cell_of)
+    starts = [0] * (cols * rows + 1)
+    for w in waypoints:
+        starts[cell_of(w) + 1] += 1
+    for i in range(1, len(starts)):
+        starts[i] += starts[i - 1]
+
+    names = bytearray()
+    name_offsets = {}
+    records = bytearray()
+    for name, lat, lon, kind, elevation, enabled in waypoints:
+        if name not in name_offsets:
+            name_offsets[name] = len(names)
+            names += name.encode("utf-8") + b"\0"
+        records += RECORD.pack(lat, lon, name_offsets[name], kind,
+                               FLAG_ENABLED if enabled else 0, max(-32768, min(32767, elevation)))
+
+    cells_offset = HEADER.size + (-HEADER.size % 4)
+    records_offset = cells_offset + 4 * len(starts)
+    names_offset = records_offset + len(records)
+    body = bytearray(cells_offset - HEADER.size)
+    body += struct.pack(f"<{len(starts)}I", *starts)
+    body += records
+    body += names
+    total = HEADER.size + len(body)
+
+    header = HEADER.pack(MAGIC, VERSION, HEADER.size, total, zlib.crc32(body), len(waypoints),
+                         min_lat, min_lon, cell, cols, rows,
+                         cells_offset, records_offset, names_offset, len(names))
+    return header + body, cols, rows, cell
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("csv")
+    parser.add_argument("-o", "--output", default="waypoints.bin")
+    parser.add_argument("--cell-deg", type=float, default=0.1, help="grid cell edge in degrees (default 0.1)")
+    parser.add_argument("--partition-size", type=lambda s: int(s, 0), default=PARTITION_SIZE)
+    args = parser.parse_args()
+
+    image, cols, rows, cell = build(parse(args.csv), args.cell_deg)
+    if len(image) > args.partition_size:
+        sys.exit(f"image is {len(image)} bytes, the partition holds {args.partition_size}")
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{args.output}: {len(image)} bytes, {cols}x{rows} cells of {cell / COORD_SCALE:g} degrees")
+
+
+if __name__ == "__main__":
+    main()
@@ -7,14 +7,46 @@
 const bleServiceUuid = "0000ffe0-0000-1000-8000-00805f9b34fb";
 const rxCharacteristicUuid = "0000ffe1-0000-1000-8000-00805f9b34fb"; 
 const txCharacteristicUuid = "0000ffe2-0000-1000-8000-00805f9b34fb";
+const telemetryCharacteristicUuid = "0000ffe3-0000-1000-8000-00805f9b34fb"; // Binary frames, see include/telemetry.h
+
+const TELEMETRY_VERSION = 1;
+const TELEMETRY_FRAME_LIVE = 1;
+const TELEMETRY_FRAME_CONFIG = 2;
+const TELEMETRY_FRAME_DELTA = 3;
+const TELEMETRY_FRAME_DIAGNOSTICS = 4;
+const LINK_PROFILES = ['idle', 'active', 'bulk'];
+const POWER_PROFILES = ['flying', 'walking', 'resting'];
+const LIVE_STREAM_HZ = 2; // Asked for on connect, the device caps it at 5
+const STREAM_RESYNC_MS = 2000; // Between requests for absolute values after a lost frame
+
+// Bulk upload, see include/bulk_transfer.h
+const bulkCharacteristicUuid = "0000ffe4-0000-1000-8000-00805f9b34fb";
+const BULK_OP_BEGIN = 0x01;
+const BULK_OP_CHUNK = 0x02;
+const BULK_OP_END = 0x03;
+const BULK_OP_ABORT = 0x04;
+const BULK_TARGET_WAYPOINTS = 1;
+const BULK_STATUS_OK = 0;
+const BULK_STATUS_INCOMPLETE = 4;
+const BULK_CHUNK_SIZES = [241, 182, 17]; // Largest first; what fits depends on the MTU the browser negotiated
+const BULK_WINDOW = 16;                  // Chunks in flight, the device queues 16 packets
+const BULK_ACK_TIMEOUT_MS = 1000;
 
 // Global variables
 let bleDevice, bleServer;
-let rxCharacteristic, txCharacteristic;
+let rxCharacteristic, txCharacteristic, telemetryCharacteristic, bulkCharacteristic;
+let bulkAckWaiter = null; // Resolves the pending waitForBulkAck()
 let mainMap, homeMarker;
 let poiMarkers = [];
 let poiColors = ['red', 'blue', 'green'];
 let activeSetPOIIndex = -1;
+let telemetryBurnRate = null; // From the last config frame, shown with the live fuel level
+let liveMarker;
+// Live stream values in the device's units: lat, lon (1e-7 deg), altitude (m),
+// speed (0.1 km/h), course (0.01 deg), fuel (0.01 L), battery (mV)
+let streamValues = [null, null, null, null, null, null, null];
+let streamSequence = null; // Of the last delta frame
+let streamResyncAt = 0;    // When absolute values were last asked for
 
 // Initialize the application
 document.addEventListener('DOMContentLoaded', function() {
@@ -45,6 +77,10 @@ function initializeMap() {
     homeMarker.bindPopup("Home Location");
     homeMarker.addTo(mainMap);
     
+    // Device position from the live stream, added with the first fix
+    liveMarker = L.circleMarker([0, 0], { radius: 8, color: '#1565c0', fillOpacity: 0.8 });
+    liveMarker.bindTooltip('');
+    
     // Create POI markers
     for (let i = 0; i < 3; i++) {
         const marker = L.marker([0, 0], {
@@ -129,6 +165,9 @@ function setupEventListeners() {
     // Update Fuel button
     document.getElementById('updateFuelButton').addEventListener('click', updateFuel);
     
+    // Waypoint database upload
+    document.getElementById('uploadWaypointsButton').addEventListener('click', uploadWaypoints);
+    
     // Mode selection buttons
     document.getElementById('flyingModeBtn').addEventListener('click', () => setMode(1));
     document.getElementById('walkingModeBtn').addEventListener('click', () => setMode(2));
@@ -275,6 +314,29 @@ async function connectToBLE() {
         await txCharacteristic.startNotifications();
         txCharacteristic.addEventListener('characteristicvaluechanged', handleIncomingBLEData);
         
+        // Binary telemetry, missing on older firmware
+        try {
+            telemetryCharacteristic = await service.getCharacteristic(telemetryCharacteristicUuid);
+            await telemetryCharacteristic.startNotifications();
+            telemetryCharacteristic.addEventListener('characteristicvaluechanged', handleTelemetryFrame);
+            streamValues = streamValues.map(() => null);
+            streamSequence = null;
+            await sendCommand(`STREAM:${LIVE_STREAM_HZ}`);
+        } catch (error) {
+            console.log('No binary telemetry, using the text status only');
+            telemetryCharacteristic = null;
+        }
+        
+        // Bulk upload, missing on older firmware
+        try {
+            bulkCharacteristic = await service.getCharacteristic(bulkCharacteristicUuid);
+            await bulkCharacteristic.startNotifications();
+            bulkCharacteristic.addEventListener('characteristicvaluechanged', handleBulkAck);
+        } catch (error) {
+            console.log('No bulk upload on this firmware');
+            bulkCharacteristic = null;
+        }
+        
         // Update UI and fetch initial data
         updateConnectionStatus(true);
         console.log('Connected to BLE device!');
@@ -302,6 +364,8 @@ function handleDisconnection() {
     // Clear BLE variables
     rxCharacteristic = null;
     txCharacteristic = null;
+    telemetryCharacteristic = null;
+    bulkCharacteristic = null;
     bleServer = null;
 }
 
@@ -355,17 +419,7 @@ function handleIncomingBLEData(event) {
             const lat = parseFloat(homeMatch[1]);
             const lon = parseFloat(homeMatch[2]);
             
-            // Update home marker and form fields
-            if (!isNaN(lat) && !isNaN(lon)) {
-                homeMarker.setLatLng([lat, lon]);
-                document.getElementById('savedHomeLat').value = lat.toFixed(6);
-                document.getElementById('savedHomeLon').value = lon.toFixed(6);
-                
-                // Center map on home location if this is first data
-                if (mainMap.getZoom() === 13) { // Default zoom
-                    mainMap.setView([lat, lon], 13);
-                }
-            }
+            applyHome(lat, lon);
         }
         
         // Extract POI information - but only if we're not actively setting one
@@ -378,29 +432,7 @@ function handleIncomingBLEData(event) {
                     const lon = parseFloat(poiMatch[2]);
                     const enabled = poiMatch[3] === '1';
                     
-                    // Get current state to avoid unnecessary updates
-                    const currentEnabled = document.getElementById(`poi${i}Enabled`).checked;
-                    
-                    // Update the fields
-                    document.getElementById(`poi${i}Lat`).value = lat.toFixed(6);
-                    document.getElementById(`poi${i}Lon`).value = lon.toFixed(6);
-                    
-                    // Only update enabled state if it's different, to avoid unticking
-                    if (currentEnabled !== enabled) {
-                        document.getElementById(`poi${i}Enabled`).checked = enabled;
-                        updatePOIStatusIndicator(i);
-                        updateDisableButtonState(i);
-                    }
-                    
-                    // Update marker
-                    if (enabled) {
-                        poiMarkers[i-1].setLatLng([lat, lon]);
-                        poiMarkers[i-1].addTo(mainMap);
-                    } else if (!currentEnabled) { // Only remove if it was already disabled
-                        if (mainMap.hasLayer(poiMarkers[i-1])) {
-                            mainMap.removeLayer(poiMarkers[i-1]);
-                        }
-                    }
+                    applyPOI(i, lat, lon, enabled);
                 }
             }
         }
@@ -410,17 +442,7 @@ function handleIncomingBLEData(event) {
         if (fuelMatch) {
             const fuelLevel = parseFloat(fuelMatch[1]);
             const burnRate = parseFloat(fuelMatch[2]);
-            
-            document.getElementById('currentFuelLevel').textContent = fuelLevel.toFixed(1);
-            document.getElementById('currentBurnRate').textContent = burnRate.toFixed(1);
-            
-            // Set default values for the input fields if they're empty
-            if (document.getElementById('newFuelLevel').value === '') {
-                document.getElementById('newFuelLevel').value = fuelLevel.toFixed(1);
-            }
-            if (document.getElementById('newBurnRate').value === '') {
-                document.getElementById('newBurnRate').value = burnRate.toFixed(1);
-            }
+            applyFuel(fuelLevel, burnRate);
         }
         
         // Extract operation mode
@@ -434,21 +456,7 @@ function handleIncomingBLEData(event) {
         const battMatch = data.match(/Batt: ([\d.]+)V/);
         if (battMatch) {
             const voltage = parseFloat(battMatch[1]);
-            document.getElementById('batteryVoltage').textContent = voltage.toFixed(2) + 'V';
-            
-            // Update battery level indicator
-            // Assuming voltage range 3.3V (0%) to 4.2V (100%)
-            const percentage = Math.max(0, Math.min(100, ((voltage - 3.3) / 0.9) * 100));
-            document.getElementById('batteryLevel').style.width = percentage + '%';
-            
-            // Change color based on level
-            if (percentage < 20) {
-                document.getElementById('batteryLevel').style.backgroundColor = '#f44336'; // Red
-            } else if (percentage < 50) {
-                document.getElementById('batteryLevel').style.backgroundColor = '#ff9800'; // Orange
-            } else {
-                document.getElementById('batteryLevel').style.backgroundColor = '#4CAF50'; // Green
-            }
+            applyBattery(voltage);
         }
         
     } catch (error) {
@@ -456,6 +464,201 @@ function handleIncomingBLEData(event) {
     }
 }
 
+// Home point from the device into the marker and form fields
+function applyHome(lat, lon) {
+    if (!isNaN(lat) && !isNaN(lon)) {
+        homeMarker.setLatLng([lat, lon]);
+        document.getElementById('savedHomeLat').value = lat.toFixed(6);
+        document.getElementById('savedHomeLon').value = lon.toFixed(6);
+    
+        // Center map on home location if this is first data
+        if (mainMap.getZoom() === 13) { // Default zoom
+            mainMap.setView([lat, lon], 13);
+        }
+    }
+}
+
+// POI from the device; callers skip this while the user is setting one
+function applyPOI(i, lat, lon, enabled) {
+    // Get current state to avoid unnecessary updates
+    const currentEnabled = document.getElementById(`poi${i}Enabled`).checked;
+    
+    // Update the fields
+    document.getElementById(`poi${i}Lat`).value = lat.toFixed(6);
+    document.getElementById(`poi${i}Lon`).value = lon.toFixed(6);
+    
+    // Only update enabled state if it's different, to avoid unticking
+    if (currentEnabled !== enabled) {
+        document.getElementById(`poi${i}Enabled`).checked = enabled;
+        updatePOIStatusIndicator(i);
+        updateDisableButtonState(i);
+    }
+    
+    // Update marker
+    if (enabled) {
+        poiMarkers[i-1].setLatLng([lat, lon]);
+        poiMarkers[i-1].addTo(mainMap);
+    } else if (!currentEnabled) { // Only remove if it was already disabled
+        if (mainMap.hasLayer(poiMarkers[i-1])) {
+            mainMap.removeLayer(poiMarkers[i-1]);
+        }
+    }
+}
+
+function applyFuel(fuelLevel, burnRate) {
+    document.getElementById('currentFuelLevel').textContent = fuelLevel.toFixed(1);
+    document.getElementById('currentBurnRate').textContent = burnRate.toFixed(1);
+    
+    // Set default values for the input fields if they're empty
+    if (document.getElementById('newFuelLevel').value === '') {
+        document.getElementById('newFuelLevel').value = fuelLevel.toFixed(1);
+    }
+    if (document.getElementById('newBurnRate').value === '') {
+        document.getElementById('newBurnRate').value = burnRate.toFixed(1);
+    }
+}
+
+function applyBattery(voltage) {
+    document.getElementById('batteryVoltage').textContent = voltage.toFixed(2) + 'V';
+    
+    // Update battery level indicator
+    // Assuming voltage range 3.3V (0%) to 4.2V (100%)
+    const percentage = Math.max(0, Math.min(100, ((voltage - 3.3) / 0.9) * 100));
+    document.getElementById('batteryLevel').style.width = percentage + '%';
+    
+    // Change color based on level
+    if (percentage < 20) {
+        document.getElementById('batteryLevel').style.backgroundColor = '#f44336'; // Red
+    } else if (percentage < 50) {
+        document.getElementById('batteryLevel').style.backgroundColor = '#ff9800'; // Orange
+    } else {
+        document.getElementById('batteryLevel').style.backgroundColor = '#4CAF50'; // Green
+    }
+}
+
+// Binary telemetry frame: a 4-byte header (version, type, length) then the
+// packed little-endian fields of include/telemetry.h. Fields past the ones
+// read here are newer additions and ignored; another version means the
+// layout changed.
+function handleTelemetryFrame(event) {
+    const view = event.target.value;
+    if (view.byteLength < 4 || view.getUint8(0) !== TELEMETRY_VERSION) {
+        return; // Incompatible schema; the text status still works
+    }
+    const type = view.getUint8(1);
+    const length = view.getUint16(2, true);
+    if (length > view.byteLength) {
+        return; // Cut short by the MTU
+    }
+    
+    if (type === TELEMETRY_FRAME_CONFIG && length >= 40) {
+        applyHome(view.getInt32(4, true) / 1e7, view.getInt32(8, true) / 1e7);
+        const poiEnabled = view.getUint8(36);
+        if (activeSetPOIIndex === -1) {
+            for (let i = 1; i <= 3; i++) {
+                const offset = 12 + (i - 1) * 8;
+                applyPOI(i, view.getInt32(offset, true) / 1e7, view.getInt32(offset + 4, true) / 1e7,
+                         (poiEnabled & (1 << (i - 1))) !== 0);
+            }
+        }
+        updateModeButtons(view.getUint8(37));
+        telemetryBurnRate = view.getUint16(38, true) / 100;
+    } else if (type === TELEMETRY_FRAME_LIVE && length >= 32) {
+        const fuel = view.getUint16(22, true);
+        if (fuel !== 0xFFFF && telemetryBurnRate !== null) {
+            applyFuel(fuel / 100, telemetryBurnRate);
+        }
+        const batteryMv = view.getUint16(24, true);
+        if (batteryMv !== 0xFFFF) {
+            applyBattery(batteryMv / 1000);
+        }
+    } else if (type === TELEMETRY_FRAME_DELTA && length >= 7) {
+        handleDeltaFrame(view, length);
+    } else if (type === TELEMETRY_FRAME_DIAGNOSTICS && length >= 70) {
+        applyDiagnostics(view);
+    }
+}
+
+// Stream, command queue, radio, loop and power profile counters
+function applyDiagnostics(view) {
+    const flags = view.getUint8(42);
+    const lines = [
+        `Stream: ${view.getUint8(4)} Hz, ${view.getUint16(6, true)} ms, ` +
+            `${view.getUint16(8, true)} B/s, ${view.getUint16(10, true)} backoffs`,
+        `Commands: ${view.getUint16(12, true)}, dropped ${view.getUint16(14, true)}`,
+        `Radio: advertised ${view.getUint32(16, true)} s, connected ${view.getUint32(20, true)} s ` +
+            `(idle ${view.getUint32(24, true)} s), off ${view.getUint32(28, true)} s, ` +
+            `${LINK_PROFILES[view.getUint8(5)] || '?'} link, ${view.getUint16(32, true)} updates`,
+        `Loop: idle ${view.getUint16(34, true)} ms/s, active ${view.getUint16(36, true)} ms/s, ` +
+            `${view.getUint16(38, true)} wakes/s, ${view.getUint16(40, true)} MHz` +
+            (flags & 0x01 ? ', scaling' : ', fixed clock'),
+        `Power: ${POWER_PROFILES[view.getUint8(43)] || '?'}${flags & 0x02 ? '' : ' (still)'}, ` +
+            `${view.getUint16(44, true)} switches`,
+    ];
+    POWER_PROFILES.forEach((name, i) => {
+        const offset = 46 + i * 8;
+        lines.push(`  ${name}: frame ${view.getUint16(offset, true)}/${view.getUint16(offset + 2, true)} ms, ` +
+                   `fix ${view.getUint16(offset + 4, true)}/${view.getUint16(offset + 6, true)} us`);
+    });
+    document.getElementById('diagnostics').textContent = lines.join('\n');
+}
+
+// Delta frame: sequence, field mask, absolute mask, then a zigzag varint per
+// field present - the value itself if absolute, otherwise the change. The
+// sequence counts every frame the device sent; after a gap the differences
+// no longer add up, so the values are dropped and the device is asked to
+// start again from absolute values.
+function handleDeltaFrame(view, length) {
+    const sequence = view.getUint8(4);
+    if (streamSequence !== null && sequence !== ((streamSequence + 1) & 0xFF)) {
+        streamValues = streamValues.map(() => null);
+        if (Date.now() - streamResyncAt > STREAM_RESYNC_MS) {
+            streamResyncAt = Date.now();
+            sendCommand(`STREAM:${LIVE_STREAM_HZ}`);
+        }
+    }
+    streamSequence = sequence;
+    const fields = view.getUint8(5);
+    const absolute = view.getUint8(6);
+    let offset = 7;
+    for (let i = 0; i < streamValues.length; i++) {
+        if (!(fields & (1 << i))) {
+            continue;
+        }
+        let raw = 0;
+        for (let shift = 0; offset < length; shift += 7) {
+            const byte = view.getUint8(offset++);
+            raw += (byte & 0x7F) * 2 ** shift;
+            if (!(byte & 0x80)) break;
+        }
+        const value = (raw >>> 1) ^ -(raw & 1);
+        if (absolute & (1 << i)) {
+            streamValues[i] = value;
+        } else if (streamValues[i] !== null) {
+            streamValues[i] = i < 2 ? (streamValues[i] + value) | 0 : streamValues[i] + value;
+        }
+    }
+    
+    const [lat, lon, altitude, speed, course, fuel, batteryMv] = streamValues;
+    if (lat !== null && lon !== null && (lat !== 0 || lon !== 0)) {
+        liveMarker.setLatLng([lat / 1e7, lon / 1e7]);
+        if (!mainMap.hasLayer(liveMarker)) {
+            liveMarker.addTo(mainMap);
+        }
+        const parts = [];
+        if (speed !== null && speed !== 0xFFFF) parts.push(`${(speed / 10).toFixed(0)} km/h`);
+        if (course !== null && course !== 0xFFFF) parts.push(`${(course / 100).toFixed(0)}\u00b0`);
+        if (altitude !== null && altitude !== -32768) parts.push(`${altitude} m`);
+        liveMarker.setTooltipContent(parts.join(', '));
+    }
+    if (fuel !== null && fuel !== 0xFFFF && telemetryBurnRate !== null) {
+        applyFuel(fuel / 100, telemetryBurnRate);
+    }
+    if (batteryMv !== null && batteryMv !== 0xFFFF) {
+        applyBattery(batteryMv / 1000);
+    }
+}
+
 // New function to update a single POI
 async function updateSinglePOI(poiNum) {
     if (!rxCharacteristic) {
@@ -521,6 +724,10 @@ async function updateFuel() {
     
     const fuelLevel = parseFloat(document.getElementById('newFuelLevel').value);
     const burnRate = parseFloat(document.getElementById('newBurnRate').value);
+    // Only a refuel with the litres poured in teaches the device's burn model;
+    // a level without them is taken as a correction
+    const addedInput = document.getElementById('newFuelAdded').value;
+    const litresAdded = parseFloat(addedInput);
     
     if (isNaN(fuelLevel) || fuelLevel < 0) {
         alert('Please enter a valid fuel level');
@@ -532,11 +739,20 @@ async function updateFuel() {
         return;
     }
     
-    const command = `FUEL:${fuelLevel}:${burnRate}`;
+    if (addedInput !== '' && (isNaN(litresAdded) || litresAdded < 0 || litresAdded > fuelLevel)) {
+        alert('Litres refuelled must be between 0 and the new fuel level');
+        return;
+    }
+    
+    let command = `FUEL:${fuelLevel.toFixed(2)}:${burnRate.toFixed(2)}`;
+    if (addedInput !== '') {
+        command += `:${litresAdded.toFixed(2)}`;
+    }
     const result = await sendCommand(command);
     
     if (result) {
         alert('Fuel settings updated successfully!');
+        document.getElementById('newFuelAdded').value = '';
         // Update current values with new values
         document.getElementById('currentFuelLevel').textContent = fuelLevel.toFixed(1);
         document.getElementById('currentBurnRate').textContent = burnRate.toFixed(1);
@@ -617,3 +833,170 @@ if (!navigator.bluetooth) {
     alert('Your browser does not support Web Bluetooth. Please use Chrome or Edge.');
     document.getElementById('connectButton').disabled = true;
 }
+
+// Bulk upload acknowledgement: op, status, request, next missing chunk, bitmap of the 32 after it
+function handleBulkAck(event) {
+    const view = event.target.value;
+    if (view.byteLength < 9 || !bulkAckWaiter) {
+        return;
+    }
+    const ack = {
+        status: view.getUint8(1),
+        request: view.getUint8(2),
+        next: view.getUint16(3, true),
+        received: view.getUint32(5, true)
+    };
+    const waiter = bulkAckWaiter;
+    bulkAckWaiter = null;
+    waiter(ack);
+}
+
+// Next acknowledgement, or only one answering request if given; null on timeout
+function waitForBulkAck(timeoutMs, request) {
+    return new Promise(resolve => {
+        const timer = setTimeout(() => {
+            bulkAckWaiter = null;
+            resolve(null);
+        }, timeoutMs);
+        const waiter = ack => {
+            if (request !== undefined && ack.request !== request) {
+                bulkAckWaiter = waiter; // Chunk acks still arriving
+                return;
+            }
+            clearTimeout(timer);
+            resolve(ack);
+        };
+        bulkAckWaiter = waiter;
+    });
+}
+
+// Mark what an acknowledgement says the device has stored
+function applyBulkAck(ack, stored) {
+    for (let i = 0; i < ack.next && i < stored.length; i++) {
+        stored[i] = true;
+    }
+    for (let i = 0; i < 32; i++) {
+        if (ack.received & (1 << i) && ack.next + i < stored.length) {
+            stored[ack.next + i] = true;
+        }
+    }
+}
+
+function crc32(bytes) {
+    let crc = 0xFFFFFFFF;
+    for (const byte of bytes) {
+        crc ^= byte;
+        for (let k = 0; k < 8; k++) {
+            crc = (crc >>> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return (crc ^ 0xFFFFFFFF) >>> 0;
+}
+
+// Send a waypoints.bin built by tools/waypoint_db.py; the device switches to it only once all of it arrived intact
+async function uploadWaypoints() {
+    const status = document.getElementById('uploadWaypointsStatus');
+    const file = document.getElementById('waypointsFile').files[0];
+    if (!bulkCharacteristic) {
+        status.textContent = 'Not connected, or the firmware has no bulk upload';
+        return;
+    }
+    if (!file) {
+        status.textContent = 'Choose a waypoints.bin first';
+        return;
+    }
+    
+    const image = new Uint8Array(await file.arrayBuffer());
+    const crc = crc32(image);
+    const started = performance.now();
+    for (const chunkSize of BULK_CHUNK_SIZES) {
+        try {
+            if (await sendBulkImage(image, crc, chunkSize, status)) {
+                const seconds = (performance.now() - started) / 1000;
+                status.textContent = `Uploaded ${image.length} bytes in ${seconds.toFixed(1)} s`;
+                return;
+            }
+            break; // Refused by the device, a smaller chunk won't help
+        } catch (error) {
+            console.log(`Chunks of ${chunkSize} bytes failed (${error.message}), trying smaller`);
+            await bulkCharacteristic.writeValueWithResponse(new Uint8Array([BULK_OP_ABORT])).catch(() => {});
+        }
+    }
+    status.textContent = 'Upload failed';
+}
+
+async function sendBulkImage(image, crc, chunkSize, status) {
+    const count = Math.ceil(image.length / chunkSize);
+    const begin = new DataView(new ArrayBuffer(12));
+    begin.setUint8(0, BULK_OP_BEGIN);
+    begin.setUint8(1, BULK_TARGET_WAYPOINTS);
+    begin.setUint32(2, image.length, true);
+    begin.setUint32(6, crc, true);
+    begin.setUint16(10, chunkSize, true);
+    const ackPromise = waitForBulkAck(5000, BULK_OP_BEGIN); // Erasing the first sector takes a moment
+    await bulkCharacteristic.writeValueWithResponse(begin.buffer);
+    const beginAck = await ackPromise;
+    if (!beginAck || beginAck.status !== BULK_STATUS_OK) {
+        console.error('Upload refused', beginAck);
+        return false;
+    }
+    
+    const stored = new Array(count).fill(false);
+    const sentAt = new Array(count).fill(0);
+    const sendChunk = async sequence => {
+        const offset = sequence * chunkSize;
+        const data = image.subarray(offset, Math.min(offset + chunkSize, image.length));
+        const packet = new Uint8Array(3 + data.length);
+        packet[0] = BULK_OP_CHUNK;
+        packet[1] = sequence & 0xFF;
+        packet[2] = sequence >> 8;
+        packet.set(data, 3);
+        await bulkCharacteristic.writeValueWithoutResponse(packet);
+    };
+    
+    let base = 0;
+    let attempts = 0;
+    while (attempts < 20) {
+        // Everything missing inside the window, then wait for the device to say what it has
+        while (base < count && stored[base]) base++;
+        if (base === count) {
+            const ackPromise = waitForBulkAck(BULK_ACK_TIMEOUT_MS * 5, BULK_OP_END); // CRC check reads the image back
+            await bulkCharacteristic.writeValueWithResponse(new Uint8Array([BULK_OP_END]));
+            const ack = await ackPromise;
+            if (ack && ack.status === BULK_STATUS_OK) {
+                return true;
+            }
+            if (!ack || ack.status !== BULK_STATUS_INCOMPLETE) {
+                console.error('Upload not committed', ack);
+                return false;
+            }
+            stored.fill(false, ack.next);
+            applyBulkAck(ack, stored);
+            continue;
+        }
+        
+        // Send what is new, overdue, or missing below a chunk the device already has
+        const highestStored = stored.lastIndexOf(true, Math.min(base + 32, count - 1));
+        const ackPromise = waitForBulkAck(BULK_ACK_TIMEOUT_MS);
+        for (let sequence = base; sequence < Math.min(base + BULK_WINDOW, count); sequence++) {
+            const now = performance.now();
+            if (!stored[sequence] && (now - sentAt[sequence] > BULK_ACK_TIMEOUT_MS || sequence < highestStored)) {
+                sentAt[sequence] = now;
+                await sendChunk(sequence);
+            }
+        }
+        const ack = await ackPromise;
+        if (!ack) {
+            attempts++; // Nothing heard, send the window again
+            continue;
+        }
+        if (ack.status !== BULK_STATUS_OK) {
+            console.error('Upload stopped', ack);
+            return false;
+        }
+        attempts = 0;
+        applyBulkAck(ack, stored);
+        status.textContent = `Uploading... ${Math.round(100 * ack.next / count)}%`;
+    }
+    return false;
+}